@@ -0,0 +1,4 @@
+$(call emb_need_var,LIB_EMBEDULAR_ROOT)
+
+# The key-value store is disabled by default
+LIB_EMBEDULAR_CONFIG += STORAGE_KV_INDEX_ENTRIES=64U
@@ -0,0 +1,64 @@
+#include "embedul.ar/source/core/main.h"
+#include "embedul.ar/source/core/manager/storage/kv.h"
+
+
+// Persistent linear volume sectors taken by the store, from the beginning of
+// the volume.
+#ifndef KV_SECTORS
+#define KV_SECTORS      32
+#endif
+
+#define KV_RETRIES      3
+
+
+void EMBEDULAR_Main (void *param)
+{
+    (void) param;
+
+#if STORAGE_KV_INDEX_ENTRIES
+    if (!STORAGE_ValidVolume (STORAGE_Role_LinearPersistent))
+    {
+        LOG_Warn (NOBJ, "persistent linear volume not registered");
+        return;
+    }
+
+    if (STORAGE_KV_Mount (0, KV_SECTORS, KV_RETRIES) != STORAGE_KV_Result_Ok)
+    {
+        return;
+    }
+
+    uint32_t boots = 0;
+    uint32_t octets = 0;
+
+    const enum STORAGE_KV_Result R =
+                STORAGE_KV_Get ("boots", &boots, sizeof(boots), &octets);
+
+    if (R != STORAGE_KV_Result_Ok && R != STORAGE_KV_Result_NotFound)
+    {
+        LOG_Warn (NOBJ, "could not read the boot count: `0", (uint32_t)R);
+        return;
+    }
+
+    ++ boots;
+
+    // Set only queues the record in RAM; commit it now instead of waiting
+    // for BOARD_Sync() to do it after the commit and write-back timeouts.
+    if (STORAGE_KV_Set ("boots", &boots, sizeof(boots))
+                                                    != STORAGE_KV_Result_Ok ||
+        STORAGE_KV_Commit () != STORAGE_KV_Result_Ok)
+    {
+        LOG_Warn (NOBJ, "could not store the boot count");
+        return;
+    }
+
+    const struct STORAGE_KV_Stats Stats = STORAGE_KV_Stats ();
+
+    LOG (NOBJ, "boot number `0", boots);
+    LOG_Items (3,
+            "keys",             Stats.keys,
+            "used sectors",     Stats.usedSectors,
+            "sector writes",    Stats.sectorWrites);
+#else
+    LOG_Warn (NOBJ, "key-value store disabled");
+#endif
+}
@@ -0,0 +1,226 @@
+#include "embedul.ar/source/core/main.h"
+
+
+// Linear volume under test. The linear cache is rebuilt from the filesystem
+// on the next boot when its contents are no longer valid.
+#ifndef BENCH_ROLE
+#define BENCH_ROLE              STORAGE_Role_LinearCache
+#endif
+
+// Write tests overwrite the region under test. Build with -DBENCH_WRITES=1
+// only on a volume whose contents can be lost.
+#ifndef BENCH_WRITES
+#define BENCH_WRITES            0
+#endif
+
+// Volume sectors accessed, from the beginning of the volume.
+#ifndef BENCH_REGION_SECTORS
+#define BENCH_REGION_SECTORS    4096
+#endif
+
+// Data transferred by each test.
+#ifndef BENCH_TEST_OCTETS
+#define BENCH_TEST_OCTETS       (1024 * 1024)
+#endif
+
+#define BENCH_MAX_REQUESTS      2048
+#define BENCH_MAX_SECTORS       64
+#define BENCH_RETRIES           1
+
+
+enum Pattern
+{
+    Pattern_Sequential,
+    Pattern_Random
+};
+
+
+struct Result
+{
+    uint32_t    requests;
+    uint32_t    errors;
+    uint32_t    elapsedMs;
+    uint32_t    cacheHits;
+    uint32_t    p50;
+    uint32_t    p90;
+    uint32_t    p99;
+    uint32_t    max;
+};
+
+
+static const uint32_t RequestSectors[] = { 1, 4, 16, BENCH_MAX_SECTORS };
+
+static uint8_t      s_data[BENCH_MAX_SECTORS * 512];
+static uint16_t     s_latency[BENCH_MAX_REQUESTS];
+
+
+static void sortLatencies (const uint32_t Count)
+{
+    for (uint32_t i = 1; i < Count; ++i)
+    {
+        const uint16_t L = s_latency[i];
+        uint32_t j = i;
+
+        for (; j && s_latency[j - 1] > L; --j)
+        {
+            s_latency[j] = s_latency[j - 1];
+        }
+
+        s_latency[j] = L;
+    }
+}
+
+
+static uint32_t percentile (const uint32_t Count, const uint32_t P)
+{
+    return s_latency[(Count - 1) * P / 100];
+}
+
+
+static struct Result runTest (const enum Pattern Pattern, const bool Write,
+                              const uint32_t Sectors,
+                              const uint32_t RegionSectors)
+{
+    struct Result r = { 0 };
+
+    r.requests = BENCH_TEST_OCTETS / (Sectors * 512);
+
+    if (r.requests > BENCH_MAX_REQUESTS)
+    {
+        r.requests = BENCH_MAX_REQUESTS;
+    }
+
+    const uint32_t Slots = RegionSectors / Sectors;
+    const uint32_t CacheHits = STORAGE_ReadCacheStats().hits;
+    const TIMER_Ticks Begin = TICKS_Now ();
+
+    for (uint32_t i = 0; i < r.requests; ++i)
+    {
+        const uint32_t Slot = (Pattern == Pattern_Sequential)? i % Slots :
+                                RANDOM_GetUint32InRange (0, Slots - 1);
+        const uint32_t Sector = Slot * Sectors;
+
+        if (Write)
+        {
+            s_data[0] = (uint8_t) i;
+        }
+
+        const TIMER_Ticks RequestBegin = TICKS_Now ();
+
+        const RAWSTOR_Status_Result Res = Write?
+            STORAGE_LinearWrite (BENCH_ROLE, s_data, Sector, Sectors,
+                                 BENCH_RETRIES) :
+            STORAGE_LinearRead (BENCH_ROLE, s_data, Sector, Sectors,
+                                BENCH_RETRIES);
+
+        const TIMER_Ticks Latency = TICKS_Now () - RequestBegin;
+
+        s_latency[i] = (Latency > UINT16_MAX)? UINT16_MAX : (uint16_t)Latency;
+
+        if (Res != RAWSTOR_Status_Result_Ok)
+        {
+            ++ r.errors;
+        }
+    }
+
+    // Written data must reach the media
+    if (Write && STORAGE_Sync (BENCH_RETRIES) != RAWSTOR_Status_Result_Ok)
+    {
+        ++ r.errors;
+    }
+
+    r.elapsedMs = (uint32_t)(TICKS_Now () - Begin);
+    r.cacheHits = STORAGE_ReadCacheStats().hits - CacheHits;
+
+    sortLatencies (r.requests);
+
+    r.p50 = percentile (r.requests, 50);
+    r.p90 = percentile (r.requests, 90);
+    r.p99 = percentile (r.requests, 99);
+    r.max = s_latency[r.requests - 1];
+
+    return r;
+}
+
+
+static void report (const enum Pattern Pattern, const bool Write,
+                    const uint32_t Sectors, const struct Result *const R)
+{
+    const char *const PatternStr = (Pattern == Pattern_Sequential)? "seq" :
+                                                                    "rand";
+    const char *const OpStr = Write? "write" : "read";
+    const uint32_t ElapsedMs = R->elapsedMs? R->elapsedMs : 1;
+    const uint64_t Octets = (uint64_t)R->requests * Sectors * 512;
+
+    const uint32_t Iops     = (uint32_t)((uint64_t)R->requests * 1000 /
+                                                                ElapsedMs);
+    const uint32_t KiBps    = (uint32_t)(Octets * 1000 / 1024 / ElapsedMs);
+    const uint32_t MeanUs   = (uint32_t)((uint64_t)R->elapsedMs * 1000 /
+                                                                R->requests);
+
+    LOG (NOBJ, "`0 `1, `2 sectors: `3 iops, `4 KiB/s, mean `5 us, "
+               "p50/p90/p99/max `6/`7/`8/`9 ms, `10 errors",
+               PatternStr, OpStr, Sectors, Iops, KiBps, MeanUs,
+               R->p50, R->p90, R->p99, R->max, R->errors);
+
+    // Machine-readable, one line per test. Same fields as in the header.
+    LOG_Plain ("bench,`0,`1,`2,`3,`4,`5,`6,`7,`8,`9,`10,`11,`12,`13",
+               PatternStr, OpStr, Sectors, R->requests, R->elapsedMs, Iops,
+               KiBps, MeanUs, R->p50, R->p90, R->p99, R->max, R->errors,
+               R->cacheHits);
+}
+
+
+void EMBEDULAR_Main (void *param)
+{
+    (void) param;
+
+    if (!STORAGE_ValidVolume (BENCH_ROLE))
+    {
+        LOG_Warn (NOBJ, "linear volume `0 not registered", BENCH_ROLE);
+        return;
+    }
+
+    const struct STORAGE_VolumeInfo Info = STORAGE_VolumeInfo (BENCH_ROLE);
+    // sectorEnd is inclusive
+    const uint32_t VolumeSectors = Info.sectorEnd - Info.sectorBegin + 1;
+    const uint32_t RegionSectors = (VolumeSectors < BENCH_REGION_SECTORS)?
+                                    VolumeSectors : BENCH_REGION_SECTORS;
+
+    if (RegionSectors < BENCH_MAX_SECTORS)
+    {
+        LOG_Warn (NOBJ, "linear volume `0 too small", BENCH_ROLE);
+        return;
+    }
+
+    LOG_ContextBegin (NOBJ, "storage benchmark");
+    LOG_Items (4,
+            "role",             (uint32_t)BENCH_ROLE,
+            "partition",        Info.partitionNr,
+            "volume sectors",   VolumeSectors,
+            "region sectors",   RegionSectors);
+
+    // Latencies have TICKS resolution; mean is computed from total time.
+    LOG_Plain ("bench,pattern,op,sectors,requests,elapsed_ms,iops,kib_s,"
+               "mean_us,p50_ms,p90_ms,p99_ms,max_ms,errors,cache_hits");
+
+    for (uint32_t i = 0; i < 2 + BENCH_WRITES * 2; ++i)
+    {
+        const enum Pattern Pattern = (i & 1)? Pattern_Random :
+                                              Pattern_Sequential;
+        const bool Write = (i >= 2);
+
+        for (uint32_t s = 0; s < sizeof(RequestSectors) / sizeof(uint32_t);
+             ++s)
+        {
+            const struct Result R = runTest (Pattern, Write,
+                                             RequestSectors[s], RegionSectors);
+
+            report (Pattern, Write, RequestSectors[s], &R);
+
+            BOARD_Sync ();
+        }
+    }
+
+    LOG_ContextEnd ();
+}
@@ -56,6 +56,7 @@ EXE_LISTING := $(BUILD_ROOT)/$(APP_NAME).lst
 EXE_MAP := $(BUILD_ROOT)/$(APP_NAME).map
 FRAMA_C_PARSE := $(BUILD_ROOT)/$(APP_NAME).parse
 FRAMA_C_EVA := $(BUILD_ROOT)/$(APP_NAME).eva
+CACHE_IMAGE_TOOL := $(BUILD_ROOT)/tools/cache_image
 
 ifneq (yes,$(VERBOSE))
     VN := @
@@ -149,10 +150,43 @@ clean:
 	$(call remove,$(HEX_IMAGE))
 	$(call remove,$(EXE_LISTING))
 	$(call remove,$(EXE_MAP))
+	$(call remove,$(CACHE_IMAGE_TOOL))
 
 run:
 	$(call execute,$(EXECUTABLE))
 
+# Host tool that writes filesystem slots on the FAT32 partition of a disk
+# image to its linear cache partition, as the first boot would. Built with the
+# same version strings and STORAGE_CACHE configuration as the application.
+ifdef LIB_EMBEDULAR_STORAGE_CACHE_FS_FRAMEWORK_DIR
+HOST_CC ?= gcc
+CACHE_IMAGE_DISK ?= disk.bin
+
+CACHE_IMAGE_SOURCES := $(LIB_EMBEDULAR_ROOT)/tools/cache_image.c $\
+    $(LIB_EMBEDULAR_ROOT)/source/core/misc/crc32c.c $\
+    $(LIB_EMBEDULAR_ROOT)/source/core/misc/rle.c $\
+    $(LIB_EMBEDULAR_ROOT)/source/3rd_party/fatfs-0.14b/ff.c
+
+CACHE_IMAGE_CFLAGS := -std=c17 -O2 -Wall -Wextra $\
+    -I$(LIB_EMBEDULAR_BASE) $\
+    -I$(LIB_EMBEDULAR_ROOT)/source/3rd_party/fatfs-0.14b $\
+    -I$(LIB_EMBEDULAR_ROOT)/source/core/fatfs $\
+    -D'CC_VcsFwkVersionStr="$(BUILD_VCS_Fwk_VERSION)"' $\
+    -D'CC_VcsAppVersionStr="$(BUILD_VCS_App_VERSION)"' $\
+    -D'CC_AppNameStr="$(APP_NAME)"' $\
+    $(filter -D'LIB_EMBEDULAR_CONFIG_STORAGE_CACHE_%,$(CFLAGS)) $\
+    $(filter -D'LIB_EMBEDULAR_STORAGE_CACHE_FS_%,$(CFLAGS))
+
+cache-image:
+	$(VN)mkdir -p $(dir $(CACHE_IMAGE_TOOL))
+	$(if $(VN), $(info $(emb_term_blue)[HOSTCC]$(emb_term_sgr0) $(CACHE_IMAGE_TOOL)))
+	$(VN)$(HOST_CC) $(CACHE_IMAGE_CFLAGS) $(CACHE_IMAGE_SOURCES) -o $(CACHE_IMAGE_TOOL)
+	$(call execute,$(CACHE_IMAGE_TOOL) $(CACHE_IMAGE_DISK))
+else
+cache-image:
+	$(error $(emb_term_red)cache-image requires filesystem support$(emb_term_sgr0))
+endif
+
 frama-c-parse: $(OBJS)
 frama-c-parse: $(APP_OBJS)
 	$(call tool,Frama-C: Parsing sources,eval $$(opam env) && frama-c -machdep="gcc_x86_64" -cpp-extra-args="-I/usr/include/x86_64-linux-gnu -DSDL_FALLTHROUGH -DSDL_DISABLE_IMMINTRIN_H -DSDL_DISABLE_MMINTRIN_H -DSDL_DISABLE_XMMINTRIN_H -DSDL_DISABLE_EMMINTRIN_H -DSDL_DISABLE_PMMINTRIN_H" -json-compilation-database="./compile_commands.json" $(SOURCES_C_EMBEDULAR) $(SOURCES_C_APP) -save $(FRAMA_C_PARSE))
@@ -169,4 +203,4 @@ frama-c: frama-c-gui
 $(call emb_info,Flash tool '$(FLASH_TOOL)')
 $(call emb_include,flash/$(FLASH_TOOL).mk)
 
-.PHONY: clean
+.PHONY: clean cache-image
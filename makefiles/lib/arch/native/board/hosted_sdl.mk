@@ -46,10 +46,14 @@ FLASH_TOOL ?= no
 # System code
 OBJS += \
     $(LIB_EMBEDULAR_ROOT)/source/drivers/random_sfmt.o \
+    $(LIB_EMBEDULAR_ROOT)/source/drivers/rawstor_ram.o \
+    $(LIB_EMBEDULAR_ROOT)/source/drivers/rawstor_sd_1bit.o \
+    $(LIB_EMBEDULAR_ROOT)/source/drivers/stream_sd_spi_sim.o \
     $(TARGET_MFR)/boot/board_hosted.o \
     $(TARGET_DRIVERS)/video_rgb332.o \
     $(TARGET_DRIVERS)/video_rgb332_adapter_sim.o \
     $(TARGET_DRIVERS)/video_rgb332_vgafb.o \
+    $(TARGET_DRIVERS)/video_headless.o \
     $(TARGET_DRIVERS)/sound_sdlmixer.o \
     $(TARGET_DRIVERS)/io_keyboard.o \
     $(TARGET_DRIVERS)/io_gui.o \
@@ -66,6 +70,17 @@ endif
 
 LIB_EMBEDULAR_SUBSYSTEMS += $(TARGET_SUBSYSTEMS)
 
+# Library defaults for a target with plenty of RAM and time to spare
+LIB_EMBEDULAR_BOARD_CONFIG += \
+    STORAGE_CACHE_COMPRESSION=1 \
+    STORAGE_CACHE_INCREMENTAL=1 \
+    STORAGE_CACHE_BACKGROUND_VERIFY=2U \
+    STORAGE_READ_CACHE_BLOCKS=4U \
+    STORAGE_READ_AHEAD_SECTORS=4U \
+    STORAGE_WRITE_BACK_SECTORS=8U \
+    VIDEO_PACING_FRAMES=120U \
+    SCREEN_FONT_GLYPH_PAGES=16U
+
 # Include required libraries
 $(call emb_include,lib/embedul.ar.mk)
 $(call emb_include,lib/arch/native/sdl.mk)
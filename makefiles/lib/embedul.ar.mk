@@ -48,6 +48,69 @@ $(call emb_need_var,LIB_EMBEDULAR_ROOT)
 #                         BOARD_Sync() from an application task at will.
 #                         This setting has no effect when not using a
 #                         multitasking OS.
+# VIDEO_DIRTY_BANDS     : horizontal bands of scanlines in which video devices
+#                         track changed framebuffer regions, one span of
+#                         columns per band. Drivers copy and present only
+#                         changed spans.
+# VIDEO_PACING_FRAMES   : frames kept by video devices to build rolling frame
+#                         time histograms and percentiles. Costs ten octets
+#                         of RAM per frame plus 660 octets of histograms and
+#                         sums, per video device; about 1.9 KB for 120 frames.
+#                         Use zero (0) to disable it.
+# SCREEN_FONT_GLYPH_PAGES: pages of 64 code points in the glyph lookup table
+#                         built on font init, taken in code point order.
+#                         Costs a 1024 octet page index plus 64 glyph pointers
+#                         per page, per font: about 5 KB for 16 pages on 32 bit
+#                         targets, 9 KB on 64 bit ones. Building it looks up
+#                         all 65536 code points. Call
+#                         SCREEN_FONT_RebuildGlyphTable() after changing the
+#                         glyphs of a font. Use zero (0) to look up glyphs by
+#                         Unicode block.
+# RAWSTOR_QUEUE_DEPTH   : asynchronous requests accepted by each raw storage
+#                         device, queued or being transferred. Adjacent
+#                         requests are merged in a single transfer.
+# STORAGE_CACHE_INDEX_ELEMENTS: number of cached elements kept in the RAM index
+#                         built while checking the linear cache at boot. Indexed
+#                         elements are looked up without accessing storage.
+# STORAGE_CACHE_COMPRESSION: enables(1) or disables(0) run-length compression of
+#                         elements copied from filesystem slots to the linear
+#                         cache. Elements are stored uncompressed when that
+#                         does not save at least one sector.
+# STORAGE_CACHE_INCREMENTAL: enables(1) or disables(0) trusting the cache
+#                         manifest at boot. Elements whose source file date,
+#                         time and size did not change are indexed without
+#                         reading their info sector nor checking their data.
+# STORAGE_CACHE_BACKGROUND_VERIFY: milliseconds spent on each BOARD_Sync(), at
+#                         least one sector, verifying indexed element data once
+#                         the board is ready. Elements not yet verified are
+#                         verified on demand when accessed. Elements matching
+#                         the manifest are not verified. 0 verifies all element
+#                         data before the board is ready.
+# STORAGE_READ_CACHE_BLOCKS: linear volume read cache blocks, replaced in least
+#                         recently used order. 0 disables the read cache.
+# STORAGE_READ_AHEAD_SECTORS: sectors per read cache block. Sequential reads
+#                         fetch a whole block in a single multi-sector
+#                         request. Uses STORAGE_READ_CACHE_BLOCKS *
+#                         STORAGE_READ_AHEAD_SECTORS * 512 octets of RAM.
+#                         Must not be 0 when the read cache is enabled.
+# STORAGE_WRITE_BACK_SECTORS: persistent linear volume sectors kept in RAM
+#                         until flushed. Consecutive dirty sectors are written
+#                         in a single multi-sector request. A full buffer is
+#                         flushed before taking new sectors. Uses 516 octets
+#                         of RAM per sector. 0 writes through.
+# STORAGE_WRITE_BACK_TIMEOUT: milliseconds a dirty sector may wait before
+#                         BOARD_Sync() flushes all dirty sectors.
+# STORAGE_KV_INDEX_ENTRIES: keys held by the RAM index of the key-value store on
+#                         the persistent linear volume, including deleted keys
+#                         not yet compacted. Must be a power of two. Uses 16
+#                         octets of RAM per entry. 0 disables the store.
+# STORAGE_KV_COMMIT_TIMEOUT: milliseconds a key-value record may wait in RAM
+#                         before BOARD_Sync() appends it to the log, plus
+#                         STORAGE_WRITE_BACK_TIMEOUT before it reaches the
+#                         media. STORAGE_KV_Commit() stores records right away.
+#
+# Board makefiles may set LIB_EMBEDULAR_BOARD_CONFIG to replace defaults that do
+# not fit every target. Application config still takes precedence.
 # ------------------------------------------------------------------------------
 
 $(call emb_declare_lib,$\
@@ -66,8 +129,24 @@ $(call emb_declare_lib,$\
 	INPUT_MAX_LIGHTING_DEVICES=2U \
 	OUTPUT_MAX_GATEWAYS=10U \
 	OUTPUT_MAX_LIGHT_CHANNELS=48U \
+	VIDEO_DIRTY_BANDS=32U \
+	VIDEO_PACING_FRAMES=0U \
+	SCREEN_FONT_GLYPH_PAGES=0U \
+	RAWSTOR_QUEUE_DEPTH=8U \
+	STORAGE_CACHE_INDEX_ELEMENTS=32U \
+	STORAGE_CACHE_COMPRESSION=0 \
+	STORAGE_CACHE_INCREMENTAL=0 \
+	STORAGE_CACHE_BACKGROUND_VERIFY=0U \
+	STORAGE_READ_CACHE_BLOCKS=0U \
+	STORAGE_READ_AHEAD_SECTORS=0U \
+	STORAGE_WRITE_BACK_SECTORS=0U \
+	STORAGE_WRITE_BACK_TIMEOUT=1000U \
+	STORAGE_KV_INDEX_ENTRIES=0U \
+	STORAGE_KV_COMMIT_TIMEOUT=500U \
 	)
 
+$(call emb_board_lib_config,LIB_EMBEDULAR,$(LIB_EMBEDULAR_BOARD_CONFIG))
+
 
 # Miscelaneous system files
 OBJS += $(LIB_EMBEDULAR)/device/board.o \
@@ -83,6 +162,7 @@ OBJS += $(LIB_EMBEDULAR)/device/board.o \
 	    $(LIB_EMBEDULAR)/manager/mio.o \
         $(LIB_EMBEDULAR)/manager/storage.o \
         $(LIB_EMBEDULAR)/manager/storage/cache.o \
+        $(LIB_EMBEDULAR)/manager/storage/kv.o \
         $(LIB_EMBEDULAR)/manager/comm.o \
         $(LIB_EMBEDULAR)/manager/screen.o \
         $(LIB_EMBEDULAR)/misc/input/action.o \
@@ -90,7 +170,9 @@ OBJS += $(LIB_EMBEDULAR)/device/board.o \
         $(LIB_EMBEDULAR)/misc/output/profile.o \
         $(LIB_EMBEDULAR)/misc/hsl.o \
         $(LIB_EMBEDULAR)/misc/rgb332.o \
-        $(LIB_EMBEDULAR)/misc/collide.o
+        $(LIB_EMBEDULAR)/misc/collide.o \
+        $(LIB_EMBEDULAR)/misc/crc32c.o \
+        $(LIB_EMBEDULAR)/misc/rle.o
 
 
 # Remove optional subsystem duplicates
@@ -120,8 +202,11 @@ ifneq ($(filter video,$(LIB_EMBEDULAR_SUBSYSTEMS)),)
     # Required core modules
     LIB_EMBEDULAR_CORE += anim
     OBJS += $(LIB_EMBEDULAR)/device/video.o \
+            $(LIB_EMBEDULAR)/device/video/pacing.o \
+            $(LIB_EMBEDULAR)/manager/screen/dlist.o \
             $(LIB_EMBEDULAR)/manager/screen/dotmap.o \
             $(LIB_EMBEDULAR)/manager/screen/font.o \
+            $(LIB_EMBEDULAR)/manager/screen/font_run.o \
             $(LIB_EMBEDULAR)/manager/screen/font_std.o \
             $(LIB_EMBEDULAR)/manager/screen/tile.o \
             $(LIB_EMBEDULAR)/manager/screen/tilemap.o \
@@ -129,7 +214,8 @@ ifneq ($(filter video,$(LIB_EMBEDULAR_SUBSYSTEMS)),)
             $(LIB_EMBEDULAR)/manager/screen/line.o \
             $(LIB_EMBEDULAR)/manager/screen/rect.o \
             $(LIB_EMBEDULAR)/manager/screen/sprite.o \
-            $(LIB_EMBEDULAR)/manager/screen/fade.o
+            $(LIB_EMBEDULAR)/manager/screen/fade.o \
+            $(LIB_EMBEDULAR)/manager/screen/pacing.o
 else
     $(call emb_warning,No video subsystem. Splash screens disabled)
     LIB_EMBEDULAR_CONFIG_SPLASH_SCREENS := 0
@@ -154,6 +154,22 @@ define emb_declare_lib
 	$(eval emb_declared_libs += $(2))
 endef
 
+# $(1): library variable name.
+# $(2): board config params, replacing defaults the user did not set.
+define emb_board_lib_config
+    $(eval $(foreach var,$(2),$(call emb_board_lib_param,$(1),$\
+        $(subst =,$(emb_space),$(var)))))
+endef
+
+# $(1): library variable name.
+# $(2): config option and value, space separated.
+define emb_board_lib_param
+	$(if $(filter $(word 1,$(2)),$($(1)_DEFAULT_CONFIG)),,$(call emb_error,$\
+        Invalid board config param '$(word 1,$(2))'))
+	$(if $(filter $(word 1,$(2)),$($(1)_USER_CONFIG)),,$\
+        $(eval $(1)_CONFIG_$(word 1,$(2)) := $(word 2,$(2))))
+endef
+
 # $(1): enum: one|two|three|four.
 # $(2): splitted list name.
 define emb_split_enum_to_list
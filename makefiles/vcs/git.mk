@@ -33,6 +33,7 @@ BUILD_VCS_TAG_CMD := describe --tags --always
 # $(2) Variable Code
 define vcs_get_failed =
     $(call emb_info,$(1) does not use GIT)
+	$(eval BUILD_VCS_$(2)_VERSION := No GIT)
 	$(eval CFLAGS += -D'CC_Vcs$(2)VersionStr="No GIT"')
 endef
 
@@ -40,6 +41,7 @@ endef
 # $(2) Variable Code
 define vcs_get_ok =
 	$(eval BUILD_VCS_VERSION := $(BUILD_VCS_BRANCH)/$(BUILD_VCS_TAG))
+	$(eval BUILD_VCS_$(2)_VERSION := $(BUILD_VCS_VERSION))
     $(call emb_info,$(1) version: '$(BUILD_VCS_VERSION)')
     $(eval CFLAGS += -D'CC_Vcs$(2)VersionStr=CC_Str($(BUILD_VCS_VERSION))')
 endef
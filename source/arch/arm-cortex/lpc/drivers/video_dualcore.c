@@ -299,8 +299,13 @@ static uint32_t * loadFromCache (struct VIDEO *const V,
             }
 
             // Load firmware directly to SRAM
-            if (STORAGE_CACHE_ElementData(&info, 0, 0,
-                                    (uint8_t *)__start_core_m0app_Ram, 1)
+            struct STORAGE_CACHE_Stream stream;
+
+            STORAGE_CACHE_StreamInit (&stream, &info);
+
+            if (STORAGE_CACHE_StreamRead(&stream,
+                                    (uint8_t *)__start_core_m0app_Ram,
+                                    info.octets, 1)
                 != RAWSTOR_Status_Result_Ok)
             {
                 return NULL;
@@ -29,13 +29,59 @@
 #include "embedul.ar/source/arch/native/sdl/drivers/io_gui.h"
 #include "embedul.ar/source/arch/native/sdl/drivers/video_rgb332_adapter_sim.h"
 #include "embedul.ar/source/arch/native/sdl/drivers/video_rgb332_vgafb.h"
+#include "embedul.ar/source/arch/native/sdl/drivers/video_headless.h"
 #include "embedul.ar/source/arch/native/sdl/drivers/sound_sdlmixer.h"
 #include "embedul.ar/source/arch/native/sdl/drivers/stream_file.h"
 #include "embedul.ar/source/arch/native/sdl/drivers/rawstor_file.h"
+#include "embedul.ar/source/drivers/rawstor_ram.h"
+#include "embedul.ar/source/drivers/stream_sd_spi_sim.h"
+#include "embedul.ar/source/drivers/rawstor_sd_1bit.h"
+#include <stdio.h>
+#include <stdlib.h>
 
 
 #define DEBUG_STREAM_FILE       "stderr"
 #define DISK_FILENAME           "disk.bin"
+// Build with -DDISK_BACKEND=RAWSTOR_FILE_Backend_Mmap for faster image access
+#ifndef DISK_BACKEND
+#define DISK_BACKEND            RAWSTOR_FILE_Backend_Pio
+#endif
+// Build with -DDISK_RAM_TIMING=RAWSTOR_RAM_TIMING_SD_SPI to load the image in
+// a RAM disk with SD card timing. Changes are not saved.
+// Build with -DDISK_SD_SPI_SIM=STREAM_SD_SPI_SIM_Card_SdV2BlockAddressing to
+// access the RAM disk through the 1-bit SD card driver and a simulated card.
+#if defined(DISK_SD_SPI_SIM) && !defined(DISK_RAM_TIMING)
+#define DISK_RAM_TIMING         { 0 }
+#endif
+// Build with -DHEADLESS to render in memory, with no windows and no
+// display server. Frames run unthrottled unless HEADLESS_VBI_PERIOD
+// sets a virtual VBI period in ticks (16 for ~60 Hz). Presented frames are
+// saved as HEADLESS_CAPTURE (for example, VIDEO_HEADLESS_Capture_Png)
+// named after HEADLESS_CAPTURE_PREFIX. HEADLESS_MAILBOX adds a third primary
+// framebuffer so rendering never waits for the virtual VBI; see
+// VIDEO_SetTripleBuffer(). HEADLESS_FRAMES ends the run through the board
+// shutdown sequence once that many primary frames were presented; zero runs
+// until SIGINT or SIGTERM. Sound is disabled.
+#ifdef HEADLESS
+#ifndef HEADLESS_VBI_PERIOD
+#define HEADLESS_VBI_PERIOD     0
+#endif
+#ifndef HEADLESS_CAPTURE
+#define HEADLESS_CAPTURE        VIDEO_HEADLESS_Capture_None
+#endif
+#ifndef HEADLESS_CAPTURE_PREFIX
+#define HEADLESS_CAPTURE_PREFIX ""
+#endif
+#ifndef HEADLESS_CAPTURE_FIRST
+#define HEADLESS_CAPTURE_FIRST  0
+#endif
+#ifndef HEADLESS_CAPTURE_COUNT
+#define HEADLESS_CAPTURE_COUNT  0
+#endif
+#ifndef HEADLESS_FRAMES
+#define HEADLESS_FRAMES         0
+#endif
+#endif
 
 #define BOARD_LOGO_1            "`F25.d88888b  888888ba  8b`L"
 #define BOARD_LOGO_2            "`F2588.`P4\"' 88`P4``8b 88`L"
@@ -69,14 +115,32 @@ struct BOARD_HOSTED
 {
     struct BOARD                    device;
     struct RANDOM_SFMT              randomSfmt;
+#ifdef HEADLESS
+    struct VIDEO_HEADLESS           videoHeadlessPrimary;
+    struct VIDEO_HEADLESS           videoHeadlessMenu;
+#ifdef HEADLESS_MAILBOX
+    uint8_t                         headlessPrimaryFb[3][256 * 144];
+#else
+    uint8_t                         headlessPrimaryFb[2][256 * 144];
+#endif
+    uint8_t                         headlessMenuFb[640 * 480];
+#else
     struct VIDEO_RGB332_ADAPTER_SIM videoAdapterSim;
     struct VIDEO_RGB332_VGAFB       videoVgafbMenu;
     //struct VIDEO_RGB332_VGAFB       videoVgafbConsole;
     struct SOUND_SDLMIXER           soundSdlmixer;
+#endif
     struct IO_KEYBOARD              ioKeyboard;
     struct IO_GUI                   ioGui;
     struct STREAM_FILE              streamDebugFile;
     struct RAWSTOR_FILE             rsImageFile;
+#ifdef DISK_RAM_TIMING
+    struct RAWSTOR_RAM              rsRamDisk;
+#endif
+#ifdef DISK_SD_SPI_SIM
+    struct STREAM_SD_SPI_SIM        streamSdSpiSim;
+    struct RAWSTOR_SD_1BIT          rsSd1Bit;
+#endif
     uint32_t                        screenToWindowId[SCREEN_Role__COUNT];
 };
 
@@ -99,6 +163,21 @@ static void         assertFunc      (struct BOARD *const B,
 static void         update          (struct BOARD *const B);
 
 
+#ifdef HEADLESS
+// Same framebuffer sizes as the adapter simulator and vga framebuffer windows
+static const struct VIDEO_IFACE VIDEO_IFACE_HEADLESS_PRIMARY =
+{
+    VIDEO_HEADLESS_IFACE("headless video adapter", 256, 144)
+};
+
+
+static const struct VIDEO_IFACE VIDEO_IFACE_HEADLESS_MENU =
+{
+    VIDEO_HEADLESS_IFACE("headless vga framebuffer", 640, 480)
+};
+#endif
+
+
 static const struct BOARD_IFACE BOARD_HOSTED_SDL_IFACE =
 {
     .Description    = "sdl hosted",
@@ -126,6 +205,43 @@ struct BOARD * BOARD__boot (const int Argc, const char **const Argv,
 }
 
 
+#ifdef DISK_RAM_TIMING
+static uint8_t * loadDiskImage (const char *const Filename,
+                                uint32_t *const Sectors)
+{
+    FILE *const F = fopen (Filename, "rb");
+    uint8_t *image = NULL;
+
+    *Sectors = 0;
+
+    if (F && !fseek (F, 0, SEEK_END))
+    {
+        const long Size = ftell (F);
+
+        if (Size >= RAWSTOR_SECTOR_SIZE && !fseek (F, 0, SEEK_SET))
+        {
+            *Sectors    = (uint32_t)(Size / RAWSTOR_SECTOR_SIZE);
+            image       = malloc ((size_t)*Sectors * RAWSTOR_SECTOR_SIZE);
+
+            if (image && fread (image, RAWSTOR_SECTOR_SIZE, *Sectors, F)
+                                                                != *Sectors)
+            {
+                free (image);
+                image = NULL;
+            }
+        }
+    }
+
+    if (F)
+    {
+        fclose (F);
+    }
+
+    return image;
+}
+#endif
+
+
 static void greetings (struct STREAM *const S)
 {
     STREAM_IN_FromParsedString (S, 0, 512, BOARD_LOGO_1);
@@ -150,8 +266,12 @@ void * initComponent (struct BOARD *const B,
         case BOARD_Stage_InitPreTicksHardware:
         {
             // initialize SDL
+        #ifdef HEADLESS
+            if (SDL_InitSubSystem (SDL_INIT_EVENTS) < 0)
+        #else
             if (SDL_InitSubSystem (SDL_INIT_EVENTS) < 0 || 
                 SDL_InitSubSystem (SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0)
+        #endif
             {
                 // No log messages or assert output yet
                 fputs ("SDL_InitSubSystem() failed: ", stderr);
@@ -220,7 +340,34 @@ void * initComponent (struct BOARD *const B,
 
         case BOARD_Stage_InitStorageDrivers:
         {
-            RAWSTOR_FILE_Init (&H->rsImageFile, DISK_FILENAME);
+        #ifdef DISK_RAM_TIMING
+            static const struct RAWSTOR_RAM_Timing DiskTiming =
+                                                        DISK_RAM_TIMING;
+            uint32_t sectors;
+            uint8_t *const Image = loadDiskImage (DISK_FILENAME, &sectors);
+
+            if (Image)
+            {
+                RAWSTOR_RAM_Init (&H->rsRamDisk, Image, sectors, &DiskTiming);
+            #ifdef DISK_SD_SPI_SIM
+                static const struct STREAM_SD_SPI_SIM_Timing CardTiming =
+                                            STREAM_SD_SPI_SIM_TIMING_TYPICAL;
+
+                STREAM_SD_SPI_SIM_Init (&H->streamSdSpiSim,
+                                        (struct RAWSTOR *)&H->rsRamDisk,
+                                        DISK_SD_SPI_SIM, &CardTiming);
+                COMM_SetDevice (COMM_Device_HighSpeedDeviceExpansion,
+                                (struct STREAM *)&H->streamSdSpiSim);
+                RAWSTOR_SD_1BIT_Init (&H->rsSd1Bit,
+                                      COMM_Device_HighSpeedDeviceExpansion);
+                STORAGE_SetDevice ((struct RAWSTOR *)&H->rsSd1Bit);
+            #else
+                STORAGE_SetDevice ((struct RAWSTOR *)&H->rsRamDisk);
+            #endif
+                break;
+            }
+        #endif
+            RAWSTOR_FILE_Init (&H->rsImageFile, DISK_FILENAME, DISK_BACKEND);
             STORAGE_SetDevice ((struct RAWSTOR *)&H->rsImageFile);
             break;
         }
@@ -232,6 +379,37 @@ void * initComponent (struct BOARD *const B,
 
         case BOARD_Stage_InitScreenDrivers:
         {
+        #ifdef HEADLESS
+            const struct VIDEO_HEADLESS_Config PrimaryConfig =
+            {
+                .vbiPeriod      = HEADLESS_VBI_PERIOD,
+                .capture        = HEADLESS_CAPTURE,
+                .capturePrefix  = HEADLESS_CAPTURE_PREFIX "primary_",
+                .captureFirst   = HEADLESS_CAPTURE_FIRST,
+                .captureCount   = HEADLESS_CAPTURE_COUNT
+            };
+
+            struct VIDEO_HEADLESS_Config menuConfig = PrimaryConfig;
+            menuConfig.capturePrefix = HEADLESS_CAPTURE_PREFIX "menu_";
+
+            VIDEO_HEADLESS_Init (&H->videoHeadlessPrimary,
+                                 &VIDEO_IFACE_HEADLESS_PRIMARY,
+                                 H->headlessPrimaryFb[0],
+                                 H->headlessPrimaryFb[1], &PrimaryConfig);
+        #ifdef HEADLESS_MAILBOX
+            VIDEO_SetTripleBuffer ((struct VIDEO *)&H->videoHeadlessPrimary,
+                                   H->headlessPrimaryFb[2]);
+        #endif
+            SCREEN_RegisterDevice (SCREEN_Role_Primary,
+                              (struct VIDEO *)&H->videoHeadlessPrimary);
+
+            VIDEO_HEADLESS_Init (&H->videoHeadlessMenu,
+                                 &VIDEO_IFACE_HEADLESS_MENU,
+                                 H->headlessMenuFb, NULL, &menuConfig);
+            SCREEN_RegisterDevice (SCREEN_Role_Menu,
+                              (struct VIDEO *)&H->videoHeadlessMenu);
+            break;
+        #else
             VIDEO_RGB332_ADAPTER_SIM_Init (&H->videoAdapterSim);
             SCREEN_RegisterDevice (SCREEN_Role_Primary,
                               (struct VIDEO *)&H->videoAdapterSim);
@@ -253,12 +431,18 @@ void * initComponent (struct BOARD *const B,
             //H->screenToWindowId[SCREEN_Role_Console] = 
             //    H->videoVgafbConsole.device.windowId;
             break;
+        #endif
         }
 
         case BOARD_Stage_InitSoundDriver:
         {
+        #ifdef HEADLESS
+            // No audio device expected either
+            break;
+        #else
             SOUND_SDL_Init (&H->soundSdlmixer);
             return &H->soundSdlmixer;
+        #endif
         }
 
         case BOARD_Stage_InitIOLevel3Drivers:
@@ -278,6 +462,8 @@ void * initComponent (struct BOARD *const B,
 
         case BOARD_Stage_ShutdownHardware:
         {
+            // Does nothing when the image was loaded in a RAM disk
+            RAWSTOR_FILE_Shutdown (&H->rsImageFile);
             SDL_Quit ();
             break;
         }
@@ -335,6 +521,32 @@ static void setMouseButtonAction (struct BOARD_HOSTED *const H,
 }
 
 
+static void exposeWindow (struct BOARD_HOSTED *const H,
+                          const uint32_t WindowId)
+{
+    for (enum SCREEN_Role r = 0; r < SCREEN_Role__COUNT; ++r)
+    {
+        if (SCREEN_IsAvailable (r) && H->screenToWindowId[r] == WindowId)
+        {
+            // Window contents lost, present the whole frame again
+            VIDEO_Invalidate (SCREEN_GetContext(r)->driver);
+        }
+    }
+}
+
+
+void BOARD__shutdown (struct BOARD *const B);
+
+
+// Ends the process through the board shutdown sequence, flushing pending
+// storage writes.
+static void quit (struct BOARD *const B)
+{
+    BOARD__shutdown (B);
+    exit (0);
+}
+
+
 void update (struct BOARD *const B)
 {
     struct BOARD_HOSTED *const H = (struct BOARD_HOSTED *) B;
@@ -345,10 +557,19 @@ void update (struct BOARD *const B)
     {
         switch (event.type)
         {
+            // Also sent on SIGINT and SIGTERM
+            case SDL_QUIT:
+                quit (B);
+                break;
+
             case SDL_WINDOWEVENT:
                 if (event.window.event == SDL_WINDOWEVENT_CLOSE)
                 {
-                    exit (0);
+                    quit (B);
+                }
+                else if (event.window.event == SDL_WINDOWEVENT_EXPOSED)
+                {
+                    exposeWindow (H, event.window.windowID);
                 }
                 break;
 
@@ -358,4 +579,12 @@ void update (struct BOARD *const B)
                 break;
         }
     }
+
+#if defined(HEADLESS) && HEADLESS_FRAMES
+    if (VIDEO_FrameNumber ((struct VIDEO *)&H->videoHeadlessPrimary) >=
+                                                            HEADLESS_FRAMES)
+    {
+        quit (B);
+    }
+#endif
 }
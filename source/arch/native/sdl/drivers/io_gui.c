@@ -399,6 +399,10 @@ void IO_GUI_Init (struct IO_GUI *const G, const enum SCREEN_Role Screen)
     CYCLIC_Init (&G->nameRegionBufferCyclic, (uint8_t *)G->nameRegionBuffer, 
             sizeof(G->nameRegionBuffer));
 
+    // Mostly the same strings are drawn on every frame
+    SCREEN_FONT_RUN_Init (&G->fontRun, G->fontRunEntry, IO_GUI_FONT_RUNS);
+    SCREEN_FONT_RUN_Attach (Screen, &G->fontRun);
+
     // Update once per frame (~60 Hz).
     IO_Init ((struct IO *)G, &IO_GUI_IFACE, G->portInfo, 15);
 }
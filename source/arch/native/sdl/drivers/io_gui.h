@@ -27,11 +27,14 @@
 
 #include "embedul.ar/source/core/manager/mio.h"
 #include "embedul.ar/source/core/manager/screen/role.h"
+#include "embedul.ar/source/core/manager/screen/font_run.h"
 #include "embedul.ar/source/core/bitfield.h"
 #include "embedul.ar/source/core/cyclic.h"
 
 
 #define IO_GUI_PORT_COUNT      1
+// Labels, captions and values drawn on each frame, and then some
+#define IO_GUI_FONT_RUNS       64
 
 
 // Keep it sync'ed with input profiles and GUI controls
@@ -158,6 +161,9 @@ struct IO_GUI
     enum IO_Type            showType;
     uint32_t                showElementPage;
     uint32_t                showElementSelected;
+    struct SCREEN_FONT_RUN  fontRun;
+    struct SCREEN_FONT_RUN_Entry
+                            fontRunEntry[IO_GUI_FONT_RUNS];
 };
 
 
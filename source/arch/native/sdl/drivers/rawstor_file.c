@@ -23,9 +23,38 @@
   3. This notice may not be removed or altered from any source distribution.
 */
 
+// O_DIRECT and 64-bit file offsets on 32-bit hosts
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+
 #include "embedul.ar/source/arch/native/sdl/drivers/rawstor_file.h"
 #include "embedul.ar/source/core/device/board.h"
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+
+// Direct transfers go through an aligned buffer of this many sectors.
+#define DIRECT_BOUNCE_SECTORS       64
+#define DIRECT_BOUNCE_ALIGNMENT     4096
+
+// Merged requests transferred in a single preadv() or pwritev() call
+#ifdef IOV_MAX
+    #define TRANSFER_IOV_MAX        IOV_MAX
+#else
+    #define TRANSFER_IOV_MAX        16
+#endif
+
+// No fdatasync() declared on macOS
+#ifdef __APPLE__
+    #define fdatasync               fsync
+#endif
 
 
 // Common IO interface
@@ -41,6 +70,13 @@ static RAWSTOR_Status_Result    mediaWrite      (struct RAWSTOR *const R,
 static RAWSTOR_Status_Result    mediaIoctl      (struct RAWSTOR *const R,
                                                  const uint8_t Cmd,
                                                  void *const Data);
+static bool                     mediaSubmit     (struct RAWSTOR *const R,
+                                        struct RAWSTOR_Request *const Req);
+static struct RAWSTOR_Request * mediaReap       (struct RAWSTOR *const R,
+                                                 const bool Wait);
+static int                      workerRun       (void *Param);
+static void                     stopWorkers     (struct RAWSTOR_FILE *const F);
+static void                     closeImage      (struct RAWSTOR_FILE *const F);
 
 
 static const struct RAWSTOR_IFACE RAWSTOR_FILE_IFACE =
@@ -49,39 +85,222 @@ static const struct RAWSTOR_IFACE RAWSTOR_FILE_IFACE =
     .MediaInit      = mediaInit,
     .MediaRead      = mediaRead,
     .MediaWrite     = mediaWrite,
-    .MediaIoctl     = mediaIoctl
+    .MediaIoctl     = mediaIoctl,
+    .MediaSubmit    = mediaSubmit,
+    .MediaReap      = mediaReap,
+    .MediaSubmitVectored
+                    = true
 };
 
 
 void RAWSTOR_FILE_Init (struct RAWSTOR_FILE *const F,
-                        const char *const Filename)
+                        const char *const Filename,
+                        const enum RAWSTOR_FILE_Backend Backend)
 {
     BOARD_AssertParams (F && Filename);
+    BOARD_AssertParams (Backend == RAWSTOR_FILE_Backend_Pio ||
+                        Backend == RAWSTOR_FILE_Backend_Direct ||
+                        Backend == RAWSTOR_FILE_Backend_Mmap);
+
+    // Workers and image file of a previous initialization
+    RAWSTOR_FILE_Shutdown (F);
 
     DEVICE_IMPLEMENTATION_Clear (F);
 
     F->filename = Filename;
+    F->backend  = Backend;
+    F->fd       = -1;
+
+    F->mutex        = SDL_CreateMutex ();
+    F->submitted    = SDL_CreateCond ();
+    F->finished     = SDL_CreateCond ();
+    BOARD_AssertState (F->mutex && F->submitted && F->finished);
+
+    for (uint32_t i = 0; i < RAWSTOR_FILE_WORKERS; ++i)
+    {
+        struct RAWSTOR_FILE_Worker *const W = &F->worker[i];
+
+        W->file     = F;
+        W->thread   = SDL_CreateThread (workerRun, "rawstor_file", W);
+        BOARD_AssertState (W->thread);
+    }
 
     RAWSTOR_Init ((struct RAWSTOR *)F, &RAWSTOR_FILE_IFACE);
 }
 
 
+// Pending transfers finish before the workers are stopped. The device must be
+// initialized again to be used after this call.
+void RAWSTOR_FILE_Shutdown (struct RAWSTOR_FILE *const F)
+{
+    BOARD_AssertParams (F);
+
+    // Never initialized or already shut down
+    if (!F->mutex)
+    {
+        return;
+    }
+
+    stopWorkers (F);
+    closeImage (F);
+
+    free (F->bounce);
+    F->bounce = NULL;
+
+    F->device.status.disk |= RAWSTOR_Status_Disk_NotInitialized;
+}
+
+
+static int openImage (struct RAWSTOR_FILE *const F)
+{
+#ifdef O_DIRECT
+    if (F->backend == RAWSTOR_FILE_Backend_Direct)
+    {
+        const int Fd = open (F->filename, O_RDWR | O_DIRECT);
+
+        // Host filesystem without direct I/O support (tmpfs, for example)
+        if (Fd >= 0 || errno != EINVAL)
+        {
+            return Fd;
+        }
+
+        LOG_Warn (&F->device, LANG_DIRECT_IO_UNSUPPORTED);
+        LOG_Items (1, LANG_FILENAME, F->filename);
+
+        F->backend = RAWSTOR_FILE_Backend_Pio;
+    }
+#endif
+
+    const int Fd = open (F->filename, O_RDWR);
+
+#if !defined(O_DIRECT) && defined(F_NOCACHE)
+    if (Fd >= 0 && F->backend == RAWSTOR_FILE_Backend_Direct)
+    {
+        fcntl (Fd, F_NOCACHE, 1);
+    }
+#endif
+
+    return Fd;
+}
+
+
+static RAWSTOR_Status_Result mediaInitFailed (struct RAWSTOR *const R,
+                                              const char *const Msg)
+{
+    struct RAWSTOR_FILE *const F = (struct RAWSTOR_FILE *) R;
+
+    LOG_WarnDebug (R, Msg);
+    LOG_Items (2,
+            LANG_FILENAME,      F->filename,
+            LANG_ERROR,         errno);
+
+    if (F->fd >= 0)
+    {
+        close (F->fd);
+        F->fd = -1;
+    }
+
+    RAWSTOR_UpdateStatusResult (R, RAWSTOR_Status_Result_NotReady);
+    return RAWSTOR_Status_Result_NotReady;
+}
+
+
+static void allocBounce (uint8_t **const Bounce)
+{
+    if (!*Bounce)
+    {
+        *Bounce = aligned_alloc (DIRECT_BOUNCE_ALIGNMENT,
+                                 DIRECT_BOUNCE_SECTORS * RAWSTOR_SECTOR_SIZE);
+        BOARD_AssertState (*Bounce);
+    }
+}
+
+
+// Transfers in progress keep using the current file and mapping. Finished
+// ones stay on the finished list until reaped.
+static void waitWorkers (struct RAWSTOR_FILE *const F)
+{
+    SDL_LockMutex (F->mutex);
+
+    while (F->active)
+    {
+        SDL_CondWait (F->finished, F->mutex);
+    }
+
+    SDL_UnlockMutex (F->mutex);
+}
+
+
+static void closeImage (struct RAWSTOR_FILE *const F)
+{
+    if (F->map)
+    {
+        munmap (F->map, (size_t)F->sectorCount * RAWSTOR_SECTOR_SIZE);
+        F->map = NULL;
+    }
+
+    if (F->fd >= 0)
+    {
+        close (F->fd);
+        F->fd = -1;
+    }
+}
+
+
+static void checkDirectLost (struct RAWSTOR_FILE *const F);
+
+
 static RAWSTOR_Status_Result mediaInit (struct RAWSTOR *const R)
 {
     struct RAWSTOR_FILE *const F = (struct RAWSTOR_FILE *) R;
 
     RAWSTOR_UpdateStatusMedia (R, RAWSTOR_Status_Media_Initializing, 0, 0);
 
-    F->fd = fopen (F->filename, "r+b");
-    if (!F->fd)
+    waitWorkers (F);
+    checkDirectLost (F);
+
+    // Initialized again
+    closeImage (F);
+
+    F->fd           = openImage (F);
+    F->directLost   = false;
+
+    if (F->fd < 0)
     {
-        LOG_WarnDebug (R, LANG_ERROR_OPENING_FILE);
-        LOG_Items (2,
-                LANG_FILENAME,          F->filename,
-                LANG_ERROR,         errno);
+        return mediaInitFailed (R, LANG_ERROR_OPENING_FILE);
+    }
 
-        RAWSTOR_UpdateStatusResult (R, RAWSTOR_Status_Result_NotReady);
-        return RAWSTOR_Status_Result_NotReady;
+    // The image size does not change while in use
+    struct stat st;
+
+    if (fstat (F->fd, &st))
+    {
+        return mediaInitFailed (R, LANG_ERROR_OPENING_FILE);
+    }
+
+    F->sectorCount = (uint32_t)(st.st_size / RAWSTOR_SECTOR_SIZE);
+
+    if (F->backend == RAWSTOR_FILE_Backend_Mmap)
+    {
+        void *const Map = mmap (NULL, (size_t)F->sectorCount *
+                                RAWSTOR_SECTOR_SIZE, PROT_READ | PROT_WRITE,
+                                MAP_SHARED, F->fd, 0);
+        if (Map == MAP_FAILED)
+        {
+            return mediaInitFailed (R, LANG_ERROR_MAPPING_FILE);
+        }
+
+        F->map = Map;
+    }
+    else if (F->backend == RAWSTOR_FILE_Backend_Direct)
+    {
+        // One for synchronous transfers and one on each worker
+        allocBounce (&F->bounce);
+
+        for (uint32_t i = 0; i < RAWSTOR_FILE_WORKERS; ++i)
+        {
+            allocBounce (&F->worker[i].bounce);
+        }
     }
 
     R->status.disk &= ~RAWSTOR_Status_Disk_NotPresent;
@@ -94,6 +313,194 @@ static RAWSTOR_Status_Result mediaInit (struct RAWSTOR *const R)
 }
 
 
+// Retries interrupted and short transfers. Also called from worker threads.
+static bool transfer (struct RAWSTOR_FILE *const F, uint8_t *data,
+                      size_t octets, off_t offset, const bool Write)
+{
+#ifdef O_DIRECT
+    bool fellBack = false;
+#endif
+
+    while (octets)
+    {
+        const ssize_t Done = Write? pwrite (F->fd, data, octets, offset) :
+                                    pread (F->fd, data, octets, offset);
+        if (Done < 0)
+        {
+        #ifdef O_DIRECT
+            // Transfer size or alignment not supported on direct I/O. Go on
+            // through the page cache, retrying once.
+            if (errno == EINVAL && !fellBack &&
+                F->backend == RAWSTOR_FILE_Backend_Direct)
+            {
+                fellBack = true;
+
+                SDL_LockMutex (F->mutex);
+
+                // Another transfer may have done it already
+                if (!F->directLost)
+                {
+                    fcntl (F->fd, F_SETFL, fcntl(F->fd, F_GETFL) & ~O_DIRECT);
+                    F->directLost = true;
+                }
+
+                SDL_UnlockMutex (F->mutex);
+                continue;
+            }
+        #endif
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return false;
+        }
+
+        // Unexpected end of file
+        if (!Done)
+        {
+            return false;
+        }
+
+        data    += Done;
+        octets  -= (size_t)Done;
+        offset  += Done;
+    }
+
+    return true;
+}
+
+
+// Same as transfer(), on several buffers. Modifies Iov.
+static bool transferv (struct RAWSTOR_FILE *const F, struct iovec *iov,
+                       int iovCount, off_t offset, const bool Write)
+{
+    while (iovCount)
+    {
+        const ssize_t Done = Write? pwritev (F->fd, iov, iovCount, offset) :
+                                    preadv (F->fd, iov, iovCount, offset);
+        if (Done < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return false;
+        }
+
+        if (!Done)
+        {
+            return false;
+        }
+
+        offset += Done;
+
+        for (size_t left = (size_t)Done; left;)
+        {
+            if (left < iov->iov_len)
+            {
+                iov->iov_base   = (uint8_t *)iov->iov_base + left;
+                iov->iov_len   -= left;
+                break;
+            }
+
+            left -= iov->iov_len;
+            ++ iov;
+            -- iovCount;
+        }
+    }
+
+    return true;
+}
+
+
+static bool transferSectors (struct RAWSTOR_FILE *const F,
+                             uint8_t *const Bounce, uint8_t *const Data,
+                             const uint32_t Sector, const uint32_t Count,
+                             const bool Write)
+{
+    // LBA (512-byte sectors) to byte addressing
+    const off_t Offset = (off_t)Sector * RAWSTOR_SECTOR_SIZE;
+
+    if (F->map)
+    {
+        uint8_t *const M = &F->map[Offset];
+        const size_t Octets = (size_t)Count * RAWSTOR_SECTOR_SIZE;
+
+        memcpy (Write? M : Data, Write? Data : M, Octets);
+        return true;
+    }
+
+    if (F->backend != RAWSTOR_FILE_Backend_Direct)
+    {
+        return transfer (F, Data, (size_t)Count * RAWSTOR_SECTOR_SIZE, Offset,
+                         Write);
+    }
+
+    for (uint32_t done = 0; done < Count;)
+    {
+        const uint32_t Sectors = (Count - done < DIRECT_BOUNCE_SECTORS)?
+                                  Count - done : DIRECT_BOUNCE_SECTORS;
+        const size_t Octets = (size_t)Sectors * RAWSTOR_SECTOR_SIZE;
+        uint8_t *const D = &Data[(size_t)done * RAWSTOR_SECTOR_SIZE];
+
+        if (Write)
+        {
+            memcpy (Bounce, D, Octets);
+        }
+
+        if (!transfer (F, Bounce, Octets, Offset +
+                       (off_t)done * RAWSTOR_SECTOR_SIZE, Write))
+        {
+            return false;
+        }
+
+        if (!Write)
+        {
+            memcpy (D, Bounce, Octets);
+        }
+
+        done += Sectors;
+    }
+
+    return true;
+}
+
+
+// Called from the main thread. Workers only read the backend while active,
+// so it is switched once none is.
+static void checkDirectLost (struct RAWSTOR_FILE *const F)
+{
+    bool lost = false;
+
+    SDL_LockMutex (F->mutex);
+
+    if (F->directLost && !F->active &&
+        F->backend == RAWSTOR_FILE_Backend_Direct)
+    {
+        F->backend  = RAWSTOR_FILE_Backend_Pio;
+        lost        = true;
+    }
+
+    SDL_UnlockMutex (F->mutex);
+
+    if (lost)
+    {
+        LOG_Warn (&F->device, LANG_DIRECT_IO_UNSUPPORTED);
+        LOG_Items (1, LANG_FILENAME, F->filename);
+    }
+}
+
+
+static bool inRange (struct RAWSTOR_FILE *const F, const uint32_t Sector,
+                     const uint32_t Count)
+{
+    return (Sector > F->sectorCount || Count > F->sectorCount - Sector)?
+                                                                false : true;
+}
+
+
 static RAWSTOR_Status_Result mediaRead (struct RAWSTOR *const R,
                                         uint8_t *const Data,
                                         const uint32_t Sector,
@@ -101,16 +508,16 @@ static RAWSTOR_Status_Result mediaRead (struct RAWSTOR *const R,
 {
     struct RAWSTOR_FILE *const F = (struct RAWSTOR_FILE *) R;
 
-    // LBA (512-byte sectors) to byte addressing
-    if (fseek (F->fd, Sector * RAWSTOR_SECTOR_SIZE, SEEK_SET))
+    if (!inRange (F, Sector, Count))
     {
-        return RAWSTOR_Status_Result_ReadWriteError;
+        return RAWSTOR_Status_Result_InvalidParam;
     }
 
-    const size_t read = fread (Data, RAWSTOR_SECTOR_SIZE, Count, F->fd);
+    const bool Ok = transferSectors (F, F->bounce, Data, Sector, Count, false);
+
+    checkDirectLost (F);
 
-	return (read != Count)? RAWSTOR_Status_Result_ReadWriteError :
-                            RAWSTOR_Status_Result_Ok;
+	return Ok? RAWSTOR_Status_Result_Ok : RAWSTOR_Status_Result_ReadWriteError;
 }
 
 
@@ -121,17 +528,18 @@ static RAWSTOR_Status_Result mediaWrite (struct RAWSTOR *const R,
 {
     struct RAWSTOR_FILE *const F = (struct RAWSTOR_FILE *) R;
 
-    // LBA (512-byte sectors) to byte addressing
-    if (fseek (F->fd, SectorBegin * RAWSTOR_SECTOR_SIZE, SEEK_SET))
+    if (!inRange (F, SectorBegin, SectorCount))
     {
-        return RAWSTOR_Status_Result_ReadWriteError;
+        return RAWSTOR_Status_Result_InvalidParam;
     }
 
-    const size_t write = fwrite (Data, RAWSTOR_SECTOR_SIZE, SectorCount, F->fd);
-    fflush (F->fd);
+    // Data is only read from on writes
+    const bool Ok = transferSectors (F, F->bounce, (uint8_t *)Data,
+                                     SectorBegin, SectorCount, true);
+
+    checkDirectLost (F);
 
-	return (write != SectorCount)? RAWSTOR_Status_Result_ReadWriteError :
-                             RAWSTOR_Status_Result_Ok;
+	return Ok? RAWSTOR_Status_Result_Ok : RAWSTOR_Status_Result_ReadWriteError;
 }
 
 
@@ -148,29 +556,24 @@ static RAWSTOR_Status_Result mediaIoctl (struct RAWSTOR *const R,
 
     switch (Cmd)
     {
+        // Written data and mapped pages reach the host storage before
+        // returning, whatever the backend.
         case RAWSTOR_IOCTL_CMD_SYNC:
-            if (fflush (F->fd))
-            {
-                return RAWSTOR_Status_Result_ReadWriteError;
-            }
-            break;
-
-        case RAWSTOR_IOCTL_CMD_GET_SECTOR_COUNT:
-        {
-            if (fseek (F->fd, 0, SEEK_END))
+            if (F->map && msync (F->map, (size_t)F->sectorCount *
+                                 RAWSTOR_SECTOR_SIZE, MS_SYNC))
             {
                 return RAWSTOR_Status_Result_ReadWriteError;
             }
 
-            long size = ftell (F->fd);
-            if (size < 0)
+            if (fdatasync (F->fd))
             {
                 return RAWSTOR_Status_Result_ReadWriteError;
             }
+            break;
 
-            *(uint32_t *) Data = (uint32_t)size / RAWSTOR_SECTOR_SIZE;
+        case RAWSTOR_IOCTL_CMD_GET_SECTOR_COUNT:
+            *(uint32_t *) Data = F->sectorCount;
             break;
-        }
 
         case RAWSTOR_IOCTL_CMD_GET_SECTOR_SIZE:
             // Get R/W sector size (uint16_t)
@@ -195,3 +598,191 @@ static RAWSTOR_Status_Result mediaIoctl (struct RAWSTOR *const R,
 
 	return RAWSTOR_Status_Result_Ok;
 }
+
+
+// Merged requests on the page cache backend are transferred by a single
+// vectored call.
+static RAWSTOR_Status_Result transferRequests (struct RAWSTOR_FILE *const F,
+                                               uint8_t *const Bounce,
+                                        struct RAWSTOR_Request *const First)
+{
+    const bool Write = (First->op == RAWSTOR_RequestOp_Write);
+    struct iovec iov[TRANSFER_IOV_MAX];
+    int iovCount = 0;
+
+    for (struct RAWSTOR_Request *req = First; req; req = req->merged)
+    {
+        if (!inRange (F, req->sectorBegin, req->sectorCount))
+        {
+            return RAWSTOR_Status_Result_InvalidParam;
+        }
+
+        if (iovCount < TRANSFER_IOV_MAX)
+        {
+            iov[iovCount].iov_base  = req->data;
+            iov[iovCount].iov_len   = (size_t)req->sectorCount *
+                                                        RAWSTOR_SECTOR_SIZE;
+        }
+
+        ++ iovCount;
+    }
+
+    if (First->merged && !F->map && iovCount <= TRANSFER_IOV_MAX &&
+        F->backend == RAWSTOR_FILE_Backend_Pio)
+    {
+        return transferv (F, iov, iovCount, (off_t)First->sectorBegin *
+                          RAWSTOR_SECTOR_SIZE, Write)?
+                                        RAWSTOR_Status_Result_Ok :
+                                        RAWSTOR_Status_Result_ReadWriteError;
+    }
+
+    for (struct RAWSTOR_Request *req = First; req; req = req->merged)
+    {
+        if (!transferSectors (F, Bounce, req->data, req->sectorBegin,
+                              req->sectorCount, Write))
+        {
+            return RAWSTOR_Status_Result_ReadWriteError;
+        }
+    }
+
+    return RAWSTOR_Status_Result_Ok;
+}
+
+
+static int workerRun (void *Param)
+{
+    struct RAWSTOR_FILE_Worker *const W = (struct RAWSTOR_FILE_Worker *) Param;
+    struct RAWSTOR_FILE *const F = W->file;
+
+    while (true)
+    {
+        SDL_LockMutex (F->mutex);
+
+        while (!F->submitHead && !F->quit)
+        {
+            SDL_CondWait (F->submitted, F->mutex);
+        }
+
+        if (!F->submitHead)
+        {
+            SDL_UnlockMutex (F->mutex);
+            break;
+        }
+
+        struct RAWSTOR_Request *const Req = F->submitHead;
+
+        F->submitHead = Req->link;
+
+        SDL_UnlockMutex (F->mutex);
+
+        Req->result = transferRequests (F, W->bounce, Req);
+        Req->link   = NULL;
+
+        SDL_LockMutex (F->mutex);
+
+        if (F->finishedHead)
+        {
+            F->finishedTail->link = Req;
+        }
+        else
+        {
+            F->finishedHead = Req;
+        }
+
+        F->finishedTail = Req;
+
+        -- F->active;
+
+        // Also wakes up waitWorkers()
+        SDL_CondBroadcast (F->finished);
+        SDL_UnlockMutex (F->mutex);
+    }
+
+    return 0;
+}
+
+
+static void stopWorkers (struct RAWSTOR_FILE *const F)
+{
+    waitWorkers (F);
+
+    SDL_LockMutex (F->mutex);
+    F->quit = true;
+    SDL_CondBroadcast (F->submitted);
+    SDL_UnlockMutex (F->mutex);
+
+    for (uint32_t i = 0; i < RAWSTOR_FILE_WORKERS; ++i)
+    {
+        struct RAWSTOR_FILE_Worker *const W = &F->worker[i];
+
+        SDL_WaitThread (W->thread, NULL);
+        W->thread = NULL;
+
+        free (W->bounce);
+        W->bounce = NULL;
+    }
+
+    SDL_DestroyCond     (F->finished);
+    SDL_DestroyCond     (F->submitted);
+    SDL_DestroyMutex    (F->mutex);
+
+    F->finished     = NULL;
+    F->submitted    = NULL;
+    F->mutex        = NULL;
+}
+
+
+static bool mediaSubmit (struct RAWSTOR *const R,
+                         struct RAWSTOR_Request *const Req)
+{
+    struct RAWSTOR_FILE *const F = (struct RAWSTOR_FILE *) R;
+
+    Req->link = NULL;
+
+    SDL_LockMutex (F->mutex);
+
+    if (F->submitHead)
+    {
+        F->submitTail->link = Req;
+    }
+    else
+    {
+        F->submitHead = Req;
+    }
+
+    F->submitTail = Req;
+
+    ++ F->active;
+
+    SDL_CondSignal (F->submitted);
+    SDL_UnlockMutex (F->mutex);
+
+    return true;
+}
+
+
+static struct RAWSTOR_Request * mediaReap (struct RAWSTOR *const R,
+                                           const bool Wait)
+{
+    struct RAWSTOR_FILE *const F = (struct RAWSTOR_FILE *) R;
+
+    SDL_LockMutex (F->mutex);
+
+    while (Wait && !F->finishedHead)
+    {
+        SDL_CondWait (F->finished, F->mutex);
+    }
+
+    struct RAWSTOR_Request *const Req = F->finishedHead;
+
+    if (Req)
+    {
+        F->finishedHead = Req->link;
+    }
+
+    SDL_UnlockMutex (F->mutex);
+
+    checkDirectLost (F);
+
+    return Req;
+}
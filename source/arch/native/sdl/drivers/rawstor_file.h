@@ -24,16 +24,67 @@
 */
 
 #include "embedul.ar/source/core/device/rawstor.h"
-#include <stdio.h>
+#include "SDL_mutex.h"
+#include "SDL_thread.h"
+
+
+// Threads transferring asynchronous requests
+#define RAWSTOR_FILE_WORKERS        2
+
+
+enum RAWSTOR_FILE_Backend
+{
+    // pread() and pwrite() on the image file
+    RAWSTOR_FILE_Backend_Pio = 0,
+    // Same, bypassing the OS page cache when the host filesystem supports it
+    RAWSTOR_FILE_Backend_Direct,
+    // Image file mapped in memory. Reads and writes are memory copies.
+    RAWSTOR_FILE_Backend_Mmap
+};
+
+
+struct RAWSTOR_FILE;
+
+
+struct RAWSTOR_FILE_Worker
+{
+    struct RAWSTOR_FILE         * file;
+    SDL_Thread                  * thread;
+    uint8_t                     * bounce;
+};
 
 
 struct RAWSTOR_FILE
 {
-    struct RAWSTOR      device;
-    const char          * filename;
-    FILE                * fd;
+    struct RAWSTOR              device;
+    const char                  * filename;
+    enum RAWSTOR_FILE_Backend   backend;
+    int                         fd;
+    uint32_t                    sectorCount;
+    uint8_t                     * map;
+    // Aligned transfer buffer for the direct backend
+    uint8_t                     * bounce;
+    // Transfers to start and finished transfers, linked through the
+    // request link member.
+    SDL_mutex                   * mutex;
+    SDL_cond                    * submitted;
+    SDL_cond                    * finished;
+    struct RAWSTOR_Request      * submitHead;
+    struct RAWSTOR_Request      * submitTail;
+    struct RAWSTOR_Request      * finishedHead;
+    struct RAWSTOR_Request      * finishedTail;
+    // Submitted transfers not yet finished by a worker
+    uint32_t                    active;
+    // Set by a transfer that fell back from direct I/O. The main thread
+    // switches backend once no worker is transferring.
+    bool                        directLost;
+    // Workers return once no transfer is left
+    bool                        quit;
+    struct RAWSTOR_FILE_Worker  worker[RAWSTOR_FILE_WORKERS];
 };
 
 
 void RAWSTOR_FILE_Init (struct RAWSTOR_FILE *const F,
-                            const char *const Filename);
+                        const char *const Filename,
+                        const enum RAWSTOR_FILE_Backend Backend);
+void RAWSTOR_FILE_Shutdown (struct RAWSTOR_FILE *const F);
@@ -0,0 +1,419 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+
+  [VIDEO driver] headless rgb332 framebuffer with frame capture.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "embedul.ar/source/arch/native/sdl/drivers/video_headless.h"
+#include "embedul.ar/source/core/misc/crc32c.h"
+#include "embedul.ar/source/core/device/board.h"
+
+
+#define DRIVER_SIGNAL_STR               "none (headless)"
+#define CHECKSUMS_FILENAME_STR          "checksums.txt"
+#define CAPTURE_FILENAME_MAX            256
+
+
+// RGB332 expanded to RGB888, as presented by the native SDL drivers
+static uint8_t  s_rgb[256][3];
+// PNG chunk and zlib stream CRC-32 (ISO 3309)
+static uint32_t s_crc32[256];
+
+
+static void initTables (void)
+{
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        s_rgb[i][0] = (uint8_t) (((i >> 5) / 7.0) * 255.0);
+        s_rgb[i][1] = (uint8_t) ((((i >> 2) & 0x7) / 7.0) * 255.0);
+        s_rgb[i][2] = (uint8_t) (((i & 0x3) / 3.0) * 255.0);
+
+        uint32_t c = i;
+
+        for (uint32_t k = 0; k < 8; ++k)
+        {
+            c = (c & 1)? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        }
+
+        s_crc32[i] = c;
+    }
+}
+
+
+void VIDEO_HEADLESS_Init (struct VIDEO_HEADLESS *const S,
+                          const struct VIDEO_IFACE *const Iface,
+                          uint8_t *const FramebufferA,
+                          uint8_t *const FramebufferB,
+                          const struct VIDEO_HEADLESS_Config *const Config)
+{
+    BOARD_AssertParams (S && Config);
+    BOARD_AssertParams (Config->capture == VIDEO_HEADLESS_Capture_None ||
+                        Config->capturePrefix);
+
+    S->config = *Config;
+
+    VIDEO_Init ((struct VIDEO *)S, Iface, FramebufferA, FramebufferB);
+}
+
+
+static FILE * openCaptureFile (struct VIDEO *const V,
+                               const char *const Filename,
+                               const char *const Mode)
+{
+    FILE *const F = fopen (Filename, Mode);
+
+    if (!F)
+    {
+        struct VIDEO_HEADLESS *const S = (struct VIDEO_HEADLESS *) V;
+
+        LOG_WarnDebug (V, LANG_ERROR_OPENING_FILE);
+        LOG_Items (1, LANG_FILENAME, Filename);
+
+        // Not retried on every frame
+        S->config.capture = VIDEO_HEADLESS_Capture_None;
+    }
+
+    return F;
+}
+
+
+void VIDEO_HEADLESS__hardwareInit (struct VIDEO *const V)
+{
+    struct VIDEO_HEADLESS *const S = (struct VIDEO_HEADLESS *) V;
+
+    initTables ();
+
+    if (S->config.capture == VIDEO_HEADLESS_Capture_Checksum)
+    {
+        char filename[CAPTURE_FILENAME_MAX];
+
+        snprintf (filename, sizeof(filename), "%s" CHECKSUMS_FILENAME_STR,
+                  S->config.capturePrefix);
+
+        S->checksums = openCaptureFile (V, filename, "w");
+    }
+
+    V->adapterDescription   = NULL;
+    V->adapterSignal        = DRIVER_SIGNAL_STR;
+    V->adapterModeline      = NULL;
+    V->adapterBuild         = NULL;
+
+    S->vbiStartedTicks = TICKS_Now ();
+    S->firstFrameTicks = S->vbiStartedTicks;
+}
+
+
+static uint32_t crc32Update (uint32_t crc, const uint8_t *const Data,
+                             const size_t Octets)
+{
+    for (size_t i = 0; i < Octets; ++i)
+    {
+        crc = s_crc32[(crc ^ Data[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc;
+}
+
+
+static void put32 (uint8_t *const Data, const uint32_t Value)
+{
+    Data[0] = (uint8_t)(Value >> 24);
+    Data[1] = (uint8_t)(Value >> 16);
+    Data[2] = (uint8_t)(Value >> 8);
+    Data[3] = (uint8_t)(Value);
+}
+
+
+struct PngChunk
+{
+    FILE        * file;
+    uint32_t    crc;
+};
+
+
+static void pngChunkBegin (struct PngChunk *const C, const char *const Type,
+                           const uint32_t Octets)
+{
+    uint8_t header[8];
+
+    put32 (header, Octets);
+    memcpy (&header[4], Type, 4);
+
+    fwrite (header, 1, sizeof(header), C->file);
+
+    // Chunk length excluded
+    C->crc = crc32Update (0xFFFFFFFF, &header[4], 4);
+}
+
+
+static void pngChunkData (struct PngChunk *const C, const void *const Data,
+                          const size_t Octets)
+{
+    fwrite (Data, 1, Octets, C->file);
+    C->crc = crc32Update (C->crc, Data, Octets);
+}
+
+
+static void pngChunkEnd (struct PngChunk *const C)
+{
+    uint8_t crc[4];
+
+    put32 (crc, C->crc ^ 0xFFFFFFFF);
+    fwrite (crc, 1, sizeof(crc), C->file);
+}
+
+
+// Indexed color image with the RGB332 palette; pixels are stored as-is.
+// Image data is a zlib stream of uncompressed deflate blocks, one per line,
+// so no compression library is needed.
+static void writePng (struct VIDEO *const V, FILE *const F)
+{
+    static const uint8_t Signature[8] =
+                            { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    const uint32_t Width    = V->iface->Width;
+    const uint32_t Height   = V->iface->Height;
+    const uint32_t Line     = Width + 1;
+
+    struct PngChunk c = { .file = F };
+
+    fwrite (Signature, 1, sizeof(Signature), F);
+
+    {
+        // Bit depth 8, indexed color, deflate, adaptive filtering, progressive
+        uint8_t ihdr[13] = { [8] = 8, [9] = 3 };
+
+        put32 (&ihdr[0], Width);
+        put32 (&ihdr[4], Height);
+
+        pngChunkBegin   (&c, "IHDR", sizeof(ihdr));
+        pngChunkData    (&c, ihdr, sizeof(ihdr));
+        pngChunkEnd     (&c);
+    }
+
+    pngChunkBegin   (&c, "PLTE", sizeof(s_rgb));
+    pngChunkData    (&c, s_rgb, sizeof(s_rgb));
+    pngChunkEnd     (&c);
+
+    // zlib header, a 5 octets block header per line and Adler-32
+    pngChunkBegin (&c, "IDAT", 2 + Height * (5 + Line) + 4);
+
+    {
+        // Deflate, 32 KiB window, no dictionary, fastest
+        static const uint8_t ZlibHeader[2] = { 0x78, 0x01 };
+        pngChunkData (&c, ZlibHeader, sizeof(ZlibHeader));
+    }
+
+    uint32_t adlerA = 1;
+    uint32_t adlerB = 0;
+
+    for (uint32_t y = 0; y < Height; ++y)
+    {
+        const uint8_t *const Pixels = &V->frontbuffer[y * Width];
+
+        // Stored block, final on the last line. Line octets, then its one's
+        // complement, both little-endian. Filter type 0 (none).
+        const uint8_t Block[6] =
+        {
+            (y == Height - 1)? 1 : 0,
+            (uint8_t)(Line), (uint8_t)(Line >> 8),
+            (uint8_t)(~Line), (uint8_t)(~Line >> 8),
+            0
+        };
+
+        pngChunkData (&c, Block, sizeof(Block));
+        pngChunkData (&c, Pixels, Width);
+
+        // Adler-32 of uncompressed data: filter type and pixels
+        adlerB = (adlerB + adlerA) % 65521;
+
+        for (uint32_t x = 0; x < Width; ++x)
+        {
+            adlerA = (adlerA + Pixels[x]) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+        }
+    }
+
+    {
+        uint8_t adler[4];
+
+        put32 (adler, adlerB << 16 | adlerA);
+        pngChunkData (&c, adler, sizeof(adler));
+    }
+
+    pngChunkEnd (&c);
+
+    pngChunkBegin   (&c, "IEND", 0);
+    pngChunkEnd     (&c);
+}
+
+
+static void writePpm (struct VIDEO *const V, FILE *const F)
+{
+    const uint32_t Width    = V->iface->Width;
+    const uint32_t Height   = V->iface->Height;
+
+    fprintf (F, "P6\n%u %u\n255\n", (unsigned) Width, (unsigned) Height);
+
+    for (uint32_t i = 0; i < Width * Height; ++i)
+    {
+        fwrite (s_rgb[V->frontbuffer[i]], 1, 3, F);
+    }
+}
+
+
+// Captures the frontbuffer as drawn, without scanline or color operations
+// that other drivers apply on presentation.
+static void capture (struct VIDEO *const V)
+{
+    struct VIDEO_HEADLESS *const S = (struct VIDEO_HEADLESS *) V;
+
+    const uint32_t Frame = S->presentedFrames;
+
+    if (Frame < S->config.captureFirst || (S->config.captureCount &&
+            S->capturedFrames >= S->config.captureCount))
+    {
+        return;
+    }
+
+    switch (S->config.capture)
+    {
+        case VIDEO_HEADLESS_Capture_None:
+            return;
+
+        case VIDEO_HEADLESS_Capture_Checksum:
+        {
+            const uint32_t Crc = CRC32C_Update (0, V->frontbuffer,
+                                        V->iface->Width * V->iface->Height);
+
+            fprintf (S->checksums, "%06u %08x\n", (unsigned) Frame,
+                                                  (unsigned) Crc);
+            // Complete up to the last frame if the process is killed
+            fflush (S->checksums);
+            break;
+        }
+
+        case VIDEO_HEADLESS_Capture_Ppm:
+        case VIDEO_HEADLESS_Capture_Png:
+        {
+            const bool Png = (S->config.capture == VIDEO_HEADLESS_Capture_Png);
+            char filename[CAPTURE_FILENAME_MAX];
+
+            snprintf (filename, sizeof(filename), "%s%06u.%s",
+                      S->config.capturePrefix, (unsigned) Frame,
+                      Png? "png" : "ppm");
+
+            FILE *const F = openCaptureFile (V, filename, "wb");
+
+            if (!F)
+            {
+                return;
+            }
+
+            if (Png)
+            {
+                writePng (V, F);
+            }
+            else
+            {
+                writePpm (V, F);
+            }
+
+            fclose (F);
+            break;
+        }
+    }
+
+    ++ S->capturedFrames;
+}
+
+
+bool VIDEO_HEADLESS__reachedVBICount (struct VIDEO *const V)
+{
+    struct VIDEO_HEADLESS *const S = (struct VIDEO_HEADLESS *) V;
+
+    const TIMER_Ticks TimeoutTicks = S->vbiStartedTicks +
+                                        V->waitVbiCount * S->config.vbiPeriod;
+
+    return (TimeoutTicks <= TICKS_Now())? true : false;
+}
+
+
+void VIDEO_HEADLESS__waitForVBI (struct VIDEO *const V)
+{
+    struct VIDEO_HEADLESS *const S = (struct VIDEO_HEADLESS *) V;
+
+    // Presenting a frame means capturing it, if requested
+    const TIMER_Ticks CaptureStart = TICKS_Now ();
+    capture (V);
+
+    VIDEO__presented (V, TICKS_Now() - CaptureStart);
+
+    ++ S->presentedFrames;
+
+    if (S->config.vbiPeriod && V->waitVbiCount)
+    {
+        const TIMER_Ticks Now = TICKS_Now ();
+        const TIMER_Ticks Period = S->config.vbiPeriod;
+
+        TIMER_Ticks timeoutTicks = S->vbiStartedTicks +
+                                        V->waitVbiCount * Period;
+
+        // Missed the virtual VBI mark; wait for the next one to synchronize
+        if (timeoutTicks < Now)
+        {
+            const TIMER_Ticks Missed = (Now - timeoutTicks) / Period + 1;
+
+            V->vbiCountMisses   += (uint32_t) Missed;
+            timeoutTicks        += Missed * Period;
+        }
+
+        TICKS_Delay (timeoutTicks - Now);
+    }
+
+    S->vbiStartedTicks = TICKS_Now ();
+}
+
+
+void VIDEO_HEADLESS__shutdown (struct VIDEO *const V)
+{
+    struct VIDEO_HEADLESS *const S = (struct VIDEO_HEADLESS *) V;
+
+    // Frame time summary for benchmarks
+    LOG (V, LANG_FRAME_SUMMARY);
+    LOG_Items (5,
+                LANG_FRAMES,            S->presentedFrames,
+                LANG_TICKS,             (uint32_t)(TICKS_Now() -
+                                                    S->firstFrameTicks),
+                LANG_VBI_MISSES,        V->vbiCountMisses,
+                LANG_DROPPED_FRAMES,    V->droppedFrames,
+                LANG_REPEATED_FRAMES,   V->repeatedFrames);
+
+    // Phase timings of the last frames
+    VIDEO_PACING_Log (&V->pacing);
+
+    if (S->checksums)
+    {
+        fclose (S->checksums);
+        S->checksums = NULL;
+    }
+}
@@ -0,0 +1,90 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+
+  [VIDEO driver] headless rgb332 framebuffer with frame capture.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "embedul.ar/source/core/device/video.h"
+#include "embedul.ar/source/core/timer.h"
+#include <stdio.h>
+
+
+#define VIDEO_HEADLESS_IFACE(_desc,_w,_h) \
+    .Description        = _desc, \
+    .Width              = _w, \
+    .Height             = _h, \
+    .HardwareInit       = VIDEO_HEADLESS__hardwareInit, \
+    .ReachedVBICount    = VIDEO_HEADLESS__reachedVBICount, \
+    .WaitForVBI         = VIDEO_HEADLESS__waitForVBI, \
+    .Shutdown           = VIDEO_HEADLESS__shutdown
+
+
+enum VIDEO_HEADLESS_Capture
+{
+    VIDEO_HEADLESS_Capture_None = 0,
+    // One "<frame> <crc32c>" line per frame in <prefix>checksums.txt
+    VIDEO_HEADLESS_Capture_Checksum,
+    // One <prefix><frame>.ppm (rgb888) or .png (indexed) file per frame
+    VIDEO_HEADLESS_Capture_Ppm,
+    VIDEO_HEADLESS_Capture_Png
+};
+
+
+struct VIDEO_HEADLESS_Config
+{
+    // Virtual vertical blanking interval period. Zero runs unthrottled.
+    TIMER_Ticks                     vbiPeriod;
+    enum VIDEO_HEADLESS_Capture     capture;
+    const char                      * capturePrefix;
+    // Frames presented before the first capture. Zero captures all of them.
+    uint32_t                        captureFirst;
+    // Frames captured. Zero captures until shutdown.
+    uint32_t                        captureCount;
+};
+
+
+struct VIDEO_HEADLESS
+{
+    struct VIDEO                    device;
+    struct VIDEO_HEADLESS_Config    config;
+    FILE                            * checksums;
+    TIMER_Ticks                     vbiStartedTicks;
+    TIMER_Ticks                     firstFrameTicks;
+    uint32_t                        presentedFrames;
+    uint32_t                        capturedFrames;
+};
+
+
+void    VIDEO_HEADLESS_Init         (struct VIDEO_HEADLESS *const S,
+                                     const struct VIDEO_IFACE *const Iface,
+                                     uint8_t *const FramebufferA,
+                                     uint8_t *const FramebufferB,
+                                     const struct VIDEO_HEADLESS_Config
+                                                                *const Config);
+void    VIDEO_HEADLESS__hardwareInit
+                                    (struct VIDEO *const V);
+bool    VIDEO_HEADLESS__reachedVBICount
+                                    (struct VIDEO *const V);
+void    VIDEO_HEADLESS__waitForVBI  (struct VIDEO *const V);
+void    VIDEO_HEADLESS__shutdown    (struct VIDEO *const V);
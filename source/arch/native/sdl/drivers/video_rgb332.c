@@ -26,10 +26,17 @@
 #include "embedul.ar/source/arch/native/sdl/drivers/video_rgb332.h"
 #include "embedul.ar/source/core/device/board.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+    #include <tmmintrin.h>
+#elif defined(__aarch64__)
+    #include <arm_neon.h>
+#endif
+
 
 #define CREATE_WINDOW_FAILED_STR        "SDL_CreateWindow() failed"
+#define CREATE_RENDERER_FAILED_STR      "SDL_CreateRenderer() failed"
+#define CREATE_TEXTURE_FAILED_STR       "SDL_CreateTexture() failed"
 #define CREATE_SURFACE_FAILED_STR       "SDL_CreateRGBSurface() failed"
-#define SET_SURFACE_COLORS_FAILED_STR   "SDL_SetPaletteColors() failed"
 #define DRIVER_SIGNAL_STR               "sdl window"
 
 
@@ -37,6 +44,158 @@
 // desktop operating system will be scheduled with 10 ms granularity at best.
 #define FRAME_PERIOD_MS       1
 
+// Display refresh rates paced by vsync instead of the VBI emulation.
+#define VSYNC_REFRESH_MIN_HZ  59
+#define VSYNC_REFRESH_MAX_HZ  61
+
+
+// Display buffer line segment converted from RGB332 to ARGB8888.
+typedef void (* ConvertFunc)(uint32_t *const Dst, const uint8_t *const Src,
+                             const uint32_t Pixels);
+
+
+// RGB332 color components expanded to 8 bits. The SIMD conversions look
+// them up sixteen pixels at a time. The scalar one uses the whole palette.
+static uint8_t  s_red[16];
+static uint8_t  s_green[16];
+static uint8_t  s_blue[16];
+static uint32_t s_argb[256];
+
+
+static void convertScalar (uint32_t *const Dst, const uint8_t *const Src,
+                           const uint32_t Pixels)
+{
+    for (uint32_t i = 0; i < Pixels; ++i)
+    {
+        Dst[i] = s_argb[Src[i]];
+    }
+}
+
+
+#if defined(__x86_64__) || defined(__i386__)
+// Selected on hosts that support SSSE3; the build targets the baseline
+// instruction set. ARGB8888 octets are stored B, G, R, A in memory.
+__attribute__((target("ssse3")))
+static void convertSsse3 (uint32_t *const Dst, const uint8_t *const Src,
+                          const uint32_t Pixels)
+{
+    const __m128i Red   = _mm_loadu_si128 ((const __m128i *)s_red);
+    const __m128i Green = _mm_loadu_si128 ((const __m128i *)s_green);
+    const __m128i Blue  = _mm_loadu_si128 ((const __m128i *)s_blue);
+    const __m128i Alpha = _mm_set1_epi8 ((char)0xFF);
+    const __m128i Mask3 = _mm_set1_epi8 (0x07);
+    const __m128i Mask2 = _mm_set1_epi8 (0x03);
+
+    uint32_t i = 0;
+
+    for (; i + 16 <= Pixels; i += 16)
+    {
+        const __m128i P = _mm_loadu_si128 ((const __m128i *)&Src[i]);
+
+        const __m128i R = _mm_shuffle_epi8 (Red,
+                            _mm_and_si128 (_mm_srli_epi16 (P, 5), Mask3));
+        const __m128i G = _mm_shuffle_epi8 (Green,
+                            _mm_and_si128 (_mm_srli_epi16 (P, 2), Mask3));
+        const __m128i B = _mm_shuffle_epi8 (Blue, _mm_and_si128 (P, Mask2));
+
+        const __m128i BgLo = _mm_unpacklo_epi8 (B, G);
+        const __m128i BgHi = _mm_unpackhi_epi8 (B, G);
+        const __m128i RaLo = _mm_unpacklo_epi8 (R, Alpha);
+        const __m128i RaHi = _mm_unpackhi_epi8 (R, Alpha);
+
+        __m128i *const D = (__m128i *) &Dst[i];
+
+        _mm_storeu_si128 (&D[0], _mm_unpacklo_epi16 (BgLo, RaLo));
+        _mm_storeu_si128 (&D[1], _mm_unpackhi_epi16 (BgLo, RaLo));
+        _mm_storeu_si128 (&D[2], _mm_unpacklo_epi16 (BgHi, RaHi));
+        _mm_storeu_si128 (&D[3], _mm_unpackhi_epi16 (BgHi, RaHi));
+    }
+
+    convertScalar (&Dst[i], &Src[i], Pixels - i);
+}
+#elif defined(__aarch64__)
+static void convertNeon (uint32_t *const Dst, const uint8_t *const Src,
+                         const uint32_t Pixels)
+{
+    const uint8x16_t Red    = vld1q_u8 (s_red);
+    const uint8x16_t Green  = vld1q_u8 (s_green);
+    const uint8x16_t Blue   = vld1q_u8 (s_blue);
+
+    uint32_t i = 0;
+
+    for (; i + 16 <= Pixels; i += 16)
+    {
+        const uint8x16_t P = vld1q_u8 (&Src[i]);
+
+        const uint8x16x4_t Bgra = {{
+            vqtbl1q_u8 (Blue,  vandq_u8 (P, vdupq_n_u8 (0x03))),
+            vqtbl1q_u8 (Green, vandq_u8 (vshrq_n_u8 (P, 2), vdupq_n_u8 (0x07))),
+            vqtbl1q_u8 (Red,   vshrq_n_u8 (P, 5)),
+            vdupq_n_u8 (0xFF)
+        }};
+
+        vst4q_u8 ((uint8_t *) &Dst[i], Bgra);
+    }
+
+    convertScalar (&Dst[i], &Src[i], Pixels - i);
+}
+#endif
+
+
+static ConvertFunc s_convert = convertScalar;
+
+
+static void initConversion (void)
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        s_red[i]    = (uint8_t) ((i / 7.0) * 255.0);
+        s_green[i]  = (uint8_t) ((i / 7.0) * 255.0);
+    }
+
+    for (int i = 0; i < 4; ++i)
+    {
+        s_blue[i]   = (uint8_t) ((i / 3.0) * 255.0);
+    }
+
+    for (int i = 0; i < 256; ++i)
+    {
+        s_argb[i] = 0xFF000000 | (uint32_t)s_red[i >> 5] << 16 |
+                    (uint32_t)s_green[(i >> 2) & 0x7] << 8 |
+                    s_blue[i & 0x3];
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports ("ssse3"))
+    {
+        s_convert = convertSsse3;
+    }
+#elif defined(__aarch64__)
+    s_convert = convertNeon;
+#endif
+}
+
+
+// Vsync pacing needs a display close to the emulated 60 Hz refresh and the
+// ability to turn it off for unthrottled frames.
+static bool vsyncPaces (SDL_Window *const Window)
+{
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    SDL_DisplayMode mode;
+
+    if (SDL_GetWindowDisplayMode (Window, &mode))
+    {
+        return false;
+    }
+
+    return (mode.refresh_rate >= VSYNC_REFRESH_MIN_HZ &&
+            mode.refresh_rate <= VSYNC_REFRESH_MAX_HZ)? true : false;
+#else
+    (void) Window;
+    return false;
+#endif
+}
+
 
 void VIDEO_RGB332__hardwareInit (struct VIDEO *const V)
 {
@@ -65,9 +224,7 @@ void VIDEO_RGB332__hardwareInit (struct VIDEO *const V)
                                         0);
     }
 
-    S->displaySurface = SDL_GetWindowSurface (S->displayWindow);
-
-    if (!S->displayWindow || !S->displaySurface)
+    if (!S->displayWindow)
     {
         LOG_WarnDebug (V, CREATE_WINDOW_FAILED_STR);
         LOG_Items (1, LANG_ERROR, SDL_GetError());
@@ -77,38 +234,70 @@ void VIDEO_RGB332__hardwareInit (struct VIDEO *const V)
 
     S->windowId = SDL_GetWindowID (S->displayWindow);
 
-    S->displayBuffer = SDL_CreateRGBSurface (SDL_SWSURFACE,
-                                             S->displayWidth,
-                                             S->displayHeight,
-                                             8,
-                                             0, 0, 0, 0);
-    if (!S->displayBuffer)
+    const bool Vsync = S->vsync && vsyncPaces (S->displayWindow);
+
+    // Hardware accelerated, presenting on vertical sync if requested.
+    // Software rendering on machines without a usable GPU.
+    S->displayRenderer = SDL_CreateRenderer (S->displayWindow, -1,
+                                    SDL_RENDERER_ACCELERATED |
+                                    (Vsync? SDL_RENDERER_PRESENTVSYNC : 0));
+    if (!S->displayRenderer)
     {
-        LOG_WarnDebug (V, CREATE_SURFACE_FAILED_STR);
+        S->displayRenderer = SDL_CreateRenderer (S->displayWindow, -1,
+                                                 SDL_RENDERER_SOFTWARE);
+    }
+
+    if (!S->displayRenderer)
+    {
+        LOG_WarnDebug (V, CREATE_RENDERER_FAILED_STR);
         LOG_Items (1, LANG_ERROR, SDL_GetError());
 
         BOARD_AssertInitialized (false);
     }
 
-    SDL_Color rgb332[256];
+    SDL_RendererInfo info;
 
-    for (int i = 0; i < 256; ++i)
+    if (SDL_GetRendererInfo (S->displayRenderer, &info))
     {
-        rgb332[i].r = (uint8_t) (((i >> 5) / 7.0) * 255.0);
-        rgb332[i].g = (uint8_t) ((((i >> 2) & 0x7) / 7.0) * 255.0);
-        rgb332[i].b = (uint8_t) (((i & 0x3) / 3.0) * 255.0);
+        info.name   = NULL;
+        info.flags  = 0;
     }
 
-    if (SDL_SetPaletteColors (S->displayBuffer->format->palette,
-                              rgb332, 0, 256))
+    S->presentVsync = (info.flags & SDL_RENDERER_PRESENTVSYNC)? true : false;
+    S->presentWaits = S->presentVsync;
+
+    S->displayTexture = SDL_CreateTexture (S->displayRenderer,
+                                           SDL_PIXELFORMAT_ARGB8888,
+                                           SDL_TEXTUREACCESS_STREAMING,
+                                           S->displayWidth,
+                                           S->displayHeight);
+    if (!S->displayTexture)
+    {
+        LOG_WarnDebug (V, CREATE_TEXTURE_FAILED_STR);
+        LOG_Items (1, LANG_ERROR, SDL_GetError());
+
+        BOARD_AssertInitialized (false);
+    }
+
+    // RGB332 pixels written by the driver, converted to the texture format
+    // on changed regions only.
+    S->displayBuffer = SDL_CreateRGBSurface (SDL_SWSURFACE,
+                                             S->displayWidth,
+                                             S->displayHeight,
+                                             8,
+                                             0, 0, 0, 0);
+    if (!S->displayBuffer)
     {
-        LOG_WarnDebug (V, SET_SURFACE_COLORS_FAILED_STR);
+        LOG_WarnDebug (V, CREATE_SURFACE_FAILED_STR);
         LOG_Items (1, LANG_ERROR, SDL_GetError());
 
-        BOARD_AssertInitialized (false);  
+        BOARD_AssertInitialized (false);
     }
 
-    V->adapterDescription   = NULL;
+    initConversion ();
+
+    // Renderer in use, as reported by SDL
+    V->adapterDescription   = info.name;
     V->adapterSignal        = DRIVER_SIGNAL_STR;
     V->adapterModeline      = NULL;
     V->adapterBuild         = NULL;
@@ -137,10 +326,81 @@ static void unlockSurface (SDL_Surface *const Surface)
 }
 
 
-static void updateScreen (struct VIDEO *const V)
+// Draws the texture on the whole window. Waits for the display vertical
+// sync when presenting on vsync.
+static void present (struct VIDEO_RGB332 *const S)
+{
+    SDL_RenderCopy      (S->displayRenderer, S->displayTexture, NULL, NULL);
+    SDL_RenderPresent   (S->displayRenderer);
+}
+
+
+// Converts a display buffer rect to the texture format.
+static void streamRect (struct VIDEO_RGB332 *const S, const SDL_Rect *const R)
+{
+    void *pixels;
+    int pitch;
+
+    if (SDL_LockTexture (S->displayTexture, R, &pixels, &pitch))
+    {
+        return;
+    }
+
+    const uint8_t *b = (const uint8_t *) S->displayBuffer->pixels +
+                                R->y * S->displayBuffer->pitch + R->x;
+    uint8_t *t = (uint8_t *) pixels;
+
+    for (int h = 0; h < R->h; ++h)
+    {
+        s_convert ((uint32_t *) t, b, (uint32_t) R->w);
+
+        b += S->displayBuffer->pitch;
+        t += pitch;
+    }
+
+    SDL_UnlockTexture (S->displayTexture);
+}
+
+
+// Unthrottled frames present without waiting for the display refresh.
+static void updatePresentWaits (struct VIDEO *const V)
 {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
     struct VIDEO_RGB332 *const S = (struct VIDEO_RGB332 *) V;
 
+    const bool Waits = V->waitVbiCount? true : false;
+
+    if (S->presentWaits != Waits &&
+        !SDL_RenderSetVSync (S->displayRenderer, Waits? 1 : 0))
+    {
+        S->presentWaits = Waits;
+    }
+#else
+    (void) V;
+#endif
+}
+
+
+// Returns true if the display was presented.
+static bool updateScreen (struct VIDEO *const V)
+{
+    struct VIDEO_RGB332 *const S = (struct VIDEO_RGB332 *) V;
+
+    struct VIDEO_Span spans[VIDEO_DIRTY_BANDS];
+    const uint32_t SpanCount = VIDEO_PresentSpans (V, spans);
+
+    if (!SpanCount)
+    {
+        // Frontbuffer unchanged. Presenting on vsync still paces the frame.
+        if (S->presentWaits && V->waitVbiCount)
+        {
+            present (S);
+            return true;
+        }
+
+        return false;
+    }
+
     uint8_t *const Surface = lockSurface (S->displayBuffer);
     // SDL_Surface lock failed
     BOARD_AssertState (Surface);
@@ -156,18 +416,34 @@ static void updateScreen (struct VIDEO *const V)
         .ScanOr32       = (uint32_t)(V->scanOr  << 24 | V->scanOr   << 16 |
                                      V->scanOr  <<  8 | V->scanOr),
         .Surface        = Surface,
-        .SurfacePitch   = S->displayBuffer->pitch
+        .SurfacePitch   = S->displayBuffer->pitch,
+        .Spans          = spans,
+        .SpanCount      = SpanCount
     };
 
     S->updateSurface (V, &Ui);
 
+    // Framebuffer spans to display buffer rects
+    const int ScaleX = S->displayWidth / V->iface->Width;
+    const int ScaleY = S->displayHeight / V->iface->Height;
+
+    for (uint32_t i = 0; i < SpanCount; ++i)
+    {
+        const SDL_Rect Rect = {
+            .x = spans[i].x * ScaleX,
+            .y = spans[i].y * ScaleY,
+            .w = spans[i].width * ScaleX,
+            .h = spans[i].height * ScaleY
+        };
+
+        streamRect (S, &Rect);
+    }
+
     unlockSurface (S->displayBuffer);
 
-    SDL_BlitSurface (S->displayBuffer, NULL, S->displaySurface, NULL);
-    
-    const int Result = SDL_UpdateWindowSurface (S->displayWindow);
+    present (S);
 
-    BOARD_AssertState (!Result);
+    return true;
 }
 
 
@@ -190,9 +466,25 @@ void VIDEO_RGB332__waitForVBI (struct VIDEO *const V)
     // The frame buffer is continuously sent to the video signal port on a
     // hardware device. On simulated devices, the screen update happens before
     // waiting for the VBI.
-    updateScreen (V);
+    if (S->presentVsync)
+    {
+        updatePresentWaits (V);
+    }
+
+    const uint32_t PresentStart = SDL_GetTicks ();
+    const bool Presented = updateScreen (V);
 
-    if (V->waitVbiCount)
+    VIDEO__presented (V, SDL_GetTicks() - PresentStart);
+
+    if (S->presentWaits)
+    {
+        // Each present waits for one display refresh
+        for (uint32_t i = Presented? 1 : 0; i < V->waitVbiCount; ++i)
+        {
+            present (S);
+        }
+    }
+    else if (V->waitVbiCount)
     {
         const uint32_t Now = SDL_GetTicks ();
 
@@ -220,6 +512,21 @@ void VIDEO_RGB332__shutdown (struct VIDEO *const V)
 {
     struct VIDEO_RGB332 *const S = (struct VIDEO_RGB332 *) V;
 
+    if (S->shutdown)
+    {
+        S->shutdown (V);
+    }
+
+    if (S->displayTexture)
+    {
+        SDL_DestroyTexture (S->displayTexture);
+    }
+
+    if (S->displayRenderer)
+    {
+        SDL_DestroyRenderer (S->displayRenderer);
+    }
+
     if (S->displayWindow)
     {
         SDL_DestroyWindow (S->displayWindow);
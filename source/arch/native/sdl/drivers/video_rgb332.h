@@ -48,25 +48,44 @@ struct VIDEO_RGB332_UpdateInfo
     const uint32_t  ScanOr32;
     uint8_t         *const Surface;
     const uint32_t  SurfacePitch;
+    // Frontbuffer regions that changed since the last update
+    const struct VIDEO_Span
+                    *const Spans;
+    const uint32_t  SpanCount;
 };
 
 
 typedef void    (* VIDEO_RGB332_UpdateSurfaceFunc)(struct VIDEO *const V,
                         const struct VIDEO_RGB332_UpdateInfo *const Ui);
+typedef void    (* VIDEO_RGB332_ShutdownFunc)(struct VIDEO *const V);
 
 
 struct VIDEO_RGB332
 {
     struct VIDEO    device;
     SDL_Window      * displayWindow;
-    SDL_Surface     * displaySurface;
+    // Display buffer contents, converted to ARGB8888 where changed, stream
+    // to this texture. The renderer draws it scaled to the window.
+    SDL_Renderer    * displayRenderer;
+    SDL_Texture     * displayTexture;
     SDL_Surface     * displayBuffer;
     uint32_t        vbiStartedTicks;
     uint32_t        windowId;
     VIDEO_RGB332_UpdateSurfaceFunc
                     updateSurface;
+    // Optional. Releases driver resources before the display is destroyed.
+    VIDEO_RGB332_ShutdownFunc
+                    shutdown;
     uint16_t        displayWidth;
     uint16_t        displayHeight;
+    // Set by the driver to pace frames with the display refresh instead of
+    // emulating the VBI with delays. Only takes effect if the renderer
+    // supports it and the display refreshes at about 60 Hz.
+    bool            vsync;
+    bool            presentVsync;
+    // Presents currently wait for the display refresh. Off while frames
+    // are not throttled.
+    bool            presentWaits;
 };
 
 
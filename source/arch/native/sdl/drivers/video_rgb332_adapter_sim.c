@@ -27,9 +27,26 @@
 #include "embedul.ar/source/arch/native/sdl/drivers/video_rgb332_adapter_sim.h"
 #include "embedul.ar/source/core/device/board.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+    #include <tmmintrin.h>
+#elif defined(__aarch64__)
+    #include <arm_neon.h>
+#endif
+
+
+// Updates with fewer changed framebuffer lines are scaled by the caller alone
+#define PARALLEL_MIN_LINES      16
+
+
+// Framebuffer line segment replicated horizontally, each pixel 5 times.
+typedef void (* ExpandFunc)(uint8_t *const Dst, const uint8_t *const Src,
+                            const uint32_t Pixels);
 
-static void updateSurface (struct VIDEO *const V,
-                           const struct VIDEO_RGB332_UpdateInfo *const Ui);
+
+static void     updateSurface   (struct VIDEO *const V,
+                                 const struct VIDEO_RGB332_UpdateInfo *const Ui);
+static int      workerRun       (void *Param);
+static void     shutdown        (struct VIDEO *const V);
 
 
 static const struct VIDEO_IFACE VIDEO_IFACE_ADAPTER_SIM =
@@ -38,74 +55,350 @@ static const struct VIDEO_IFACE VIDEO_IFACE_ADAPTER_SIM =
 };
 
 
+static void expandScalar (uint8_t *const Dst, const uint8_t *const Src,
+                          const uint32_t Pixels)
+{
+    for (uint32_t w = 0, whd = 0; w < Pixels; ++w, whd += 5)
+    {
+        Dst[whd+0] = Src[w];
+        Dst[whd+1] = Src[w];
+        Dst[whd+2] = Src[w];
+        Dst[whd+3] = Src[w];
+        Dst[whd+4] = Src[w];
+    }
+}
+
+
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+// Source pixel of each of the 80 octets 16 pixels expand to.
+static const uint8_t s_ExpandShuffle[5][16] =
+{
+    {  0,  0,  0,  0,  0,  1,  1,  1,  1,  1,  2,  2,  2,  2,  2,  3 },
+    {  3,  3,  3,  3,  4,  4,  4,  4,  4,  5,  5,  5,  5,  5,  6,  6 },
+    {  6,  6,  6,  7,  7,  7,  7,  7,  8,  8,  8,  8,  8,  9,  9,  9 },
+    {  9,  9, 10, 10, 10, 10, 10, 11, 11, 11, 11, 11, 12, 12, 12, 12 },
+    { 12, 13, 13, 13, 13, 13, 14, 14, 14, 14, 14, 15, 15, 15, 15, 15 }
+};
+#endif
+
+
+#if defined(__x86_64__) || defined(__i386__)
+// Selected on hosts that support SSSE3; the build targets the baseline
+// instruction set.
+__attribute__((target("ssse3")))
+static void expandSsse3 (uint8_t *const Dst, const uint8_t *const Src,
+                         const uint32_t Pixels)
+{
+    const __m128i M0 = _mm_loadu_si128 ((const __m128i *)s_ExpandShuffle[0]);
+    const __m128i M1 = _mm_loadu_si128 ((const __m128i *)s_ExpandShuffle[1]);
+    const __m128i M2 = _mm_loadu_si128 ((const __m128i *)s_ExpandShuffle[2]);
+    const __m128i M3 = _mm_loadu_si128 ((const __m128i *)s_ExpandShuffle[3]);
+    const __m128i M4 = _mm_loadu_si128 ((const __m128i *)s_ExpandShuffle[4]);
+
+    uint32_t w = 0;
+
+    for (; w + 16 <= Pixels; w += 16)
+    {
+        const __m128i P = _mm_loadu_si128 ((const __m128i *)&Src[w]);
+        __m128i *const D = (__m128i *) &Dst[w * 5];
+
+        _mm_storeu_si128 (&D[0], _mm_shuffle_epi8 (P, M0));
+        _mm_storeu_si128 (&D[1], _mm_shuffle_epi8 (P, M1));
+        _mm_storeu_si128 (&D[2], _mm_shuffle_epi8 (P, M2));
+        _mm_storeu_si128 (&D[3], _mm_shuffle_epi8 (P, M3));
+        _mm_storeu_si128 (&D[4], _mm_shuffle_epi8 (P, M4));
+    }
+
+    expandScalar (&Dst[w * 5], &Src[w], Pixels - w);
+}
+#elif defined(__aarch64__)
+static void expandNeon (uint8_t *const Dst, const uint8_t *const Src,
+                        const uint32_t Pixels)
+{
+    const uint8x16_t M0 = vld1q_u8 (s_ExpandShuffle[0]);
+    const uint8x16_t M1 = vld1q_u8 (s_ExpandShuffle[1]);
+    const uint8x16_t M2 = vld1q_u8 (s_ExpandShuffle[2]);
+    const uint8x16_t M3 = vld1q_u8 (s_ExpandShuffle[3]);
+    const uint8x16_t M4 = vld1q_u8 (s_ExpandShuffle[4]);
+
+    uint32_t w = 0;
+
+    for (; w + 16 <= Pixels; w += 16)
+    {
+        const uint8x16_t P = vld1q_u8 (&Src[w]);
+        uint8_t *const D = &Dst[w * 5];
+
+        vst1q_u8 (&D[0],  vqtbl1q_u8 (P, M0));
+        vst1q_u8 (&D[16], vqtbl1q_u8 (P, M1));
+        vst1q_u8 (&D[32], vqtbl1q_u8 (P, M2));
+        vst1q_u8 (&D[48], vqtbl1q_u8 (P, M3));
+        vst1q_u8 (&D[64], vqtbl1q_u8 (P, M4));
+    }
+
+    expandScalar (&Dst[w * 5], &Src[w], Pixels - w);
+}
+#endif
+
+
+static ExpandFunc s_expand = expandScalar;
+
+
+static void stopWorkers (struct VIDEO_RGB332_ADAPTER_SIM *const S)
+{
+    if (!S->mutex)
+    {
+        return;
+    }
+
+    SDL_LockMutex (S->mutex);
+    S->quit = true;
+    SDL_CondBroadcast (S->started);
+    SDL_UnlockMutex (S->mutex);
+
+    for (uint32_t i = 0; i < VIDEO_RGB332_ADAPTER_SIM_WORKERS; ++i)
+    {
+        SDL_WaitThread (S->worker[i].thread, NULL);
+        S->worker[i].thread = NULL;
+    }
+
+    SDL_DestroyCond     (S->finished);
+    SDL_DestroyCond     (S->started);
+    SDL_DestroyMutex    (S->mutex);
+
+    S->finished = NULL;
+    S->started  = NULL;
+    S->mutex    = NULL;
+}
+
+
 void VIDEO_RGB332_ADAPTER_SIM_Init (struct VIDEO_RGB332_ADAPTER_SIM *const S)
 {
+    // Workers of a previous initialization
+    stopWorkers (S);
+
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports ("ssse3"))
+    {
+        s_expand = expandSsse3;
+    }
+#elif defined(__aarch64__)
+    s_expand = expandNeon;
+#endif
+
     S->device.displayWidth  = 1280;
     S->device.displayHeight = 720;
     S->device.updateSurface = updateSurface;
+    S->device.shutdown      = shutdown;
+    // Paced by the display refresh. The vga framebuffer window does not,
+    // as two windows waiting for vsync would halve the frame rate.
+    S->device.vsync         = true;
 
     VIDEO_Init ((struct VIDEO *)S, &VIDEO_IFACE_ADAPTER_SIM,
                 S->framebufferA, S->framebufferB);
+
+    S->mutex    = SDL_CreateMutex ();
+    S->started  = SDL_CreateCond ();
+    S->finished = SDL_CreateCond ();
+    BOARD_AssertState (S->mutex && S->started && S->finished);
+
+    S->update       = NULL;
+    S->updateNumber = 0;
+    S->pending      = 0;
+    S->quit         = false;
+
+    for (uint32_t i = 0; i < VIDEO_RGB332_ADAPTER_SIM_WORKERS; ++i)
+    {
+        struct VIDEO_RGB332_ADAPTER_SIM_Worker *const W = &S->worker[i];
+
+        W->sim      = S;
+        W->slice    = i + 1;
+        W->thread   = SDL_CreateThread (workerRun, "adapter_sim", W);
+        BOARD_AssertState (W->thread);
+    }
 }
 
 
-static void updateSurface (struct VIDEO *const V,
-                           const struct VIDEO_RGB332_UpdateInfo *const Ui)
+// Scales Lines span lines, starting at span line First. Each framebuffer
+// line is expanded once per line operation it uses. The remaining surface
+// lines are copies.
+static void scaleLines (struct VIDEO *const V,
+                        const struct VIDEO_RGB332_UpdateInfo *const Ui,
+                        const struct VIDEO_Span *const Span,
+                        const uint32_t First, const uint32_t Lines)
 {
-    uint8_t *b = V->frontbuffer;
-    uint8_t *s = Ui->Surface;
+    const uint8_t ShowAnd = (uint8_t) Ui->ShowAnd32;
+    const uint8_t ShowOr  = (uint8_t) Ui->ShowOr32;
+    const uint8_t ScanAnd = (uint8_t) Ui->ScanAnd32;
+    const uint8_t ScanOr  = (uint8_t) Ui->ScanOr32;
+
+    // Visible scanlines, or direct-color operations
+    const bool LineOps = (ShowAnd != 0xFF || ShowOr != 0x00 || V->scanlines);
+
+    // Span integer-scaled 5 times, as the whole framebuffer
+    const uint32_t Octets = Span->width * 5U;
+
+    const uint8_t *b = &V->frontbuffer[(Span->y + First) * 256 + Span->x];
+    uint8_t *s = &Ui->Surface[(Span->y + First) * 5U * Ui->SurfacePitch +
+                              Span->x * 5U];
 
-    // 256x144 framebuffer integer-scaled to a 1280x720 signal
-    for (int h = 0; h < 144; ++h)
+    for (uint32_t h = 0; h < Lines; ++h)
     {
-        uint8_t line[1280];
+        // Operations applied before expansion, on 5 times less octets
+        uint8_t lineShow[256];
+        uint8_t lineScan[256];
 
-        for (uint32_t whd = 0; whd < 1280; whd += 5)
+        const uint8_t *show = b;
+
+        if (LineOps)
         {
-            line[whd+0] = *b;
-            line[whd+1] = *b;
-            line[whd+2] = *b;
-            line[whd+3] = *b;
-            line[whd+4] = *b;
-            b ++;
+            for (uint32_t i = 0; i < Span->width; ++i)
+            {
+                lineShow[i] = (b[i] & ShowAnd) | ShowOr;
+                lineScan[i] = (b[i] & ScanAnd) | ScanOr;
+            }
+
+            show = lineShow;
         }
 
-        // Visible scanlines, or direct-color operations
-        if (Ui->ShowAnd32 != 0xFF || Ui->ShowOr32 != 0x00 || V->scanlines)
-        {
-            // 4 pixes per iteration (320 x 4 = 1280)
-            uint32_t lineShow[320];
-            uint32_t lineScan[320];
+        b += 256;
+
+        uint8_t *showLine = NULL;
+        uint8_t *scanLine = NULL;
 
-            memcpy (lineShow, line, 1280);
-            memcpy (lineScan, line, 1280);
+        // Last 'scanlines' surface lines use the scanline operation
+        for (uint32_t r = 0; r < 5; ++r)
+        {
+            const bool Scan = (5 - r <= V->scanlines);
+            uint8_t **const Line = Scan? &scanLine : &showLine;
 
-            for (uint32_t i = 0; i < 320; ++i)
+            if (*Line)
+            {
+                memcpy (s, *Line, Octets);
+            }
+            else
             {
-                lineShow[i] &= Ui->ShowAnd32;
-                lineShow[i] |= Ui->ShowOr32;
-                lineScan[i] &= Ui->ScanAnd32;
-                lineScan[i] |= Ui->ScanOr32;
+                s_expand (s, Scan? lineScan : show, Span->width);
+                *Line = s;
             }
 
-            memcpy (s, (5 > V->scanlines)? lineShow : lineScan, 1280);
-            s += Ui->SurfacePitch;
-            memcpy (s, (4 > V->scanlines)? lineShow : lineScan, 1280);
-            s += Ui->SurfacePitch;
-            memcpy (s, (3 > V->scanlines)? lineShow : lineScan, 1280);
-            s += Ui->SurfacePitch;
-            memcpy (s, (2 > V->scanlines)? lineShow : lineScan, 1280);
-            s += Ui->SurfacePitch;
-            memcpy (s, (1 > V->scanlines)? lineShow : lineScan, 1280);
             s += Ui->SurfacePitch;
         }
-        else 
+    }
+}
+
+
+// Scales part Slice of Slices of each changed span. Spans never share
+// framebuffer lines, so no two slices write the same surface octets.
+static void scaleSlice (struct VIDEO *const V,
+                        const struct VIDEO_RGB332_UpdateInfo *const Ui,
+                        const uint32_t Slice, const uint32_t Slices)
+{
+    for (uint32_t i = 0; i < Ui->SpanCount; ++i)
+    {
+        const struct VIDEO_Span *const Span = &Ui->Spans[i];
+
+        const uint32_t First = Span->height * Slice / Slices;
+        const uint32_t Last  = Span->height * (Slice + 1) / Slices;
+
+        if (Last > First)
         {
-            memcpy (s, line, 1280); s += Ui->SurfacePitch;
-            memcpy (s, line, 1280); s += Ui->SurfacePitch;
-            memcpy (s, line, 1280); s += Ui->SurfacePitch;
-            memcpy (s, line, 1280); s += Ui->SurfacePitch;
-            memcpy (s, line, 1280); s += Ui->SurfacePitch;
+            scaleLines (V, Ui, Span, First, Last - First);
         }
     }
 }
+
+
+static int workerRun (void *Param)
+{
+    struct VIDEO_RGB332_ADAPTER_SIM_Worker *const W =
+                            (struct VIDEO_RGB332_ADAPTER_SIM_Worker *) Param;
+    struct VIDEO_RGB332_ADAPTER_SIM *const S = W->sim;
+
+    uint32_t updateNumber = 0;
+
+    while (true)
+    {
+        SDL_LockMutex (S->mutex);
+
+        while (S->updateNumber == updateNumber && !S->quit)
+        {
+            SDL_CondWait (S->started, S->mutex);
+        }
+
+        if (S->quit)
+        {
+            SDL_UnlockMutex (S->mutex);
+            break;
+        }
+
+        updateNumber = S->updateNumber;
+
+        const struct VIDEO_RGB332_UpdateInfo *const Ui = S->update;
+
+        SDL_UnlockMutex (S->mutex);
+
+        scaleSlice ((struct VIDEO *)S, Ui, W->slice,
+                    VIDEO_RGB332_ADAPTER_SIM_WORKERS + 1);
+
+        SDL_LockMutex (S->mutex);
+
+        if (! -- S->pending)
+        {
+            SDL_CondSignal (S->finished);
+        }
+
+        SDL_UnlockMutex (S->mutex);
+    }
+
+    return 0;
+}
+
+
+static void updateSurface (struct VIDEO *const V,
+                           const struct VIDEO_RGB332_UpdateInfo *const Ui)
+{
+    struct VIDEO_RGB332_ADAPTER_SIM *const S =
+                                    (struct VIDEO_RGB332_ADAPTER_SIM *) V;
+
+    // 256x144 framebuffer integer-scaled to a 1280x720 signal. Only changed
+    // spans are scaled.
+    uint32_t lines = 0;
+
+    for (uint32_t i = 0; i < Ui->SpanCount; ++i)
+    {
+        lines += Ui->Spans[i].height;
+    }
+
+    if (lines < PARALLEL_MIN_LINES)
+    {
+        scaleSlice (V, Ui, 0, 1);
+        return;
+    }
+
+    // Span lines split between workers and the caller
+    SDL_LockMutex (S->mutex);
+
+    S->update   = Ui;
+    S->pending  = VIDEO_RGB332_ADAPTER_SIM_WORKERS;
+    ++ S->updateNumber;
+
+    SDL_CondBroadcast (S->started);
+    SDL_UnlockMutex (S->mutex);
+
+    scaleSlice (V, Ui, 0, VIDEO_RGB332_ADAPTER_SIM_WORKERS + 1);
+
+    SDL_LockMutex (S->mutex);
+
+    while (S->pending)
+    {
+        SDL_CondWait (S->finished, S->mutex);
+    }
+
+    SDL_UnlockMutex (S->mutex);
+}
+
+
+static void shutdown (struct VIDEO *const V)
+{
+    stopWorkers ((struct VIDEO_RGB332_ADAPTER_SIM *) V);
+}
@@ -27,6 +27,24 @@
 #pragma once
 
 #include "embedul.ar/source/arch/native/sdl/drivers/video_rgb332.h"
+#include "SDL_mutex.h"
+#include "SDL_thread.h"
+
+
+// Threads scaling framebuffer lines along with the caller
+#define VIDEO_RGB332_ADAPTER_SIM_WORKERS    3
+
+
+struct VIDEO_RGB332_ADAPTER_SIM;
+
+
+struct VIDEO_RGB332_ADAPTER_SIM_Worker
+{
+    struct VIDEO_RGB332_ADAPTER_SIM     * sim;
+    SDL_Thread                          * thread;
+    // Part of each span this worker scales. The caller scales part zero.
+    uint32_t                            slice;
+};
 
 
 struct VIDEO_RGB332_ADAPTER_SIM
@@ -34,6 +52,18 @@ struct VIDEO_RGB332_ADAPTER_SIM
     struct VIDEO_RGB332     device;
     uint8_t                 framebufferA[256 * 144];
     uint8_t                 framebufferB[256 * 144];
+    // Update being scaled, numbered to tell workers it is a new one, and
+    // workers yet to finish it. Workers return once quit is set.
+    SDL_mutex               * mutex;
+    SDL_cond                * started;
+    SDL_cond                * finished;
+    const struct VIDEO_RGB332_UpdateInfo
+                            * update;
+    uint32_t                updateNumber;
+    uint32_t                pending;
+    bool                    quit;
+    struct VIDEO_RGB332_ADAPTER_SIM_Worker
+                            worker[VIDEO_RGB332_ADAPTER_SIM_WORKERS];
 };
 
 
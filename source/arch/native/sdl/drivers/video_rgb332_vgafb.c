@@ -50,35 +50,31 @@ void VIDEO_RGB332_VGAFB_Init (struct VIDEO_RGB332_VGAFB *const S)
 static void updateSurface (struct VIDEO *const V,
                            const struct VIDEO_RGB332_UpdateInfo *const Ui)
 {
-    uint8_t *b = V->frontbuffer;
-    uint8_t *s = Ui->Surface;
+    const uint8_t ShowAnd = (uint8_t) Ui->ShowAnd32;
+    const uint8_t ShowOr  = (uint8_t) Ui->ShowOr32;
 
-    if (Ui->SurfacePitch == 640)
+    for (uint32_t i = 0; i < Ui->SpanCount; ++i)
     {
-        memcpy (s, b, 640 * 480);
-    }
-    else 
-    {
-        for (uint32_t h = 0; h < 480; ++h)
-        {
-            memcpy (s, b, 640);
-            s += Ui->SurfacePitch;
-            b += 640;
-        }
-    }
+        const struct VIDEO_Span *const Span = &Ui->Spans[i];
 
-    // Direct-color operations (scanlines unsupported)
-    if (Ui->ShowAnd32 != 0xFF || Ui->ShowOr32 != 0x00)
-    {
-        for (uint32_t h = 0; h < 480; ++h)
+        const uint8_t *b = &V->frontbuffer[Span->y * 640 + Span->x];
+        uint8_t *s = &Ui->Surface[Span->y * Ui->SurfacePitch + Span->x];
+
+        for (uint32_t h = 0; h < Span->height; ++h)
         {
-            uint32_t *s32 = (uint32_t *)&Ui->Surface[h * Ui->SurfacePitch];
+            memcpy (s, b, Span->width);
 
-            for (uint32_t w = 0; w < 160; ++w)
+            // Direct-color operations (scanlines unsupported)
+            if (ShowAnd != 0xFF || ShowOr != 0x00)
             {
-                s32[w] &= Ui->ShowAnd32;
-                s32[w] |= Ui->ShowOr32;
+                for (uint32_t w = 0; w < Span->width; ++w)
+                {
+                    s[w] = (s[w] & ShowAnd) | ShowOr;
+                }
             }
+
+            s += Ui->SurfacePitch;
+            b += 640;
         }
     }
 }
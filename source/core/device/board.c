@@ -24,6 +24,8 @@
 */
 
 #include "embedul.ar/source/core/device/board.h"
+#include "embedul.ar/source/core/manager/storage/cache.h"
+#include "embedul.ar/source/core/manager/storage/kv.h"
 
 
 #define BOARD_DEFAULT_SEED              0xbf8e18f1a02a2e49
@@ -196,6 +198,16 @@ void BOARD_Sync (void)
         }
 
         MIO_Update ();
+
+    #if STORAGE_KV_INDEX_ENTRIES
+        STORAGE_KV_Update ();
+    #endif
+
+        STORAGE_Update ();
+
+    #if STORAGE_CACHE_BACKGROUND_VERIFY
+        STORAGE_CACHE_VerifyFor (STORAGE_CACHE_BACKGROUND_VERIFY, 1);
+    #endif
     }
     OSWRAP_ResumeScheduler ();
 }
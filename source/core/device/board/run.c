@@ -25,6 +25,7 @@
 
 #include "embedul.ar/source/core/main.h"
 #include "embedul.ar/source/core/manager/storage/cache.h"
+#include "embedul.ar/source/core/misc/crc32c.h"
 
 
 #define GREET_FWK_LOGO_1    "`F36_________`L"
@@ -82,6 +83,8 @@
 #define CHECK_EDATA_OVERRIDE_PROFILE_CODE   INPUT_PROFILE_MAIN_Bit_A
 #define CHECK_EDATA_OVERRIDE_TIMEOUT        5000
 
+#define SHUTDOWN_SYNC_RETRIES               3
+
 
 #define LOG_ELEMENTS_STR(_cs) \
     ((_cs->checksPassed & STORAGE_CACHE_CheckFlags_Signature)? \
@@ -751,6 +754,8 @@ static void logSector0Status (const struct STORAGE_CACHE_State *const Cs)
                             LOG_ELEMENTS_STR(Cs));
 
     LOG_TableEnd (&s_CheckSector0Table);
+
+    LOG_Items (1, LANG_MANIFEST, LOG_CHECK_STR(Cs, Manifest));
 }
 
 
@@ -821,6 +826,14 @@ static void checkCache (const uint32_t ReadWriteRetries)
 {
     bool skipElementDataCheck = false;
 
+    // Indexed element data is verified once the board is ready
+    const bool DeferElementDataCheck = STORAGE_CACHE_BACKGROUND_VERIFY?
+                                                                true : false;
+
+    // Incremental checks only verify data of elements missing from the
+    // manifest, and deferred checks do not delay the boot; no need to wait
+    // for the user to skip them.
+#if !STORAGE_CACHE_INCREMENTAL && !STORAGE_CACHE_BACKGROUND_VERIFY
     if (!BOARD_INIT_InputCountdown (CHECK_EDATA_OVERRIDE_PROFILE_TYPE,
                                     CHECK_EDATA_OVERRIDE_PROFILE_CODE,
                                     CHECK_EDATA_OVERRIDE_TIMEOUT,
@@ -830,17 +843,20 @@ static void checkCache (const uint32_t ReadWriteRetries)
     }
 
     LOG_Newline ();
+#endif
 
     struct STORAGE_CACHE_State  cs;
     TIMER_Ticks                 nextBreak = 0;
 
-    STORAGE_CACHE_Init (&cs, skipElementDataCheck, ReadWriteRetries,
-                        LOG_ProgressMax(), logProcessBreakFunc,
-                        (void *)&nextBreak);
+    STORAGE_CACHE_Init (&cs, skipElementDataCheck, DeferElementDataCheck,
+                        ReadWriteRetries, LOG_ProgressMax(),
+                        logProcessBreakFunc, (void *)&nextBreak);
 
     {
         LOG_AutoContext (NOBJ, LANG_LINEAR_CACHE_CHECK);
 
+        LOG_Items (1, LANG_CRC32C_IMPLEMENTATION, CRC32C_Implementation());
+
         uint32_t    lastOutColumn           = 0;
         bool        elementContextOpened    = false;
 
@@ -879,6 +895,15 @@ static void checkCache (const uint32_t ReadWriteRetries)
                     break;
             #endif // LIB_EMBEDULAR_HAS_FILESYSTEM
 
+                case STORAGE_CACHE_Stage_CheckManifestEntry:
+                    if (cs.checksPassed & STORAGE_CACHE_CheckFlags_Manifest)
+                    {
+                        LOG_Items (1,
+                                    LANG_FILENAME,  cs.filepath);
+                        LOG (NOBJ, LANG_UNCHANGED);
+                    }
+                    break;
+
                 case STORAGE_CACHE_Stage_CheckElementInfo:
                     LOG_Items (1,
                                 LANG_FILENAME,  cs.filepath);
@@ -912,6 +937,10 @@ static void checkCache (const uint32_t ReadWriteRetries)
                     break;
 
             #ifdef LIB_EMBEDULAR_HAS_FILESYSTEM
+                case STORAGE_CACHE_Stage_WriteManifest:
+                    LOG (NOBJ, LANG_MANIFEST_UPDATE);
+                    break;
+
                 case STORAGE_CACHE_Stage_WriteSector0:
                     LOG (NOBJ, LANG_SECTOR_0_UPDATE);
                     break;
@@ -921,6 +950,18 @@ static void checkCache (const uint32_t ReadWriteRetries)
                     break;
             };
         }
+
+        if (DeferElementDataCheck)
+        {
+            STORAGE_CACHE_VerifyStart ();
+
+            const struct STORAGE_CACHE_VerifyProgress Vp =
+                                            STORAGE_CACHE_VerifyProgress ();
+
+            LOG_Items (2,
+                        LANG_BACKGROUND_VERIFY, Vp.elements,
+                        LANG_SECTORS,           Vp.sectors);
+        }
     }
 }
 
@@ -1156,6 +1197,9 @@ static void boardShutdownSequence (struct BOARD *const B)
 {
     LOG_Warn (B, LANG_SHUTTING_DOWN);
 
+    // Writes still held by the storage write-back buffer
+    STORAGE_Sync (SHUTDOWN_SYNC_RETRIES);
+
     // Managers shutdown (will shut down their registered drivers)
     SCREEN_Shutdown ();
 
@@ -1164,6 +1208,14 @@ static void boardShutdownSequence (struct BOARD *const B)
 }
 
 
+// Called by boards that end the process on their own, like a hosted board
+// whose window is closed, instead of returning from the application.
+void BOARD__shutdown (struct BOARD *const B)
+{
+    boardShutdownSequence (B);
+}
+
+
 void OSWRAP__greetings              (struct STREAM *const S);
 int  OSWRAP__createRunTaskAndStart  (struct BOARD *const B,
                                      const OSWRAP_TaskFunc RunTask);
@@ -37,6 +37,9 @@ void RAWSTOR_Init (struct RAWSTOR *const R, const struct RAWSTOR_IFACE *iface)
                             iface->MediaWrite &&
                             iface->MediaIoctl);
 
+    // Asynchronous drivers provide both or none
+    BOARD_AssertInterface (!iface->MediaSubmit == !iface->MediaReap);
+
     OBJECT_Clear (R);
 
     R->iface            = iface;
@@ -199,6 +202,10 @@ RAWSTOR_Status_Result RAWSTOR_MediaInit (struct RAWSTOR *const R)
 }
 
 
+static bool overlapsPending (struct RAWSTOR *const R, const uint32_t Begin,
+                             const uint32_t End);
+
+
 RAWSTOR_Status_Result RAWSTOR_MediaRead (struct RAWSTOR *const R,
                                          uint8_t *const Data, 
                                          const uint32_t SectorBegin,
@@ -213,6 +220,12 @@ RAWSTOR_Status_Result RAWSTOR_MediaRead (struct RAWSTOR *const R,
         return Res;
     }
 
+    // Overlapping asynchronous requests complete first
+    if (overlapsPending (R, SectorBegin, SectorBegin + SectorCount))
+    {
+        RAWSTOR_Wait (R);
+    }
+
     return R->iface->MediaRead (R, Data, SectorBegin, SectorCount);
 }
 
@@ -231,6 +244,12 @@ RAWSTOR_Status_Result RAWSTOR_MediaWrite (struct RAWSTOR *const R,
         return Res;
     }
 
+    // Overlapping asynchronous requests complete first
+    if (overlapsPending (R, SectorBegin, SectorBegin + SectorCount))
+    {
+        RAWSTOR_Wait (R);
+    }
+
     return R->iface->MediaWrite (R, Data, SectorBegin, SectorCount);
 }
 
@@ -246,10 +265,370 @@ RAWSTOR_Status_Result RAWSTOR_MediaIoctl (struct RAWSTOR *const R,
         return Res;
     }
 
+    // Pending writes include queued requests
+    if (Cmd == RAWSTOR_IOCTL_CMD_SYNC)
+    {
+        RAWSTOR_Wait (R);
+    }
+
     return R->iface->MediaIoctl (R, Cmd, Data);
 }
 
 
+// Requests must not overlap with an earlier queued or in flight request
+// that will complete after them.
+static bool overlaps (const struct RAWSTOR_Request *const A,
+                      const uint32_t Begin, const uint32_t End)
+{
+    const uint32_t ABegin = A->sectorBegin;
+    const uint32_t AEnd   = A->sectorBegin + A->sectorCount;
+
+    return (Begin < AEnd && ABegin < End)? true : false;
+}
+
+
+static bool overlapsInFlight (struct RAWSTOR *const R, const uint32_t Begin,
+                              const uint32_t End)
+{
+    for (uint32_t i = 0; i < R->inFlightCount; ++i)
+    {
+        for (const struct RAWSTOR_Request *req = R->inFlight[i]; req;
+             req = req->merged)
+        {
+            if (overlaps (req, Begin, End))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+static bool overlapsQueued (struct RAWSTOR *const R, const uint32_t Before,
+                            const uint32_t Begin, const uint32_t End)
+{
+    for (uint32_t i = 0; i < Before; ++i)
+    {
+        if (overlaps (R->queue[i], Begin, End))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+static bool overlapsPending (struct RAWSTOR *const R, const uint32_t Begin,
+                             const uint32_t End)
+{
+    return overlapsQueued (R, R->queued, Begin, End) ||
+           overlapsInFlight (R, Begin, End);
+}
+
+
+static void removeQueued (struct RAWSTOR *const R, const uint32_t Index)
+{
+    -- R->queued;
+
+    for (uint32_t i = Index; i < R->queued; ++i)
+    {
+        R->queue[i] = R->queue[i + 1];
+    }
+}
+
+
+// Takes the first queued request and appends queued requests of the same
+// operation that continue it, in submission order.
+static struct RAWSTOR_Request * takeTransfer (struct RAWSTOR *const R,
+                                              const bool Vectored)
+{
+    struct RAWSTOR_Request *const First = R->queue[0];
+    struct RAWSTOR_Request *last = First;
+    uint32_t end = First->sectorBegin + First->sectorCount;
+
+    removeQueued (R, 0);
+
+    for (uint32_t i = 0; i < R->queued; ++i)
+    {
+        struct RAWSTOR_Request *const Req = R->queue[i];
+        const uint32_t ReqEnd = Req->sectorBegin + Req->sectorCount;
+
+        if (Req->op != First->op || Req->sectorBegin != end ||
+            (!Vectored && Req->data != &last->data[last->sectorCount *
+                                                   RAWSTOR_SECTOR_SIZE]) ||
+            overlapsQueued (R, i, Req->sectorBegin, ReqEnd) ||
+            overlapsInFlight (R, Req->sectorBegin, ReqEnd))
+        {
+            continue;
+        }
+
+        removeQueued (R, i);
+
+        last->merged    = Req;
+        last            = Req;
+        end             = ReqEnd;
+
+        ++ R->queueStats.merged;
+
+        // A request skipped before may continue this one
+        i = (uint32_t)-1;
+    }
+
+    return First;
+}
+
+
+// Puts back the requests of a transfer not accepted by the driver.
+static void requeueTransfer (struct RAWSTOR *const R,
+                             struct RAWSTOR_Request *const First)
+{
+    uint32_t count = 0;
+
+    for (const struct RAWSTOR_Request *req = First; req; req = req->merged)
+    {
+        ++ count;
+    }
+
+    for (uint32_t i = R->queued; i; --i)
+    {
+        R->queue[i - 1 + count] = R->queue[i - 1];
+    }
+
+    R->queued += count;
+
+    uint32_t i = 0;
+
+    for (struct RAWSTOR_Request *req = First; req; ++i)
+    {
+        struct RAWSTOR_Request *const Next = req->merged;
+
+        req->merged = NULL;
+        R->queue[i] = req;
+        req         = Next;
+    }
+
+    R->queueStats.merged -= count - 1;
+}
+
+
+static void completeTransfer (struct RAWSTOR *const R,
+                              struct RAWSTOR_Request *const First,
+                              const RAWSTOR_Status_Result Result)
+{
+    struct RAWSTOR_Request *req = First;
+
+    while (req)
+    {
+        // The callback may submit the request again
+        struct RAWSTOR_Request *const Next = req->merged;
+
+        req->merged = NULL;
+        req->result = Result;
+
+        -- R->pending;
+        ++ R->queueStats.completed;
+
+        if (Result != RAWSTOR_Status_Result_Ok)
+        {
+            ++ R->queueStats.failed;
+        }
+
+        if (req->done)
+        {
+            req->done (R, req);
+        }
+
+        req = Next;
+    }
+}
+
+
+static void reapTransfers (struct RAWSTOR *const R, bool wait)
+{
+    struct RAWSTOR_Request *first;
+
+    while (R->inFlightCount && (first = R->iface->MediaReap (R, wait)))
+    {
+        uint32_t i = 0;
+
+        while (i < R->inFlightCount && R->inFlight[i] != first)
+        {
+            ++ i;
+        }
+
+        BOARD_AssertState (i < R->inFlightCount);
+
+        -- R->inFlightCount;
+        R->inFlight[i] = R->inFlight[R->inFlightCount];
+
+        completeTransfer (R, first, first->result);
+
+        wait = false;
+    }
+}
+
+
+// Requests submitted from done callbacks wait for the next call.
+static void startTransfers (struct RAWSTOR *const R)
+{
+    uint32_t budget = R->queued;
+
+    if (!budget)
+    {
+        return;
+    }
+
+    const RAWSTOR_Status_Result Res = checkMediaReady (R);
+
+    if (Res != RAWSTOR_Status_Result_Ok)
+    {
+        for (; budget && R->queued; --budget)
+        {
+            struct RAWSTOR_Request *const Req = R->queue[0];
+
+            removeQueued (R, 0);
+            completeTransfer (R, Req, Res);
+        }
+
+        return;
+    }
+
+    if (R->iface->MediaSubmit)
+    {
+        while (R->queued && R->inFlightCount < RAWSTOR_QUEUE_DEPTH)
+        {
+            const struct RAWSTOR_Request *const Req = R->queue[0];
+
+            if (overlapsInFlight (R, Req->sectorBegin, Req->sectorBegin +
+                                                       Req->sectorCount))
+            {
+                break;
+            }
+
+            struct RAWSTOR_Request *const First =
+                            takeTransfer (R, R->iface->MediaSubmitVectored);
+
+            if (!R->iface->MediaSubmit (R, First))
+            {
+                requeueTransfer (R, First);
+                break;
+            }
+
+            R->inFlight[R->inFlightCount ++] = First;
+            ++ R->queueStats.transfers;
+        }
+
+        return;
+    }
+
+    // Synchronous fallback. Merged request buffers are contiguous.
+    while (budget && R->queued)
+    {
+        struct RAWSTOR_Request *const First = takeTransfer (R, false);
+        uint32_t requests   = 0;
+        uint32_t sectors    = 0;
+
+        for (const struct RAWSTOR_Request *req = First; req; req = req->merged)
+        {
+            ++ requests;
+            sectors += req->sectorCount;
+        }
+
+        budget = (requests < budget)? budget - requests : 0;
+
+        const RAWSTOR_Status_Result Result =
+            (First->op == RAWSTOR_RequestOp_Write)?
+                R->iface->MediaWrite (R, First->data, First->sectorBegin,
+                                      sectors) :
+                R->iface->MediaRead (R, First->data, First->sectorBegin,
+                                     sectors);
+
+        ++ R->queueStats.transfers;
+
+        completeTransfer (R, First, Result);
+    }
+}
+
+
+bool RAWSTOR_Submit (struct RAWSTOR *const R, struct RAWSTOR_Request *const Req)
+{
+    BOARD_AssertParams (R && R->iface && Req && Req->data &&
+                        Req->sectorCount);
+    BOARD_AssertParams (Req->op == RAWSTOR_RequestOp_Read ||
+                        Req->op == RAWSTOR_RequestOp_Write);
+
+    if (R->pending >= RAWSTOR_QUEUE_DEPTH)
+    {
+        ++ R->queueStats.full;
+        return false;
+    }
+
+    Req->result = RAWSTOR_Status_Result_NotReady;
+    Req->merged = NULL;
+
+    R->queue[R->queued ++] = Req;
+
+    ++ R->pending;
+    ++ R->queueStats.submitted;
+
+    return true;
+}
+
+
+// Completes finished transfers and starts queued ones. Called on each
+// BOARD_Sync() for registered storage volumes.
+void RAWSTOR_Poll (struct RAWSTOR *const R)
+{
+    BOARD_AssertParams (R && R->iface);
+
+    if (R->iface->MediaReap)
+    {
+        reapTransfers (R, false);
+    }
+
+    startTransfers (R);
+}
+
+
+// Returns once all requests completed, including those submitted by done
+// callbacks in the meantime.
+void RAWSTOR_Wait (struct RAWSTOR *const R)
+{
+    BOARD_AssertParams (R && R->iface);
+
+    while (R->pending)
+    {
+        if (R->inFlightCount)
+        {
+            reapTransfers (R, true);
+        }
+
+        startTransfers (R);
+
+        // A driver with nothing in flight must accept a transfer
+        BOARD_AssertState (!R->pending || R->inFlightCount ||
+                           !R->iface->MediaSubmit);
+    }
+}
+
+
+uint32_t RAWSTOR_Pending (struct RAWSTOR *const R)
+{
+    BOARD_AssertParams (R);
+    return R->pending;
+}
+
+
+struct RAWSTOR_QueueStats RAWSTOR_QueueStats (struct RAWSTOR *const R)
+{
+    BOARD_AssertParams (R);
+    return R->queueStats;
+}
+
+
 const char * RAWSTOR_Description (struct RAWSTOR *const R)
 {
     BOARD_AssertParams (R && R->iface && R->iface->Description);
@@ -31,6 +31,14 @@
 
 #define RAWSTOR_SECTOR_SIZE                     512
 
+// Asynchronous requests accepted by a RAWSTOR device, either waiting in its
+// queue or being transferred by the driver.
+#define RAWSTOR_QUEUE_DEPTH         LIB_EMBEDULAR_CONFIG_RAWSTOR_QUEUE_DEPTH
+
+#if !RAWSTOR_QUEUE_DEPTH
+    #error RAWSTOR_QUEUE_DEPTH must be at least one
+#endif
+
 // NOTE: this amount multiplied by the size of SDCARD_StatusLogEntry must give
 //       a 2^n number required to initialize the CYCLIC structure used to store
 //       the logs.
@@ -147,6 +155,55 @@ typedef uint8_t SDCARD_Type;
 struct RAWSTOR;
 
 
+enum RAWSTOR_RequestOp
+{
+    RAWSTOR_RequestOp_Read = 0,
+    RAWSTOR_RequestOp_Write
+};
+
+
+struct RAWSTOR_Request;
+
+
+// Called from RAWSTOR_Poll() once the request completed. The request may be
+// submitted again from the callback.
+typedef void (* RAWSTOR_RequestDoneFunc)(struct RAWSTOR *const R,
+                                         struct RAWSTOR_Request *const Req);
+
+
+// Storage is owned by the caller and must stay valid, along with data, until
+// the done callback is called.
+struct RAWSTOR_Request
+{
+    enum RAWSTOR_RequestOp          op;
+    uint8_t                         * data;
+    uint32_t                        sectorBegin;
+    uint32_t                        sectorCount;
+    RAWSTOR_RequestDoneFunc         done;
+    void                            * param;
+    // Set on completion
+    RAWSTOR_Status_Result           result;
+    // Next request merged in the same transfer. Set by RAWSTOR.
+    struct RAWSTOR_Request          * merged;
+    // Free for the driver while the request is being transferred.
+    struct RAWSTOR_Request          * link;
+};
+
+
+struct RAWSTOR_QueueStats
+{
+    uint32_t                        submitted;
+    // Requests appended to an adjacent request transfer
+    uint32_t                        merged;
+    // Transfers started on the driver
+    uint32_t                        transfers;
+    uint32_t                        completed;
+    uint32_t                        failed;
+    // Submissions refused with a full queue
+    uint32_t                        full;
+};
+
+
 typedef void (* RAWSTOR_HardwareInitFunc)(struct RAWSTOR *const R);
 typedef RAWSTOR_Status_Result (* RAWSTOR_MediaInitFunc)(
                                         struct RAWSTOR *const R);
@@ -163,6 +220,16 @@ typedef RAWSTOR_Status_Result (* RAWSTOR_MediaWriteFunc)(
 typedef RAWSTOR_Status_Result (* RAWSTOR_MediaIoctlFunc)(
                                         struct RAWSTOR *const R,
                                         const uint8_t Cmd, void *const Data);
+// Starts a transfer of Req and its merged requests, at their sectorBegin,
+// without waiting for it to finish. Returns false if the driver can not take
+// another transfer now.
+typedef bool (* RAWSTOR_MediaSubmitFunc)(struct RAWSTOR *const R,
+                                         struct RAWSTOR_Request *const Req);
+// Returns the first request of a finished transfer, with its result set, or
+// NULL. Wait blocks until one finishes.
+typedef struct RAWSTOR_Request * (* RAWSTOR_MediaReapFunc)(
+                                        struct RAWSTOR *const R,
+                                        const bool Wait);
 
 
 struct RAWSTOR_IFACE
@@ -173,6 +240,12 @@ struct RAWSTOR_IFACE
     const RAWSTOR_MediaReadFunc     MediaRead;
     const RAWSTOR_MediaWriteFunc    MediaWrite;
     const RAWSTOR_MediaIoctlFunc    MediaIoctl;
+    // Optional. Queued requests are transferred by MediaRead and MediaWrite
+    // on RAWSTOR_Poll() when not available.
+    const RAWSTOR_MediaSubmitFunc   MediaSubmit;
+    const RAWSTOR_MediaReapFunc     MediaReap;
+    // Merged requests are not required to have contiguous data buffers.
+    const bool                      MediaSubmitVectored;
 };
 
 
@@ -184,6 +257,15 @@ struct RAWSTOR
     uint8_t                         statusLogBuffer[RAWSTOR_STATUS_LOG_ENTRIES *
                                                 sizeof(struct RAWSTOR_Status)];
     uint32_t                        sectorOffset;
+    // Submitted requests not yet handed to the driver, in order
+    struct RAWSTOR_Request          * queue[RAWSTOR_QUEUE_DEPTH];
+    uint32_t                        queued;
+    // First requests of the transfers started on the driver
+    struct RAWSTOR_Request          * inFlight[RAWSTOR_QUEUE_DEPTH];
+    uint32_t                        inFlightCount;
+    // Queued and in flight requests
+    uint32_t                        pending;
+    struct RAWSTOR_QueueStats       queueStats;
 };
 
 
@@ -219,4 +301,11 @@ RAWSTOR_Status_Result
                 RAWSTOR_MediaIoctl          (struct RAWSTOR *const R,
                                              const uint8_t Cmd,
                                              void *const Data);
+bool            RAWSTOR_Submit              (struct RAWSTOR *const R,
+                                             struct RAWSTOR_Request *const Req);
+void            RAWSTOR_Poll                (struct RAWSTOR *const R);
+void            RAWSTOR_Wait                (struct RAWSTOR *const R);
+uint32_t        RAWSTOR_Pending             (struct RAWSTOR *const R);
+struct RAWSTOR_QueueStats
+                RAWSTOR_QueueStats          (struct RAWSTOR *const R);
 const char *    RAWSTOR_Description         (struct RAWSTOR *const R);
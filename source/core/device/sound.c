@@ -231,7 +231,7 @@ void SOUND_BufferConsumed (void)
 
 
 // Cached BGMs have always the same format as the mixer and are streamed
-// directly to the mixer buffers.
+// (decoded, if compressed) directly to the mixer buffers.
 static bool bgmCachedToBuffer (struct SOUND *const S, uint8_t *const Buffer,
                                void *const ProcData)
 {
@@ -247,9 +247,17 @@ static bool bgmCachedToBuffer (struct SOUND *const S, uint8_t *const Buffer,
 
     s_a->bufferBgmReadTicks = TICKS_Now ();
 
+    const uint32_t OctetsLeft = s_a->bgmCached.stream.octetsLeft;
+
     RAWSTOR_Status_Result r =
-        STORAGE_LinearRead (STORAGE_Role_LinearCache, Buffer,
-                            s_a->bgmCached.sectorCurrent, 1, 1);
+        STORAGE_CACHE_StreamRead (&s_a->bgmCached.stream, Buffer,
+                                  SOUND_MIXER_BUFFER_SIZE, 1);
+
+    // Zero padding after the last element octet, as in its last sector.
+    if (OctetsLeft < SOUND_MIXER_BUFFER_SIZE)
+    {
+        memset (&Buffer[OctetsLeft], 0, SOUND_MIXER_BUFFER_SIZE - OctetsLeft);
+    }
 
     if (r != RAWSTOR_Status_Result_Ok)
     {
@@ -271,9 +279,9 @@ static bool bgmCachedToBuffer (struct SOUND *const S, uint8_t *const Buffer,
         // noticeable).
     }
 
-    if (++ s_a->bgmCached.sectorCurrent >= s_a->bgmCached.sectorCount)
+    if (!s_a->bgmCached.stream.octetsLeft)
     {
-        s_a->bgmCached.sectorCurrent = s_a->bgmCached.sectorBegin;
+        STORAGE_CACHE_StreamRewind (&s_a->bgmCached.stream);
         LOG (S, LANG_BGM_REWIND);
 
         if (s_a->bgmCached.repeat)
@@ -307,14 +315,17 @@ void SOUND_PlayCachedBgm (const uint32_t CachedElement, const uint32_t Repeat)
 
     struct STORAGE_CACHE_ElementInfo info;
     
-    if (STORAGE_CACHE_ElementInfo(&info, CachedElement, sectorData, 1)
+    if (STORAGE_CACHE_IndexedElement(&info, CachedElement) ||
+        STORAGE_CACHE_ElementInfo(&info, CachedElement, sectorData, 1)
         == RAWSTOR_Status_Result_Ok)
     {
         SOUND_SetProcBGM (bgmCachedToBuffer, NULL);
 
-        s_a->bgmCached.sectorBegin      = info.sectorBegin;
-        s_a->bgmCached.sectorCount      = info.sectorCount;
-        s_a->bgmCached.sectorCurrent    = info.sectorBegin;
+        // The last BGM may still have a read in progress
+        STORAGE_CACHE_StreamClose (&s_a->bgmCached.stream);
+        STORAGE_CACHE_StreamInit (&s_a->bgmCached.stream, &info);
+        STORAGE_CACHE_StreamReadAhead (&s_a->bgmCached.stream,
+                                       s_a->bgmCached.readAhead);
         s_a->bgmCached.repeat           = Repeat;
 
         s_a->bgmStatus = SOUND_BGM_Status_Playing;
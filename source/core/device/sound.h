@@ -29,6 +29,7 @@
 #include "embedul.ar/source/core/device/sound/mixer.h"
 #include "embedul.ar/source/core/device/sound/bgm.h"
 #include "embedul.ar/source/core/device/rawstor.h"
+#include "embedul.ar/source/core/manager/storage/cache.h"
 
 
 #define SOUND_MIXER_BUFFERS     8
@@ -60,9 +61,9 @@ struct SOUND_IFACE
 
 struct SOUND_BGM_Cached
 {
-    uint32_t                        sectorBegin;
-    uint32_t                        sectorCount;
-    uint32_t                        sectorCurrent;
+    struct STORAGE_CACHE_Stream     stream;
+    // Next stream sector, read while the current one is being mixed
+    uint8_t                         readAhead[512];
     uint32_t                        repeat;
 };
 
@@ -47,6 +47,161 @@ static uint32_t framebufferOctets (struct VIDEO *const V)
 }
 
 
+static void dirtyClear (struct VIDEO_Dirty *const D)
+{
+    // x1 = 0xFFFF, x2 = 0: all bands empty
+    memset (D->x1, 0xFF, sizeof(D->x1));
+    memset (D->x2, 0x00, sizeof(D->x2));
+}
+
+
+static void dirtyMark (struct VIDEO *const V, struct VIDEO_Dirty *const D,
+                       int32_t x1, int32_t y1, const int32_t Width,
+                       const int32_t Height)
+{
+    int32_t x2 = x1 + Width;
+    int32_t y2 = y1 + Height;
+
+    // Clamped to framebuffer limits
+    if (x1 < 0)
+    {
+        x1 = 0;
+    }
+
+    if (y1 < 0)
+    {
+        y1 = 0;
+    }
+
+    if (x2 > V->iface->Width)
+    {
+        x2 = V->iface->Width;
+    }
+
+    if (y2 > V->iface->Height)
+    {
+        y2 = V->iface->Height;
+    }
+
+    if (x1 >= x2 || y1 >= y2)
+    {
+        return;
+    }
+
+    const uint32_t LastBand = (uint32_t)(y2 - 1) / V->dirtyBandLines;
+
+    for (uint32_t b = (uint32_t)y1 / V->dirtyBandLines; b <= LastBand; ++b)
+    {
+        if (D->x1[b] > x1)
+        {
+            D->x1[b] = (uint16_t) x1;
+        }
+
+        if (D->x2[b] < x2)
+        {
+            D->x2[b] = (uint16_t) x2;
+        }
+    }
+}
+
+
+static void dirtyAll (struct VIDEO *const V, struct VIDEO_Dirty *const D)
+{
+    dirtyMark (V, D, 0, 0, V->iface->Width, V->iface->Height);
+}
+
+
+static void dirtyMerge (struct VIDEO_Dirty *const D,
+                        const struct VIDEO_Dirty *const S)
+{
+    for (uint32_t b = 0; b < VIDEO_DIRTY_BANDS; ++b)
+    {
+        if (D->x1[b] > S->x1[b])
+        {
+            D->x1[b] = S->x1[b];
+        }
+
+        if (D->x2[b] < S->x2[b])
+        {
+            D->x2[b] = S->x2[b];
+        }
+    }
+}
+
+
+// Consecutive bands spanning the same columns are merged in a single span.
+// Returns the number of spans, up to VIDEO_DIRTY_BANDS.
+static uint32_t dirtySpans (struct VIDEO *const V,
+                            const struct VIDEO_Dirty *const D,
+                            struct VIDEO_Span *const Spans)
+{
+    const uint32_t Lines = V->dirtyBandLines;
+    uint32_t count = 0;
+
+    for (uint32_t b = 0; b < VIDEO_DIRTY_BANDS && b * Lines < V->iface->Height;
+         ++b)
+    {
+        if (D->x1[b] >= D->x2[b])
+        {
+            continue;
+        }
+
+        const uint32_t Y = b * Lines;
+        const uint32_t H = (Y + Lines > V->iface->Height)?
+                                V->iface->Height - Y : Lines;
+
+        struct VIDEO_Span *const Last = count? &Spans[count - 1] : NULL;
+
+        if (Last && Last->y + Last->height == Y && Last->x == D->x1[b] &&
+            Last->width == D->x2[b] - D->x1[b])
+        {
+            Last->height += (uint16_t) H;
+        }
+        else
+        {
+            Spans[count ++] = (struct VIDEO_Span) {
+                .x      = D->x1[b],
+                .y      = (uint16_t) Y,
+                .width  = (uint16_t)(D->x2[b] - D->x1[b]),
+                .height = (uint16_t) H
+            };
+        }
+    }
+
+    return count;
+}
+
+
+static void copySpans (struct VIDEO *const V, uint8_t *const Dst,
+                       const uint8_t *const Src,
+                       const struct VIDEO_Dirty *const D)
+{
+    const uint32_t Width = V->iface->Width;
+    struct VIDEO_Span spans[VIDEO_DIRTY_BANDS];
+
+    const uint32_t Count = dirtySpans (V, D, spans);
+
+    for (uint32_t i = 0; i < Count; ++i)
+    {
+        const struct VIDEO_Span *const S = &spans[i];
+        const uint32_t Offset = S->y * Width + S->x;
+
+        if (S->width == Width)
+        {
+            // Full scanlines are contiguous
+            memcpy (&Dst[Offset], &Src[Offset], S->height * Width);
+            continue;
+        }
+
+        for (uint32_t l = 0; l < S->height; ++l)
+        {
+            memcpy (&Dst[Offset + l * Width], &Src[Offset + l * Width],
+                    S->width);
+        }
+    }
+}
+
+
 void VIDEO_Init (struct VIDEO *const V, const struct VIDEO_IFACE *const Iface,
                  uint8_t *const FramebufferA, uint8_t *const FramebufferB)
 {
@@ -69,6 +224,14 @@ void VIDEO_Init (struct VIDEO *const V, const struct VIDEO_IFACE *const Iface,
     // Initial front and back buffer
     V->frontbuffer      = FramebufferA;
     V->backbuffer       = FramebufferB? FramebufferB : FramebufferA;
+    V->newFrame         = true;
+    // Nothing drawn yet, whole frame to be presented
+    V->dirtyBandLines   = (uint16_t)((Iface->Height + VIDEO_DIRTY_BANDS - 1) /
+                                                        VIDEO_DIRTY_BANDS);
+    dirtyClear (&V->dirty);
+    dirtyClear (&V->stale);
+    dirtyClear (&V->present);
+    dirtyAll (V, &V->present);
 
     {
         LOG_AutoContext (V, LANG_INIT);
@@ -109,15 +272,38 @@ void VIDEO_Init (struct VIDEO *const V, const struct VIDEO_IFACE *const Iface,
 }
 
 
+// Mailbox presentation: VIDEO_NextFrame() queues the completed frame and
+// returns at once with a free framebuffer to draw on. At VBI the display picks
+// the newest completed frame; older ones are dropped. Trades memory and
+// wasted frames for never blocking the renderer. Requires a double buffered
+// device. Intended to be called by drivers, after VIDEO_Init().
+void VIDEO_SetTripleBuffer (struct VIDEO *const V, uint8_t *const FramebufferC)
+{
+    BOARD_AssertParams (VIDEO_IsValid(V) && FramebufferC);
+    BOARD_AssertState  (V->frontbuffer != V->backbuffer && !V->sparebuffer);
+
+    memset (FramebufferC, 0, framebufferOctets(V));
+
+    V->sparebuffer  = FramebufferC;
+    V->spareReady   = false;
+
+    dirtyClear  (&V->spareStale);
+    dirtyAll    (V, &V->spareStale);
+}
+
+
 bool VIDEO_IsValid (struct VIDEO *const V)
 {
     return (V && validIface(V->iface))? true : false;
 }
 
 
+// Buffer contents changed through returned pointers are not known. Whole
+// buffers are considered changed.
 uint8_t * VIDEO_Frontbuffer (struct VIDEO *const V)
 {
     BOARD_AssertParams (VIDEO_IsValid(V));
+    VIDEO_MarkFrontDirty (V, 0, 0, V->iface->Width, V->iface->Height);
     return V->frontbuffer;
 }
 
@@ -125,6 +311,7 @@ uint8_t * VIDEO_Frontbuffer (struct VIDEO *const V)
 uint8_t * VIDEO_Backbuffer (struct VIDEO *const V)
 {
     BOARD_AssertParams (VIDEO_IsValid(V));
+    dirtyAll (V, &V->dirty);
     return V->backbuffer;
 }
 
@@ -136,6 +323,7 @@ uint8_t * VIDEO_BackbufferXY (struct VIDEO *const V, const int32_t X,
     BOARD_AssertParams (X >= 0 && X < V->iface->Width &&
                         Y >= 0 && Y < V->iface->Height);
 
+    dirtyAll (V, &V->dirty);
     return &V->backbuffer[Y * V->iface->Width + X];
 }
 
@@ -171,6 +359,13 @@ void VIDEO_SetWaitVBICount (struct VIDEO *const V, const uint32_t Count)
 void VIDEO_SetScanlines (struct VIDEO *const V, const uint8_t Scanlines)
 {
     BOARD_AssertParams (VIDEO_IsValid(V));
+
+    if (V->scanlines != Scanlines)
+    {
+        // Affects the whole presented frame
+        dirtyAll (V, &V->present);
+    }
+
     V->scanlines = Scanlines;
 }
 
@@ -180,24 +375,36 @@ void VIDEO_SetScanlineOp (struct VIDEO *const V, const enum VIDEO_SOP Op,
 {
     BOARD_AssertParams (VIDEO_IsValid(V));
 
+    uint8_t *op = NULL;
+
     switch (Op)
     {
         case VIDEO_SOP_ShowAnd:
-            V->showAnd = Value;
+            op = &V->showAnd;
             break;
 
         case VIDEO_SOP_ShowOr:
-            V->showOr = Value;
+            op = &V->showOr;
             break;
 
         case VIDEO_SOP_ScanAnd:
-            V->scanAnd = Value;
+            op = &V->scanAnd;
             break;
 
         case VIDEO_SOP_ScanOr:
-            V->scanOr = Value;
+            op = &V->scanOr;
             break;
     }
+
+    BOARD_AssertParams (op);
+
+    if (*op != Value)
+    {
+        // Affects the whole presented frame
+        dirtyAll (V, &V->present);
+    }
+
+    *op = Value;
 }
 
 
@@ -233,6 +440,62 @@ void VIDEO_ResetAllScanlineOps (struct VIDEO *const V)
 }
 
 
+// Backbuffer region written on the current frame. Drawing functions of the
+// SCREEN manager do this on their own.
+void VIDEO_MarkDirty (struct VIDEO *const V, const int32_t X, const int32_t Y,
+                      const int32_t Width, const int32_t Height)
+{
+    BOARD_AssertParams (VIDEO_IsValid(V));
+    dirtyMark (V, &V->dirty, X, Y, Width, Height);
+}
+
+
+// Frontbuffer region written directly, as opposed to drawn on the backbuffer
+// and then swapped.
+void VIDEO_MarkFrontDirty (struct VIDEO *const V, const int32_t X,
+                           const int32_t Y, const int32_t Width,
+                           const int32_t Height)
+{
+    BOARD_AssertParams (VIDEO_IsValid(V));
+
+    dirtyMark (V, &V->present, X, Y, Width, Height);
+
+    if (V->frontbuffer != V->backbuffer)
+    {
+        dirtyMark (V, &V->stale, X, Y, Width, Height);
+
+        if (V->sparebuffer)
+        {
+            dirtyMark (V, &V->spareStale, X, Y, Width, Height);
+        }
+    }
+    else
+    {
+        dirtyMark (V, &V->dirty, X, Y, Width, Height);
+    }
+}
+
+
+// The whole frontbuffer must be presented again, for example after the
+// driver lost its display contents.
+void VIDEO_Invalidate (struct VIDEO *const V)
+{
+    BOARD_AssertParams (VIDEO_IsValid(V));
+    dirtyAll (V, &V->present);
+}
+
+
+// Frontbuffer regions that changed since the driver last presented a frame.
+// Spans must hold VIDEO_DIRTY_BANDS elements. Intended to be called by
+// drivers from WaitForVBI; the regions are cleared once it returns.
+uint32_t VIDEO_PresentSpans (struct VIDEO *const V,
+                             struct VIDEO_Span *const Spans)
+{
+    BOARD_AssertParams (VIDEO_IsValid(V) && Spans);
+    return dirtySpans (V, &V->present, Spans);
+}
+
+
 // Dont swap buffers (on current frame only)
 void VIDEO_SwapOverride (struct VIDEO *const V)
 {
@@ -263,24 +526,54 @@ void VIDEO_WaitForVBI (struct VIDEO *const V)
 }
 
 
-void VIDEO_NextFrame (struct VIDEO *const V)
+// Required interface implementation, timed for frame pacing
+static void waitForVBI (struct VIDEO *const V)
 {
-    BOARD_AssertParams (VIDEO_IsValid(V));
+    const TIMER_Ticks Start = TICKS_Now ();
 
-    // frameEnd/Transition/Begin are interface optional notifications
-    if (V->iface->FrameEnd)
+    V->iface->WaitForVBI (V);
+
+    V->pacing.waitTicks += TICKS_Now() - Start;
+}
+
+
+static void swapFramebuffers (uint8_t **const A, uint8_t **const B)
+{
+    uint8_t *const T = *A;
+    *A = *B;
+    *B = T;
+}
+
+
+static void presentFifo (struct VIDEO *const V)
+{
+    const bool SingleBuffer = (V->frontbuffer == V->backbuffer);
+
+    if (SingleBuffer)
     {
-        V->iface->FrameEnd (V);
+        // Drawn straight on the frontbuffer
+        dirtyMerge (&V->present, &V->dirty);
+        dirtyClear (&V->dirty);
+
+        V->newFrame = true;
     }
 
-    V->lastFrameBusy = TICKS_Now() - V->frameStartTicks;
+    // Swap overridden on the last frame
+    if (!V->newFrame)
+    {
+        ++ V->repeatedFrames;
+    }
 
-    // Required interface implementation
-    V->iface->WaitForVBI (V);
+    waitForVBI (V);
 
-    const uint8_t * LastFront = V->frontbuffer;
-    const uint8_t * LastBack = V->backbuffer;
-    (void) LastFront;
+    // Frontbuffer presented, if the driver does present on WaitForVBI
+    dirtyClear (&V->present);
+
+    V->newFrame = false;
+
+    // Backbuffer now differs from the frontbuffer on drawn regions too
+    dirtyMerge (&V->stale, &V->dirty);
+    dirtyClear (&V->dirty);
 
     // Swap buffers override
     if (V->swapOverride)
@@ -294,9 +587,145 @@ void VIDEO_NextFrame (struct VIDEO *const V)
         uint8_t *const B = V->frontbuffer;
         V->frontbuffer = V->backbuffer;
         V->backbuffer = B;
+        V->newFrame = true;
+
+        if (!SingleBuffer)
+        {
+            // Both buffers still differ on the same regions
+            dirtyMerge (&V->present, &V->stale);
+        }
+    }
+}
+
+
+static void presentMailbox (struct VIDEO *const V)
+{
+    // Backbuffer now differs from the frontbuffer on drawn regions too
+    dirtyMerge (&V->stale, &V->dirty);
+    dirtyClear (&V->dirty);
+
+    if (V->swapOverride)
+    {
+        // Request valid on current frame only
+        V->swapOverride = false;
+    }
+    else
+    {
+        // The completed frame replaces one the display did not pick
+        if (V->spareReady)
+        {
+            ++ V->droppedFrames;
+        }
+
+        swapFramebuffers (&V->backbuffer, &V->sparebuffer);
+
+        const struct VIDEO_Dirty Stale = V->stale;
+        V->stale        = V->spareStale;
+        V->spareStale   = Stale;
+        V->spareReady   = true;
+    }
+
+    // Rendering goes on right away unless the display is due
+    if (!V->iface->ReachedVBICount (V))
+    {
+        return;
+    }
+
+    if (V->spareReady)
+    {
+        // Newest completed frame picked. The former frontbuffer, now the
+        // free one, differs from it on the same regions.
+        dirtyMerge (&V->present, &V->spareStale);
+        dirtyMerge (&V->stale, &V->spareStale);
+
+        swapFramebuffers (&V->frontbuffer, &V->sparebuffer);
+
+        V->spareReady   = false;
+        V->newFrame     = true;
+    }
+
+    if (!V->newFrame)
+    {
+        ++ V->repeatedFrames;
+    }
+
+    waitForVBI (V);
+
+    dirtyClear (&V->present);
+
+    V->newFrame = false;
+}
+
+
+static void samplePacing (struct VIDEO *const V, const TIMER_Ticks DrawTicks,
+                          const TIMER_Ticks UpdateStartTicks)
+{
+    struct VIDEO_PACING *const P = &V->pacing;
+
+    // Presenting may happen within WaitForVBI or not
+    const TIMER_Ticks Present   = P->presentTicks;
+    const TIMER_Ticks Wait      = (P->waitTicks > Present)?
+                                            P->waitTicks - Present : 0;
+    const TIMER_Ticks Elapsed   = TICKS_Now() - UpdateStartTicks;
+    const TIMER_Ticks Update    = (Elapsed > Wait + Present)?
+                                            Elapsed - Wait - Present : 0;
+
+    const TIMER_Ticks Ticks[VIDEO_PACING_Phase__COUNT] =
+    {
+        [VIDEO_PACING_Phase_Draw]       = DrawTicks,
+        [VIDEO_PACING_Phase_Update]     = Update,
+        [VIDEO_PACING_Phase_WaitVBI]    = Wait,
+        [VIDEO_PACING_Phase_Present]    = Present,
+        [VIDEO_PACING_Phase_Frame]      = V->lastFramePeriod
+    };
+
+    VIDEO_PACING__sample (P, Ticks);
+
+    P->waitTicks    = 0;
+    P->presentTicks = 0;
+}
+
+
+void VIDEO_NextFrame (struct VIDEO *const V)
+{
+    BOARD_AssertParams (VIDEO_IsValid(V));
+
+    const TIMER_Ticks Now = TICKS_Now ();
+
+    VIDEO__nextFrame (V, Now - V->frameStartTicks, Now);
+}
+
+
+// Frame ticks spent drawing and the start of the update are given by the
+// caller when several devices share a frame.
+void VIDEO__nextFrame (struct VIDEO *const V, const TIMER_Ticks DrawTicks,
+                       const TIMER_Ticks UpdateStartTicks)
+{
+    BOARD_AssertParams (VIDEO_IsValid(V));
+
+    // frameEnd/Transition/Begin are interface optional notifications
+    if (V->iface->FrameEnd)
+    {
+        V->iface->FrameEnd (V);
+    }
+
+    V->lastFrameBusy = TICKS_Now() - V->frameStartTicks;
+
+    const uint8_t * LastBack = V->backbuffer;
+
+    if (V->sparebuffer)
+    {
+        presentMailbox (V);
+    }
+    else
+    {
+        presentFifo (V);
     }
 
     V->lastFramePeriod = TICKS_Now() - V->frameStartTicks;
+
+    samplePacing (V, DrawTicks, UpdateStartTicks);
+
     V->frameStartTicks = TICKS_Now();
 
     if (V->iface->FrameTransition)
@@ -312,9 +741,21 @@ void VIDEO_NextFrame (struct VIDEO *const V)
     {
         V->copyFrame = false;
 
-        if (V->backbuffer != LastBack)
+        if (V->backbuffer != LastBack && LastBack == V->sparebuffer)
         {
-            memcpy (V->backbuffer, LastBack, framebufferOctets(V));
+            // Last frame not displayed yet. Both buffers can only differ
+            // where either one differs from the frontbuffer.
+            struct VIDEO_Dirty differ = V->stale;
+            dirtyMerge (&differ, &V->spareStale);
+
+            copySpans (V, V->backbuffer, LastBack, &differ);
+            V->stale = V->spareStale;
+        }
+        else if (V->backbuffer != LastBack)
+        {
+            // Only regions where both buffers differ
+            copySpans (V, V->backbuffer, LastBack, &V->stale);
+            dirtyClear (&V->stale);
         }
     }
 
@@ -333,6 +774,55 @@ uint32_t VIDEO_FrameNumber (struct VIDEO *const V)
 }
 
 
+uint32_t VIDEO_DroppedFrames (struct VIDEO *const V)
+{
+    BOARD_AssertParams (VIDEO_IsValid(V));
+    return V->droppedFrames;
+}
+
+
+uint32_t VIDEO_RepeatedFrames (struct VIDEO *const V)
+{
+    BOARD_AssertParams (VIDEO_IsValid(V));
+    return V->repeatedFrames;
+}
+
+
+const struct VIDEO_PACING * VIDEO_Pacing (struct VIDEO *const V)
+{
+    BOARD_AssertParams (VIDEO_IsValid(V));
+    return &V->pacing;
+}
+
+
+void VIDEO_ResetPacing (struct VIDEO *const V)
+{
+    BOARD_AssertParams (VIDEO_IsValid(V));
+    VIDEO_PACING_Reset (&V->pacing);
+}
+
+
+void VIDEO_LogPacing (struct VIDEO *const V)
+{
+    BOARD_AssertParams (VIDEO_IsValid(V));
+
+    LOG_AutoContext (V, LANG_FRAME_PACING);
+
+    VIDEO_PACING_Log (&V->pacing);
+
+    if (V->sparebuffer)
+    {
+        LOG_Items (2,
+                    LANG_DROPPED_FRAMES,    V->droppedFrames,
+                    LANG_REPEATED_FRAMES,   V->repeatedFrames);
+    }
+    else
+    {
+        LOG_Items (1, LANG_REPEATED_FRAMES, V->repeatedFrames);
+    }
+}
+
+
 void VIDEO_Shutdown (struct VIDEO *const V)
 {
     BOARD_AssertParams (VIDEO_IsValid(V));
@@ -351,3 +841,20 @@ const char * VIDEO_Description (struct VIDEO *const V)
     BOARD_AssertParams (VIDEO_IsValid(V));
     return V->iface->Description;
 }
+
+
+// VIDEO_MarkDirty() without parameter checks, for drawing functions that
+// already validated the device and clipped the region.
+void VIDEO__markDirty (struct VIDEO *const V, const int32_t X, const int32_t Y,
+                       const int32_t Width, const int32_t Height)
+{
+    dirtyMark (V, &V->dirty, X, Y, Width, Height);
+}
+
+
+// Called by drivers with the ticks taken to present the frontbuffer, within
+// WaitForVBI or not.
+void VIDEO__presented (struct VIDEO *const V, const TIMER_Ticks Ticks)
+{
+    V->pacing.presentTicks += Ticks;
+}
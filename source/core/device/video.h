@@ -25,6 +25,7 @@
 
 #pragma once
 
+#include "embedul.ar/source/core/device/video/pacing.h"
 #include "embedul.ar/source/core/timer.h"
 #include <stdbool.h>
 
@@ -34,6 +35,14 @@
 #define VIDEO_SOP_DEFAULT_SCAN_AND    0x24
 #define VIDEO_SOP_DEFAULT_SCAN_OR     0x00
 
+// Changed framebuffer regions are tracked as one horizontal span per band of
+// scanlines. Each band covers Height / VIDEO_DIRTY_BANDS lines, rounded up.
+#define VIDEO_DIRTY_BANDS           LIB_EMBEDULAR_CONFIG_VIDEO_DIRTY_BANDS
+
+#if !VIDEO_DIRTY_BANDS
+    #error VIDEO_DIRTY_BANDS must be at least one
+#endif
+
 
 struct VIDEO;
 
@@ -62,6 +71,23 @@ struct VIDEO_IFACE
 };
 
 
+// Columns [x1, x2) of each band. Empty when x1 >= x2.
+struct VIDEO_Dirty
+{
+    uint16_t                        x1[VIDEO_DIRTY_BANDS];
+    uint16_t                        x2[VIDEO_DIRTY_BANDS];
+};
+
+
+struct VIDEO_Span
+{
+    uint16_t                        x;
+    uint16_t                        y;
+    uint16_t                        width;
+    uint16_t                        height;
+};
+
+
 enum VIDEO_SOP
 {
     VIDEO_SOP_ShowAnd,
@@ -79,11 +105,20 @@ struct VIDEO
     TIMER_Ticks                     lastFramePeriod;
     uint8_t                         * frontbuffer;
     uint8_t                         * backbuffer;
+    // Triple buffering only. Newest completed frame, waiting to be picked
+    // by the display at VBI when 'spareReady'; a free framebuffer otherwise.
+    uint8_t                         * sparebuffer;
     uint32_t                        frameNumber;
     uint32_t                        waitVbiCount;
     uint32_t                        vbiCountMisses;
+    // Completed frames never displayed, and VBIs that displayed the same
+    // frame again.
+    uint32_t                        droppedFrames;
+    uint32_t                        repeatedFrames;
     bool                            swapOverride;
     bool                            copyFrame;
+    bool                            spareReady;
+    bool                            newFrame;
     uint8_t                         scanlines;
     uint8_t                         showAnd;
     uint8_t                         showOr;
@@ -93,6 +128,16 @@ struct VIDEO
     const char                      * adapterSignal;
     const char                      * adapterModeline;
     const char                      * adapterBuild;
+    uint16_t                        dirtyBandLines;
+    // Backbuffer regions drawn on the current frame
+    struct VIDEO_Dirty              dirty;
+    // Backbuffer regions that differ from the frontbuffer, besides 'dirty'
+    struct VIDEO_Dirty              stale;
+    // Frontbuffer regions not yet presented by the driver
+    struct VIDEO_Dirty              present;
+    // Sparebuffer regions that differ from the frontbuffer
+    struct VIDEO_Dirty              spareStale;
+    struct VIDEO_PACING             pacing;
 };
 
 
@@ -100,6 +145,8 @@ void        VIDEO_Init                  (struct VIDEO *const V,
                                          const struct VIDEO_IFACE *const Iface,
                                          uint8_t *const FramebufferA,
                                          uint8_t *const FramebufferB);
+void        VIDEO_SetTripleBuffer       (struct VIDEO *const V,
+                                         uint8_t *const FramebufferC);
 bool        VIDEO_IsValid               (struct VIDEO *const V);
 uint8_t *   VIDEO_Frontbuffer           (struct VIDEO *const V);
 uint8_t *   VIDEO_Backbuffer            (struct VIDEO *const V);
@@ -118,12 +165,38 @@ void        VIDEO_SetScanlineOp         (struct VIDEO *const V,
 void        VIDEO_ResetScanlineOp       (struct VIDEO *const V,
                                          const enum VIDEO_SOP Op);
 void        VIDEO_ResetAllScanlineOps   (struct VIDEO *const V);
+void        VIDEO_MarkDirty             (struct VIDEO *const V,
+                                         const int32_t X, const int32_t Y,
+                                         const int32_t Width,
+                                         const int32_t Height);
+void        VIDEO_MarkFrontDirty        (struct VIDEO *const V,
+                                         const int32_t X, const int32_t Y,
+                                         const int32_t Width,
+                                         const int32_t Height);
+void        VIDEO_Invalidate            (struct VIDEO *const V);
+uint32_t    VIDEO_PresentSpans          (struct VIDEO *const V,
+                                         struct VIDEO_Span *const Spans);
 void        VIDEO_SwapOverride          (struct VIDEO *const V);
 void        VIDEO_CopyFrame             (struct VIDEO *const V);
 bool        VIDEO_ReachedVBICount       (struct VIDEO *const V);
 void        VIDEO_WaitForVBI            (struct VIDEO *const V);
 void        VIDEO_NextFrame             (struct VIDEO *const V);
 uint32_t    VIDEO_FrameNumber           (struct VIDEO *const V);
+uint32_t    VIDEO_DroppedFrames         (struct VIDEO *const V);
+uint32_t    VIDEO_RepeatedFrames        (struct VIDEO *const V);
+const struct VIDEO_PACING *
+            VIDEO_Pacing                (struct VIDEO *const V);
+void        VIDEO_ResetPacing           (struct VIDEO *const V);
+void        VIDEO_LogPacing             (struct VIDEO *const V);
 void        VIDEO_Shutdown              (struct VIDEO *const V);
 const char *
             VIDEO_Description           (struct VIDEO *const V);
+void        VIDEO__markDirty            (struct VIDEO *const V,
+                                         const int32_t X, const int32_t Y,
+                                         const int32_t Width,
+                                         const int32_t Height);
+void        VIDEO__nextFrame            (struct VIDEO *const V,
+                                         const TIMER_Ticks DrawTicks,
+                                         const TIMER_Ticks UpdateStartTicks);
+void        VIDEO__presented            (struct VIDEO *const V,
+                                         const TIMER_Ticks Ticks);
@@ -0,0 +1,290 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+
+  [VIDEO] frame pacing histograms.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "embedul.ar/source/core/device/video/pacing.h"
+#include "embedul.ar/source/core/device/board.h"
+
+
+static const char *const s_PhaseNames[VIDEO_PACING_Phase__COUNT] =
+{
+    [VIDEO_PACING_Phase_Draw]       = LANG_DRAW,
+    [VIDEO_PACING_Phase_Update]     = LANG_UPDATE,
+    [VIDEO_PACING_Phase_WaitVBI]    = LANG_WAIT_VBI,
+    [VIDEO_PACING_Phase_Present]    = LANG_PRESENT,
+    [VIDEO_PACING_Phase_Frame]      = LANG_FRAME
+};
+
+
+static const struct LOG_Table s_PacingTable =
+{
+    LANG_FRAME_PACING, 6,
+    (struct LOG_TableItem[]) {
+        {
+            LANG_PHASE, 14, 0
+        },
+        {
+            LANG_P50, 22, 0
+        },
+        {
+            LANG_P90, 30, 0
+        },
+        {
+            LANG_P99, 38, 0
+        },
+        {
+            LANG_MAX, 46, 0
+        },
+        {
+            LANG_AVERAGE, 0, 0
+        }
+    }
+};
+
+
+void VIDEO_PACING_Reset (struct VIDEO_PACING *const P)
+{
+    BOARD_AssertParams (P);
+
+    memset (P, 0, sizeof(*P));
+}
+
+
+uint32_t VIDEO_PACING_Frames (const struct VIDEO_PACING *const P)
+{
+    BOARD_AssertParams (P);
+
+#if VIDEO_PACING_FRAMES
+    return P->frames;
+#else
+    return 0;
+#endif
+}
+
+
+// Ticks taken by the given percent of frames or less, in one tick steps.
+// VIDEO_PACING_BUCKETS - 1 means that long or longer. Zero without frames.
+uint32_t VIDEO_PACING_Percentile (const struct VIDEO_PACING *const P,
+                                  const enum VIDEO_PACING_Phase Phase,
+                                  const uint32_t Percent)
+{
+    BOARD_AssertParams (P && Phase < VIDEO_PACING_Phase__COUNT &&
+                        Percent <= 100);
+
+#if VIDEO_PACING_FRAMES
+    if (!P->frames)
+    {
+        return 0;
+    }
+
+    // Frames at or below the percentile, rounded up; at least one
+    uint32_t rank = (P->frames * Percent + 99) / 100;
+
+    if (!rank)
+    {
+        rank = 1;
+    }
+
+    uint32_t count = 0;
+
+    for (uint32_t b = 0; b < VIDEO_PACING_BUCKETS; ++b)
+    {
+        count += P->histogram[Phase][b];
+
+        if (count >= rank)
+        {
+            return b;
+        }
+    }
+
+    return VIDEO_PACING_BUCKETS - 1;
+#else
+    (void) Phase;
+    (void) Percent;
+    return 0;
+#endif
+}
+
+
+uint32_t VIDEO_PACING_Average (const struct VIDEO_PACING *const P,
+                               const enum VIDEO_PACING_Phase Phase)
+{
+    BOARD_AssertParams (P && Phase < VIDEO_PACING_Phase__COUNT);
+
+#if VIDEO_PACING_FRAMES
+    return P->frames? P->sum[Phase] / P->frames : 0;
+#else
+    (void) Phase;
+    return 0;
+#endif
+}
+
+
+uint32_t VIDEO_PACING_Max (const struct VIDEO_PACING *const P,
+                           const enum VIDEO_PACING_Phase Phase)
+{
+    BOARD_AssertParams (P && Phase < VIDEO_PACING_Phase__COUNT);
+
+    uint32_t max = 0;
+
+#if VIDEO_PACING_FRAMES
+    for (uint32_t i = 0; i < P->frames; ++i)
+    {
+        if (max < P->sample[i][Phase])
+        {
+            max = P->sample[i][Phase];
+        }
+    }
+#else
+    (void) Phase;
+#endif
+
+    return max;
+}
+
+
+// Phase ticks of a recent frame. Age 0 is the last frame.
+uint32_t VIDEO_PACING_Recent (const struct VIDEO_PACING *const P,
+                              const enum VIDEO_PACING_Phase Phase,
+                              const uint32_t Age)
+{
+    BOARD_AssertParams (P && Phase < VIDEO_PACING_Phase__COUNT);
+
+#if VIDEO_PACING_FRAMES
+    if (Age >= P->frames)
+    {
+        return 0;
+    }
+
+    const uint32_t I = (P->next + VIDEO_PACING_FRAMES - 1 - Age) %
+                                                        VIDEO_PACING_FRAMES;
+    return P->sample[I][Phase];
+#else
+    (void) Phase;
+    (void) Age;
+    return 0;
+#endif
+}
+
+
+// VIDEO_PACING_BUCKETS frame counts, one per tick, or NULL if disabled.
+const uint16_t * VIDEO_PACING_Histogram (const struct VIDEO_PACING *const P,
+                                         const enum VIDEO_PACING_Phase Phase)
+{
+    BOARD_AssertParams (P && Phase < VIDEO_PACING_Phase__COUNT);
+
+#if VIDEO_PACING_FRAMES
+    return P->histogram[Phase];
+#else
+    (void) Phase;
+    return NULL;
+#endif
+}
+
+
+const char * VIDEO_PACING_PhaseName (const enum VIDEO_PACING_Phase Phase)
+{
+    BOARD_AssertParams (Phase < VIDEO_PACING_Phase__COUNT);
+    return s_PhaseNames[Phase];
+}
+
+
+// Percentiles, maximum and average ticks of each phase on the rolling window.
+// Intended to be called within a LOG context.
+void VIDEO_PACING_Log (const struct VIDEO_PACING *const P)
+{
+    BOARD_AssertParams (P);
+
+    LOG_Items (1, LANG_FRAMES, VIDEO_PACING_Frames(P));
+
+    // Disabled or no frame presented yet
+    if (!VIDEO_PACING_Frames (P))
+    {
+        return;
+    }
+
+    LOG_TableBegin (&s_PacingTable);
+
+    for (enum VIDEO_PACING_Phase p = 0; p < VIDEO_PACING_Phase__COUNT; ++p)
+    {
+        LOG_TableEntry (&s_PacingTable,
+                        s_PhaseNames[p],
+                        VIDEO_PACING_Percentile(P, p, 50),
+                        VIDEO_PACING_Percentile(P, p, 90),
+                        VIDEO_PACING_Percentile(P, p, 99),
+                        VIDEO_PACING_Max(P, p),
+                        VIDEO_PACING_Average(P, p));
+    }
+
+    LOG_TableEnd (&s_PacingTable);
+}
+
+
+static uint16_t clampSample (const TIMER_Ticks Ticks)
+{
+    return (Ticks > 0xFFFF)? 0xFFFF : (uint16_t) Ticks;
+}
+
+
+static uint32_t sampleBucket (const uint16_t Sample)
+{
+    return (Sample >= VIDEO_PACING_BUCKETS)?
+                        VIDEO_PACING_BUCKETS - 1 : Sample;
+}
+
+
+// Adds a frame to the rolling window, replacing the oldest one once full.
+void VIDEO_PACING__sample (struct VIDEO_PACING *const P,
+                           const TIMER_Ticks Ticks[VIDEO_PACING_Phase__COUNT])
+{
+    BOARD_AssertParams (P && Ticks);
+
+#if VIDEO_PACING_FRAMES
+    uint16_t *const Sample = P->sample[P->next];
+
+    for (enum VIDEO_PACING_Phase p = 0; p < VIDEO_PACING_Phase__COUNT; ++p)
+    {
+        if (P->frames == VIDEO_PACING_FRAMES)
+        {
+            -- P->histogram[p][sampleBucket (Sample[p])];
+            P->sum[p] -= Sample[p];
+        }
+
+        Sample[p] = clampSample (Ticks[p]);
+
+        ++ P->histogram[p][sampleBucket (Sample[p])];
+        P->sum[p] += Sample[p];
+    }
+
+    if (P->frames < VIDEO_PACING_FRAMES)
+    {
+        ++ P->frames;
+    }
+
+    P->next = (P->next + 1) % VIDEO_PACING_FRAMES;
+#else
+    (void) clampSample;
+    (void) sampleBucket;
+#endif
+}
@@ -0,0 +1,93 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+
+  [VIDEO] frame pacing histograms.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "embedul.ar/source/core/timer.h"
+#include <stdbool.h>
+
+
+// Frames kept in the rolling window. Zero disables pacing instrumentation.
+#define VIDEO_PACING_FRAMES         LIB_EMBEDULAR_CONFIG_VIDEO_PACING_FRAMES
+
+// One tick wide histogram buckets. The last one counts longer phases too.
+#define VIDEO_PACING_BUCKETS        64
+
+
+enum VIDEO_PACING_Phase
+{
+    // Application drawing, from frame start to SCREEN_Update()
+    VIDEO_PACING_Phase_Draw = 0,
+    // SCREEN_Update() work besides waiting for VBI and presenting
+    VIDEO_PACING_Phase_Update,
+    // Waiting for VBI, as reported by the driver WaitForVBI
+    VIDEO_PACING_Phase_WaitVBI,
+    // Presenting the frontbuffer, if the driver reports it
+    VIDEO_PACING_Phase_Present,
+    // Whole frame period
+    VIDEO_PACING_Phase_Frame,
+    VIDEO_PACING_Phase__COUNT
+};
+
+
+struct VIDEO_PACING
+{
+#if VIDEO_PACING_FRAMES
+    // Phase ticks of the last frames, oldest at 'next' once full
+    uint16_t        sample[VIDEO_PACING_FRAMES][VIDEO_PACING_Phase__COUNT];
+    uint16_t        histogram[VIDEO_PACING_Phase__COUNT]
+                             [VIDEO_PACING_BUCKETS];
+    uint32_t        sum[VIDEO_PACING_Phase__COUNT];
+    uint32_t        frames;
+    uint32_t        next;
+#endif
+    // Spent on the driver WaitForVBI and reported by the driver as
+    // presenting, on the current frame
+    TIMER_Ticks     waitTicks;
+    TIMER_Ticks     presentTicks;
+};
+
+
+void        VIDEO_PACING_Reset      (struct VIDEO_PACING *const P);
+uint32_t    VIDEO_PACING_Frames     (const struct VIDEO_PACING *const P);
+uint32_t    VIDEO_PACING_Percentile (const struct VIDEO_PACING *const P,
+                                     const enum VIDEO_PACING_Phase Phase,
+                                     const uint32_t Percent);
+uint32_t    VIDEO_PACING_Average    (const struct VIDEO_PACING *const P,
+                                     const enum VIDEO_PACING_Phase Phase);
+uint32_t    VIDEO_PACING_Max        (const struct VIDEO_PACING *const P,
+                                     const enum VIDEO_PACING_Phase Phase);
+uint32_t    VIDEO_PACING_Recent     (const struct VIDEO_PACING *const P,
+                                     const enum VIDEO_PACING_Phase Phase,
+                                     const uint32_t Age);
+const uint16_t *
+            VIDEO_PACING_Histogram  (const struct VIDEO_PACING *const P,
+                                     const enum VIDEO_PACING_Phase Phase);
+const char *
+            VIDEO_PACING_PhaseName  (const enum VIDEO_PACING_Phase Phase);
+void        VIDEO_PACING_Log        (const struct VIDEO_PACING *const P);
+void        VIDEO_PACING__sample    (struct VIDEO_PACING *const P,
+                                     const TIMER_Ticks
+                                        Ticks[VIDEO_PACING_Phase__COUNT]);
@@ -40,6 +40,9 @@
 #define LANG_ASSERT_UNSUPPORTED             "unsupported"
 #define LANG_AT_MSG_BIGGER_THAN_EXPECT      "at-message bigger than expected"
 #define LANG_AVAILABLE                      "available"
+#define LANG_AVERAGE                        "average"
+#define LANG_BACKGROUND_VERIFY              "background verification"
+#define LANG_BACKGROUND_VERIFY_DONE         "background verification finished"
 #define LANG_BGM_CACHE_READ_FAILED          "cache bgm read error"
 #define LANG_BGM_PLAYBACK_STOP_NOW          "bgm playback will stop now"
 #define LANG_BGM_REPEAT                     "bgm repeat"
@@ -55,6 +58,7 @@
 #define LANG_CACHED_ELEMENT                 "cached element"
 #define LANG_CACHED_ELEMENT_NOT_FOUND       "cached element not found"
 #define LANG_CACHED_ELEMENT_READ_FAILED     "error reading cached element"
+#define LANG_CACHED_ELEMENT_VERIFY_FAILED   "cached element verification failed"
 #define LANG_CHANNELS                       "channels"
 #define LANG_CHECKING                       "checking.."
 #define LANG_CHECKSUM                       "checksum"
@@ -71,6 +75,8 @@
 #define LANG_COMMUNICATION_ERROR            "communication error"
 #define LANG_CONFIGURING_WIFI               "configuring wifi"
 #define LANG_CONNECT_TO_ACESS_POINT         "connect to ap"
+#define LANG_CORRUPTED_SECTORS              "corrupted sectors"
+#define LANG_CRC32C_IMPLEMENTATION          "crc32c implementation"
 #define LANG_CREATE_TCP_SERVER              "create tcp server"
 #define LANG_CREATE_UDP_TRANSMISSION        "udp transmission"
 #define LANG_DATA                           "data"
@@ -86,11 +92,16 @@
 #define LANG_DEVICE_SECTOR_END              "sector end"
 #define LANG_DEVICE_SECTOR_OFFSET           "sector offset"
 #define LANG_DEVICE_SECTOR_READ             "sector read"
+#define LANG_DIRECT_IO_UNSUPPORTED          "direct i/o unsupported, using page cache"
 #define LANG_DISABLE_COMMAND_STORE          "disable command store"
+#define LANG_DISPLAY_LIST_FULL              "display list full"
+#define LANG_DRAW                           "draw"
 #define LANG_DRIVER                         "driver"
 #define LANG_DRIVER_CODE                    "drv. code"
 #define LANG_DRIVER_CODE_DESC               "drv. code description"
 #define LANG_DRIVER_DESCRIPTION             "driver description"
+#define LANG_DROPPED_DRAW_CALLS             "dropped draw calls"
+#define LANG_DROPPED_FRAMES                 "dropped frames"
 #define LANG_ELEMENT                        "element"
 #define LANG_ELEMENTS                       "elements"
 #define LANG_ENABLE_ERROR_CODES             "enable error codes"
@@ -98,15 +109,21 @@
 #define LANG_ERROR                          "error"
 #define LANG_ERROR_CODE                     "error code"
 #define LANG_ERROR_GETTING_DEVICE_SECTORS   "error getting device sectors"
+#define LANG_ERROR_MAPPING_FILE             "error mapping file"
 #define LANG_ERROR_OPENING_FILE             "error opening file"
 #define LANG_EXECUTE                        "execute"
+#define LANG_FAILED                         "failed"
 #define LANG_FILE_METRICS                   "file metrics"
 #define LANG_FILE_SIZE                      "file size"
 #define LANG_FILENAME                       "filename"
 #define LANG_FILESYSTEM                     "filesystem"
 #define LANG_FILESYSTEM_MOUNT_ERROR         "error mounting filesystem"
 #define LANG_FILESYSTEM_SUPPORT_ENABLED     "filesystem support enabled"
+#define LANG_FRAME                          "frame"
 #define LANG_FRAMEBUFFERS                   "framebuffers"
+#define LANG_FRAMES                         "frames"
+#define LANG_FRAME_PACING                   "frame pacing"
+#define LANG_FRAME_SUMMARY                  "frame summary"
 #define LANG_FRAMEWORK                      "framework"
 #define LANG_FULL_SPEED                     "full speed"
 #define LANG_FWK_VER_SHORT                  "fwk ver"
@@ -141,13 +158,21 @@
 #define LANG_IO_LEVEL_3_DRIVERS             "io level 3 drivers"
 #define LANG_IO_PROFILES                    "io profiles"
 #define LANG_IO_PROFILES_SUMMARY            "io profiles summary"
+#define LANG_KEYS                           "keys"
+#define LANG_KV_MOUNTED                     "key-value store mounted"
+#define LANG_KV_MOUNT_FAILED                "key-value store mount failed"
+#define LANG_KV_SECTOR_CORRUPTED            "key-value store sector corrupted"
+#define LANG_KV_TORN_PAGES                  "key-value store log truncated"
 #define LANG_LEFT                           "left"
 #define LANG_LINEAR_CACHE_CHECK             "linear cache check"
 #define LANG_LINEAR_CACHE_UPDATE            "linear cache update"
 #define LANG_LOAD_FROM_CACHE                "load from cache"
 #define LANG_LOAD_FROM_FILESYSTEM           "load from filesystem"
 #define LANG_MANAGER_DRIVER_OVERWRITE       "overwriting an already set driver"
+#define LANG_MANIFEST                       "manifest"
+#define LANG_MANIFEST_UPDATE                "manifest update"
 #define LANG_MAPPINGS                       "mappings"
+#define LANG_MAX                            "max"
 #define LANG_MAX_DEVICES                    "max devices"
 #define LANG_MAX_INPUT_GATEWAYS             "max input gateways"
 #define LANG_MAX_LOG_ITEMS                  "max log items"
@@ -174,6 +199,10 @@
 #define LANG_OUT_OF_BOUND_WRITE_ACCESS      "out-of-bounds write access"
 #define LANG_OUT_OF_BOUNDS_READ_ACCESS      "out-of-bounds read access"
 #define LANG_OUTPUT_SUMMARY                 "output summary"
+#define LANG_P50                            "p50"
+#define LANG_P90                            "p90"
+#define LANG_P99                            "p99"
+#define LANG_PACING_OVERLAY_FMT             "p50 `0 p99 `1 max `2"
 #define LANG_PACKET_COMMAND                 "packet command"
 #define LANG_PACKET_SIZE                    "packet size"
 #define LANG_PARTITION                      "partition"
@@ -181,14 +210,18 @@
 #define LANG_PARTITION_TYPE_SHORT           "part. type"
 #define LANG_PASSWORD                       "password"
 #define LANG_PATH                           "path"
+#define LANG_PATH_HASH                      "path hash"
 #define LANG_PERIOD                         "period"
+#define LANG_PHASE                          "phase"
 #define LANG_PORT                           "port"
+#define LANG_PRESENT                        "present"
 #define LANG_PURPOSE                        "purpose"
 #define LANG_RANGE_COUNT                    "range count"
 #define LANG_READ                           "read"
 #define LANG_READY                          "ready"
 #define LANG_RECEIVED                       "received"
 #define LANG_REMOVED                        "removed"
+#define LANG_REPEATED_FRAMES                "repeated frames"
 #define LANG_REQUIRED_TYPE                  "required type"
 #define LANG_RESINCYNG                      "resyncing"
 #define LANG_RESOURCES                      "resources"
@@ -202,8 +235,10 @@
 #define LANG_SCREEN_DRIVERS                 "screen drivers"
 #define LANG_SCREEN_MGR_SUMMARY             "screen manager summary"
 #define LANG_SCREENS                        "screens"
+#define LANG_SECTOR                         "sector"
 #define LANG_SECTOR_0                       "sector 0"
 #define LANG_SECTOR_0_UPDATE                "sector 0 update"
+#define LANG_SECTORS                        "sectors"
 #define LANG_SET                            "set"
 #define LANG_SET_HOSTNAME                   "set hostname"
 #define LANG_SET_MULTI_CONNECTIONS          "set multi connections"
@@ -226,12 +261,14 @@
 #define LANG_SWITCH_ECHO_OFF                "switch echo off"
 #define LANG_TCP_PORT                       "tcp port"
 #define LANG_TCP_SERVER_START               "tcp server start"
+#define LANG_TICKS                          "ticks"
 #define LANG_TIMEOUT                        "timeout"
 #define LANG_TOTAL_READ_HIGH_THAN_RECV      "total read higher than received octets"
 #define LANG_TYPE                           "type"
 #define LANG_UART_CONFIG                    "uart config"
 #define LANG_UDP_PORT                       "udp port"
 #define LANG_UDP_TRANSMISSION_START         "udp transmission start"
+#define LANG_UNCHANGED                      "unchanged"
 #define LANG_UNDEFINED                      "undefined"
 #define LANG_UNEXPECTED_IPD_BODY            "unexpected IPD body"
 #define LANG_UNEXPECTED_VALUE               "unexpected value"
@@ -240,11 +277,15 @@
 #define LANG_UNKNOWN                        "unknown"
 #define LANG_UNKNOWN_RESPONSE               "unknown response"
 #define LANG_DEVICE_INIT_FAILED             "device init failed"
+#define LANG_UPDATE                         "update"
 #define LANG_UPDATING                       "updating.."
 #define LANG_VALUE                          "value"
+#define LANG_VBI_MISSES                     "vbi misses"
+#define LANG_VERIFIED                       "verified"
 #define LANG_VERSION                        "version"
 #define LANG_VERSION_INFO                   "version info"
 #define LANG_VOLUME                         "volume"
 #define LANG_VOLUMES                        "volumes"
+#define LANG_WAIT_VBI                       "wait vbi"
 #define LANG_WIDTH                          "width"
 #define LANG_WRITE                          "write"
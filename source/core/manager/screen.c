@@ -24,6 +24,8 @@
 */
 
 #include "embedul.ar/source/core/manager/screen.h"
+#include "embedul.ar/source/core/manager/screen/dlist.h"
+#include "embedul.ar/source/core/manager/screen/pacing.h"
 #include "embedul.ar/source/core/device/board.h"
 #include "embedul.ar/source/core/manager/storage/cache.h"
 
@@ -60,11 +62,48 @@ static void clearDriverBuffer (struct SCREEN_Context *const C,
     for (uint32_t i = 0; i < C->clip.height; ++i)
     {
         memset (p, Color, C->clip.width);
-        p += C->clip.width;
+        p += C->driver->iface->Width;
     }
 }
 
 
+static void markClipDirty (struct SCREEN_Context *const C, const bool Front)
+{
+    if (Front)
+    {
+        VIDEO_MarkFrontDirty (C->driver, C->clip.x1, C->clip.y1,
+                              C->clip.width, C->clip.height);
+    }
+    else
+    {
+        VIDEO__markDirty (C->driver, C->clip.x1, C->clip.y1,
+                          C->clip.width, C->clip.height);
+    }
+}
+
+
+// While recording a display list, clearing the backbuffer is recorded as a
+// clip sized rectangle.
+static void clearBack (struct SCREEN_Context *const C, const uint8_t Color)
+{
+    if (C->dlist)
+    {
+        const struct SCREEN_DLIST_Cmd Cmd = {
+            .type   = SCREEN_DLIST_CmdType_Rect,
+            .rect   = { .x = C->clip.x1, .y = C->clip.y1,
+                        .width = C->clip.width, .height = C->clip.height,
+                        .colorSel = RGB332_SelectColor (Color) }
+        };
+
+        SCREEN_DLIST__record (C, &Cmd, C->clip.y1, C->clip.y2, NULL, 0);
+        return;
+    }
+
+    clearDriverBuffer (C, C->driver->backbuffer, Color);
+    markClipDirty (C, false);
+}
+
+
 static void resetContext (struct SCREEN_Context *const C)
 {
     const uint16_t W = C->driver->iface->Width;
@@ -103,6 +142,8 @@ void SCREEN_Init (struct SCREEN *const S)
         SCREEN_FONT_Init (&S->defaultFont, NULL);
     #endif
 
+        S->frameStartTicks = TICKS_Now ();
+
         s_s = S;
     }
 }
@@ -198,7 +239,7 @@ void SCREEN_ClearBack (const enum SCREEN_Role Role, const uint8_t Color)
     BOARD_AssertState (SCREEN_IsAvailable(Role));
 
     struct SCREEN_Context * const C = screenContext (Role);
-    clearDriverBuffer (C, C->driver->backbuffer, Color);
+    clearBack (C, Color);
 }
 
 
@@ -208,6 +249,7 @@ void SCREEN_ClearFront (const enum SCREEN_Role Role, const uint8_t Color)
 
     struct SCREEN_Context * const C = screenContext (Role);
     clearDriverBuffer (C, C->driver->frontbuffer, Color);
+    markClipDirty (C, true);
 }
 
 
@@ -217,7 +259,8 @@ void SCREEN_Zap (const enum SCREEN_Role Role, const uint8_t Color)
 
     struct SCREEN_Context * const C = screenContext (Role);
     clearDriverBuffer (C, C->driver->frontbuffer, Color);
-    clearDriverBuffer (C, C->driver->backbuffer, Color);
+    markClipDirty (C, true);
+    clearBack (C, Color);
 }
 
 
@@ -228,8 +271,18 @@ void SCREEN_BlitCachedElement (const enum SCREEN_Role Role,
 
     struct SCREEN_Context * const C = screenContext (Role);
 
+    // The element overwrites anything recorded so far
+    if (C->dlist)
+    {
+        SCREEN_DLIST_Discard (Role);
+    }
+
     C->driver->copyFrame = true;
 
+    // Either an element or a solid color overwrites the whole backbuffer
+    VIDEO__markDirty (C->driver, 0, 0, C->driver->iface->Width,
+                      C->driver->iface->Height);
+
     if (!STORAGE_ValidVolume (STORAGE_Role_LinearCache))
     {
         LOG_WarnDebug (s_s, LANG_NO_LINEAR_CACHE);
@@ -254,13 +307,21 @@ void SCREEN_BlitCachedElement (const enum SCREEN_Role Role,
     // overwritten by the cached element.
     struct STORAGE_CACHE_ElementInfo info;
 
-    if (STORAGE_CACHE_ElementInfo(&info, CachedElement,
+    if (STORAGE_CACHE_IndexedElement(&info, CachedElement) ||
+        STORAGE_CACHE_ElementInfo(&info, CachedElement,
                                         C->driver->backbuffer, 1)
         == RAWSTOR_Status_Result_Ok)
     {
         BOARD_AssertParams (info.octets == driverBufferOctets(C));
 
-        if (STORAGE_CACHE_ElementData(&info, 0, 0, C->driver->backbuffer, 1)
+        // Element data, decoded as it is read when compressed, goes straight
+        // to the backbuffer.
+        struct STORAGE_CACHE_Stream stream;
+
+        STORAGE_CACHE_StreamInit (&stream, &info);
+
+        if (STORAGE_CACHE_StreamRead(&stream, C->driver->backbuffer,
+                                     info.octets, 1)
             == RAWSTOR_Status_Result_Ok)
         {
             return;
@@ -324,16 +385,41 @@ bool SCREEN_Clip (const enum SCREEN_Role Role,
 }
 
 
+void SCREEN_SetPacingOverlay (const enum SCREEN_Role Role, const bool Enabled)
+{
+    BOARD_AssertState (SCREEN_IsAvailable(Role));
+
+    struct SCREEN_Context * const C = screenContext (Role);
+    C->pacingOverlay = Enabled;
+}
+
+
 void SCREEN_Update (void)
 {
 #ifdef LIB_EMBEDULAR_HAS_VIDEO
+    // Drawing ends here for all devices. The update of each one, including
+    // its pacing overlay, excludes the others.
+    const TIMER_Ticks DrawTicks = TICKS_Now() - s_s->frameStartTicks;
+
     for (enum SCREEN_Role r = 0; r < SCREEN_Role__COUNT; ++r)
     {
         if (SCREEN_IsAvailable (r))
         {
-            VIDEO_NextFrame (s_s->context[r].driver);
+            struct SCREEN_Context * const C = screenContext (r);
+
+            const TIMER_Ticks UpdateStartTicks = TICKS_Now ();
+
+            // Not drawn over a display list still being recorded
+            if (C->pacingOverlay && !C->dlist)
+            {
+                SCREEN_PACING_Draw (r);
+            }
+
+            VIDEO__nextFrame (C->driver, DrawTicks, UpdateStartTicks);
         }
     }
+
+    s_s->frameStartTicks = TICKS_Now ();
 #endif
 }
 
@@ -451,5 +537,50 @@ uint8_t * SCREEN_Context__backbufferXY (const struct SCREEN_Context * const C,
     BOARD_AssertParams (X >= 0 && X < C->driver->iface->Width &&
                         Y >= 0 && Y < C->driver->iface->Height);
 
+    if (C->band.buffer)
+    {
+        BOARD_AssertParams (Y >= C->band.y && Y < C->band.y + C->band.lines);
+
+        return &C->band.buffer[(Y - C->band.y) * C->driver->iface->Width + X];
+    }
+
     return &C->driver->backbuffer[Y * C->driver->iface->Width + X];
 }
+
+
+// Backbuffer region, in screen coordinates, written by a drawing function.
+// Tracked by the video device so drivers can copy and present only what
+// changed.
+void SCREEN_Context__markDirty (const struct SCREEN_Context * const C,
+                                const int32_t X, const int32_t Y,
+                                const int32_t Width, const int32_t Height)
+{
+    VIDEO__markDirty (C->driver, X, Y, Width, Height);
+}
+
+
+// Scanlines drawing functions write to. Returns the address of the first
+// one, at column zero.
+uint8_t * SCREEN_Context__target (const struct SCREEN_Context * const C,
+                                  int32_t *const FirstLine,
+                                  uint32_t *const Lines)
+{
+    if (C->band.buffer)
+    {
+        *FirstLine  = C->band.y;
+        *Lines      = C->band.lines;
+        return C->band.buffer;
+    }
+
+    *FirstLine  = 0;
+    *Lines      = C->driver->iface->Height;
+    return C->driver->backbuffer;
+}
+
+
+// Modifiable context, for SCREEN submodules that change its state.
+struct SCREEN_Context * SCREEN__context (const enum SCREEN_Role Role)
+{
+    BOARD_AssertState (SCREEN_IsAvailable(Role));
+    return screenContext (Role);
+}
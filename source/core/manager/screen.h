@@ -48,12 +48,32 @@ struct SCREEN_Clip
 };
 
 
+// Scanlines of a display list band being rasterized.
+struct SCREEN_Band
+{
+    uint8_t                 * buffer;
+    uint16_t                y;
+    uint16_t                lines;
+};
+
+
+struct SCREEN_DLIST;
+
+
 struct SCREEN_Context
 {
     struct VIDEO            * driver;
     struct SCREEN_FONT      * font;
     struct RGB332_Gradient  gradient;
     struct SCREEN_Clip      clip;
+    // Display list recording draw calls, if any
+    struct SCREEN_DLIST     * dlist;
+    // Text run cache used by font drawing, if any
+    struct SCREEN_FONT_RUN  * fontRun;
+    // Drawing goes to this band instead of the backbuffer, if set
+    struct SCREEN_Band      band;
+    // Frame pacing overlay drawn by SCREEN_Update()
+    bool                    pacingOverlay;
 };
 
 
@@ -62,6 +82,8 @@ struct SCREEN
     struct SCREEN_Context   context[SCREEN_Role__COUNT];
     struct SCREEN_FONT      defaultFont;
     uint32_t                registeredDevices;
+    // End of the last update on all devices
+    TIMER_Ticks             frameStartTicks;
 };
 
 
@@ -124,6 +146,8 @@ bool        SCREEN_Clip                 (const enum SCREEN_Role Role,
                                          const uint16_t Height,
                                          struct SCREEN_ClippedRegion *const
                                          Creg);
+void        SCREEN_SetPacingOverlay     (const enum SCREEN_Role Role,
+                                         const bool Enabled);
 void        SCREEN_Update               (void);
 void        SCREEN_Shutdown             (void);
 bool        SCREEN_Context__clip        (const struct SCREEN_Context * const C,
@@ -150,3 +174,12 @@ int32_t     SCREEN_Context__fromClipY   (const struct SCREEN_Context * const C,
 uint8_t *   SCREEN_Context__backbufferXY
                                         (const struct SCREEN_Context * const C,
                                          const int32_t X, const int32_t Y);
+void        SCREEN_Context__markDirty   (const struct SCREEN_Context * const C,
+                                         const int32_t X, const int32_t Y,
+                                         const int32_t Width,
+                                         const int32_t Height);
+uint8_t *   SCREEN_Context__target      (const struct SCREEN_Context * const C,
+                                         int32_t *const FirstLine,
+                                         uint32_t *const Lines);
+struct SCREEN_Context *
+            SCREEN__context             (const enum SCREEN_Role Role);
@@ -0,0 +1,377 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+  
+  [SCREEN MANAGER] display list; draw calls rasterized in horizontal bands.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "embedul.ar/source/core/manager/screen/dlist.h"
+#include "embedul.ar/source/core/manager/screen/pixel.h"
+#include "embedul.ar/source/core/manager/screen/rect.h"
+#include "embedul.ar/source/core/manager/screen/line.h"
+#include "embedul.ar/source/core/manager/screen/tile.h"
+#include "embedul.ar/source/core/device/board.h"
+
+
+void SCREEN_DLIST_Init (struct SCREEN_DLIST *const L,
+                        struct SCREEN_DLIST_Cmd *const Cmd,
+                        const uint32_t CmdCapacity,
+                        char *const Text, const uint32_t TextOctets,
+                        uint8_t *const Band, const uint32_t BandOctets)
+{
+    BOARD_AssertParams (L && Cmd && CmdCapacity && Band && BandOctets);
+    // Text buffer is optional; strings are dropped without one
+    BOARD_AssertParams (Text || !TextOctets);
+
+    OBJECT_Clear (L);
+
+    L->cmd          = Cmd;
+    L->cmdCapacity  = CmdCapacity;
+    L->text         = Text;
+    L->textOctets   = TextOctets;
+    L->band         = Band;
+    L->bandOctets   = BandOctets;
+}
+
+
+// Bands are copied to the backbuffer when BandOut is NULL (default).
+void SCREEN_DLIST_SetBandOut (struct SCREEN_DLIST *const L,
+                              SCREEN_DLIST_BandOutFunc const BandOut,
+                              void *const Param)
+{
+    BOARD_AssertParams (L);
+
+    L->bandOut      = BandOut;
+    L->bandOutParam = Param;
+}
+
+
+static bool overlaps (const struct SCREEN_DLIST_Cmd *const Cmd,
+                      const uint16_t Band)
+{
+    return (Band >= Cmd->bandFirst && Band <= Cmd->bandLast);
+}
+
+
+// True if the command overwrites every pixel of scanlines Y to Y + Lines - 1.
+static bool coversBand (const struct SCREEN_DLIST_Cmd *const Cmd,
+                        const uint16_t Width, const int32_t Y,
+                        const int32_t Lines)
+{
+    if (Cmd->type != SCREEN_DLIST_CmdType_Rect)
+    {
+        return false;
+    }
+
+    const struct SCREEN_Clip *const Clip = &Cmd->clip;
+
+    const int32_t X1 = (Cmd->rect.x > Clip->x1)? Cmd->rect.x : Clip->x1;
+    const int32_t Y1 = (Cmd->rect.y > Clip->y1)? Cmd->rect.y : Clip->y1;
+    const int32_t X2 = Cmd->rect.x + Cmd->rect.width - 1;
+    const int32_t Y2 = Cmd->rect.y + Cmd->rect.height - 1;
+
+    return (X1 == 0 && X2 >= Width - 1 && Clip->x2 == Width - 1 &&
+            Y1 <= Y && Y2 >= Y + Lines - 1 && Clip->y2 >= Y + Lines - 1);
+}
+
+
+static void replay (struct SCREEN_Context *const C,
+                    struct SCREEN_DLIST *const L,
+                    const struct SCREEN_DLIST_Cmd *const Cmd)
+{
+    C->clip     = Cmd->clip;
+    C->gradient = Cmd->gradient;
+    C->font     = Cmd->font;
+
+    // Clipping limited to band scanlines. Lines keep their original clipping
+    // to be rasterized exactly as when drawn to the backbuffer; pixels
+    // outside the band are skipped instead.
+    if (Cmd->type != SCREEN_DLIST_CmdType_Line)
+    {
+        const int32_t BandY2 = C->band.y + C->band.lines - 1;
+
+        if (C->clip.y1 < C->band.y)
+        {
+            C->clip.y1 = C->band.y;
+        }
+
+        if (C->clip.y2 > BandY2)
+        {
+            C->clip.y2 = (uint16_t) BandY2;
+        }
+
+        if (C->clip.y1 > C->clip.y2)
+        {
+            return;
+        }
+
+        C->clip.height = C->clip.y2 - C->clip.y1 + 1;
+    }
+
+    switch (Cmd->type)
+    {
+        case SCREEN_DLIST_CmdType_Pixel:
+            SCREEN_PIXEL_Draw (L->role, Cmd->pixel.x, Cmd->pixel.y,
+                               Cmd->pixel.color);
+            break;
+
+        case SCREEN_DLIST_CmdType_Rect:
+            SCREEN_RECT_Draw (L->role, Cmd->rect.x, Cmd->rect.y,
+                              Cmd->rect.width, Cmd->rect.height,
+                              Cmd->rect.colorSel);
+            break;
+
+        case SCREEN_DLIST_CmdType_Line:
+            SCREEN_LINE_Draw (L->role, Cmd->line.x1, Cmd->line.y1,
+                              Cmd->line.x2, Cmd->line.y2, Cmd->line.colorSel);
+            break;
+
+        case SCREEN_DLIST_CmdType_Tile:
+            SCREEN_TILE_Draw (L->role, Cmd->tile.data, Cmd->tile.x,
+                              Cmd->tile.y);
+            break;
+
+        case SCREEN_DLIST_CmdType_Tilemap:
+            SCREEN_TILEMAP_Draw (L->role, Cmd->tilemap.tilemap,
+                                 Cmd->tilemap.x, Cmd->tilemap.y,
+                                 Cmd->tilemap.animation, Cmd->tilemap.frame,
+                                 Cmd->tilemap.tileproc, Cmd->tilemap.lineproc,
+                                 Cmd->tilemap.param);
+            break;
+
+        case SCREEN_DLIST_CmdType_Glyph:
+            SCREEN_FONT_DrawGlyph (L->role, Cmd->glyph.x, Cmd->glyph.y,
+                                   Cmd->glyph.colorSel, Cmd->glyph.codepoint);
+            break;
+
+        case SCREEN_DLIST_CmdType_String:
+            SCREEN_FONT_DrawStringSegment (L->role, Cmd->string.x,
+                                           Cmd->string.y,
+                                           Cmd->string.colorSel,
+                                           &L->text[Cmd->string.offset],
+                                           Cmd->string.octets);
+            break;
+
+        default:
+            BOARD_AssertUnexpectedValue (L, (uint32_t)Cmd->type);
+            break;
+    }
+}
+
+
+// Rasterizes recorded commands band by band, then empties the list.
+static void rasterize (struct SCREEN_DLIST *const L)
+{
+    struct SCREEN_Context *const C = SCREEN__context (L->role);
+
+    // Replayed draw calls change the context state
+    const struct SCREEN_Context Saved = *C;
+
+    const uint16_t Width    = C->driver->iface->Width;
+    const uint16_t Height   = C->driver->iface->Height;
+
+    // Replayed draw calls must draw, not record
+    C->dlist = NULL;
+
+    uint16_t b = 0;
+
+    for (int32_t y = 0; y < Height; y += L->bandLines, ++b)
+    {
+        const int32_t Lines = (y + L->bandLines > Height)?
+                                    Height - y : L->bandLines;
+
+        uint32_t first = 0;
+
+        while (first < L->cmdCount && !overlaps(&L->cmd[first], b))
+        {
+            ++ first;
+        }
+
+        if (first == L->cmdCount && !L->bandOut)
+        {
+            // Nothing to draw, backbuffer scanlines stay as they are
+            continue;
+        }
+
+        uint8_t *const Backbuffer = &C->driver->backbuffer[y * Width];
+        const uint32_t Octets = (uint32_t)(Lines * Width);
+
+        // Band initial contents, unless completely overwritten
+        if (first == L->cmdCount ||
+            !coversBand(&L->cmd[first], Width, y, Lines))
+        {
+            if (L->bandOut)
+            {
+                memset (L->band, 0, Octets);
+            }
+            else
+            {
+                memcpy (L->band, Backbuffer, Octets);
+            }
+        }
+
+        C->band = (struct SCREEN_Band) {
+            .buffer = L->band,
+            .y      = (uint16_t) y,
+            .lines  = (uint16_t) Lines
+        };
+
+        for (uint32_t i = first; i < L->cmdCount; ++i)
+        {
+            if (overlaps (&L->cmd[i], b))
+            {
+                replay (C, L, &L->cmd[i]);
+            }
+        }
+
+        C->band = (struct SCREEN_Band) { 0 };
+
+        if (L->bandOut)
+        {
+            L->bandOut (L->bandOutParam, (uint16_t)y, (uint16_t)Lines,
+                        L->band);
+        }
+        else
+        {
+            memcpy (Backbuffer, L->band, Octets);
+        }
+    }
+
+    *C = Saved;
+
+    L->cmdCount = 0;
+    L->textUsed = 0;
+}
+
+
+// Draw calls on Role are recorded in L until SCREEN_DLIST_End().
+void SCREEN_DLIST_Begin (const enum SCREEN_Role Role,
+                         struct SCREEN_DLIST *const L)
+{
+    struct SCREEN_Context *const C = SCREEN__context (Role);
+
+    BOARD_AssertParams (L && L->cmd);
+    BOARD_AssertState  (!C->dlist);
+
+    L->role         = Role;
+    L->bandLines    = (uint16_t)(L->bandOctets / C->driver->iface->Width);
+    L->cmdCount     = 0;
+    L->textUsed     = 0;
+    L->dropped      = 0;
+
+    // The band buffer must hold at least one scanline
+    BOARD_AssertParams (L->bandLines);
+
+    C->dlist = L;
+}
+
+
+// Stops recording and rasterizes recorded draw calls.
+void SCREEN_DLIST_End (const enum SCREEN_Role Role)
+{
+    struct SCREEN_Context *const C = SCREEN__context (Role);
+
+    BOARD_AssertState (C->dlist);
+
+    struct SCREEN_DLIST *const L = C->dlist;
+
+    rasterize (L);
+
+    C->dlist = NULL;
+
+    if (L->dropped)
+    {
+        LOG_WarnDebug (L, LANG_DISPLAY_LIST_FULL);
+        LOG_Items (1, LANG_DROPPED_DRAW_CALLS, L->dropped);
+    }
+}
+
+
+// Drops draw calls recorded so far; recording continues.
+void SCREEN_DLIST_Discard (const enum SCREEN_Role Role)
+{
+    struct SCREEN_Context *const C = SCREEN__context (Role);
+
+    BOARD_AssertState (C->dlist);
+
+    C->dlist->cmdCount = 0;
+    C->dlist->textUsed = 0;
+}
+
+
+// Called by drawing functions while a display list is recording. YTop and
+// YBottom are the first and last scanline the command may draw on. Text,
+// if any, is copied to the list.
+bool SCREEN_DLIST__record (const struct SCREEN_Context *const C,
+                           const struct SCREEN_DLIST_Cmd *const Cmd,
+                           const int32_t YTop, const int32_t YBottom,
+                           const char *const Text, const uint32_t TextOctets)
+{
+    struct SCREEN_DLIST *const L = C->dlist;
+
+    if (L->cmdCount == L->cmdCapacity ||
+        L->textUsed + TextOctets > L->textOctets)
+    {
+        // Full. When drawing to the backbuffer, recorded draw calls can be
+        // rasterized now and recording started again. A band output function
+        // expects each band once per frame.
+        if (L->bandOut || !L->cmdCount)
+        {
+            ++ L->dropped;
+            return false;
+        }
+
+        rasterize (L);
+
+        if (L->textUsed + TextOctets > L->textOctets)
+        {
+            ++ L->dropped;
+            return false;
+        }
+    }
+
+    // Clamped to screen scanlines
+    const int32_t Last = C->driver->iface->Height - 1;
+    const int32_t Y1 = (YTop < 0)? 0 : (YTop > Last)? Last : YTop;
+    const int32_t Y2 = (YBottom < 0)? 0 : (YBottom > Last)? Last : YBottom;
+
+    struct SCREEN_DLIST_Cmd *const R = &L->cmd[L->cmdCount ++];
+
+    *R = *Cmd;
+
+    R->clip         = C->clip;
+    R->gradient     = C->gradient;
+    R->font         = C->font;
+    R->bandFirst    = (uint16_t)(Y1 / L->bandLines);
+    R->bandLast     = (uint16_t)(Y2 / L->bandLines);
+
+    if (Text)
+    {
+        memcpy (&L->text[L->textUsed], Text, TextOctets);
+
+        R->string.offset = L->textUsed;
+        R->string.octets = TextOctets;
+
+        L->textUsed += TextOctets;
+    }
+
+    return true;
+}
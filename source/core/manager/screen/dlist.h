@@ -0,0 +1,169 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+  
+  [SCREEN MANAGER] display list; draw calls rasterized in horizontal bands.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "embedul.ar/source/core/manager/screen.h"
+#include "embedul.ar/source/core/manager/screen/tilemap.h"
+
+
+enum SCREEN_DLIST_CmdType
+{
+    SCREEN_DLIST_CmdType_Pixel = 0,
+    SCREEN_DLIST_CmdType_Rect,
+    SCREEN_DLIST_CmdType_Line,
+    SCREEN_DLIST_CmdType_Tile,
+    SCREEN_DLIST_CmdType_Tilemap,
+    SCREEN_DLIST_CmdType_Glyph,
+    SCREEN_DLIST_CmdType_String
+};
+
+
+// A recorded draw call, along with the context state it depends on.
+struct SCREEN_DLIST_Cmd
+{
+    enum SCREEN_DLIST_CmdType       type;
+    struct SCREEN_Clip              clip;
+    struct RGB332_Gradient          gradient;
+    struct SCREEN_FONT              * font;
+    // First and last band the command draws on
+    uint16_t                        bandFirst;
+    uint16_t                        bandLast;
+    union
+    {
+        struct
+        {
+            int32_t                 x;
+            int32_t                 y;
+            RGB332_Color            color;
+        }
+        pixel;
+        struct
+        {
+            int32_t                 x;
+            int32_t                 y;
+            uint16_t                width;
+            uint16_t                height;
+            RGB332_Select           colorSel;
+        }
+        rect;
+        struct
+        {
+            int32_t                 x1;
+            int32_t                 y1;
+            int32_t                 x2;
+            int32_t                 y2;
+            RGB332_Select           colorSel;
+        }
+        line;
+        struct
+        {
+            const uint8_t           * data;
+            int32_t                 x;
+            int32_t                 y;
+        }
+        tile;
+        struct
+        {
+            const struct SCREEN_TILEMAP
+                                    * tilemap;
+            int32_t                 x;
+            int32_t                 y;
+            uint16_t                animation;
+            uint16_t                frame;
+            SCREEN_TILEMAP_TileProc tileproc;
+            SCREEN_TILEMAP_LineProc lineproc;
+            void                    * param;
+        }
+        tilemap;
+        struct
+        {
+            int32_t                 x;
+            int32_t                 y;
+            RGB332_Select           colorSel;
+            uint16_t                codepoint;
+        }
+        glyph;
+        struct
+        {
+            int32_t                 x;
+            int32_t                 y;
+            RGB332_Select           colorSel;
+            // Copied to the display list text buffer
+            uint32_t                offset;
+            uint32_t                octets;
+        }
+        string;
+    };
+};
+
+
+// Receives each rasterized band, from top to bottom. Lines * screen width
+// octets, starting at scanline Y.
+typedef void (* SCREEN_DLIST_BandOutFunc)(void *const Param, const uint16_t Y,
+                                          const uint16_t Lines,
+                                          const uint8_t *const Band);
+
+
+// Pixel, rect, line, tile, tilemap (and so sprite) and font draw calls are
+// recorded; data they point to must stay unchanged until SCREEN_DLIST_End().
+// Dotmaps and cached elements draw on the backbuffer right away.
+struct SCREEN_DLIST
+{
+    struct SCREEN_DLIST_Cmd         * cmd;
+    uint32_t                        cmdCapacity;
+    uint32_t                        cmdCount;
+    char                            * text;
+    uint32_t                        textOctets;
+    uint32_t                        textUsed;
+    uint8_t                         * band;
+    uint32_t                        bandOctets;
+    uint16_t                        bandLines;
+    enum SCREEN_Role                role;
+    SCREEN_DLIST_BandOutFunc        bandOut;
+    void                            * bandOutParam;
+    // Draw calls that did not fit and could not be flushed
+    uint32_t                        dropped;
+};
+
+
+void    SCREEN_DLIST_Init       (struct SCREEN_DLIST *const L,
+                                 struct SCREEN_DLIST_Cmd *const Cmd,
+                                 const uint32_t CmdCapacity,
+                                 char *const Text, const uint32_t TextOctets,
+                                 uint8_t *const Band,
+                                 const uint32_t BandOctets);
+void    SCREEN_DLIST_SetBandOut (struct SCREEN_DLIST *const L,
+                                 SCREEN_DLIST_BandOutFunc const BandOut,
+                                 void *const Param);
+void    SCREEN_DLIST_Begin      (const enum SCREEN_Role Role,
+                                 struct SCREEN_DLIST *const L);
+void    SCREEN_DLIST_End        (const enum SCREEN_Role Role);
+void    SCREEN_DLIST_Discard    (const enum SCREEN_Role Role);
+bool    SCREEN_DLIST__record    (const struct SCREEN_Context *const C,
+                                 const struct SCREEN_DLIST_Cmd *const Cmd,
+                                 const int32_t YTop, const int32_t YBottom,
+                                 const char *const Text,
+                                 const uint32_t TextOctets);
@@ -91,6 +91,8 @@ void SCREEN_DOTMAP_DebugDraw (const enum SCREEN_Role Role,
     const struct SCREEN_Context *const C = SCREEN_GetContext (Role);
 
     BOARD_AssertParams (M);
+    // Not recorded by display lists.
+    BOARD_AssertState  (!C->dlist);
     BOARD_AssertParams (X + M->width < C->driver->iface->Width &&
                         Y + M->height < C->driver->iface->Height);
     
@@ -107,6 +109,10 @@ void SCREEN_DOTMAP_DebugDraw (const enum SCREEN_Role Role,
     // Current position in orange.
     * SCREEN_Context__backbufferXY (C, M->x + (int32_t)X, M->y + (int32_t)Y) =
                                         0xf0;
+
+    SCREEN_Context__markDirty (C, (int32_t)X, (int32_t)Y,
+                               (int32_t)M->width, (int32_t)M->height);
+    SCREEN_Context__markDirty (C, M->x + (int32_t)X, M->y + (int32_t)Y, 1, 1);
 }
 
  
@@ -118,6 +124,8 @@ void SCREEN_DOTMAP_DebugDrawAround (const enum SCREEN_Role Role,
     const struct SCREEN_Context *const C = SCREEN_GetContext (Role);
 
     BOARD_AssertParams (M);
+    // Not recorded by display lists.
+    BOARD_AssertState  (!C->dlist);
     BOARD_AssertParams (X + 3 < C->driver->iface->Width &&
                         Y + 3 < C->driver->iface->Height);
 
@@ -130,4 +138,6 @@ void SCREEN_DOTMAP_DebugDrawAround (const enum SCREEN_Role Role,
     * SCREEN_Context__backbufferXY(C, (int32_t)X  ,(int32_t)Y+2) = M->around[6];
     * SCREEN_Context__backbufferXY(C, (int32_t)X+1,(int32_t)Y+2) = M->around[7];
     * SCREEN_Context__backbufferXY(C, (int32_t)X+2,(int32_t)Y+2) = M->around[8];
+
+    SCREEN_Context__markDirty (C, (int32_t)X, (int32_t)Y, 3, 3);
 }
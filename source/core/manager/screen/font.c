@@ -25,8 +25,20 @@
 
 #include "embedul.ar/source/core/manager/screen/font.h"
 #include "embedul.ar/source/core/manager/screen/font_std.h"
+#include "embedul.ar/source/core/manager/screen/font_run.h"
+#include "embedul.ar/source/core/manager/screen/dlist.h"
+#include "embedul.ar/source/core/manager/screen/tile.h"
 #include "embedul.ar/source/core/device/board.h"
 #include "embedul.ar/source/core/utf8.h"
+#include <string.h>
+
+
+// Code points decoded per UTF8_Decode() call when drawing a string segment.
+#define SCREEN_FONT_DECODE_CHUNK        32
+
+
+_Static_assert (SCREEN_FONT_GLYPH_PAGES < SCREEN_FONT_PAGE_UNTABLED,
+                "too many glyph pages");
 
 
 static const uint8_t s_MissingGlyph[8] =
@@ -88,6 +100,70 @@ static const uint8_t * selectGlyph (const struct SCREEN_FONT *f,
 }
 
 
+// Two-level code point to glyph table. Pages with glyphs are taken in code
+// point order; glyphs on pages left out are looked up by selectGlyph().
+static void buildGlyphTable (struct SCREEN_FONT *const F)
+{
+#if SCREEN_FONT_GLYPH_PAGES
+    const uint8_t *const Missing = (* F->missing);
+
+    uint32_t pages = 0;
+
+    for (uint32_t p = 0; p < SCREEN_FONT_PAGES_BMP; ++p)
+    {
+        const uint32_t First = p * SCREEN_FONT_PAGE_GLYPHS;
+
+        uint32_t i = 0;
+
+        while (i < SCREEN_FONT_PAGE_GLYPHS &&
+               selectGlyph (F, (uint16_t)(First + i)) == Missing)
+        {
+            ++ i;
+        }
+
+        if (i == SCREEN_FONT_PAGE_GLYPHS)
+        {
+            F->pageIndex[p] = 0;
+        }
+        else if (pages == SCREEN_FONT_GLYPH_PAGES)
+        {
+            F->pageIndex[p] = SCREEN_FONT_PAGE_UNTABLED;
+        }
+        else
+        {
+            for (i = 0; i < SCREEN_FONT_PAGE_GLYPHS; ++i)
+            {
+                F->page[pages][i] = selectGlyph (F, (uint16_t)(First + i));
+            }
+
+            F->pageIndex[p] = (uint8_t) ++ pages;
+        }
+    }
+#else
+    (void) F;
+#endif
+}
+
+
+inline static const uint8_t * lookupGlyph (const struct SCREEN_FONT *const F,
+                                           const uint16_t Codepoint)
+{
+#if SCREEN_FONT_GLYPH_PAGES
+    const uint8_t Page = F->pageIndex[Codepoint / SCREEN_FONT_PAGE_GLYPHS];
+
+    if (Page == SCREEN_FONT_PAGE_UNTABLED)
+    {
+        return selectGlyph (F, Codepoint);
+    }
+
+    return Page? F->page[Page - 1][Codepoint % SCREEN_FONT_PAGE_GLYPHS] :
+                 (* F->missing);
+#else
+    return selectGlyph (F, Codepoint);
+#endif
+}
+
+
 void SCREEN_FONT_Init (struct SCREEN_FONT *const F, 
                        SCREEN_FONT_SetGlyphsFunc const SetGlyphs)
 {
@@ -103,11 +179,24 @@ void SCREEN_FONT_Init (struct SCREEN_FONT *const F,
     {
         SCREEN_FONT_STD (F);
     }
-    
+
+    SCREEN_FONT_RebuildGlyphTable (F);
+}
+
+
+// Refreshes glyph lookups after glyph blocks, assorted glyphs or the missing
+// glyph of an initialized font change. Scans every code point of the basic
+// multilingual plane when glyph pages are enabled.
+void SCREEN_FONT_RebuildGlyphTable (struct SCREEN_FONT *const F)
+{
+    BOARD_AssertParams (F);
+
     if (!F->missing)
     {
         F->missing = &s_MissingGlyph;
     }
+
+    buildGlyphTable (F);
 }
 
 
@@ -128,18 +217,20 @@ static void drawClippedGlyph (const struct SCREEN_Context *const C,
     
     int32_t cx = SCREEN_Context__toClipX (C, x);
 
+    // Both edges may be clipped on a clipping region narrower than a glyph
     if (cx < 0)
     {
         clipMask >>= -cx;
     }
-    else if (cx > C->clip.width - 8)
+    
+    if (cx > C->clip.width - 8)
     {
-        clipMask <<= cx - (C->clip.width - 8);
+        clipMask &= (uint8_t)(0xFF << (cx - (C->clip.width - 8)));
     }
     
     x = SCREEN_Context__fromClipX (C, cx);
     
-    const uint8_t *const    Glyph   = selectGlyph (C->font, Codepoint);
+    const uint8_t *const    Glyph   = lookupGlyph (C->font, Codepoint);
     const uint16_t          Width   = C->driver->iface->Width;
     uint8_t *               bb      = SCREEN_Context__backbufferXY
                                                 (C, (x >= 0)? x : 0, y);
@@ -232,6 +323,17 @@ bool SCREEN_FONT_DrawGlyph (const enum SCREEN_Role Role,
         return false;
     }
 
+    if (C->dlist)
+    {
+        const struct SCREEN_DLIST_Cmd Cmd = {
+            .type   = SCREEN_DLIST_CmdType_Glyph,
+            .glyph  = { .x = X, .y = Y, .colorSel = ColorSel,
+                        .codepoint = Codepoint }
+        };
+
+        return SCREEN_DLIST__record (C, &Cmd, Y, Y + 7, NULL, 0);
+    }
+
     uint8_t v0, v1;
     glyphClipV (C, &cy, &v0, &v1);
 
@@ -239,11 +341,115 @@ bool SCREEN_FONT_DrawGlyph (const enum SCREEN_Role Role,
     const int32_t Sy = SCREEN_Context__fromClipY (C, cy);
 
     drawClippedGlyph (C, Sx, Sy, v0, v1, ColorSel, Codepoint);
+    SCREEN_Context__markDirty (C, Sx, Sy, 8, v1 - v0 + 1);
 
     return true;
 }
 
 
+// Draws glyphs of a cached text run on a textline, from glyph First up to the
+// right clipping edge. Same preconditions as drawClippedGlyph(); 'x' is the
+// left edge of the first glyph in the run. Whole glyphs are stored as masked
+// rows of a single color.
+static uint32_t drawRun (const struct SCREEN_Context *const C,
+                         const struct SCREEN_FONT_RUN_Entry *const E,
+                         const int32_t X, const int32_t Y,
+                         uint8_t v0, const uint8_t V1,
+                         const uint32_t First, const RGB332_Select ColorSel)
+{
+    if (X + (int32_t)(First << 3) > C->clip.x2 || First >= E->glyphs)
+    {
+        return 0;
+    }
+
+    // Last glyph at or before the right clipping edge
+    uint32_t last = (uint32_t)((C->clip.x2 - X) >> 3);
+
+    if (last >= E->glyphs)
+    {
+        last = E->glyphs - 1u;
+    }
+
+    // Only the first and last glyph may be clipped. Mask bit 0 selects the
+    // leftmost pixel.
+    const int32_t FirstCx   = SCREEN_Context__toClipX (C,
+                                                X + (int32_t)(First << 3));
+    const int32_t LastCx    = SCREEN_Context__toClipX (C,
+                                                X + (int32_t)(last << 3));
+    const int32_t LeftCut   = (FirstCx < 0)? -FirstCx : 0;
+    const int32_t RightCut  = (LastCx > C->clip.width - 8)?
+                                    LastCx - (C->clip.width - 8) : 0;
+    const uint8_t FirstClip = (uint8_t)(0xFF << LeftCut);
+    const uint8_t LastClip  = (uint8_t)(0xFF >> RightCut);
+
+    const bool      Gradient    = RGB332_SelectIsGradientAuto (ColorSel);
+    const uint8_t   Solid       = RGB332_GetSelectedColor (&C->gradient,
+                                                                ColorSel, 0);
+    const uint16_t  Width       = C->driver->iface->Width;
+
+    // Leftmost pixel drawn
+    uint8_t * line = SCREEN_Context__backbufferXY (C,
+                            X + (int32_t)(First << 3) + LeftCut, Y);
+
+    while (v0 <= V1)
+    {
+        const uint8_t Color = Gradient? C->gradient.c[v0] : Solid;
+
+        uint8_t colorRow[8];
+        memset (colorRow, Color, sizeof(colorRow));
+
+        for (uint32_t g = First; g <= last; ++g)
+        {
+            uint8_t clip = 0xFF;
+
+            if (g == First)
+            {
+                clip &= FirstClip;
+            }
+
+            if (g == last)
+            {
+                clip &= LastClip;
+            }
+
+            const uint8_t Mask = E->mask[g][v0] & clip;
+
+            if (!Mask)
+            {
+                continue;
+            }
+
+            // Offset of the glyph leftmost pixel, clipped or not
+            const int32_t Offset = (int32_t)((g - First) << 3) - LeftCut;
+
+            if (clip != 0xFF)
+            {
+                for (int32_t j = 0; j < 8; ++j)
+                {
+                    if (Mask & (1 << j))
+                    {
+                        line[Offset + j] = Color;
+                    }
+                }
+            }
+            else if (Mask == 0xFF)
+            {
+                memcpy (&line[Offset], colorRow, sizeof(colorRow));
+            }
+            else
+            {
+                SCREEN_TILE__copyRowMasked (&line[Offset], colorRow, Mask);
+            }
+        }
+
+        ++ v0;
+        line += Width;
+    }
+
+    return last - First + 1;
+}
+
+
 uint32_t SCREEN_FONT_DrawStringSegment (const enum SCREEN_Role Role,
                                         const int32_t X, const int32_t Y, 
                                         const RGB332_Select ColorSel,
@@ -263,6 +469,30 @@ uint32_t SCREEN_FONT_DrawStringSegment (const enum SCREEN_Role Role,
         return 0;
     }
 
+    if (C->dlist)
+    {
+        // String copied to the display list
+        const struct SCREEN_DLIST_Cmd Cmd = {
+            .type   = SCREEN_DLIST_CmdType_String,
+            .string = { .x = X, .y = Y, .colorSel = ColorSel }
+        };
+
+        if (!SCREEN_DLIST__record (C, &Cmd, Y, Y + 7, Str, Octets))
+        {
+            return 0;
+        }
+
+        // Glyphs that will be drawn, between the ones skipped on the left
+        // and the first one beyond the right clipping edge.
+        const int32_t Glyphs = (int32_t) UTF8_Count ((const uint8_t *)Str,
+                                                     Octets);
+        const int32_t Skip   = (cx < 0)? -cx >> 3 : 0;
+        const int32_t Right  = ((C->clip.x2 - X) >> 3) + 1;
+        const int32_t End    = (Right < Glyphs)? Right : Glyphs;
+
+        return (End > Skip)? (uint32_t)(End - Skip) : 0;
+    }
+
     uint32_t        glyphsDrawn = 0;
     const char      * sp        = Str;
     uint32_t        octetsLeft  = Octets;
@@ -273,40 +503,65 @@ uint32_t SCREEN_FONT_DrawStringSegment (const enum SCREEN_Role Role,
     
     int32_t x = SCREEN_Context__fromClipX (C, cx);
     int32_t y = SCREEN_Context__fromClipY (C, cy);
+
+    // Left edge of the first glyph drawn
+    const int32_t FirstX = x + (int32_t)(skipGlyphs << 3);
+
+    if (C->fontRun)
+    {
+        const struct SCREEN_FONT_RUN_Entry *const E =
+                        SCREEN_FONT_RUN__get (C->fontRun, C->font, Str, Octets);
+        if (E)
+        {
+            glyphsDrawn = drawRun (C, E, x, y, v0, v1, skipGlyphs, ColorSel);
+
+            SCREEN_Context__markDirty (C, FirstX, y,
+                                       (int32_t)(glyphsDrawn << 3),
+                                       v1 - v0 + 1);
+            return glyphsDrawn;
+        }
+    }
     
+    // Code points are decoded in chunks to keep the stack usage bounded.
+    uint16_t codepoints[SCREEN_FONT_DECODE_CHUNK];
+
     while (octetsLeft)
     {
-        struct UTF8_GetCodePointResult r =
-                        UTF8_GetCodePoint ((const uint8_t *)sp, octetsLeft);
+        const struct UTF8_DecodeResult R =
+                    UTF8_Decode ((const uint8_t *)sp, octetsLeft, codepoints,
+                                 SCREEN_FONT_DECODE_CHUNK,
+                                 SCREEN_FONT_REPLACEMENT_CHAR_CODEPOINT);
 
-        if (r.dataLength)
-        {
-            sp += r.dataLength;
-            // Octets can't be negative
-            BOARD_AssertState (octetsLeft >= r.dataLength);
-            octetsLeft -= r.dataLength;
-        }
-        // Invalid byte, draw a replacement char
-        else
-        {
-            r.codepoint = SCREEN_FONT_REPLACEMENT_CHAR_CODEPOINT;
-            sp += 1;
-            octetsLeft -= 1;
-        }
+        // Octets can't be negative
+        BOARD_AssertState (R.octets && octetsLeft >= R.octets);
+        sp += R.octets;
+        octetsLeft -= R.octets;
 
-        if (skipGlyphs)
-        {
-            -- skipGlyphs;
-        }
-        else if (x <= C->clip.x2)
+        for (uint32_t i = 0; i < R.codepoints; ++i)
         {
-            drawClippedGlyph (C, x, y, v0, v1, ColorSel, r.codepoint);
-            ++ glyphsDrawn;
-        }
+            if (skipGlyphs)
+            {
+                -- skipGlyphs;
+            }
+            else if (x <= C->clip.x2)
+            {
+                drawClippedGlyph (C, x, y, v0, v1, ColorSel, codepoints[i]);
+                ++ glyphsDrawn;
+            }
+            else
+            {
+                // Remaining glyphs are beyond the right clipping edge
+                octetsLeft = 0;
+                break;
+            }
 
-        x += 8;
+            x += 8;
+        }
     }
-    
+
+    SCREEN_Context__markDirty (C, FirstX, y, (int32_t)(glyphsDrawn << 3),
+                               v1 - v0 + 1);
+
     return glyphsDrawn;
 }
 
@@ -524,3 +779,11 @@ uint32_t SCREEN_FONT_DrawParsedStringArgsLite (const enum SCREEN_Role Role,
                                              SCREEN_FONT_AutoMaxOctets(Role),
                                              Str, ArgValues, ArgCount);
 }
+
+
+// Glyph of a code point on an initialized font.
+const uint8_t * SCREEN_FONT__glyph (const struct SCREEN_FONT *const F,
+                                    const uint16_t Codepoint)
+{
+    return lookupGlyph (F, Codepoint);
+}
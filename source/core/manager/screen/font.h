@@ -34,6 +34,16 @@
 // Unicode point U+FFFD (Invalid data stream byte)
 #define SCREEN_FONT_REPLACEMENT_CHAR_CODEPOINT       0xFFFD
 
+// Glyph pages in the flat code point to glyph table built on font init. Each
+// font keeps a SCREEN_FONT_PAGES_BMP octet page index plus a glyph pointer
+// per code point of each page. Zero looks up glyphs by Unicode block on each
+// character drawn.
+#define SCREEN_FONT_GLYPH_PAGES     LIB_EMBEDULAR_CONFIG_SCREEN_FONT_GLYPH_PAGES
+#define SCREEN_FONT_PAGE_GLYPHS     64
+#define SCREEN_FONT_PAGES_BMP       (0x10000 / SCREEN_FONT_PAGE_GLYPHS)
+// Page index of code points beyond the glyph pages available
+#define SCREEN_FONT_PAGE_UNTABLED   0xFF
+
 
 #define SCREEN_FONT_DrawParsedString(_role,_x,_y,_col,_dp,_row,_max,_str,...) \
     SCREEN_FONT_DrawParsedStringArgs (_role,_x,_y,_col,_dp,_row,_max,_str, \
@@ -96,6 +106,14 @@ struct SCREEN_FONT
     const uint8_t (* (*assorted)(uint16_t codepoint))[8];
     // Default glyph to use when there is no glyph available
     const uint8_t (* missing)[8];
+
+#if SCREEN_FONT_GLYPH_PAGES
+    // Glyph page of each SCREEN_FONT_PAGE_GLYPHS code points, starting at
+    // one. Zero on pages without glyphs, SCREEN_FONT_PAGE_UNTABLED on pages
+    // left out once all glyph pages are taken.
+    uint8_t         pageIndex[SCREEN_FONT_PAGES_BMP];
+    const uint8_t   * page[SCREEN_FONT_GLYPH_PAGES][SCREEN_FONT_PAGE_GLYPHS];
+#endif
 };
 
 
@@ -105,6 +123,8 @@ typedef void (* SCREEN_FONT_SetGlyphsFunc) (struct SCREEN_FONT *const F);
 void        SCREEN_FONT_Init            (struct SCREEN_FONT *const F,
                                          SCREEN_FONT_SetGlyphsFunc const
                                          SetGlyphs);
+void        SCREEN_FONT_RebuildGlyphTable
+                                        (struct SCREEN_FONT *const F);
 bool        SCREEN_FONT_DrawGlyph       (const enum SCREEN_Role Role,
                                          const int32_t X, const int32_t Y,
                                          const RGB332_Select ColorSel,
@@ -144,3 +164,6 @@ uint32_t    SCREEN_FONT_DrawParsedStringArgsLite
                                          const char *const Str,
                                          struct VARIANT *const ArgValues,
                                          const uint32_t ArgCount);
+const uint8_t *
+            SCREEN_FONT__glyph          (const struct SCREEN_FONT *const F,
+                                         const uint16_t Codepoint);
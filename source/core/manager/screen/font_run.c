@@ -0,0 +1,207 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+  
+  [SCREEN MANAGER] text run cache of rendered glyph masks.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "embedul.ar/source/core/manager/screen/font_run.h"
+#include "embedul.ar/source/core/manager/screen.h"
+#include "embedul.ar/source/core/device/board.h"
+#include "embedul.ar/source/core/utf8.h"
+#include <string.h>
+
+
+void SCREEN_FONT_RUN_Init (struct SCREEN_FONT_RUN *const R,
+                           struct SCREEN_FONT_RUN_Entry *const Entry,
+                           const uint32_t Capacity)
+{
+    BOARD_AssertParams (R && Entry && Capacity);
+
+    OBJECT_Clear (R);
+
+    R->entry    = Entry;
+    R->capacity = Capacity;
+
+    SCREEN_FONT_RUN_Invalidate (R);
+}
+
+
+void SCREEN_FONT_RUN_Attach (const enum SCREEN_Role Role,
+                             struct SCREEN_FONT_RUN *const R)
+{
+    BOARD_AssertParams (R && R->entry);
+
+    struct SCREEN_Context *const C = SCREEN__context (Role);
+    C->fontRun = R;
+}
+
+
+void SCREEN_FONT_RUN_Detach (const enum SCREEN_Role Role)
+{
+    struct SCREEN_Context *const C = SCREEN__context (Role);
+    C->fontRun = NULL;
+}
+
+
+// Drops every entry. Required after changing glyphs of an initialized font.
+void SCREEN_FONT_RUN_Invalidate (struct SCREEN_FONT_RUN *const R)
+{
+    BOARD_AssertParams (R && R->entry);
+
+    for (uint32_t i = 0; i < R->capacity; ++i)
+    {
+        R->entry[i].font = NULL;
+    }
+}
+
+
+uint32_t SCREEN_FONT_RUN_Hits (const struct SCREEN_FONT_RUN *const R)
+{
+    BOARD_AssertParams (R);
+    return R->hits;
+}
+
+
+uint32_t SCREEN_FONT_RUN_Misses (const struct SCREEN_FONT_RUN *const R)
+{
+    BOARD_AssertParams (R);
+    return R->misses;
+}
+
+
+// FNV-1a
+static uint32_t hashText (const char *const Str, const uint32_t Octets)
+{
+    uint32_t hash = 0x811C9DC5;
+
+    for (uint32_t i = 0; i < Octets; ++i)
+    {
+        hash ^= (uint8_t) Str[i];
+        hash *= 0x01000193;
+    }
+
+    return hash;
+}
+
+
+// Font glyph rows have the leftmost pixel on bit 7; tile masks on bit 0.
+static uint8_t reverseBits (uint8_t b)
+{
+    b = (uint8_t)(((b & 0xF0) >> 4) | ((b & 0x0F) << 4));
+    b = (uint8_t)(((b & 0xCC) >> 2) | ((b & 0x33) << 2));
+    b = (uint8_t)(((b & 0xAA) >> 1) | ((b & 0x55) << 1));
+    return b;
+}
+
+
+static void buildEntry (struct SCREEN_FONT_RUN_Entry *const E,
+                        const struct SCREEN_FONT *const F,
+                        const char *const Str, const uint32_t Octets,
+                        const uint32_t Hash)
+{
+    E->font     = F;
+    E->hash     = Hash;
+    E->octets   = (uint16_t) Octets;
+    E->glyphs   = 0;
+
+    memcpy (E->text, Str, Octets);
+
+    // Never more code points than octets
+    uint16_t codepoints[SCREEN_FONT_RUN_OCTETS];
+
+    const uint8_t   * sp        = (const uint8_t *) Str;
+    uint32_t        octetsLeft  = Octets;
+
+    while (octetsLeft)
+    {
+        const struct UTF8_DecodeResult R =
+                    UTF8_Decode (sp, octetsLeft, codepoints,
+                                 SCREEN_FONT_RUN_OCTETS,
+                                 SCREEN_FONT_REPLACEMENT_CHAR_CODEPOINT);
+
+        BOARD_AssertState (R.octets && octetsLeft >= R.octets);
+        sp += R.octets;
+        octetsLeft -= R.octets;
+
+        for (uint32_t i = 0; i < R.codepoints; ++i)
+        {
+            const uint8_t *const Glyph = SCREEN_FONT__glyph (F, codepoints[i]);
+            uint8_t *const Mask = E->mask[E->glyphs ++];
+
+            for (uint32_t r = 0; r < 8; ++r)
+            {
+                Mask[r] = reverseBits (Glyph[r]);
+            }
+        }
+    }
+}
+
+
+// Entry of a string segment, built if not cached. NULL if it is too long
+// to be cached.
+const struct SCREEN_FONT_RUN_Entry *
+SCREEN_FONT_RUN__get (struct SCREEN_FONT_RUN *const R,
+                      const struct SCREEN_FONT *const F,
+                      const char *const Str, const uint32_t Octets)
+{
+    if (Octets > SCREEN_FONT_RUN_OCTETS)
+    {
+        return NULL;
+    }
+
+    const uint32_t Hash = hashText (Str, Octets);
+
+    struct SCREEN_FONT_RUN_Entry * victim = &R->entry[0];
+
+    ++ R->useCount;
+
+    for (uint32_t i = 0; i < R->capacity; ++i)
+    {
+        struct SCREEN_FONT_RUN_Entry *const E = &R->entry[i];
+
+        if (!E->font)
+        {
+            victim = E;
+            continue;
+        }
+
+        if (E->font == F && E->hash == Hash && E->octets == Octets &&
+            !memcmp (E->text, Str, Octets))
+        {
+            E->lastUse = R->useCount;
+            ++ R->hits;
+            return E;
+        }
+
+        if (victim->font && victim->lastUse > E->lastUse)
+        {
+            victim = E;
+        }
+    }
+
+    ++ R->misses;
+
+    buildEntry (victim, F, Str, Octets, Hash);
+    victim->lastUse = R->useCount;
+
+    return victim;
+}
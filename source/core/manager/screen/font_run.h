@@ -0,0 +1,79 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+  
+  [SCREEN MANAGER] text run cache of rendered glyph masks.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "embedul.ar/source/core/manager/screen/role.h"
+#include "embedul.ar/source/core/manager/screen/font.h"
+#include <stdint.h>
+
+
+// Longest string segment cached, in octets
+#define SCREEN_FONT_RUN_OCTETS      64
+
+
+// A string segment as drawn by a given font.
+struct SCREEN_FONT_RUN_Entry
+{
+    // NULL on unused entries
+    const struct SCREEN_FONT        * font;
+    uint32_t                        hash;
+    uint32_t                        lastUse;
+    uint16_t                        octets;
+    uint16_t                        glyphs;
+    char                            text[SCREEN_FONT_RUN_OCTETS];
+    // One 8 row tile mask per glyph. Bit 0 selects the leftmost pixel.
+    uint8_t                         mask[SCREEN_FONT_RUN_OCTETS][8];
+};
+
+
+// Strings drawn by SCREEN_FONT_DrawStringSegment() on the attached screen are
+// looked up here. Entries are built on first use and replaced least recently
+// used first. Colors are not cached; a string and its shadow share an entry.
+struct SCREEN_FONT_RUN
+{
+    struct SCREEN_FONT_RUN_Entry    * entry;
+    uint32_t                        capacity;
+    uint32_t                        useCount;
+    uint32_t                        hits;
+    uint32_t                        misses;
+};
+
+
+void        SCREEN_FONT_RUN_Init        (struct SCREEN_FONT_RUN *const R,
+                                         struct SCREEN_FONT_RUN_Entry
+                                                                *const Entry,
+                                         const uint32_t Capacity);
+void        SCREEN_FONT_RUN_Attach      (const enum SCREEN_Role Role,
+                                         struct SCREEN_FONT_RUN *const R);
+void        SCREEN_FONT_RUN_Detach      (const enum SCREEN_Role Role);
+void        SCREEN_FONT_RUN_Invalidate  (struct SCREEN_FONT_RUN *const R);
+uint32_t    SCREEN_FONT_RUN_Hits        (const struct SCREEN_FONT_RUN *const R);
+uint32_t    SCREEN_FONT_RUN_Misses      (const struct SCREEN_FONT_RUN *const R);
+const struct SCREEN_FONT_RUN_Entry *
+            SCREEN_FONT_RUN__get        (struct SCREEN_FONT_RUN *const R,
+                                         const struct SCREEN_FONT *const F,
+                                         const char *const Str,
+                                         const uint32_t Octets);
@@ -24,6 +24,7 @@
 */
 
 #include "embedul.ar/source/core/manager/screen/line.h"
+#include "embedul.ar/source/core/manager/screen/dlist.h"
 #include "embedul.ar/source/core/device/board.h"
 
 
@@ -117,6 +118,10 @@ bool SCREEN_LINE_Draw (const enum SCREEN_Role Role,
 {
     const struct SCREEN_Context *const C = SCREEN_GetContext (Role);
 
+    // Given endpoints, recorded on a display list to be clipped again exactly
+    // the same way when replayed.
+    const int32_t X1 = x1, Y1 = y1, X2 = x2, Y2 = y2;
+
     // One or both endpoints are clipped
     if (SCREEN_Context__isPointOut(C, x1, y1) ||
         SCREEN_Context__isPointOut(C, x2, y2))
@@ -135,6 +140,19 @@ bool SCREEN_LINE_Draw (const enum SCREEN_Role Role,
         }
     }
 
+    if (C->dlist)
+    {
+        // Scanlines drawn are those between clipped endpoints
+        const struct SCREEN_DLIST_Cmd Cmd = {
+            .type   = SCREEN_DLIST_CmdType_Line,
+            .line   = { .x1 = X1, .y1 = Y1, .x2 = X2, .y2 = Y2,
+                        .colorSel = ColorSel }
+        };
+
+        return SCREEN_DLIST__record (C, &Cmd, (y1 < y2)? y1 : y2,
+                                     (y1 > y2)? y1 : y2, NULL, 0);
+    }
+
     // Absolute value of horizontal and vertical run-lenghts.
     const uint16_t H = (uint16_t) ((x2 > x1)? x2 - x1 : x1 - x2);
     const uint16_t V = (uint16_t) ((y2 > y1)? y2 - y1 : y1 - y2);
@@ -163,7 +181,8 @@ bool SCREEN_LINE_Draw (const enum SCREEN_Role Role,
             swap_i32 (&y1, &y2);
         }
 
-        m       = (((uint32_t)V) << 24) / H;
+        // A single point line has no run-length to divide
+        m       = H? (((uint32_t)V) << 24) / H : 0;
         steps   = H;
         step    = 1;
         delta   = (y1 > y2)? -Width : Width;
@@ -182,7 +201,17 @@ bool SCREEN_LINE_Draw (const enum SCREEN_Role Role,
         delta   = (x1 > x2)? -1 : 1;
     }
 
-    uint8_t *bb = SCREEN_Context__backbufferXY (C, x1, y1);
+    SCREEN_Context__markDirty (C, (x1 < x2)? x1 : x2, (y1 < y2)? y1 : y2,
+                               H + 1, V + 1);
+
+    // Lines are kept whole when rasterized on a display list band; pixels
+    // outside the band scanlines are skipped.
+    int32_t         firstLine;
+    uint32_t        lines;
+    uint8_t *const  Target  = SCREEN_Context__target (C, &firstLine, &lines);
+    const uint32_t  Size    = lines * Width;
+
+    int32_t off = (y1 - firstLine) * Width + x1;
     uint32_t ds = 0x007FFFFF;   // 0.5
     const int32_t Zd[2] = { 0, delta };
 
@@ -196,10 +225,14 @@ bool SCREEN_LINE_Draw (const enum SCREEN_Role Role,
         
         do
         {
-            *bb = Pal[pi ++];
+            if ((uint32_t)off < Size)
+            {
+                Target[off] = Pal[pi];
+            }
+            ++ pi;
             ds += m;
-            bb += step;
-            bb += Zd[ds >> 24];
+            off += step;
+            off += Zd[ds >> 24];
             ds &= 0x00FFFFFF;
             pi &= 0x7;
         }
@@ -212,10 +245,13 @@ bool SCREEN_LINE_Draw (const enum SCREEN_Role Role,
 
         do
         {
-            *bb = Color;
+            if ((uint32_t)off < Size)
+            {
+                Target[off] = Color;
+            }
             ds += m;
-            bb += step;
-            bb += Zd[ds >> 24];
+            off += step;
+            off += Zd[ds >> 24];
             ds &= 0x00FFFFFF;
         }
         while (steps --);
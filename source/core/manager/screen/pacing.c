@@ -0,0 +1,113 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+  
+  [SCREEN MANAGER] frame pacing overlay.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "embedul.ar/source/core/manager/screen/pacing.h"
+#include "embedul.ar/source/core/manager/screen/rect.h"
+#include "embedul.ar/source/core/manager/screen/line.h"
+#include "embedul.ar/source/core/manager/screen/font.h"
+#include "embedul.ar/source/core/manager/screen.h"
+#include "embedul.ar/source/core/device/board.h"
+
+
+#define OVERLAY_WIDTH       (SCREEN_PACING_BARS * SCREEN_PACING_BAR_WIDTH + 2)
+// Text row, graph and margins
+#define OVERLAY_HEIGHT      (SCREEN_PACING_GRAPH_HEIGHT + 8 + 3)
+
+#define COLOR_BACKGROUND    0x00
+#define COLOR_TEXT          0xFF
+#define COLOR_MARK          0x49
+#define COLOR_OK            0x1C
+#define COLOR_LATE          0xFC
+#define COLOR_MISSED        0xE0
+
+
+static uint8_t barColor (const uint32_t Ticks)
+{
+    if (Ticks <= SCREEN_PACING_TICKS_OK)
+    {
+        return COLOR_OK;
+    }
+
+    return (Ticks <= SCREEN_PACING_TICKS_LATE)? COLOR_LATE : COLOR_MISSED;
+}
+
+
+// Recent frame periods as bars, newest on the right, along with frame period
+// percentiles. Drawn on the bottom left corner regardless of clipping.
+void SCREEN_PACING_Draw (const enum SCREEN_Role Role)
+{
+    struct SCREEN_Context *const C = SCREEN__context (Role);
+    const struct VIDEO_PACING *const P = VIDEO_Pacing (C->driver);
+
+    if (!VIDEO_PACING_Frames (P))
+    {
+        return;
+    }
+
+    const struct SCREEN_Clip Clip = C->clip;
+    const uint16_t Width    = C->driver->iface->Width;
+    const uint16_t Height   = C->driver->iface->Height;
+
+    SCREEN_SetClippingRect (Role, 0, 0, Width - 1, Height - 1);
+
+    const int32_t X     = 0;
+    const int32_t Y     = Height - OVERLAY_HEIGHT;
+    // Bars grow up from the scanline above the bottom margin
+    const int32_t Base  = Height - 1;
+
+    SCREEN_RECT_Draw (Role, X, Y, OVERLAY_WIDTH, OVERLAY_HEIGHT,
+                      COLOR_BACKGROUND);
+
+    SCREEN_LINE_DrawHoriz (Role, X, Base - SCREEN_PACING_TICKS_OK,
+                           OVERLAY_WIDTH, COLOR_MARK);
+    SCREEN_LINE_DrawHoriz (Role, X, Base - SCREEN_PACING_TICKS_LATE,
+                           OVERLAY_WIDTH, COLOR_MARK);
+
+    for (uint32_t i = 0; i < SCREEN_PACING_BARS; ++i)
+    {
+        const uint32_t Ticks = VIDEO_PACING_Recent (P,
+                                    VIDEO_PACING_Phase_Frame,
+                                    SCREEN_PACING_BARS - 1 - i);
+        if (!Ticks)
+        {
+            continue;
+        }
+
+        const uint16_t Bar = (Ticks > SCREEN_PACING_GRAPH_HEIGHT)?
+                                SCREEN_PACING_GRAPH_HEIGHT : (uint16_t) Ticks;
+
+        SCREEN_RECT_Draw (Role, X + 1 + (int32_t)(i * SCREEN_PACING_BAR_WIDTH),
+                          Base - Bar, SCREEN_PACING_BAR_WIDTH, Bar,
+                          barColor (Ticks));
+    }
+
+    SCREEN_FONT_DrawParsedStringLite (Role, X + 1, Y + 1, COLOR_TEXT,
+                LANG_PACING_OVERLAY_FMT,
+                VIDEO_PACING_Percentile(P, VIDEO_PACING_Phase_Frame, 50),
+                VIDEO_PACING_Percentile(P, VIDEO_PACING_Phase_Frame, 99),
+                VIDEO_PACING_Max(P, VIDEO_PACING_Phase_Frame));
+
+    C->clip = Clip;
+}
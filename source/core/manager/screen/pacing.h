@@ -0,0 +1,41 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+  
+  [SCREEN MANAGER] frame pacing overlay.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "embedul.ar/source/core/manager/screen/role.h"
+
+
+// Bars drawn, one per recent frame, and their width in pixels
+#define SCREEN_PACING_BARS          80
+#define SCREEN_PACING_BAR_WIDTH     2
+// Graph height in pixels; one pixel per tick
+#define SCREEN_PACING_GRAPH_HEIGHT  34
+// Frame periods up to one and two VBIs at 60 Hz, in ticks
+#define SCREEN_PACING_TICKS_OK      17
+#define SCREEN_PACING_TICKS_LATE    34
+
+
+void SCREEN_PACING_Draw (const enum SCREEN_Role Role);
@@ -24,6 +24,7 @@
 */
 
 #include "embedul.ar/source/core/manager/screen/pixel.h"
+#include "embedul.ar/source/core/manager/screen/dlist.h"
 #include "embedul.ar/source/core/device/board.h"
 
 
@@ -38,7 +39,18 @@ bool SCREEN_PIXEL_Draw (const enum SCREEN_Role Role,
         return false;
     }
 
+    if (C->dlist)
+    {
+        const struct SCREEN_DLIST_Cmd Cmd = {
+            .type   = SCREEN_DLIST_CmdType_Pixel,
+            .pixel  = { .x = X, .y = Y, .color = Color }
+        };
+
+        return SCREEN_DLIST__record (C, &Cmd, Y, Y, NULL, 0);
+    }
+
     * SCREEN_Context__backbufferXY(C, X, Y) = Color;
+    SCREEN_Context__markDirty (C, X, Y, 1, 1);
 
     return true;
 }
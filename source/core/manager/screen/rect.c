@@ -24,6 +24,7 @@
 */
 
 #include "embedul.ar/source/core/manager/screen/rect.h"
+#include "embedul.ar/source/core/manager/screen/dlist.h"
 #include "embedul.ar/source/core/device/board.h"
 
 
@@ -41,6 +42,17 @@ bool SCREEN_RECT_Draw (const enum SCREEN_Role Role,
         return false;
     }
 
+    if (C->dlist)
+    {
+        const struct SCREEN_DLIST_Cmd Cmd = {
+            .type   = SCREEN_DLIST_CmdType_Rect,
+            .rect   = { .x = X, .y = Y, .width = Width, .height = Height,
+                        .colorSel = ColorSel }
+        };
+
+        return SCREEN_DLIST__record (C, &Cmd, Y, Y + Height - 1, NULL, 0);
+    }
+
     struct SCREEN_ClippedRegion cr;
     SCREEN_Context__clip (C, Cx, Cy, Width, Height, &cr);
 
@@ -52,11 +64,13 @@ bool SCREEN_RECT_Draw (const enum SCREEN_Role Role,
     const uint8_t   Color       = RGB332_GetSelectedColor (&C->gradient,
                                                                 ColorSel, 0);
 
-    while (cr.yBottom --)
+    for (uint32_t i = 0; i < cr.cHeight; ++i)
     {
         memset (bb, Color, (size_t)cr.cWidth);
         bb += Scanline;
     }
 
+    SCREEN_Context__markDirty (C, Sx, Sy, cr.cWidth, cr.cHeight);
+
     return true;
 }
@@ -24,7 +24,111 @@
 */
 
 #include "embedul.ar/source/core/manager/screen/tile.h"
+#include "embedul.ar/source/core/manager/screen/dlist.h"
 #include "embedul.ar/source/core/device/board.h"
+#include <string.h>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+#endif
+
+
+#if !defined(__SSE2__) && !defined(__ARM_NEON)
+// Byte masks of each mask nibble. The lowest bit selects the pixel at the
+// lowest address of a little endian word.
+static const uint32_t s_NibbleByteMask[16] =
+{
+    0x00000000, 0x000000FF, 0x0000FF00, 0x0000FFFF,
+    0x00FF0000, 0x00FF00FF, 0x00FFFF00, 0x00FFFFFF,
+    0xFF000000, 0xFF0000FF, 0xFF00FF00, 0xFF00FFFF,
+    0xFFFF0000, 0xFFFF00FF, 0xFFFFFF00, 0xFFFFFFFF
+};
+#endif
+
+
+// Copies an 8 pixel row. memcpy compiles to a single 64-bit store on 64-bit
+// hosts and to two word stores on Cortex-M.
+static void copyRow (uint8_t *const Dst, const uint8_t *const Src)
+{
+    memcpy (Dst, Src, 8);
+}
+
+
+// Copies the pixels of an 8 pixel row whose mask bit is set, expanding the
+// mask to one byte per pixel for a single read-modify-write of the row. SSE2
+// or NEON on native targets, two 32-bit words elsewhere (Cortex-M included).
+static void copyRowMasked (uint8_t *const Dst, const uint8_t *const Src,
+                           const uint8_t Mask)
+{
+#if defined(__SSE2__)
+    const __m128i Bits  = _mm_set_epi8 (0, 0, 0, 0, 0, 0, 0, 0,
+                                        (char)0x80, 0x40, 0x20, 0x10,
+                                        0x08, 0x04, 0x02, 0x01);
+    const __m128i M     = _mm_cmpeq_epi8 (_mm_and_si128 (
+                                _mm_set1_epi8 ((char)Mask), Bits), Bits);
+    const __m128i S     = _mm_loadl_epi64 ((const __m128i *)Src);
+    const __m128i D     = _mm_loadl_epi64 ((const __m128i *)Dst);
+
+    _mm_storel_epi64 ((__m128i *)Dst, _mm_or_si128 (_mm_and_si128 (M, S),
+                                                    _mm_andnot_si128 (M, D)));
+#elif defined(__ARM_NEON)
+    static const uint8_t Bits[8] = { 0x01, 0x02, 0x04, 0x08,
+                                     0x10, 0x20, 0x40, 0x80 };
+
+    const uint8x8_t M = vtst_u8 (vdup_n_u8 (Mask), vld1_u8 (Bits));
+
+    vst1_u8 (Dst, vbsl_u8 (M, vld1_u8 (Src), vld1_u8 (Dst)));
+#else
+    const uint32_t M0 = s_NibbleByteMask[Mask & 0x0F];
+    const uint32_t M1 = s_NibbleByteMask[Mask >> 4];
+    uint32_t s[2];
+    uint32_t d[2];
+
+    memcpy (s, Src, sizeof(s));
+    memcpy (d, Dst, sizeof(d));
+
+    d[0] = (d[0] & ~M0) | (s[0] & M0);
+    d[1] = (d[1] & ~M1) | (s[1] & M1);
+
+    memcpy (Dst, d, sizeof(d));
+#endif
+}
+
+
+// Draws full width tile rows. Mask NULL: tile without mask.
+static void drawRows (uint8_t *v, const uint16_t Scanline,
+                      const uint8_t *td, const uint8_t *mask,
+                      const int32_t Rows)
+{
+    if (!mask)
+    {
+        for (int32_t i = 0; i < Rows; ++i)
+        {
+            copyRow (v, td);
+            v += Scanline;
+            td += 8;
+        }
+        return;
+    }
+
+    for (int32_t i = 0; i < Rows; ++i)
+    {
+        // Opaque and transparent rows are common on sprites
+        if (*mask == 0xFF)
+        {
+            copyRow (v, td);
+        }
+        else if (*mask)
+        {
+            copyRowMasked (v, td, *mask);
+        }
+        v += Scanline;
+        td += 8;
+        mask += 1;
+    }
+}
 
 
 bool SCREEN_TILE_Draw (const enum SCREEN_Role Role,
@@ -43,6 +147,16 @@ bool SCREEN_TILE_Draw (const enum SCREEN_Role Role,
         return false;
     }
 
+    if (C->dlist)
+    {
+        const struct SCREEN_DLIST_Cmd Cmd = {
+            .type   = SCREEN_DLIST_CmdType_Tile,
+            .tile   = { .data = TileData, .x = X, .y = Y }
+        };
+
+        return SCREEN_DLIST__record (C, &Cmd, Y, Y + 7, NULL, 0);
+    }
+
     struct SCREEN_ClippedRegion clip;
     SCREEN_Context__clip (C, Cx, Cy, 8, 8, &clip);
 
@@ -70,74 +184,62 @@ bool SCREEN_TILE_Draw (const enum SCREEN_Role Role,
     uint8_t *v = SCREEN_Context__backbufferXY (C, Sx, Sy);
     const uint16_t Scanline = C->driver->iface->Width;
 
-    if (!mask)
+    SCREEN_Context__markDirty (C, Sx, Sy, clip.cWidth, clip.cHeight);
+
+    if (clip.xLeft == 0 && clip.xRight == 8)
+    {
+        drawRows (v, Scanline, td, mask, clip.yBottom - clip.yTop);
+    }
+    else if (!mask)
     {    
-        if (clip.xLeft == 0 && clip.xRight == 8)
-        {    
-            for (int32_t i = clip.yTop; i < clip.yBottom; ++i)
-            {
-                v[0] = td[0];
-                v[1] = td[1];
-                v[2] = td[2];
-                v[3] = td[3];
-                v[4] = td[4];
-                v[5] = td[5];
-                v[6] = td[6];
-                v[7] = td[7];
-                v += Scanline;
-                td += 8;
-            }
-        }
-        else 
+        for (int32_t i = clip.yTop; i < clip.yBottom; ++i)
         {
-            for (int32_t i = clip.yTop; i < clip.yBottom; ++i)
+            uint32_t k = 0;
+            for (int32_t j = clip.xLeft; j < clip.xRight; ++j)
             {
-                uint32_t k = 0;
-                for (int32_t j = clip.xLeft; j < clip.xRight; ++j)
-                {
-                    v[k] = td[j];
-                    ++ k;
-                }
-                v += Scanline;
-                td += 8;
-            }        
-        }
+                v[k] = td[j];
+                ++ k;
+            }
+            v += Scanline;
+            td += 8;
+        }        
     }
     else
     {
-        if (clip.xLeft == 0 && clip.xRight == 8)
-        {    
-            for (int32_t i = clip.yTop; i < clip.yBottom; ++i)
-            {
-                if (*mask & 0x01) v[0] = td[0];
-                if (*mask & 0x02) v[1] = td[1];
-                if (*mask & 0x04) v[2] = td[2];
-                if (*mask & 0x08) v[3] = td[3];
-                if (*mask & 0x10) v[4] = td[4];
-                if (*mask & 0x20) v[5] = td[5];
-                if (*mask & 0x40) v[6] = td[6];
-                if (*mask & 0x80) v[7] = td[7];
-                v += Scanline;
-                td += 8;
-                mask += 1;
-            }
-        }
-        else
+        for (int32_t i = clip.yTop; i < clip.yBottom; ++i)
         {
-            for (int32_t i = clip.yTop; i < clip.yBottom; ++i)
+            uint32_t k = 0;
+            for (int32_t j = clip.xLeft; j < clip.xRight; ++j)
             {
-                uint32_t k = 0;
-                for (int32_t j = clip.xLeft; j < clip.xRight; ++j)
-                {
-                    if (*mask & (1 << j)) v[k] = td[j];
-                    ++ k;
-                }
-                v += Scanline;
-                td += 8;
-                mask += 1;
-            }        
-        }
+                if (*mask & (1 << j)) v[k] = td[j];
+                ++ k;
+            }
+            v += Scanline;
+            td += 8;
+            mask += 1;
+        }        
     }
     
     return true;
 }
+
+
+// Draws a tile that lies entirely inside the clipping rect, with no context
+// lookup or clipping. Backbuffer points to the top left tile pixel.
+void SCREEN_TILE__drawUnclipped (uint8_t *const Backbuffer,
+                                 const uint16_t Scanline,
+                                 const uint8_t *const TileData)
+{
+    // Mask data is located after tile header and pixels
+    drawRows (Backbuffer, Scanline, TileData + 4,
+              TileData[0]? TileData + 4 + (8 * 8) : NULL, 8);
+}
+
+
+// Copies the pixels of an 8 pixel row whose mask bit is set. Bit 0 selects
+// the leftmost pixel.
+void SCREEN_TILE__copyRowMasked (uint8_t *const Dst, const uint8_t *const Src,
+                                 const uint8_t Mask)
+{
+    copyRowMasked (Dst, Src, Mask);
+}
@@ -33,3 +33,8 @@
 bool SCREEN_TILE_Draw (const enum SCREEN_Role Role,
                        const uint8_t *const TileData, const int32_t X, 
                        const int32_t Y);
+void SCREEN_TILE__drawUnclipped (uint8_t *const Backbuffer,
+                                 const uint16_t Scanline,
+                                 const uint8_t *const TileData);
+void SCREEN_TILE__copyRowMasked (uint8_t *const Dst, const uint8_t *const Src,
+                                 const uint8_t Mask);
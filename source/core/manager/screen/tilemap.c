@@ -25,25 +25,194 @@
 
 #include "embedul.ar/source/core/manager/screen/tilemap.h"
 #include "embedul.ar/source/core/manager/screen/tile.h"
+#include "embedul.ar/source/core/manager/screen/dlist.h"
 #include "embedul.ar/source/core/device/board.h"
+#include <string.h>
 
 
-static void defaultTileProc (const enum SCREEN_Role Role,
-                             const uint8_t *const *const Tiles,
-                             const uint16_t Tile,
-                             const int32_t X, const int32_t Y, 
-                             const int32_t Tx, const int32_t Ty,
-                             void *const Param)
+// State shared by tile lines drawn without a custom tile procedure.
+struct DefaultDraw
 {
-    (void) Param;
-    
-    if (Tile)
+    const struct SCREEN_Context     * C;
+    const uint8_t *const            * tiles;
+    enum SCREEN_Role                role;
+    int32_t                         sx;
+    int32_t                         sy;
+    // Tile columns to draw
+    int32_t                         txBegin;
+    int32_t                         txEnd;
+    // Tile columns and lines entirely inside the clipping rect
+    int32_t                         txInBegin;
+    int32_t                         txInEnd;
+    int32_t                         tyInBegin;
+    int32_t                         tyInEnd;
+};
+
+
+// First tile column from Tx on that is not empty (zero), or End. Empty runs
+// are skipped four tiles at a time.
+static int32_t skipEmpty8 (const uint8_t *const MapLine, int32_t tx,
+                           const int32_t End)
+{
+    uint32_t run;
+
+    while (tx + 4 <= End)
+    {
+        memcpy (&run, &MapLine[tx], sizeof(run));
+        if (run)
+        {
+            break;
+        }
+        tx += 4;
+    }
+
+    while (tx < End && !MapLine[tx])
+    {
+        ++ tx;
+    }
+
+    return tx;
+}
+
+
+static int32_t skipEmpty16 (const uint16_t *const MapLine, int32_t tx,
+                            const int32_t End)
+{
+    uint64_t run;
+
+    while (tx + 4 <= End)
+    {
+        memcpy (&run, &MapLine[tx], sizeof(run));
+        if (run)
+        {
+            break;
+        }
+        tx += 4;
+    }
+
+    while (tx < End && !MapLine[tx])
+    {
+        ++ tx;
+    }
+
+    return tx;
+}
+
+
+// Returns the backbuffer address of the first interior tile on line Ty, or
+// NULL when the line is clipped or has no interior tiles.
+static uint8_t * interiorLine (const struct DefaultDraw *const D,
+                               const int32_t Ty)
+{
+    if (Ty < D->tyInBegin || Ty >= D->tyInEnd ||
+        D->txInBegin >= D->txInEnd)
+    {
+        return NULL;
+    }
+
+    return SCREEN_Context__backbufferXY (D->C, D->sx + (D->txInBegin << 3),
+                                         D->sy + (Ty << 3));
+}
+
+
+// Returns true if drawn as an interior tile.
+static bool drawTile (const struct DefaultDraw *const D,
+                      uint8_t *const Interior, const uint16_t Tile,
+                      const int32_t Tx, const int32_t Ty)
+{
+    if (Interior && Tx >= D->txInBegin && Tx < D->txInEnd)
+    {
+        SCREEN_TILE__drawUnclipped (Interior + ((Tx - D->txInBegin) << 3),
+                                    D->C->driver->iface->Width,
+                                    D->tiles[Tile]);
+        return true;
+    }
+
+    SCREEN_TILE_Draw (D->role, D->tiles[Tile],
+                      D->sx + (Tx << 3), D->sy + (Ty << 3));
+    return false;
+}
+
+
+// Interior tiles drawn from column TxFirst to TxLast. SCREEN_TILE_Draw marks
+// edge tiles on its own.
+static void markInterior (const struct DefaultDraw *const D,
+                          const int32_t TxFirst, const int32_t TxLast,
+                          const int32_t Ty)
+{
+    if (TxFirst <= TxLast)
     {
-        SCREEN_TILE_Draw (Role, Tiles[Tile], X + (Tx << 3), Y + (Ty << 3));
+        SCREEN_Context__markDirty (D->C, D->sx + (TxFirst << 3),
+                                   D->sy + (Ty << 3),
+                                   (TxLast - TxFirst + 1) << 3, 8);
     }
 }
 
 
+static void drawLine8 (const struct DefaultDraw *const D,
+                       const uint8_t *const MapLine, const int32_t Ty)
+{
+    uint8_t *const Interior = interiorLine (D, Ty);
+    int32_t first = D->txEnd;
+    int32_t last = -1;
+
+    for (int32_t tx = D->txBegin;; ++tx)
+    {
+        tx = skipEmpty8 (MapLine, tx, D->txEnd);
+        if (tx >= D->txEnd)
+        {
+            break;
+        }
+        if (drawTile (D, Interior, MapLine[tx], tx, Ty))
+        {
+            first = (tx < first)? tx : first;
+            last = tx;
+        }
+    }
+
+    markInterior (D, first, last, Ty);
+}
+
+
+static void drawLine16 (const struct DefaultDraw *const D,
+                        const uint16_t *const MapLine, const int32_t Ty)
+{
+    uint8_t *const Interior = interiorLine (D, Ty);
+    int32_t first = D->txEnd;
+    int32_t last = -1;
+
+    for (int32_t tx = D->txBegin;; ++tx)
+    {
+        tx = skipEmpty16 (MapLine, tx, D->txEnd);
+        if (tx >= D->txEnd)
+        {
+            break;
+        }
+        if (drawTile (D, Interior, MapLine[tx], tx, Ty))
+        {
+            first = (tx < first)? tx : first;
+            last = tx;
+        }
+    }
+
+    markInterior (D, first, last, Ty);
+}
+
+
+// Range of tiles, starting at clip coordinate C, that lie entirely inside a
+// clipping rect of Size pixels; clamped to [Begin, End).
+static void interiorRange (const int32_t C, const uint16_t Size,
+                           const int32_t Begin, const int32_t End,
+                           int32_t *const InBegin, int32_t *const InEnd)
+{
+    int32_t b = (C < 0)? ((7 - C) >> 3) : 0;
+    int32_t e = (Size - C) >> 3;
+
+    *InBegin    = (b < Begin)? Begin : (b > End)? End : b;
+    *InEnd      = (e > End)? End : (e < *InBegin)? *InBegin : e;
+}
+
+
 bool SCREEN_TILEMAP_Draw (const enum SCREEN_Role Role,
                          const struct SCREEN_TILEMAP *const Tilemap,
                          const int32_t X, const int32_t Y, 
@@ -74,6 +243,20 @@ bool SCREEN_TILEMAP_Draw (const enum SCREEN_Role Role,
     {
         return false;
     }
+
+    if (C->dlist)
+    {
+        // Procedures will be called on each band the tilemap is drawn on
+        const struct SCREEN_DLIST_Cmd Cmd = {
+            .type       = SCREEN_DLIST_CmdType_Tilemap,
+            .tilemap    = { .tilemap = Tilemap, .x = X, .y = Y,
+                            .animation = Animation, .frame = Frame,
+                            .tileproc = Tileproc, .lineproc = Lineproc,
+                            .param = Param }
+        };
+
+        return SCREEN_DLIST__record (C, &Cmd, Y, Y + PH - 1, NULL, 0);
+    }
     
     struct SCREEN_ClippedRegion cr;
     SCREEN_Context__clip (C, Cx, Cy, PW, PH, &cr);
@@ -88,8 +271,53 @@ bool SCREEN_TILEMAP_Draw (const enum SCREEN_Role Role,
     const int32_t Sx = SCREEN_Context__fromClipX (C, Cx);
     const int32_t Sy = SCREEN_Context__fromClipY (C, Cy);
     
-    SCREEN_TILEMAP_TileProc tileprocSel = 
-                                (Tileproc)? Tileproc : defaultTileProc;
+    if (!Tileproc)
+    {
+        // Interior tiles skip the context lookup and clipping of
+        // SCREEN_TILE_Draw. Only tiles on the clipped edges use it.
+        struct DefaultDraw d = {
+            .C          = C,
+            .tiles      = Tilemap->tiles,
+            .role       = Role,
+            .sx         = Sx,
+            .sy         = Sy,
+            .txBegin    = cr.xLeft,
+            .txEnd      = cr.xRight
+        };
+
+        interiorRange (Cx, C->clip.width, cr.xLeft, cr.xRight,
+                       &d.txInBegin, &d.txInEnd);
+        interiorRange (Cy, C->clip.height, cr.yTop, cr.yBottom,
+                       &d.tyInBegin, &d.tyInEnd);
+
+        for (int32_t ty = cr.yTop; ty < cr.yBottom; ++ty)
+        {
+            if (Lineproc)
+            {
+                Lineproc (Sx, Sy, ty, Param);
+            }
+
+            switch (Tilemap->ptrType)
+            {
+                case SCREEN_TILEMAP_PtrType_8Bit:
+                    drawLine8 (&d, &Tilemap->map8[Animation][Frame]
+                                                 [ty * TMA->width], ty);
+                    break;
+
+                case SCREEN_TILEMAP_PtrType_16Bit:
+                    drawLine16 (&d, &Tilemap->map16[Animation][Frame]
+                                                   [ty * TMA->width], ty);
+                    break;
+
+                default:
+                    BOARD_AssertUnexpectedValue (NOBJ,
+                                                (uint32_t)Tilemap->ptrType);
+                    break;
+            }
+        }
+
+        return true;
+    }
 
     switch (Tilemap->ptrType)
     {
@@ -105,7 +333,7 @@ bool SCREEN_TILEMAP_Draw (const enum SCREEN_Role Role,
                 const uint8_t *const MapLine = &TMAF[ty * TMA->width];
                 for (int32_t tx = cr.xLeft; tx < cr.xRight; ++tx)
                 {
-                    tileprocSel (Role, Tilemap->tiles, MapLine[tx],
+                    Tileproc (Role, Tilemap->tiles, MapLine[tx],
                                  Sx, Sy, tx, ty, Param);
                 }
             }
@@ -124,7 +352,7 @@ bool SCREEN_TILEMAP_Draw (const enum SCREEN_Role Role,
                 const uint16_t *const MapLine = &TMAF[ty * TMA->width];
                 for (int32_t tx = cr.xLeft; tx < cr.xRight; ++tx)
                 {
-                    tileprocSel (Role, Tilemap->tiles, MapLine[tx],
+                    Tileproc (Role, Tilemap->tiles, MapLine[tx],
                                  Sx, Sy, tx, ty, Param);
                 }
             }
@@ -365,6 +365,18 @@ uint32_t STORAGE_CachedElementsCount (void)
 }
 
 
+struct STORAGE_ReadCacheStats STORAGE_ReadCacheStats (void)
+{
+    return s_s->readCacheStats;
+}
+
+
+struct STORAGE_WriteBackStats STORAGE_WriteBackStats (void)
+{
+    return s_s->writeBackStats;
+}
+
+
 static uint32_t checkAccess (const enum STORAGE_Role LinearRole,
                              const struct STORAGE_Volume *const Vol,
                              const uint32_t LocalSector, const uint32_t Count,
@@ -392,6 +404,387 @@ static uint32_t checkAccess (const enum STORAGE_Role LinearRole,
 }
 
 
+static RAWSTOR_Status_Result linearWrite (const enum STORAGE_Role LinearRole,
+                                          const uint8_t *const Data,
+                                          const uint32_t DeviceSector,
+                                          const uint32_t Count,
+                                          const uint32_t Retries)
+{
+    uint32_t currentRetries = Retries;
+    RAWSTOR_Status_Result r;
+    do 
+    {
+        r = drvWrite (LinearRole, Data, DeviceSector, Count);
+    }
+    while (r != RAWSTOR_Status_Result_Ok && currentRetries --);
+
+    return r;
+}
+
+
+#if STORAGE_WRITE_BACK_SECTORS
+// Position of LocalSector, or where it would be, in the dirty sectors list.
+static uint32_t dirtySectorIndex (const uint32_t LocalSector)
+{
+    const struct STORAGE_WriteBack *const Wb = &s_s->writeBack;
+
+    uint32_t i = 0;
+
+    while (i < Wb->count && Wb->sector[i] < LocalSector)
+    {
+        ++ i;
+    }
+
+    return i;
+}
+
+
+static void removeDirtySectors (const uint32_t Index, const uint32_t Count)
+{
+    struct STORAGE_WriteBack *const Wb = &s_s->writeBack;
+
+    const uint32_t Left = Wb->count - Index - Count;
+
+    memmove (&Wb->sector[Index], &Wb->sector[Index + Count],
+             Left * sizeof(Wb->sector[0]));
+    memmove (Wb->data[Index], Wb->data[Index + Count], Left << 9);
+
+    Wb->count -= Count;
+    s_s->writeBackStats.dirtySectors = Wb->count;
+}
+
+
+/*
+    Writes dirty sectors in ascending order, one media request per run of
+    consecutive sectors. Sectors not written remain dirty.
+*/
+static RAWSTOR_Status_Result flushDirtySectors (const uint32_t Retries)
+{
+    struct STORAGE_WriteBack *const Wb = &s_s->writeBack;
+
+    const uint32_t SectorBegin = 
+        s_s->volume[STORAGE_Role_LinearPersistent].info.sectorBegin;
+
+    RAWSTOR_Status_Result r = RAWSTOR_Status_Result_Ok;
+    uint32_t flushed = 0;
+
+    while (flushed < Wb->count)
+    {
+        uint32_t run = 1;
+
+        while (flushed + run < Wb->count && 
+               Wb->sector[flushed + run] == Wb->sector[flushed] + run)
+        {
+            ++ run;
+        }
+
+        r = linearWrite (STORAGE_Role_LinearPersistent, Wb->data[flushed],
+                         SectorBegin + Wb->sector[flushed], run, Retries);
+
+        if (r != RAWSTOR_Status_Result_Ok)
+        {
+            ++ s_s->writeBackStats.failedFlushes;
+            break;
+        }
+
+        ++ s_s->writeBackStats.flushWrites;
+        s_s->writeBackStats.flushedSectors += run;
+
+        flushed += run;
+    }
+
+    removeDirtySectors (0, flushed);
+
+    return r;
+}
+
+
+// Dirty sectors are newer than their media contents.
+static void readDirtySectors (uint8_t *const Data, const uint32_t LocalSector,
+                              const uint32_t Count)
+{
+    const struct STORAGE_WriteBack *const Wb = &s_s->writeBack;
+
+    for (uint32_t i = dirtySectorIndex (LocalSector);
+         i < Wb->count && Wb->sector[i] < LocalSector + Count; ++i)
+    {
+        memcpy (&Data[(Wb->sector[i] - LocalSector) << 9], Wb->data[i], 512);
+    }
+}
+
+
+static RAWSTOR_Status_Result writeBack (const uint8_t *const Data,
+                                        const uint32_t LocalSector,
+                                        const uint32_t DeviceSector,
+                                        const uint32_t Count,
+                                        const uint32_t Retries)
+{
+    struct STORAGE_WriteBack *const Wb = &s_s->writeBack;
+
+    // Requests that would not fit are written through. Their sectors are
+    // no longer dirty.
+    if (Count > STORAGE_WRITE_BACK_SECTORS)
+    {
+        const uint32_t Index = dirtySectorIndex (LocalSector);
+
+        removeDirtySectors (Index, dirtySectorIndex (LocalSector + Count) -
+                                                                    Index);
+
+        return linearWrite (STORAGE_Role_LinearPersistent, Data, DeviceSector,
+                            Count, Retries);
+    }
+
+    for (uint32_t i = 0; i < Count; ++i)
+    {
+        const uint32_t Sector = LocalSector + i;
+
+        uint32_t index = dirtySectorIndex (Sector);
+
+        if (index < Wb->count && Wb->sector[index] == Sector)
+        {
+            ++ s_s->writeBackStats.absorbedWrites;
+        }
+        else
+        {
+            if (Wb->count == STORAGE_WRITE_BACK_SECTORS)
+            {
+                const RAWSTOR_Status_Result R = flushDirtySectors (Retries);
+
+                if (R != RAWSTOR_Status_Result_Ok)
+                {
+                    return R;
+                }
+
+                index = 0;
+            }
+
+            if (!Wb->count)
+            {
+                Wb->firstDirty = TICKS_Now ();
+            }
+
+            const uint32_t Right = Wb->count - index;
+
+            memmove (&Wb->sector[index + 1], &Wb->sector[index],
+                     Right * sizeof(Wb->sector[0]));
+            memmove (Wb->data[index + 1], Wb->data[index], Right << 9);
+
+            Wb->sector[index] = Sector;
+            ++ Wb->count;
+        }
+
+        memcpy (Wb->data[index], &Data[i << 9], 512);
+    }
+
+    s_s->writeBackStats.dirtySectors = Wb->count;
+
+    return RAWSTOR_Status_Result_Ok;
+}
+#endif
+
+
+static RAWSTOR_Status_Result linearRead (const enum STORAGE_Role LinearRole,
+                                         uint8_t *const Data,
+                                         const uint32_t LocalSector,
+                                         const uint32_t DeviceSector,
+                                         const uint32_t Count,
+                                         const uint32_t Retries)
+{
+    uint32_t currentRetries = Retries;
+    RAWSTOR_Status_Result r;
+    do 
+    {
+        r = drvRead (LinearRole, Data, DeviceSector, Count);
+    }
+    while (r != RAWSTOR_Status_Result_Ok && currentRetries --);
+
+#if STORAGE_WRITE_BACK_SECTORS
+    if (r == RAWSTOR_Status_Result_Ok && 
+        LinearRole == STORAGE_Role_LinearPersistent)
+    {
+        readDirtySectors (Data, LocalSector, Count);
+    }
+#else
+    (void) LocalSector;
+#endif
+
+    return r;
+}
+
+
+#if STORAGE_READ_CACHE_BLOCKS
+static struct STORAGE_ReadCacheBlock * 
+cachedBlock (const enum STORAGE_Role LinearRole, const uint32_t LocalSector)
+{
+    for (uint32_t i = 0; i < STORAGE_READ_CACHE_BLOCKS; ++i)
+    {
+        struct STORAGE_ReadCacheBlock *const B = &s_s->readCache.block[i];
+
+        if (B->sectors && B->role == LinearRole &&
+            LocalSector >= B->sectorBegin &&
+            LocalSector < B->sectorBegin + B->sectors)
+        {
+            return B;
+        }
+    }
+
+    return NULL;
+}
+
+
+static struct STORAGE_ReadCacheBlock * leastRecentlyUsedBlock (void)
+{
+    struct STORAGE_ReadCacheBlock * lru = &s_s->readCache.block[0];
+
+    for (uint32_t i = 0; i < STORAGE_READ_CACHE_BLOCKS; ++i)
+    {
+        struct STORAGE_ReadCacheBlock *const B = &s_s->readCache.block[i];
+
+        if (!B->sectors)
+        {
+            return B;
+        }
+
+        if (B->lastUse < lru->lastUse)
+        {
+            lru = B;
+        }
+    }
+
+    return lru;
+}
+
+
+/*
+    Sequential reads, those that start where the last one on the same volume
+    ended, fetch STORAGE_READ_AHEAD_SECTORS in a single request. Requests of
+    that many sectors or more are already large enough and skip the cache.
+*/
+static RAWSTOR_Status_Result cachedRead (const enum STORAGE_Role LinearRole,
+                                         const struct STORAGE_Volume *const Vol,
+                                         uint8_t *const Data,
+                                         const uint32_t LocalSector,
+                                         const uint32_t DeviceSector,
+                                         const uint32_t Count,
+                                         const uint32_t Retries)
+{
+    struct STORAGE_ReadCache *const Rc = &s_s->readCache;
+
+    const bool Sequential = (LocalSector == Rc->nextSector[LinearRole]);
+
+    Rc->nextSector[LinearRole] = LocalSector + Count;
+
+    if (Count >= STORAGE_READ_AHEAD_SECTORS)
+    {
+        s_s->readCacheStats.misses += Count;
+        return linearRead (LinearRole, Data, LocalSector, DeviceSector, Count,
+                           Retries);
+    }
+
+    const uint32_t VolumeSectors = Vol->info.sectorEnd -
+                                   Vol->info.sectorBegin + 1;
+    uint32_t done = 0;
+
+    while (done < Count)
+    {
+        const uint32_t Sector = LocalSector + done;
+        const uint32_t Left   = Count - done;
+
+        struct STORAGE_ReadCacheBlock * b = cachedBlock (LinearRole, Sector);
+
+        if (b)
+        {
+            const uint32_t Cached = b->sectorBegin + b->sectors - Sector;
+            s_s->readCacheStats.hits += (Cached < Left)? Cached : Left;
+        }
+        else
+        {
+            uint32_t fetch = (Sequential)? STORAGE_READ_AHEAD_SECTORS : Left;
+
+            if (fetch > VolumeSectors - Sector)
+            {
+                fetch = VolumeSectors - Sector;
+            }
+
+            b = leastRecentlyUsedBlock ();
+
+            const RAWSTOR_Status_Result R = 
+                linearRead (LinearRole, b->data, Sector, DeviceSector + done,
+                            fetch, Retries);
+
+            if (R != RAWSTOR_Status_Result_Ok)
+            {
+                b->sectors = 0;
+                return R;
+            }
+
+            b->role         = LinearRole;
+            b->sectorBegin  = Sector;
+            b->sectors      = fetch;
+
+            s_s->readCacheStats.misses      += (fetch < Left)? fetch : Left;
+            s_s->readCacheStats.prefetched  += (fetch > Left)? fetch - Left : 0;
+        }
+
+        b->lastUse = ++ Rc->useCount;
+
+        uint32_t sectors = b->sectorBegin + b->sectors - Sector;
+
+        if (sectors > Left)
+        {
+            sectors = Left;
+        }
+
+        memcpy (&Data[done << 9], &b->data[(Sector - b->sectorBegin) << 9],
+                sectors << 9);
+
+        done += sectors;
+    }
+
+    return RAWSTOR_Status_Result_Ok;
+}
+
+
+/*
+    Cached blocks are kept in sync with written sectors. Blocks overlapping a
+    failed write are discarded; their sectors on media are unknown.
+*/
+static void writeCachedBlocks (const enum STORAGE_Role LinearRole,
+                               const uint8_t *const Data,
+                               const uint32_t LocalSector,
+                               const uint32_t Count, const bool Written)
+{
+    for (uint32_t i = 0; i < STORAGE_READ_CACHE_BLOCKS; ++i)
+    {
+        struct STORAGE_ReadCacheBlock *const B = &s_s->readCache.block[i];
+
+        if (!B->sectors || B->role != LinearRole ||
+            LocalSector >= B->sectorBegin + B->sectors ||
+            LocalSector + Count <= B->sectorBegin)
+        {
+            continue;
+        }
+
+        if (!Written)
+        {
+            B->sectors = 0;
+            continue;
+        }
+
+        const uint32_t Begin = (LocalSector > B->sectorBegin)?
+                                    LocalSector : B->sectorBegin;
+        const uint32_t End   = (LocalSector + Count < B->sectorBegin + 
+                                                            B->sectors)?
+                                    LocalSector + Count :
+                                    B->sectorBegin + B->sectors;
+
+        memcpy (&B->data[(Begin - B->sectorBegin) << 9],
+                &Data[(Begin - LocalSector) << 9], (End - Begin) << 9);
+    }
+}
+#endif
+
+
 RAWSTOR_Status_Result STORAGE_LinearRead (const enum STORAGE_Role LinearRole,
                                           uint8_t *const Data,
                                           const uint32_t LocalSector,
@@ -410,16 +803,13 @@ RAWSTOR_Status_Result STORAGE_LinearRead (const enum STORAGE_Role LinearRole,
     const uint32_t DeviceSector = checkAccess (LinearRole, Vol,
                                                LocalSector, Count, 
                                                LANG_OUT_OF_BOUNDS_READ_ACCESS);
-
-    uint32_t currentRetries = Retries;
-    static RAWSTOR_Status_Result r;
-    do 
-    {
-        drvRead (LinearRole, Data, DeviceSector, Count);
-    }
-    while (r != RAWSTOR_Status_Result_Ok && currentRetries --);
-
-    return r;
+#if STORAGE_READ_CACHE_BLOCKS
+    return cachedRead (LinearRole, Vol, Data, LocalSector, DeviceSector, Count,
+                       Retries);
+#else
+    return linearRead (LinearRole, Data, LocalSector, DeviceSector, Count,
+                       Retries);
+#endif
 }
 
 
@@ -442,18 +832,151 @@ RAWSTOR_Status_Result STORAGE_LinearWrite (const enum STORAGE_Role LinearRole,
                                                LocalSector, Count, 
                                                LANG_OUT_OF_BOUND_WRITE_ACCESS);
 
-    uint32_t currentRetries = Retries;
-    static RAWSTOR_Status_Result r;
-    do 
+#if STORAGE_WRITE_BACK_SECTORS
+    const RAWSTOR_Status_Result R = 
+        (LinearRole == STORAGE_Role_LinearPersistent)?
+            writeBack (Data, LocalSector, DeviceSector, Count, Retries) :
+            linearWrite (LinearRole, Data, DeviceSector, Count, Retries);
+#else
+    const RAWSTOR_Status_Result R = 
+            linearWrite (LinearRole, Data, DeviceSector, Count, Retries);
+#endif
+
+#if STORAGE_READ_CACHE_BLOCKS
+    writeCachedBlocks (LinearRole, Data, LocalSector, Count,
+                       R == RAWSTOR_Status_Result_Ok);
+#endif
+
+    return R;
+}
+
+
+/*
+    Queues an asynchronous read of Req->sectorCount partition-local sectors
+    starting at Req->sectorBegin, which is converted to a device sector. The
+    done callback is called from STORAGE_Update() or STORAGE_LinearWait().
+    Data comes straight from the media: it does not go through the read cache
+    nor sees sectors waiting in the write-back buffer. Returns false when the
+    driver queue is full.
+*/
+bool STORAGE_LinearSubmitRead (const enum STORAGE_Role LinearRole,
+                               struct RAWSTOR_Request *const Req)
+{
+    BOARD_AssertParams (LinearRole <= STORAGE_Role_Linear__END && Req &&
+                        Req->op == RAWSTOR_RequestOp_Read);
+#if STORAGE_WRITE_BACK_SECTORS
+    BOARD_AssertParams (LinearRole != STORAGE_Role_LinearPersistent);
+#endif
+
+    const struct STORAGE_Volume *const Vol = &s_s->volume[LinearRole];
+
+    // Linear accesses allowed in 0xDA partitions only.
+    BOARD_AssertState  (Vol->driver &&
+                        Vol->info.partitionType == MBR_PART_TYPE_NO_FS_DATA);
+
+    const uint32_t DeviceSector = checkAccess (LinearRole, Vol,
+                                               Req->sectorBegin,
+                                               Req->sectorCount,
+                                               LANG_OUT_OF_BOUNDS_READ_ACCESS);
+    Req->sectorBegin = DeviceSector;
+
+    if (!RAWSTOR_Submit (Vol->driver, Req))
     {
-        r = drvWrite (LinearRole, Data, DeviceSector, Count);
+        return false;
+    }
+
+    s_s->rwRequests.read += Req->sectorCount;
+
+    return true;
+}
+
+
+// Returns once every asynchronous request on the volume driver completed.
+void STORAGE_LinearWait (const enum STORAGE_Role LinearRole)
+{
+    BOARD_AssertParams (LinearRole <= STORAGE_Role_Linear__END);
+    BOARD_AssertState  (s_s->volume[LinearRole].driver);
+
+    RAWSTOR_Wait (s_s->volume[LinearRole].driver);
+}
+
+
+RAWSTOR_Status_Result STORAGE_Sync (const uint32_t Retries)
+{
+    RAWSTOR_Status_Result r = RAWSTOR_Status_Result_Ok;
+
+#if STORAGE_WRITE_BACK_SECTORS
+    if (s_s->writeBack.count)
+    {
+        r = flushDirtySectors (Retries);
+    }
+#else
+    (void) Retries;
+#endif
+
+    // Complete pending writes on every linear volume driver
+    for (enum STORAGE_Role role = STORAGE_Role_Linear__BEGIN;
+         role <= STORAGE_Role_Linear__END; ++role)
+    {
+        struct RAWSTOR *const Driver = s_s->volume[role].driver;
+
+        if (!Driver)
+        {
+            continue;
+        }
+
+        const RAWSTOR_Status_Result R = 
+                    RAWSTOR_MediaIoctl (Driver, RAWSTOR_IOCTL_CMD_SYNC, NULL);
+
+        if (R != RAWSTOR_Status_Result_Ok)
+        {
+            ++ s_s->failedRequests.ioctl;
+            r = R;
+        }
     }
-    while (r != RAWSTOR_Status_Result_Ok && currentRetries --);
 
     return r;
 }
 
 
+void STORAGE_Update (void)
+{
+    if (!s_s)
+    {
+        return;
+    }
+
+    // Asynchronous requests on volume drivers, each driver polled once
+    for (uint32_t i = 0; i < STORAGE_Role__COUNT; ++i)
+    {
+        struct RAWSTOR *const Driver = s_s->volume[i].driver;
+        uint32_t j = 0;
+
+        while (j < i && s_s->volume[j].driver != Driver)
+        {
+            ++ j;
+        }
+
+        if (Driver && j == i)
+        {
+            RAWSTOR_Poll (Driver);
+        }
+    }
+
+#if STORAGE_WRITE_BACK_SECTORS
+    if (s_s->writeBack.count &&
+        TICKS_Now() - s_s->writeBack.firstDirty >= STORAGE_WRITE_BACK_TIMEOUT)
+    {
+        if (flushDirtySectors (1) != RAWSTOR_Status_Result_Ok)
+        {
+            // Try again after another timeout
+            s_s->writeBack.firstDirty = TICKS_Now ();
+        }
+    }
+#endif
+}
+
+
 #ifdef LIB_EMBEDULAR_HAS_FILESYSTEM
 RAWSTOR_Status_Disk STORAGE_MAI_InitVolume (const enum STORAGE_Role Role)
 {
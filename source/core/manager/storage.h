@@ -31,6 +31,25 @@
 #endif
 
 
+// Linear volume read cache blocks, replaced in least recently used order.
+// Zero disables the read cache.
+#define STORAGE_READ_CACHE_BLOCKS   LIB_EMBEDULAR_CONFIG_STORAGE_READ_CACHE_BLOCKS
+
+// Sectors per read cache block. Sequential reads fetch a whole block ahead.
+#define STORAGE_READ_AHEAD_SECTORS  LIB_EMBEDULAR_CONFIG_STORAGE_READ_AHEAD_SECTORS
+
+#if STORAGE_READ_CACHE_BLOCKS && !STORAGE_READ_AHEAD_SECTORS
+    #error [STORAGE] Read cache blocks require read-ahead sectors
+#endif
+
+// Persistent linear volume sectors kept in RAM until flushed. Zero writes
+// through.
+#define STORAGE_WRITE_BACK_SECTORS  LIB_EMBEDULAR_CONFIG_STORAGE_WRITE_BACK_SECTORS
+
+// Milliseconds a dirty sector may wait before STORAGE_Update() flushes it.
+#define STORAGE_WRITE_BACK_TIMEOUT  LIB_EMBEDULAR_CONFIG_STORAGE_WRITE_BACK_TIMEOUT
+
+
 enum STORAGE_Role
 {
     STORAGE_Role_LinearCache,
@@ -81,6 +100,65 @@ struct STORAGE_FailedRequests
 };
 
 
+struct STORAGE_ReadCacheStats
+{
+    // Sectors served from cached blocks
+    uint32_t    hits;
+    // Sectors requested but not cached
+    uint32_t    misses;
+    // Sectors read ahead of the request that missed
+    uint32_t    prefetched;
+};
+
+
+#if STORAGE_READ_CACHE_BLOCKS
+struct STORAGE_ReadCacheBlock
+{
+    enum STORAGE_Role   role;
+    // Partition-local sectors. An empty block has no sectors.
+    uint32_t            sectorBegin;
+    uint32_t            sectors;
+    uint32_t            lastUse;
+    uint8_t             data[STORAGE_READ_AHEAD_SECTORS * 512];
+};
+
+
+struct STORAGE_ReadCache
+{
+    struct STORAGE_ReadCacheBlock   block[STORAGE_READ_CACHE_BLOCKS];
+    uint32_t                        useCount;
+    // Sector that would continue the last read on each linear volume
+    uint32_t                        nextSector[STORAGE_Role_Linear__END + 1];
+};
+#endif
+
+
+struct STORAGE_WriteBackStats
+{
+    // Sectors written but not yet on media
+    uint32_t    dirtySectors;
+    // Sector writes that replaced an already dirty sector
+    uint32_t    absorbedWrites;
+    uint32_t    flushedSectors;
+    // Multi-sector media writes issued by flushes
+    uint32_t    flushWrites;
+    uint32_t    failedFlushes;
+};
+
+
+#if STORAGE_WRITE_BACK_SECTORS
+struct STORAGE_WriteBack
+{
+    // Dirty partition-local sectors in ascending order, so consecutive
+    // sectors also have consecutive data.
+    uint32_t                        count;
+    uint32_t                        sector[STORAGE_WRITE_BACK_SECTORS];
+    uint8_t                         data[STORAGE_WRITE_BACK_SECTORS][512];
+    TIMER_Ticks                     firstDirty;
+};
+#endif
+
+
 struct STORAGE
 {
     struct STORAGE_Volume               volume[STORAGE_Role__COUNT];
@@ -88,6 +166,14 @@ struct STORAGE
     struct STORAGE_RWSectorRequests     rwRequests;
     struct STORAGE_FailedRequests       failedRequests;
     uint32_t                            cachedElementsCount;
+    struct STORAGE_ReadCacheStats       readCacheStats;
+#if STORAGE_READ_CACHE_BLOCKS
+    struct STORAGE_ReadCache            readCache;
+#endif
+    struct STORAGE_WriteBackStats       writeBackStats;
+#if STORAGE_WRITE_BACK_SECTORS
+    struct STORAGE_WriteBack            writeBack;
+#endif
 #ifdef LIB_EMBEDULAR_HAS_FILESYSTEM
     FATFS                               fatFs[STORAGE_Role_FatFs__END - 
                                                 STORAGE_Role_FatFs__BEGIN + 1];
@@ -105,6 +191,13 @@ bool        STORAGE_ValidVolume         (const enum STORAGE_Role Role);
 struct STORAGE_VolumeInfo
             STORAGE_VolumeInfo          (const enum STORAGE_Role Role);
 uint32_t    STORAGE_CachedElementsCount (void);
+struct STORAGE_ReadCacheStats
+            STORAGE_ReadCacheStats      (void);
+struct STORAGE_WriteBackStats
+            STORAGE_WriteBackStats      (void);
+RAWSTOR_Status_Result
+            STORAGE_Sync                (const uint32_t Retries);
+void        STORAGE_Update              (void);
 RAWSTOR_Status_Result
             STORAGE_LinearRead          (const enum STORAGE_Role LinearRole,
                                          uint8_t *const Data,
@@ -117,3 +210,6 @@ RAWSTOR_Status_Result
                                          const uint32_t LocalSector,
                                          const uint32_t Count,
                                          const uint32_t Retries);
+bool        STORAGE_LinearSubmitRead    (const enum STORAGE_Role LinearRole,
+                                         struct RAWSTOR_Request *const Req);
+void        STORAGE_LinearWait          (const enum STORAGE_Role LinearRole);
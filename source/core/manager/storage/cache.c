@@ -24,7 +24,9 @@
 */
 
 #include "embedul.ar/source/core/manager/storage/cache.h"
+#include "embedul.ar/source/core/manager/storage/cache_layout.h"
 #include "embedul.ar/source/core/device/board.h"
+#include "embedul.ar/source/core/misc/crc32c.h"
 #include <stdio.h>
 
 #ifdef LIB_EMBEDULAR_HAS_FILESYSTEM
@@ -32,36 +34,27 @@
 #endif
 
 
-#define CACHE_SIGNATURE                 "EMBEDUL.AR CACHE"
-#define CACHE_FWK_ELEMENTS              8
-// CRC-32C (Castagnoli) polynomial, in reversed bit order.
-#define CACHE_CRC32_POLY                0x82f63b78
-
-
 // STORAGE private API
 void STORAGE___setCachedElementsCount (const uint32_t Count);
 
 
-static uint32_t crc32c (uint32_t crc, const uint8_t *buf, size_t len)
-{
-    crc = ~crc;
+// Cached elements index, built while checking the cache. Lookups through the
+// index require no storage access.
+static struct STORAGE_CACHE_IndexEntry s_index[STORAGE_CACHE_INDEX_ELEMENTS];
 
-    while (len --)
-    {
-        crc ^= *buf++;
 
-        crc = (crc >> 1) ^ (CACHE_CRC32_POLY & (0 - (crc & 1)));
-        crc = (crc >> 1) ^ (CACHE_CRC32_POLY & (0 - (crc & 1)));
-        crc = (crc >> 1) ^ (CACHE_CRC32_POLY & (0 - (crc & 1)));
-        crc = (crc >> 1) ^ (CACHE_CRC32_POLY & (0 - (crc & 1)));
-        crc = (crc >> 1) ^ (CACHE_CRC32_POLY & (0 - (crc & 1)));
-        crc = (crc >> 1) ^ (CACHE_CRC32_POLY & (0 - (crc & 1)));
-        crc = (crc >> 1) ^ (CACHE_CRC32_POLY & (0 - (crc & 1)));
-        crc = (crc >> 1) ^ (CACHE_CRC32_POLY & (0 - (crc & 1)));
-    }
+// Background verification of indexed elements whose data check was deferred.
+struct CACHE_Verify
+{
+    bool                                active;
+    uint32_t                            element;
+    uint32_t                            sectorCurrent;
+    uint32_t                            crc32;
+    struct STORAGE_CACHE_VerifyProgress progress;
+};
 
-    return ~crc;
-}
+
+static struct CACHE_Verify s_verify;
 
 
 static uint32_t getElementInfoSector (const uint32_t Element)
@@ -127,7 +120,7 @@ static bool checkSectorCrc32 (uint8_t sectorData[static 512])
     // Original CRC32 of the whole data was computed with 0 in the CRC32 field.
     *((uint32_t *)&sectorData[512-4]) = 0;
 
-    const uint32_t ComputedCrc32 = crc32c (0, sectorData, 512);
+    const uint32_t ComputedCrc32 = CRC32C_Update (0, sectorData, 512);
 
     *((uint32_t *)&sectorData[512-4]) = StoredCrc32;
 
@@ -135,10 +128,46 @@ static bool checkSectorCrc32 (uint8_t sectorData[static 512])
 }
 
 
+static void indexElement (const struct STORAGE_CACHE_State *const Cs,
+                          const uint32_t Crc32,
+                          const uint32_t PathHash,
+                          const enum STORAGE_CACHE_ElementStatus Status)
+{
+    if (Cs->element >= STORAGE_CACHE_INDEX_ELEMENTS)
+    {
+        return;
+    }
+
+    struct STORAGE_CACHE_IndexEntry *const E = &s_index[Cs->element];
+
+    E->octets       = Cs->octets;
+    E->sectorBegin  = Cs->sectorBegin;
+    E->sectorEnd    = Cs->sectorEnd;
+    E->crc32        = Crc32;
+    E->pathHash     = PathHash;
+    E->fileDate     = Cs->storedFileDate;
+    E->fileTime     = Cs->storedFileTime;
+    E->encoding     = Cs->encoding;
+    E->status       = Status;
+}
+
+
+static void unindexElement (const struct STORAGE_CACHE_State *const Cs)
+{
+    if (Cs->element < STORAGE_CACHE_INDEX_ELEMENTS)
+    {
+        s_index[Cs->element].status = STORAGE_CACHE_ElementStatus_Unavailable;
+    }
+}
+
+
 static void start (struct STORAGE_CACHE_State *const Cs)
 {
     STORAGE___setCachedElementsCount (0);
 
+    memset (s_index, 0, sizeof(s_index));
+    memset (&s_verify, 0, sizeof(s_verify));
+
 #ifdef LIB_EMBEDULAR_HAS_FILESYSTEM
     if (STORAGE_ValidVolume (STORAGE_Role_FatFsDrive0))
     {
@@ -195,16 +224,34 @@ static void readSector0 (struct STORAGE_CACHE_State *const Cs)
     check (Cs, STORAGE_CACHE_CheckFlags_AppVersion,
                 !strncmp((char *)&sectorData[144], CC_VcsAppVersionStr, 64));
 
+    // Manifest size; element data begins right after the manifest.
+    check (Cs, STORAGE_CACHE_CheckFlags_Manifest,
+                *((uint32_t *)&sectorData[208]) == CACHE_MANIFEST_SECTORS);
+
     // Sector 0 data can be trusted
     if (!(Cs->checksFailed & STORAGE_CACHE_CheckFlags_Checksum))
     {
         // Retrieve element count
         Cs->elementCount = *((uint32_t *)&sectorData[512-8]);
 
+        // Cached elements might overlap the manifest sectors; rewrite them all
+        // from filesystem slots. Otherwise they are still readable as is.
+        if (Cs->hasSlots && 
+            (Cs->checksFailed & STORAGE_CACHE_CheckFlags_Manifest))
+        {
+            Cs->elementCount = 0;
+        }
+
         // Report available element count to storage.
         STORAGE___setCachedElementsCount (Cs->elementCount);
     }
 
+    Cs->manifestValid = STORAGE_CACHE_INCREMENTAL && CACHE_MANIFEST_SECTORS &&
+                        !(Cs->checksFailed & 
+                            (STORAGE_CACHE_CheckFlags_Checksum |
+                             STORAGE_CACHE_CheckFlags_Signature |
+                             STORAGE_CACHE_CheckFlags_Manifest));
+
     // No filesystem slots nor cached elements, nothing to iterate
     if (!Cs->hasSlots && !Cs->elementCount)
     {
@@ -238,7 +285,9 @@ static void beginIteration (struct STORAGE_CACHE_State *const Cs)
     }
 #endif
 
-    nextTask (Cs, STORAGE_CACHE_Stage_CheckElementInfo);
+    nextTask (Cs, (Cs->manifestValid)?
+                        STORAGE_CACHE_Stage_CheckManifestEntry :
+                        STORAGE_CACHE_Stage_CheckElementInfo);
 }
 
 
@@ -343,9 +392,16 @@ static void readSlot (struct STORAGE_CACHE_State *const Cs)
     // Actual slot is already in the cache?
     // T: Check if the cached element is exactly the same file
     // F: Write filesystem slot to cached element
-    nextTask (Cs, (Cs->element < Cs->elementCount)?
-                        STORAGE_CACHE_Stage_CheckElementInfo :
-                        STORAGE_CACHE_Stage_SlotToElementInfo);
+    if (Cs->element < Cs->elementCount)
+    {
+        nextTask (Cs, (Cs->manifestValid)?
+                            STORAGE_CACHE_Stage_CheckManifestEntry :
+                            STORAGE_CACHE_Stage_CheckElementInfo);
+    }
+    else
+    {
+        nextTask (Cs, STORAGE_CACHE_Stage_SlotToElementInfo);
+    }
 }
 #endif // #ifdef LIB_EMBEDULAR_HAS_FILESYSTEM
 
@@ -372,15 +428,55 @@ writeElementInfoSector (const uint32_t Element,
 }
 
 
+/*
+    Element data is about to be moved. Manifest entries of any element, even
+    unchanged ones, can't be trusted until the manifest is written again.
+*/
+static bool invalidateManifest (struct STORAGE_CACHE_State *const Cs)
+{
+    uint8_t sectorData[512];
+
+    memset (sectorData, 0, sizeof(sectorData));
+
+    for (uint32_t sector = 1; sector <= CACHE_MANIFEST_SECTORS; ++sector)
+    {
+        const RAWSTOR_Status_Result Rsr =
+                STORAGE_LinearWrite (STORAGE_Role_LinearCache, sectorData,
+                                     sector, 1, Cs->rwRetries);
+
+        check (Cs, STORAGE_CACHE_CheckFlags_Write,
+                                    (Rsr == RAWSTOR_Status_Result_Ok));
+
+        if (Rsr != RAWSTOR_Status_Result_Ok)
+        {
+            return false;
+        }
+    }
+
+    Cs->manifestInvalidated = true;
+    Cs->writeManifest       = true;
+    Cs->writeSector0        = true;
+
+    return true;
+}
+
+
 static void slotToElementInfo (struct STORAGE_CACHE_State *const Cs)
 {
     clearChecks (Cs);
 
-    uint8_t sectorData[512];
+    if (!Cs->manifestInvalidated && !invalidateManifest (Cs))
+    {
+        nextTask (Cs, STORAGE_CACHE_Stage_EndIteration);
+        return;
+    }
 
+    uint8_t sectorData[512];
 
     memset (sectorData, 0, sizeof(sectorData));
 
+    Cs->storedFileDate  = Cs->fno.fdate;
+    Cs->storedFileTime  = Cs->fno.ftime;
     Cs->octets          = Cs->fno.fsize;
     // Element data is stored after the last one
     Cs->sectorBegin     = Cs->sectorEnd + 1;
@@ -389,6 +485,13 @@ static void slotToElementInfo (struct STORAGE_CACHE_State *const Cs)
                                 (Cs->octets >> 9);
     Cs->sectorCurrent   = Cs->sectorBegin;
     Cs->checkCrc32      = 0;
+    Cs->fileOctetsRead  = 0;
+    Cs->encodedOctets   = 0;
+    Cs->encodedFill     = 0;
+    // Single sector elements are not worth compressing.
+    Cs->encoding        = (STORAGE_CACHE_COMPRESSION && Cs->octets > 512)?
+                                            STORAGE_CACHE_Encoding_Rle :
+                                            STORAGE_CACHE_Encoding_Raw;
 
     *((uint32_t *)&sectorData[0])   = Cs->fno.fdate;
     *((uint32_t *)&sectorData[4])   = Cs->fno.ftime;
@@ -432,14 +535,31 @@ static void slotToElementInfo (struct STORAGE_CACHE_State *const Cs)
 
 
 #ifdef LIB_EMBEDULAR_HAS_FILESYSTEM
-static void slotToElementData (struct STORAGE_CACHE_State *const Cs)
+static bool writeSlotSector (struct STORAGE_CACHE_State *const Cs,
+                             const uint8_t *const SectorData)
 {
-    // Clear checks on first iteration only
-    if (!Cs->sectorCurrent)
+    const RAWSTOR_Status_Result Rsr = 
+            STORAGE_LinearWrite (STORAGE_Role_LinearCache, SectorData, 
+                                 Cs->sectorCurrent, 1, Cs->rwRetries);
+
+    check (Cs, STORAGE_CACHE_CheckFlags_Write,
+                                (Rsr == RAWSTOR_Status_Result_Ok));
+
+    if (Rsr != RAWSTOR_Status_Result_Ok)
     {
-        clearChecks (Cs);
+        return false;
     }
 
+    Cs->checkCrc32 = CRC32C_Update (Cs->checkCrc32, SectorData, 512);
+
+    ++ Cs->sectorCurrent;
+
+    return true;
+}
+
+
+static bool slotToRawData (struct STORAGE_CACHE_State *const Cs)
+{
     uint8_t sectorData[512];
 
     while (Cs->sectorCurrent <= Cs->sectorEnd)
@@ -452,9 +572,7 @@ static void slotToElementData (struct STORAGE_CACHE_State *const Cs)
 
         if (R != FR_OK)
         {
-            f_close (&Cs->file);
-            nextTask (Cs, STORAGE_CACHE_Stage_EndIteration);
-            return;
+            return false;
         }
 
         if (br < 512)
@@ -463,23 +581,95 @@ static void slotToElementData (struct STORAGE_CACHE_State *const Cs)
             memset (&sectorData[br], 0, 512 - br);
         }
 
-        const RAWSTOR_Status_Result Rsr = 
-                STORAGE_LinearWrite (STORAGE_Role_LinearCache, sectorData, 
-                                     Cs->sectorCurrent, 1, Cs->rwRetries);
+        if (!writeSlotSector (Cs, sectorData))
+        {
+            return false;
+        }
 
-        check (Cs, STORAGE_CACHE_CheckFlags_Write,
-                                (Rsr == RAWSTOR_Status_Result_Ok));
+        Cs->progressCurrent += Cs->progressDelta;
 
-        if (Rsr != RAWSTOR_Status_Result_Ok)
+        if (Cs->breakFunc && Cs->breakFunc(Cs->breakFuncParam))
         {
-            f_close (&Cs->file);
-            nextTask (Cs, STORAGE_CACHE_Stage_EndIteration);
-            return;
+            break;
+        }
+    }
+
+    return true;
+}
+
+
+static bool slotToRleData (struct STORAGE_CACHE_State *const Cs)
+{
+    uint8_t fileData[512];
+
+    // Compression must save at least one of the sectors the element would
+    // take uncompressed. sectorEnd is still the uncompressed one.
+    const uint32_t MaxEncodedOctets = (Cs->sectorEnd - Cs->sectorBegin) << 9;
+
+    while (Cs->fileOctetsRead < Cs->octets)
+    {
+        UINT br;
+
+        FRESULT R = f_read (&Cs->file, fileData, 512, &br);
+
+        check (Cs, STORAGE_CACHE_CheckFlags_Filesystem, (R == FR_OK && br));
+
+        if (R != FR_OK || !br)
+        {
+            return false;
         }
 
-        Cs->checkCrc32 = crc32c (Cs->checkCrc32, sectorData, 512);
+        Cs->fileOctetsRead += br;
 
-        ++ Cs->sectorCurrent;
+        const uint32_t Encoded = RLE_Encode (fileData, br,
+                                             &Cs->encoded[Cs->encodedFill]);
+        Cs->encodedFill     += Encoded;
+        Cs->encodedOctets   += Encoded;
+
+        if (Cs->encodedOctets > MaxEncodedOctets)
+        {
+            // Not worth it, restart element data uncompressed.
+            R = f_lseek (&Cs->file, 0);
+
+            check (Cs, STORAGE_CACHE_CheckFlags_Filesystem, (R == FR_OK));
+
+            if (R != FR_OK)
+            {
+                return false;
+            }
+
+            Cs->encoding        = STORAGE_CACHE_Encoding_Raw;
+            Cs->encodedOctets   = 0;
+            Cs->encodedFill     = 0;
+            Cs->sectorCurrent   = Cs->sectorBegin;
+            Cs->checkCrc32      = 0;
+            Cs->progressCurrent = 0;
+            return true;
+        }
+
+        while (Cs->encodedFill >= 512)
+        {
+            if (!writeSlotSector (Cs, Cs->encoded))
+            {
+                return false;
+            }
+
+            Cs->encodedFill -= 512;
+            memmove (Cs->encoded, &Cs->encoded[512], Cs->encodedFill);
+        }
+
+        // Last sector padded with zeros
+        if (Cs->fileOctetsRead == Cs->octets && Cs->encodedFill)
+        {
+            memset (&Cs->encoded[Cs->encodedFill], 0, 512 - Cs->encodedFill);
+
+            if (!writeSlotSector (Cs, Cs->encoded))
+            {
+                return false;
+            }
+
+            Cs->encodedFill = 0;
+        }
 
         Cs->progressCurrent += Cs->progressDelta;
 
@@ -489,13 +679,45 @@ static void slotToElementData (struct STORAGE_CACHE_State *const Cs)
         }
     }
 
+    return true;
+}
+
+
+static void slotToElementData (struct STORAGE_CACHE_State *const Cs)
+{
+    // Clear checks on first iteration only
+    if (!Cs->sectorCurrent)
+    {
+        clearChecks (Cs);
+    }
+
+    const bool Ok = (Cs->encoding == STORAGE_CACHE_Encoding_Rle)?
+                                slotToRleData (Cs) : slotToRawData (Cs);
+    if (!Ok)
+    {
+        f_close (&Cs->file);
+        nextTask (Cs, STORAGE_CACHE_Stage_EndIteration);
+        return;
+    }
+
+    const bool Finished = (Cs->encoding == STORAGE_CACHE_Encoding_Rle)?
+                                (Cs->fileOctetsRead == Cs->octets) :
+                                (Cs->sectorCurrent > Cs->sectorEnd);
+
     // Finished processing current element data
-    if (Cs->sectorCurrent > Cs->sectorEnd)
+    if (Finished)
     {
         f_close (&Cs->file);
 
+        if (Cs->encoding == STORAGE_CACHE_Encoding_Rle)
+        {
+            // Actual, compressed, data end
+            Cs->sectorEnd = Cs->sectorCurrent - 1;
+        }
+
         Cs->progressCurrent = Cs->progressMax << 24;
 
+        uint8_t sectorData[512];
         RAWSTOR_Status_Result rsr;
 
         // Read ElementInfo without CRCs
@@ -510,9 +732,14 @@ static void slotToElementData (struct STORAGE_CACHE_State *const Cs)
             return;
         }
 
-        // Update data and sector CRC32
+        // Update data encoding, data and sector CRC32
+        *((uint32_t *)&sectorData[16])      = Cs->sectorEnd;
         *((uint32_t *)&sectorData[20])      = Cs->checkCrc32;
-        *((uint32_t *)&sectorData[512-4])   = crc32c (0, sectorData, 512);
+        *((uint32_t *)&sectorData[88])      = Cs->encoding;
+        *((uint32_t *)&sectorData[92])      = Cs->encodedOctets;
+        *((uint32_t *)&sectorData[512-4])   = 0;
+        *((uint32_t *)&sectorData[512-4])   =
+                                        CRC32C_Update (0, sectorData, 512);
 
         // Update ElementInfo with valid CRCs
         rsr = writeElementInfoSector(Cs->element, sectorData, Cs->rwRetries);
@@ -526,6 +753,10 @@ static void slotToElementData (struct STORAGE_CACHE_State *const Cs)
             return;
         }
 
+        // Data just written from the slot file, its checksum is known good.
+        indexElement (Cs, Cs->checkCrc32, STORAGE_CACHE_PathHash(Cs->filepath),
+                      STORAGE_CACHE_ElementStatus_Verified);
+
         // Next slot
         nextTask (Cs, STORAGE_CACHE_Stage_NextIteration);
     }
@@ -538,6 +769,106 @@ static void slotToElementData (struct STORAGE_CACHE_State *const Cs)
 #endif // #ifdef LIB_EMBEDULAR_HAS_FILESYSTEM
 
 
+/*
+    Manifest entry of the current element or NULL. Entries are read one
+    manifest sector at a time.
+*/
+static const uint8_t * manifestEntry (struct STORAGE_CACHE_State *const Cs)
+{
+    if (Cs->element >= STORAGE_CACHE_INDEX_ELEMENTS ||
+        Cs->element >= Cs->elementCount)
+    {
+        return NULL;
+    }
+
+    const uint32_t Sector = 1 + Cs->element / CACHE_MANIFEST_ENTRIES;
+
+    if (Cs->manifestSector != Sector)
+    {
+        const RAWSTOR_Status_Result Rsr = 
+                STORAGE_LinearRead (STORAGE_Role_LinearCache, Cs->manifest,
+                                    Sector, 1, Cs->rwRetries);
+
+        // A failed manifest sector only affects its own entries
+        if (Rsr != RAWSTOR_Status_Result_Ok || !checkSectorCrc32(Cs->manifest))
+        {
+            Cs->manifestSector = 0;
+            return NULL;
+        }
+
+        Cs->manifestSector = Sector;
+    }
+
+    const uint8_t *const Entry = &Cs->manifest[
+            (Cs->element % CACHE_MANIFEST_ENTRIES) * CACHE_MANIFEST_ENTRY_OCTETS];
+
+    return (*((uint16_t *)&Entry[30]) & CACHE_MANIFEST_ENTRY_USED)?
+                                                                Entry : NULL;
+}
+
+
+static void checkManifestEntry (struct STORAGE_CACHE_State *const Cs)
+{
+    clearChecks (Cs);
+
+    const uint8_t *const Entry = manifestEntry (Cs);
+
+    bool unchanged = (Entry)? true : false;
+
+#ifdef LIB_EMBEDULAR_HAS_FILESYSTEM
+    if (unchanged && Cs->hasSlots)
+    {
+        // Same source file and not overwritten by a previously updated element
+        unchanged = Cs->fno.fdate == *((uint32_t *)&Entry[0]) &&
+                    Cs->fno.ftime == *((uint32_t *)&Entry[4]) &&
+                    Cs->fno.fsize == *((uint32_t *)&Entry[8]) &&
+                    Cs->fno.fattrib & AM_ARC &&
+                    *((uint32_t *)&Entry[12]) > Cs->sectorEnd &&
+                    *((uint32_t *)&Entry[24]) ==
+                                        STORAGE_CACHE_PathHash(Cs->filepath);
+    }
+#endif
+
+    check (Cs, STORAGE_CACHE_CheckFlags_Manifest, unchanged);
+
+    if (!unchanged)
+    {
+    #ifdef LIB_EMBEDULAR_HAS_FILESYSTEM
+        // Write a manifest entry once the element gets checked
+        if (Cs->hasSlots && Cs->element < STORAGE_CACHE_INDEX_ELEMENTS)
+        {
+            Cs->writeManifest = true;
+        }
+    #endif
+        nextTask (Cs, STORAGE_CACHE_Stage_CheckElementInfo);
+        return;
+    }
+
+    Cs->storedFileDate  = *((uint32_t *)&Entry[0]);
+    Cs->storedFileTime  = *((uint32_t *)&Entry[4]);
+    Cs->octets          = *((uint32_t *)&Entry[8]);
+    Cs->sectorBegin     = *((uint32_t *)&Entry[12]);
+    Cs->sectorEnd       = *((uint32_t *)&Entry[16]);
+    Cs->sectorCurrent   = Cs->sectorBegin;
+    Cs->storedCrc32     = *((uint32_t *)&Entry[20]);
+    Cs->checkCrc32      = 0;
+    Cs->encoding        = *((uint16_t *)&Entry[28]);
+    Cs->encodedOctets   = 0;
+
+    if (!Cs->hasSlots)
+    {
+        // Element info sector not read, filepath unknown.
+        Cs->filepath[0] = '\0';
+    }
+
+    // Element data not checked; the manifest already vouches for it
+    indexElement (Cs, Cs->storedCrc32, *((uint32_t *)&Entry[24]),
+                  STORAGE_CACHE_ElementStatus_Trusted);
+
+    nextTask (Cs, STORAGE_CACHE_Stage_NextIteration);
+}
+
+
 static void checkElementInfo (struct STORAGE_CACHE_State *const Cs)
 {
     clearChecks (Cs);
@@ -585,6 +916,8 @@ static void checkElementInfo (struct STORAGE_CACHE_State *const Cs)
     Cs->sectorCurrent   = Cs->sectorBegin;
     Cs->storedCrc32     = *((uint32_t *)&sectorData[20]);
     Cs->checkCrc32      = 0;
+    Cs->encoding        = *((uint32_t *)&sectorData[88]);
+    Cs->encodedOctets   = *((uint32_t *)&sectorData[92]);
 
     initProgressCounter (Cs);
 
@@ -594,11 +927,13 @@ static void checkElementInfo (struct STORAGE_CACHE_State *const Cs)
         const char *const StoredFilepath
                             = (const char *)&sectorData[24];
 
+        // Element data must not overlap a previously updated element.
         const bool FileMetricsMatch =
                             Cs->fno.fdate == Cs->storedFileDate &&
                             Cs->fno.ftime == Cs->storedFileTime &&
                             Cs->fno.fsize == Cs->octets &&
                             Cs->fno.fattrib & AM_ARC &&
+                            Cs->sectorBegin > LastSectorEnd &&
                             !strncmp(Cs->filepath, StoredFilepath,
                                                 sizeof(Cs->filepath));
 
@@ -621,7 +956,21 @@ static void checkElementInfo (struct STORAGE_CACHE_State *const Cs)
     }
 #endif // LIB_EMBEDULAR_HAS_FILESYSTEM
 
-    nextTask (Cs, (Cs->skipElementDataCheck)?
+    if (!Cs->hasSlots)
+    {
+        // Filepath as stored; otherwise it matches the slot filepath.
+        memcpy (Cs->filepath, &sectorData[24], sizeof(Cs->filepath));
+        Cs->filepath[sizeof(Cs->filepath) - 1] = '\0';
+    }
+
+    indexElement (Cs, Cs->storedCrc32, STORAGE_CACHE_PathHash(Cs->filepath),
+                  STORAGE_CACHE_ElementStatus_Indexed);
+
+    // Data of indexed elements can be verified after boot
+    const bool DeferDataCheck = Cs->deferElementDataCheck &&
+                                Cs->element < STORAGE_CACHE_INDEX_ELEMENTS;
+
+    nextTask (Cs, (Cs->skipElementDataCheck || DeferDataCheck)?
                         STORAGE_CACHE_Stage_NextIteration :
                         STORAGE_CACHE_Stage_CheckElementData);
 }
@@ -646,12 +995,13 @@ static void checkElementData (struct STORAGE_CACHE_State *const Cs)
 
         if (r != RAWSTOR_Status_Result_Ok)
         {
+            unindexElement (Cs);
             check (Cs, STORAGE_CACHE_CheckFlags_Read, false);
             nextTask (Cs, STORAGE_CACHE_Stage_EndIteration);
             return;
         }
 
-        Cs->checkCrc32 = crc32c (Cs->checkCrc32, sectorData, 512);
+        Cs->checkCrc32 = CRC32C_Update (Cs->checkCrc32, sectorData, 512);
 
         ++ Cs->sectorCurrent;
 
@@ -677,10 +1027,14 @@ static void checkElementData (struct STORAGE_CACHE_State *const Cs)
 
         if (Cs->checksFailed & STORAGE_CACHE_CheckFlags_Checksum)
         {
+            unindexElement (Cs);
             nextTask (Cs, STORAGE_CACHE_Stage_EndIteration);
             return;
         }
 
+        indexElement (Cs, Cs->storedCrc32, STORAGE_CACHE_PathHash(Cs->filepath),
+                      STORAGE_CACHE_ElementStatus_Verified);
+
         nextTask (Cs, STORAGE_CACHE_Stage_NextIteration);
     }
     else 
@@ -697,7 +1051,7 @@ static void nextIteration (struct STORAGE_CACHE_State *const Cs)
 
     ++ Cs->element;
 
-    if (Cs->hasSlots || Cs->element + 1 < Cs->elementCount)
+    if (Cs->hasSlots || Cs->element < Cs->elementCount)
     {
         // Process next filesystem slot or element info
         nextTask (Cs, STORAGE_CACHE_Stage_BeginIteration);
@@ -714,7 +1068,10 @@ static void endIteration (struct STORAGE_CACHE_State *const Cs)
     // endIteration will carry on the checks performed in the last task.
 
 #ifdef LIB_EMBEDULAR_HAS_FILESYSTEM
-    const enum STORAGE_CACHE_Stage NextStage = (Cs->writeSector0)?
+    const enum STORAGE_CACHE_Stage NextStage = 
+                                    (Cs->writeManifest)?
+                                        STORAGE_CACHE_Stage_WriteManifest :
+                                    (Cs->writeSector0)?
                                         STORAGE_CACHE_Stage_WriteSector0 :
                                         STORAGE_CACHE_Stage_Done;
 #else 
@@ -726,6 +1083,80 @@ static void endIteration (struct STORAGE_CACHE_State *const Cs)
 
 
 #ifdef LIB_EMBEDULAR_HAS_FILESYSTEM
+/*
+    Writes a manifest sector with the entries of its elements below Elements.
+    Only elements with verified data, or trusted on a previous manifest, get
+    an entry; the rest are checked again on the next boot.
+*/
+static RAWSTOR_Status_Result writeManifestSector (const uint32_t Sector,
+                                                  const uint32_t Elements,
+                                                  const uint32_t Retries)
+{
+    uint8_t sectorData[512];
+
+    memset (sectorData, 0x00, sizeof(sectorData));
+
+    for (uint32_t i = 0; i < CACHE_MANIFEST_ENTRIES; ++i)
+    {
+        const uint32_t Element = Sector * CACHE_MANIFEST_ENTRIES + i;
+
+        if (Element >= Elements || Element >= STORAGE_CACHE_INDEX_ELEMENTS)
+        {
+            break;
+        }
+
+        const struct STORAGE_CACHE_IndexEntry *const E = &s_index[Element];
+
+        if (E->status != STORAGE_CACHE_ElementStatus_Verified &&
+            E->status != STORAGE_CACHE_ElementStatus_Trusted)
+        {
+            continue;
+        }
+
+        uint8_t *const Entry = &sectorData[i * CACHE_MANIFEST_ENTRY_OCTETS];
+
+        *((uint32_t *)&Entry[0])    = E->fileDate;
+        *((uint32_t *)&Entry[4])    = E->fileTime;
+        *((uint32_t *)&Entry[8])    = E->octets;
+        *((uint32_t *)&Entry[12])   = E->sectorBegin;
+        *((uint32_t *)&Entry[16])   = E->sectorEnd;
+        *((uint32_t *)&Entry[20])   = E->crc32;
+        *((uint32_t *)&Entry[24])   = E->pathHash;
+        *((uint16_t *)&Entry[28])   = E->encoding;
+        *((uint16_t *)&Entry[30])   = CACHE_MANIFEST_ENTRY_USED;
+    }
+
+    *((uint32_t *)&sectorData[512-4]) = CRC32C_Update (0, sectorData, 512);
+
+    return STORAGE_LinearWrite (STORAGE_Role_LinearCache, sectorData,
+                                1 + Sector, 1, Retries);
+}
+
+
+static void writeManifest (struct STORAGE_CACHE_State *const Cs)
+{
+    clearChecks (Cs);
+
+    for (uint32_t sector = 0; sector < CACHE_MANIFEST_SECTORS; ++sector)
+    {
+        // Cs->element is the resulting element count
+        const RAWSTOR_Status_Result Rsr =
+                writeManifestSector (sector, Cs->element, Cs->rwRetries);
+
+        check (Cs, STORAGE_CACHE_CheckFlags_Write,
+                                    (Rsr == RAWSTOR_Status_Result_Ok));
+
+        if (Rsr != RAWSTOR_Status_Result_Ok)
+        {
+            break;
+        }
+    }
+
+    nextTask (Cs, (Cs->writeSector0)? STORAGE_CACHE_Stage_WriteSector0 :
+                                      STORAGE_CACHE_Stage_Done);
+}
+
+
 static void writeSector0 (struct STORAGE_CACHE_State *const Cs)
 {
     clearChecks (Cs);
@@ -739,8 +1170,9 @@ static void writeSector0 (struct STORAGE_CACHE_State *const Cs)
     strncpy ((char *)&sectorData[80], CC_AppNameStr, 64);
     strncpy ((char *)&sectorData[144], CC_VcsAppVersionStr, 64);
 
+    *((uint32_t *)&sectorData[208])   = CACHE_MANIFEST_SECTORS;
     *((uint32_t *)&sectorData[512-8]) = Cs->element;
-    *((uint32_t *)&sectorData[512-4]) = crc32c (0, sectorData, 512);
+    *((uint32_t *)&sectorData[512-4]) = CRC32C_Update (0, sectorData, 512);
 
     const RAWSTOR_Status_Result Rsr = STORAGE_LinearWrite (
                 STORAGE_Role_LinearCache, sectorData, 0, 1, Cs->rwRetries);
@@ -757,6 +1189,7 @@ static void writeSector0 (struct STORAGE_CACHE_State *const Cs)
 
 void STORAGE_CACHE_Init (struct STORAGE_CACHE_State *const Cs,
                          const bool SkipElementDataCheck,
+                         const bool DeferElementDataCheck,
                          const uint32_t RwRetries,
                          const uint8_t ProgressMax,
                          const STORAGE_CACHE_ProcessBreakFunc BreakFunc,
@@ -767,11 +1200,14 @@ void STORAGE_CACHE_Init (struct STORAGE_CACHE_State *const Cs,
     memset (Cs, 0, sizeof(struct STORAGE_CACHE_State));
 
     Cs->skipElementDataCheck    = SkipElementDataCheck;
+    Cs->deferElementDataCheck   = DeferElementDataCheck;
     Cs->rwRetries               = RwRetries;
     Cs->progressMax             = ProgressMax;
     Cs->breakFunc               = BreakFunc;
     Cs->breakFuncParam          = BreakFuncParam;
     Cs->nextTask                = STORAGE_CACHE_Stage_Start;
+    // Element data starts right after sector 0 and the manifest
+    Cs->sectorEnd               = CACHE_MANIFEST_SECTORS;
 }
 
 
@@ -807,6 +1243,10 @@ bool STORAGE_CACHE_ProcessNextTask (struct STORAGE_CACHE_State *const Cs)
             break;
     #endif // LIB_EMBEDULAR_HAS_FILESYSTEM
 
+        case STORAGE_CACHE_Stage_CheckManifestEntry:
+            checkManifestEntry (Cs);
+            break;
+
         case STORAGE_CACHE_Stage_CheckElementInfo:
             checkElementInfo (Cs);
             break;
@@ -824,6 +1264,10 @@ bool STORAGE_CACHE_ProcessNextTask (struct STORAGE_CACHE_State *const Cs)
             break;
 
     #ifdef LIB_EMBEDULAR_HAS_FILESYSTEM
+        case STORAGE_CACHE_Stage_WriteManifest:
+            writeManifest (Cs);
+            break;
+
         case STORAGE_CACHE_Stage_WriteSector0:
             writeSector0 (Cs);
             break;
@@ -874,11 +1318,15 @@ RAWSTOR_Status_Result STORAGE_CACHE_ElementInfo (
 
     if (Rsr == RAWSTOR_Status_Result_Ok)
     {
+        Ei->element     = Element;
         Ei->octets      = *((uint32_t *)&SectorData[8]);
         Ei->sectorBegin = *((uint32_t *)&SectorData[12]);
         Ei->sectorEnd   = *((uint32_t *)&SectorData[16]);
         Ei->sectorCount = Ei->sectorEnd - Ei->sectorBegin + 1;
+        Ei->encoding    = *((uint32_t *)&SectorData[88]);
         memcpy (Ei->filepath, &SectorData[24], sizeof(Ei->filepath));
+        Ei->filepath[sizeof(Ei->filepath) - 1] = '\0';
+        Ei->pathHash    = STORAGE_CACHE_PathHash (Ei->filepath);
     }
     else
     {
@@ -894,16 +1342,151 @@ RAWSTOR_Status_Result STORAGE_CACHE_ElementInfo (
 }
 
 
-RAWSTOR_Status_Result STORAGE_CACHE_ElementData (
-                        const struct STORAGE_CACHE_ElementInfo *const Ei,
-                        const uint32_t SectorDelta, const uint32_t SectorCount,
-                        uint8_t *const ElementData, const uint32_t Retries)
+/*
+    Zero I/O element info lookup. Ei->filepath is left empty; the index keeps
+    a path hash only. Returns false when Element was not indexed, either
+    because it failed its checks or because it is beyond
+    STORAGE_CACHE_INDEX_ELEMENTS. STORAGE_CACHE_ElementInfo() can still read
+    it from storage.
+    An element still waiting for background verification is verified on
+    demand, with the I/O that it takes.
+*/
+bool STORAGE_CACHE_IndexedElement (struct STORAGE_CACHE_ElementInfo *const Ei,
+                                   const uint32_t Element)
 {
-    BOARD_AssertParams (Ei && ElementData &&
-                        SectorDelta + SectorCount <= Ei->sectorCount);
+    BOARD_AssertParams (Ei);
 
-    // user-defined SectorCount must account for SectorDelta.
-    const uint32_t Sectors = SectorCount? SectorCount :
+    const struct STORAGE_CACHE_IndexEntry *const E =
+                                        STORAGE_CACHE_IndexEntry (Element);
+    if (!E)
+    {
+        return false;
+    }
+
+    if (s_verify.active && E->status == STORAGE_CACHE_ElementStatus_Indexed &&
+        !STORAGE_CACHE_VerifyElement (Element, 1))
+    {
+        return false;
+    }
+
+    Ei->element     = Element;
+    Ei->octets      = E->octets;
+    Ei->sectorBegin = E->sectorBegin;
+    Ei->sectorEnd   = E->sectorEnd;
+    Ei->sectorCount = E->sectorEnd - E->sectorBegin + 1;
+    Ei->encoding    = E->encoding;
+    Ei->pathHash    = E->pathHash;
+    Ei->filepath[0] = '\0';
+
+    return true;
+}
+
+
+/*
+    Finds an indexed element by its full file path, as stored in the cache
+    (for example "0:/EMBEDUL.AR/CACHE/0/FILE.BIN"). Paths are compared by
+    hash; when two indexed elements share the same hash, the stored file
+    paths are read to resolve the match.
+*/
+bool STORAGE_CACHE_FindElement (const char *const Filepath,
+                                uint32_t *const Element)
+{
+    BOARD_AssertParams (Filepath && Element);
+
+    const uint32_t PathHash = STORAGE_CACHE_PathHash (Filepath);
+    const uint32_t Count    = STORAGE_CachedElementsCount() <
+                                STORAGE_CACHE_INDEX_ELEMENTS?
+                                    STORAGE_CachedElementsCount() :
+                                    STORAGE_CACHE_INDEX_ELEMENTS;
+    uint32_t    matches = 0;
+    uint32_t    found   = 0;
+
+    for (uint32_t e = 0; e < Count; ++e)
+    {
+        if (s_index[e].status != STORAGE_CACHE_ElementStatus_Unavailable &&
+            s_index[e].pathHash == PathHash)
+        {
+            if (!matches ++)
+            {
+                found = e;
+            }
+        }
+    }
+
+    if (matches == 1)
+    {
+        *Element = found;
+        return true;
+    }
+
+    // Hash collision (or no match at all)
+    for (uint32_t e = found; matches && e < Count; ++e)
+    {
+        if (s_index[e].status == STORAGE_CACHE_ElementStatus_Unavailable ||
+            s_index[e].pathHash != PathHash)
+        {
+            continue;
+        }
+
+        struct STORAGE_CACHE_ElementInfo    ei;
+        uint8_t                             sectorData[512];
+
+        if (STORAGE_CACHE_ElementInfo (&ei, e, sectorData, 1) ==
+                                                    RAWSTOR_Status_Result_Ok &&
+            !strncmp (ei.filepath, Filepath, sizeof(ei.filepath)))
+        {
+            *Element = e;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/*
+    Index entry of an available (indexed and not failed) element or NULL.
+*/
+const struct STORAGE_CACHE_IndexEntry * STORAGE_CACHE_IndexEntry (
+                                                    const uint32_t Element)
+{
+    if (Element >= STORAGE_CachedElementsCount() ||
+        Element >= STORAGE_CACHE_INDEX_ELEMENTS ||
+        s_index[Element].status == STORAGE_CACHE_ElementStatus_Unavailable)
+    {
+        return NULL;
+    }
+
+    return &s_index[Element];
+}
+
+
+uint32_t STORAGE_CACHE_PathHash (const char *const Filepath)
+{
+    BOARD_AssertParams (Filepath);
+
+    uint32_t hash = CACHE_PATH_HASH_BASIS;
+
+    for (uint32_t i = 0; i < 64 && Filepath[i]; ++i)
+    {
+        hash ^= (uint8_t) Filepath[i];
+        hash *= CACHE_PATH_HASH_PRIME;
+    }
+
+    return hash;
+}
+
+
+RAWSTOR_Status_Result STORAGE_CACHE_ElementData (
+                        const struct STORAGE_CACHE_ElementInfo *const Ei,
+                        const uint32_t SectorDelta, const uint32_t SectorCount,
+                        uint8_t *const ElementData, const uint32_t Retries)
+{
+    BOARD_AssertParams (Ei && ElementData &&
+                        SectorDelta + SectorCount <= Ei->sectorCount);
+
+    // user-defined SectorCount must account for SectorDelta.
+    const uint32_t Sectors = SectorCount? SectorCount :
                                           Ei->sectorCount - SectorDelta;
 
     const RAWSTOR_Status_Result Rsr = 
@@ -914,10 +1497,543 @@ RAWSTOR_Status_Result STORAGE_CACHE_ElementData (
     if (Rsr != RAWSTOR_Status_Result_Ok)
     {
         LOG (NOBJ, LANG_CACHED_ELEMENT_READ_FAILED);
-        LOG_Items (3,
-                        LANG_PATH,      Ei->filepath,
-                        LANG_ERROR,     Rsr);
+
+        // Indexed element info has no file path, only its hash
+        if (Ei->filepath[0])
+        {
+            LOG_Items (3,
+                        LANG_CACHED_ELEMENT,    Ei->element,
+                        LANG_PATH,              Ei->filepath,
+                        LANG_ERROR,             Rsr);
+        }
+        else
+        {
+            LOG_Items (3,
+                        LANG_CACHED_ELEMENT,    Ei->element,
+                        LANG_PATH_HASH,         Ei->pathHash,
+                        LANG_ERROR,             Rsr);
+        }
     }
 
     return Rsr;
 }
+
+
+void STORAGE_CACHE_StreamInit (struct STORAGE_CACHE_Stream *const S,
+                               const struct STORAGE_CACHE_ElementInfo *const Ei)
+{
+    BOARD_AssertParams (S && Ei);
+    BOARD_AssertParams (Ei->encoding == STORAGE_CACHE_Encoding_Raw ||
+                        Ei->encoding == STORAGE_CACHE_Encoding_Rle);
+
+    S->encoding     = Ei->encoding;
+    S->sectorBegin  = Ei->sectorBegin;
+    S->sectorEnd    = Ei->sectorEnd;
+    S->octets       = Ei->octets;
+    S->aheadData    = NULL;
+    S->aheadQueued  = false;
+    S->aheadReady   = false;
+
+    STORAGE_CACHE_StreamRewind (S);
+}
+
+
+void STORAGE_CACHE_StreamRewind (struct STORAGE_CACHE_Stream *const S)
+{
+    BOARD_AssertParams (S);
+
+    S->sectorNext   = S->sectorBegin;
+    S->octetsLeft   = S->octets;
+    S->sectorPos    = 0;
+    S->sectorFill   = 0;
+
+    RLE_DecoderInit (&S->rle);
+}
+
+
+static void submitReadAhead (struct STORAGE_CACHE_Stream *const S);
+
+
+/*
+    Reads each next element sector ahead, asynchronously, into Buffer (512
+    octets). The stream must be closed by STORAGE_CACHE_StreamClose() before
+    initializing it again or releasing Buffer.
+*/
+void STORAGE_CACHE_StreamReadAhead (struct STORAGE_CACHE_Stream *const S,
+                                    uint8_t *const Buffer)
+{
+    BOARD_AssertParams (S && Buffer);
+    BOARD_AssertState  (!S->aheadQueued);
+
+    S->aheadData    = Buffer;
+    S->aheadReady   = false;
+
+    submitReadAhead (S);
+}
+
+
+// Waits for a read-ahead still in progress.
+void STORAGE_CACHE_StreamClose (struct STORAGE_CACHE_Stream *const S)
+{
+    BOARD_AssertParams (S);
+
+    if (S->aheadQueued)
+    {
+        STORAGE_LinearWait (STORAGE_Role_LinearCache);
+    }
+
+    S->aheadData    = NULL;
+    S->aheadReady   = false;
+}
+
+
+static void readAheadDone (struct RAWSTOR *const R,
+                           struct RAWSTOR_Request *const Req)
+{
+    (void) R;
+
+    struct STORAGE_CACHE_Stream *const S = Req->param;
+
+    S->aheadQueued  = false;
+    S->aheadReady   = (Req->result == RAWSTOR_Status_Result_Ok)? true : false;
+}
+
+
+static void submitReadAhead (struct STORAGE_CACHE_Stream *const S)
+{
+    if (!S->aheadData || S->aheadQueued || S->sectorNext > S->sectorEnd)
+    {
+        return;
+    }
+
+    S->ahead.op             = RAWSTOR_RequestOp_Read;
+    S->ahead.data           = S->aheadData;
+    S->ahead.sectorBegin    = S->sectorNext;
+    S->ahead.sectorCount    = 1;
+    S->ahead.done           = readAheadDone;
+    S->ahead.param          = S;
+
+    S->aheadSector  = S->sectorNext;
+    S->aheadReady   = false;
+    S->aheadQueued  = STORAGE_LinearSubmitRead (STORAGE_Role_LinearCache,
+                                                &S->ahead);
+}
+
+
+// Next element sector, taken from the read-ahead buffer when it holds it.
+static RAWSTOR_Status_Result readNextSector (
+                                        struct STORAGE_CACHE_Stream *const S,
+                                        uint8_t *const Data,
+                                        const uint32_t Retries)
+{
+    if (S->aheadQueued && S->aheadSector == S->sectorNext)
+    {
+        STORAGE_LinearWait (STORAGE_Role_LinearCache);
+    }
+
+    RAWSTOR_Status_Result rsr = RAWSTOR_Status_Result_Ok;
+
+    if (S->aheadReady && S->aheadSector == S->sectorNext)
+    {
+        memcpy (Data, S->aheadData, 512);
+        S->aheadReady = false;
+    }
+    else
+    {
+        // Failed read-ahead, or none at all, retried as usual
+        rsr = STORAGE_LinearRead (STORAGE_Role_LinearCache, Data,
+                                  S->sectorNext, 1, Retries);
+    }
+
+    ++ S->sectorNext;
+
+    submitReadAhead (S);
+
+    return rsr;
+}
+
+
+/*
+    Reads the next Octets of decoded element data, or whatever is left of it.
+    Whole uncompressed sectors are read directly into Data. A sector that
+    fails to read is still consumed, leaving undefined data in its place.
+*/
+RAWSTOR_Status_Result STORAGE_CACHE_StreamRead (
+                                        struct STORAGE_CACHE_Stream *const S,
+                                        uint8_t *const Data,
+                                        const uint32_t Octets,
+                                        const uint32_t Retries)
+{
+    BOARD_AssertParams (S && Data);
+
+    const uint32_t Wanted = (Octets < S->octetsLeft)? Octets : S->octetsLeft;
+    uint32_t done = 0;
+
+    while (done < Wanted)
+    {
+        const uint32_t Left = Wanted - done;
+
+        if (S->sectorPos == S->sectorFill)
+        {
+            if (S->sectorNext > S->sectorEnd)
+            {
+                // Element data ended before reaching its decoded size.
+                S->octetsLeft = 0;
+                return RAWSTOR_Status_Result_ReadWriteError;
+            }
+
+            // Whole sectors, one at a time when reading ahead
+            if (S->encoding == STORAGE_CACHE_Encoding_Raw && Left >= 512 &&
+                S->aheadData)
+            {
+                const RAWSTOR_Status_Result Rsr =
+                                    readNextSector (S, &Data[done], Retries);
+
+                S->octetsLeft   -= 512;
+                done            += 512;
+
+                if (Rsr != RAWSTOR_Status_Result_Ok)
+                {
+                    return Rsr;
+                }
+
+                continue;
+            }
+
+            if (S->encoding == STORAGE_CACHE_Encoding_Raw && Left >= 512)
+            {
+                const uint32_t Available = S->sectorEnd - S->sectorNext + 1;
+                const uint32_t Sectors   = ((Left >> 9) < Available)?
+                                                    (Left >> 9) : Available;
+
+                const RAWSTOR_Status_Result Rsr =
+                    STORAGE_LinearRead (STORAGE_Role_LinearCache, &Data[done],
+                                        S->sectorNext, Sectors, Retries);
+
+                S->sectorNext   += Sectors;
+                S->octetsLeft   -= Sectors << 9;
+                done            += Sectors << 9;
+
+                if (Rsr != RAWSTOR_Status_Result_Ok)
+                {
+                    return Rsr;
+                }
+
+                continue;
+            }
+
+            const RAWSTOR_Status_Result Rsr =
+                                    readNextSector (S, S->sector, Retries);
+
+            S->sectorPos    = 0;
+            S->sectorFill   = 512;
+
+            if (Rsr != RAWSTOR_Status_Result_Ok)
+            {
+                return Rsr;
+            }
+        }
+
+        uint32_t produced;
+
+        if (S->encoding == STORAGE_CACHE_Encoding_Raw)
+        {
+            produced = S->sectorFill - S->sectorPos;
+            if (produced > Left)
+            {
+                produced = Left;
+            }
+
+            memcpy (&Data[done], &S->sector[S->sectorPos], produced);
+            S->sectorPos += produced;
+        }
+        else
+        {
+            const struct RLE_DecodeResult R =
+                    RLE_Decode (&S->rle, &S->sector[S->sectorPos],
+                                S->sectorFill - S->sectorPos, &Data[done], Left);
+
+            S->sectorPos += R.in;
+            produced = R.out;
+        }
+
+        S->octetsLeft   -= produced;
+        done            += produced;
+    }
+
+    return RAWSTOR_Status_Result_Ok;
+}
+
+
+#ifdef LIB_EMBEDULAR_HAS_FILESYSTEM
+/*
+    Invalidates the element info sector and manifest entry of an element that
+    failed verification, so that the next boot rewrites it from its
+    filesystem slot.
+*/
+static void discardElement (const uint32_t Element, const uint32_t Retries)
+{
+    if (!STORAGE_ValidVolume (STORAGE_Role_FatFsDrive0))
+    {
+        return;
+    }
+
+    uint8_t sectorData[512];
+
+    memset (sectorData, 0, sizeof(sectorData));
+
+    writeElementInfoSector (Element, sectorData, Retries);
+
+    const uint32_t Sector = 1 + Element / CACHE_MANIFEST_ENTRIES;
+
+    if (STORAGE_LinearRead (STORAGE_Role_LinearCache, sectorData, Sector, 1,
+                            Retries) != RAWSTOR_Status_Result_Ok ||
+        !checkSectorCrc32 (sectorData))
+    {
+        return;
+    }
+
+    uint8_t *const Entry = &sectorData[
+            (Element % CACHE_MANIFEST_ENTRIES) * CACHE_MANIFEST_ENTRY_OCTETS];
+
+    *((uint16_t *)&Entry[30])           = 0;
+    *((uint32_t *)&sectorData[512-4])   = 0;
+    *((uint32_t *)&sectorData[512-4])   = CRC32C_Update (0, sectorData, 512);
+
+    STORAGE_LinearWrite (STORAGE_Role_LinearCache, sectorData, Sector, 1,
+                         Retries);
+}
+#endif // #ifdef LIB_EMBEDULAR_HAS_FILESYSTEM
+
+
+static uint32_t verifyElementCount (void)
+{
+    return (STORAGE_CachedElementsCount() < STORAGE_CACHE_INDEX_ELEMENTS)?
+                STORAGE_CachedElementsCount() : STORAGE_CACHE_INDEX_ELEMENTS;
+}
+
+
+static bool verifyResult (const uint32_t Element, const uint32_t Crc32,
+                          const uint32_t Retries)
+{
+    struct STORAGE_CACHE_IndexEntry *const E = &s_index[Element];
+
+    const bool Verified = (Crc32 == E->crc32)? true : false;
+
+    if (s_verify.active)
+    {
+        ++ *((Verified)? &s_verify.progress.verified :
+                         &s_verify.progress.failed);
+    }
+
+    if (Verified)
+    {
+        E->status = STORAGE_CACHE_ElementStatus_Verified;
+    #ifdef LIB_EMBEDULAR_HAS_FILESYSTEM
+        // Verified elements are trusted on the next boot
+        if (CACHE_MANIFEST_SECTORS &&
+            STORAGE_ValidVolume (STORAGE_Role_FatFsDrive0))
+        {
+            writeManifestSector (Element / CACHE_MANIFEST_ENTRIES,
+                                 verifyElementCount (), Retries);
+        }
+    #endif
+        return true;
+    }
+
+    E->status = STORAGE_CACHE_ElementStatus_Unavailable;
+
+    LOG_WarnDebug (NOBJ, LANG_CACHED_ELEMENT_VERIFY_FAILED);
+    LOG_Items (1, LANG_CACHED_ELEMENT, Element);
+
+#ifdef LIB_EMBEDULAR_HAS_FILESYSTEM
+    discardElement (Element, Retries);
+#else
+    (void) Retries;
+#endif
+
+    return false;
+}
+
+
+/*
+    Starts background verification of indexed elements whose data check was
+    deferred at boot. Call STORAGE_CACHE_VerifyNext() to make progress.
+*/
+void STORAGE_CACHE_VerifyStart (void)
+{
+    memset (&s_verify, 0, sizeof(s_verify));
+
+    const uint32_t Count = verifyElementCount ();
+
+    for (uint32_t e = 0; e < Count; ++e)
+    {
+        if (s_index[e].status == STORAGE_CACHE_ElementStatus_Indexed)
+        {
+            ++ s_verify.progress.elements;
+            s_verify.progress.sectors += s_index[e].sectorEnd -
+                                         s_index[e].sectorBegin + 1;
+        }
+    }
+
+    s_verify.active = (s_verify.progress.elements)? true : false;
+}
+
+
+/*
+    Verifies up to Sectors element data sectors. Returns false once there is
+    nothing left to verify.
+*/
+bool STORAGE_CACHE_VerifyNext (const uint32_t Sectors,
+                               const uint32_t Retries)
+{
+    uint32_t sectorsLeft = Sectors;
+
+    while (s_verify.active && sectorsLeft)
+    {
+        if (s_verify.element >= verifyElementCount ())
+        {
+            s_verify.active = false;
+
+            LOG (NOBJ, LANG_BACKGROUND_VERIFY_DONE);
+            LOG_Items (2,
+                            LANG_VERIFIED,  s_verify.progress.verified,
+                            LANG_FAILED,    s_verify.progress.failed);
+            break;
+        }
+
+        const struct STORAGE_CACHE_IndexEntry *const E =
+                                                &s_index[s_verify.element];
+
+        // Not pending or already verified on demand
+        if (E->status != STORAGE_CACHE_ElementStatus_Indexed)
+        {
+            ++ s_verify.element;
+            s_verify.sectorCurrent = 0;
+            continue;
+        }
+
+        // Element data never starts at sector 0
+        if (!s_verify.sectorCurrent)
+        {
+            s_verify.sectorCurrent  = E->sectorBegin;
+            s_verify.crc32          = 0;
+        }
+
+        uint8_t sectorData[512];
+
+        const RAWSTOR_Status_Result Rsr = 
+                STORAGE_LinearRead (STORAGE_Role_LinearCache, sectorData,
+                                    s_verify.sectorCurrent, 1, Retries);
+
+        -- sectorsLeft;
+
+        if (Rsr != RAWSTOR_Status_Result_Ok)
+        {
+            // Failed read ends element verification with a wrong checksum
+            s_verify.progress.sectorsChecked += E->sectorEnd -
+                                                s_verify.sectorCurrent + 1;
+            verifyResult (s_verify.element, ~E->crc32, Retries);
+            continue;
+        }
+
+        s_verify.crc32 = CRC32C_Update (s_verify.crc32, sectorData, 512);
+
+        ++ s_verify.progress.sectorsChecked;
+
+        if (++ s_verify.sectorCurrent > E->sectorEnd)
+        {
+            verifyResult (s_verify.element, s_verify.crc32, Retries);
+        }
+    }
+
+    return s_verify.active;
+}
+
+
+/*
+    Verifies element data sectors until Milliseconds elapse, at least one.
+    Returns false once there is nothing left to verify.
+*/
+bool STORAGE_CACHE_VerifyFor (const uint32_t Milliseconds,
+                              const uint32_t Retries)
+{
+    const TIMER_Ticks Start = TICKS_Now ();
+
+    while (STORAGE_CACHE_VerifyNext (1, Retries))
+    {
+        if (TICKS_Now() - Start >= Milliseconds)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/*
+    Verifies the data of an indexed element right away, if not already
+    verified. Returns false if the element is not available.
+*/
+bool STORAGE_CACHE_VerifyElement (const uint32_t Element,
+                                  const uint32_t Retries)
+{
+    const struct STORAGE_CACHE_IndexEntry *const E =
+                                        STORAGE_CACHE_IndexEntry (Element);
+    if (!E)
+    {
+        return false;
+    }
+
+    if (E->status == STORAGE_CACHE_ElementStatus_Verified)
+    {
+        return true;
+    }
+
+    // Discard partial background verification of this same element
+    if (s_verify.element == Element && s_verify.sectorCurrent)
+    {
+        s_verify.progress.sectorsChecked -= s_verify.sectorCurrent -
+                                            E->sectorBegin;
+        s_verify.sectorCurrent = 0;
+    }
+
+    uint32_t crc32 = 0;
+
+    for (uint32_t sector = E->sectorBegin; sector <= E->sectorEnd; ++sector)
+    {
+        uint8_t sectorData[512];
+
+        const RAWSTOR_Status_Result Rsr = 
+                STORAGE_LinearRead (STORAGE_Role_LinearCache, sectorData,
+                                    sector, 1, Retries);
+
+        if (Rsr != RAWSTOR_Status_Result_Ok)
+        {
+            crc32 = ~E->crc32;
+            break;
+        }
+
+        crc32 = CRC32C_Update (crc32, sectorData, 512);
+    }
+
+    if (s_verify.active)
+    {
+        s_verify.progress.sectorsChecked += E->sectorEnd - E->sectorBegin + 1;
+    }
+
+    return verifyResult (Element, crc32, Retries);
+}
+
+
+bool STORAGE_CACHE_VerifyPending (void)
+{
+    return s_verify.active;
+}
+
+
+struct STORAGE_CACHE_VerifyProgress STORAGE_CACHE_VerifyProgress (void)
+{
+    return s_verify.progress;
+}
@@ -26,6 +26,31 @@
 #pragma once
 
 #include "embedul.ar/source/core/manager/storage.h"
+#include "embedul.ar/source/core/misc/rle.h"
+
+
+// Cached elements described by the RAM index. Elements beyond this limit are
+// still available through STORAGE_CACHE_ElementInfo().
+#define STORAGE_CACHE_INDEX_ELEMENTS \
+                            LIB_EMBEDULAR_CONFIG_STORAGE_CACHE_INDEX_ELEMENTS
+
+
+// Compress elements when copying filesystem slots to the linear cache.
+#define STORAGE_CACHE_COMPRESSION \
+                            LIB_EMBEDULAR_CONFIG_STORAGE_CACHE_COMPRESSION
+
+
+// Trust the cache manifest at boot: elements whose source file metadata did
+// not change are indexed without checking their info sector nor their data.
+#define STORAGE_CACHE_INCREMENTAL \
+                            LIB_EMBEDULAR_CONFIG_STORAGE_CACHE_INCREMENTAL
+
+
+// Milliseconds spent verifying indexed element data on each BOARD_Sync() after
+// boot, at least one sector. Zero verifies all element data during the boot
+// sequence.
+#define STORAGE_CACHE_BACKGROUND_VERIFY \
+                            LIB_EMBEDULAR_CONFIG_STORAGE_CACHE_BACKGROUND_VERIFY
 
 
 typedef bool (* STORAGE_CACHE_ProcessBreakFunc)(void *const Param);
@@ -43,6 +68,7 @@ enum STORAGE_CACHE_CheckFlags
     STORAGE_CACHE_CheckFlags_AppVersion     = 0x0080,
     STORAGE_CACHE_CheckFlags_FileMetrics    = 0x0100,
     STORAGE_CACHE_CheckFlags_Filesystem     = 0x0200,
+    STORAGE_CACHE_CheckFlags_Manifest       = 0x0400,
 };
 
 
@@ -56,20 +82,31 @@ enum STORAGE_CACHE_Stage
     STORAGE_CACHE_Stage_SlotToElementInfo,
     STORAGE_CACHE_Stage_SlotToElementData,
 #endif
+    STORAGE_CACHE_Stage_CheckManifestEntry,
     STORAGE_CACHE_Stage_CheckElementInfo,
     STORAGE_CACHE_Stage_CheckElementData,
     STORAGE_CACHE_Stage_NextIteration,
     STORAGE_CACHE_Stage_EndIteration,
 #ifdef LIB_EMBEDULAR_HAS_FILESYSTEM
+    STORAGE_CACHE_Stage_WriteManifest,
     STORAGE_CACHE_Stage_WriteSector0,
 #endif
     STORAGE_CACHE_Stage_Done
 };
 
 
+// Element data encoding, as stored in the linear cache.
+enum STORAGE_CACHE_Encoding
+{
+    STORAGE_CACHE_Encoding_Raw = 0,
+    STORAGE_CACHE_Encoding_Rle
+};
+
+
 struct STORAGE_CACHE_State
 {
     bool                            skipElementDataCheck;
+    bool                            deferElementDataCheck;
     bool                            hasSlots;
     uint32_t                        rwRetries;
     uint32_t                        progressMax;
@@ -79,11 +116,20 @@ struct STORAGE_CACHE_State
     enum STORAGE_CACHE_Stage        nextTask;
     uint32_t                        elementCount;
     uint32_t                        element;
+    bool                            manifestValid;
+    uint32_t                        manifestSector;
 #ifdef LIB_EMBEDULAR_HAS_FILESYSTEM
     bool                            writeSector0;
+    bool                            writeManifest;
+    bool                            manifestInvalidated;
     FIL                             file;
     FILINFO                         fno;
+    uint32_t                        fileOctetsRead;
+    uint32_t                        encodedFill;
+    uint8_t                         encoded[512 + RLE_ENCODE_BOUND(512)];
 #endif
+    enum STORAGE_CACHE_Encoding     encoding;
+    uint32_t                        encodedOctets;
     uint32_t                        storedFileDate;
     uint32_t                        storedFileTime;
     uint32_t                        octets;
@@ -95,23 +141,93 @@ struct STORAGE_CACHE_State
     uint32_t                        storedCrc32;
     uint32_t                        checkCrc32;
     char                            filepath[64];
+    uint8_t                         manifest[512];
     enum STORAGE_CACHE_CheckFlags   checksFailed;
     enum STORAGE_CACHE_CheckFlags   checksPassed;
 };
 
 
+enum STORAGE_CACHE_ElementStatus
+{
+    // Not indexed or failed its data check
+    STORAGE_CACHE_ElementStatus_Unavailable = 0,
+    // Element info sector checked
+    STORAGE_CACHE_ElementStatus_Indexed,
+    // Matched the cache manifest; not verified in the background
+    STORAGE_CACHE_ElementStatus_Trusted,
+    // Element info sector and data checksum checked
+    STORAGE_CACHE_ElementStatus_Verified
+};
+
+
+struct STORAGE_CACHE_IndexEntry
+{
+    uint32_t                            octets;
+    uint32_t                            sectorBegin;
+    uint32_t                            sectorEnd;
+    uint32_t                            crc32;
+    uint32_t                            pathHash;
+    // Source file date and time, as reported by FatFs
+    uint32_t                            fileDate;
+    uint32_t                            fileTime;
+    enum STORAGE_CACHE_Encoding         encoding;
+    enum STORAGE_CACHE_ElementStatus    status;
+};
+
+
 struct STORAGE_CACHE_ElementInfo
 {
-    uint32_t        octets;
-    uint32_t        sectorBegin;
-    uint32_t        sectorEnd;
-    uint32_t        sectorCount;
-    char            filepath[64];
+    uint32_t                        element;
+    // Decoded element size
+    uint32_t                        octets;
+    uint32_t                        sectorBegin;
+    uint32_t                        sectorEnd;
+    uint32_t                        sectorCount;
+    enum STORAGE_CACHE_Encoding     encoding;
+    // STORAGE_CACHE_PathHash() of filepath, also set when it is left empty
+    uint32_t                        pathHash;
+    char                            filepath[64];
+};
+
+
+struct STORAGE_CACHE_VerifyProgress
+{
+    // Elements and data sectors pending verification when it started
+    uint32_t                        elements;
+    uint32_t                        sectors;
+    uint32_t                        verified;
+    uint32_t                        failed;
+    uint32_t                        sectorsChecked;
+};
+
+
+// Sequential, decoded access to element data. Compressed elements are
+// decoded as sectors are read.
+struct STORAGE_CACHE_Stream
+{
+    enum STORAGE_CACHE_Encoding     encoding;
+    uint32_t                        sectorBegin;
+    uint32_t                        sectorEnd;
+    uint32_t                        sectorNext;
+    uint32_t                        octets;
+    uint32_t                        octetsLeft;
+    uint32_t                        sectorPos;
+    uint32_t                        sectorFill;
+    struct RLE_Decoder              rle;
+    uint8_t                         sector[512];
+    // Asynchronous read of the next element sector into a caller buffer.
+    // Disabled when aheadData is NULL.
+    struct RAWSTOR_Request          ahead;
+    uint8_t                         * aheadData;
+    uint32_t                        aheadSector;
+    bool                            aheadQueued;
+    bool                            aheadReady;
 };
 
 
 void    STORAGE_CACHE_Init              (struct STORAGE_CACHE_State *const Cs,
                                          const bool SkipElementDataCheck,
+                                         const bool DeferElementDataCheck,
                                          const uint32_t RwRetries,
                                          const uint8_t ProgressMax,
                                          const STORAGE_CACHE_ProcessBreakFunc
@@ -127,6 +243,14 @@ RAWSTOR_Status_Result
                                          Ei, const uint32_t Element,
                                          uint8_t SectorData[const static 512],
                                          const uint32_t Retries);
+bool    STORAGE_CACHE_IndexedElement    (struct STORAGE_CACHE_ElementInfo *const
+                                         Ei, const uint32_t Element);
+bool    STORAGE_CACHE_FindElement       (const char *const Filepath,
+                                         uint32_t *const Element);
+const struct STORAGE_CACHE_IndexEntry *
+        STORAGE_CACHE_IndexEntry        (const uint32_t Element);
+uint32_t
+        STORAGE_CACHE_PathHash          (const char *const Filepath);
 RAWSTOR_Status_Result
         STORAGE_CACHE_ElementData       (const struct 
                                          STORAGE_CACHE_ElementInfo *const Ei,
@@ -134,3 +258,25 @@ RAWSTOR_Status_Result
                                          const uint32_t SectorCount,
                                          uint8_t *const ElementData,
                                          const uint32_t Retries);
+void    STORAGE_CACHE_StreamInit        (struct STORAGE_CACHE_Stream *const S,
+                                         const struct 
+                                         STORAGE_CACHE_ElementInfo *const Ei);
+void    STORAGE_CACHE_StreamRewind      (struct STORAGE_CACHE_Stream *const S);
+void    STORAGE_CACHE_StreamReadAhead   (struct STORAGE_CACHE_Stream *const S,
+                                         uint8_t *const Buffer);
+void    STORAGE_CACHE_StreamClose       (struct STORAGE_CACHE_Stream *const S);
+RAWSTOR_Status_Result
+        STORAGE_CACHE_StreamRead        (struct STORAGE_CACHE_Stream *const S,
+                                         uint8_t *const Data,
+                                         const uint32_t Octets,
+                                         const uint32_t Retries);
+void    STORAGE_CACHE_VerifyStart       (void);
+bool    STORAGE_CACHE_VerifyNext        (const uint32_t Sectors,
+                                         const uint32_t Retries);
+bool    STORAGE_CACHE_VerifyFor         (const uint32_t Milliseconds,
+                                         const uint32_t Retries);
+bool    STORAGE_CACHE_VerifyElement     (const uint32_t Element,
+                                         const uint32_t Retries);
+bool    STORAGE_CACHE_VerifyPending     (void);
+struct STORAGE_CACHE_VerifyProgress
+        STORAGE_CACHE_VerifyProgress    (void);
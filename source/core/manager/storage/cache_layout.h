@@ -0,0 +1,47 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+  
+  [STORAGE subsystem] linear cache on-media layout.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+// Shared by cache.c and tools/cache_image; must not depend on the rest of
+// the framework.
+
+
+#define CACHE_SIGNATURE                 "EMBEDUL.AR CACHE"
+#define CACHE_FWK_ELEMENTS              8
+// FNV-1a 32-bit hash parameters, used on element file paths.
+#define CACHE_PATH_HASH_BASIS           0x811c9dc5
+#define CACHE_PATH_HASH_PRIME           0x01000193
+// Cache manifest, stored in the sectors that follow sector 0. One entry per
+// indexed element, CACHE_MANIFEST_ENTRIES per sector (sector CRC32 last):
+// [0] file date, [4] file time, [8] octets, [12] sector begin,
+// [16] sector end, [20] data CRC32, [24] path hash, [28] encoding (16 bits),
+// [30] entry flags (16 bits).
+#define CACHE_MANIFEST_ENTRY_OCTETS     32
+#define CACHE_MANIFEST_ENTRIES          ((512 - 4) / CACHE_MANIFEST_ENTRY_OCTETS)
+#define CACHE_MANIFEST_SECTORS          \
+            ((LIB_EMBEDULAR_CONFIG_STORAGE_CACHE_INDEX_ELEMENTS + \
+              CACHE_MANIFEST_ENTRIES - 1) / CACHE_MANIFEST_ENTRIES)
+#define CACHE_MANIFEST_ENTRY_USED       0x0001
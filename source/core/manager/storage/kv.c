@@ -0,0 +1,1118 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+
+  [STORAGE subsystem] log-structured key-value store on the persistent
+  linear volume.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "embedul.ar/source/core/manager/storage/kv.h"
+#include "embedul.ar/source/core/device/board.h"
+#include "embedul.ar/source/core/misc/crc32c.h"
+#include <string.h>
+
+
+#if STORAGE_KV_INDEX_ENTRIES
+
+/*
+    The store is a circular log of sectors. Records are appended to a page
+    kept in RAM, which is written to the next log sector on commit. Sector
+    contents are never rewritten in place; a sector is reused only after
+    compaction copied its live records forward, so every sector is written
+    once per cycle around the log and a torn write only loses the page that
+    was being written.
+
+    Page sequence numbers map to log sectors as (sequence % sectors). Each
+    page stores the sequence of the oldest page still holding live records
+    (the tail), so mounting replays pages from the tail of the most recent
+    page to rebuild the RAM index.
+
+    Page:   [0] signature, [4] sequence, [8] tail sequence, [12] log sectors,
+            [16] record octets, [20] reserved, [24] records, [508] CRC32.
+    Record: [0] key octets, [1] flags, [2] value octets (16 bits), key,
+            value.
+*/
+#define KV_PAGE_SIGNATURE       0x53564b45      // "EKVS"
+#define KV_PAGE_HEADER          24
+#define KV_PAGE_PAYLOAD         (512 - KV_PAGE_HEADER - 4)
+#define KV_RECORD_HEADER        4
+#define KV_RECORD_DELETED       0x01
+// Sectors a commit must leave free so compaction can always write a page.
+#define KV_RESERVED_SECTORS     2
+#define KV_MIN_SECTORS          (KV_RESERVED_SECTORS + 2)
+// Pages that may be lost out of order on a power failure.
+#define KV_TORN_PAGES           (STORAGE_WRITE_BACK_SECTORS + 1)
+// FNV-1a 32-bit hash parameters, used on keys.
+#define KV_KEY_HASH_BASIS       0x811c9dc5
+#define KV_KEY_HASH_PRIME       0x01000193
+
+#define KV_ENTRY_USED           0x01
+#define KV_ENTRY_DELETED        0x02
+
+
+struct KV_IndexEntry
+{
+    uint32_t    hash;
+    uint32_t    seq;
+    uint16_t    offset;
+    uint16_t    valueOctets;
+    uint8_t     keyOctets;
+    uint8_t     flags;
+};
+
+
+struct KV_State
+{
+    bool                    mounted;
+    uint32_t                sectorBegin;
+    uint32_t                sectors;
+    uint32_t                retries;
+    // Sequence of the page in RAM
+    uint32_t                headSeq;
+    // Oldest page with live records, the one recorded on the last page
+    // written and the one recorded on the last page known to be on media
+    uint32_t                tailSeq;
+    uint32_t                durableTailSeq;
+    uint32_t                syncedTailSeq;
+    uint32_t                headOctets;
+    TIMER_Ticks             firstPending;
+    uint32_t                entries;
+    uint32_t                capacity;
+    uint32_t                compactLeft;
+    bool                    scratchValid;
+    uint32_t                scratchSeq;
+    struct STORAGE_KV_Stats stats;
+    uint8_t                 page[512];
+    uint8_t                 scratch[512];
+};
+
+
+// Open addressing with linear probing. At least one entry is always left
+// unused to end probe sequences.
+static struct KV_IndexEntry s_index[STORAGE_KV_INDEX_ENTRIES];
+static struct KV_State s_kv;
+
+
+static uint32_t keyHash (const char *const Key, const uint32_t KeyOctets)
+{
+    uint32_t hash = KV_KEY_HASH_BASIS;
+
+    for (uint32_t i = 0; i < KeyOctets; ++i)
+    {
+        hash ^= (uint8_t) Key[i];
+        hash *= KV_KEY_HASH_PRIME;
+    }
+
+    return hash;
+}
+
+
+static uint32_t pageSector (const uint32_t Seq)
+{
+    return s_kv.sectorBegin + Seq % s_kv.sectors;
+}
+
+
+static uint32_t usedSectors (void)
+{
+    return s_kv.headSeq - s_kv.tailSeq;
+}
+
+
+static uint32_t entryOctets (const struct KV_IndexEntry *const E)
+{
+    return KV_RECORD_HEADER + E->keyOctets + E->valueOctets;
+}
+
+
+// Records are not aligned.
+static uint16_t recordValueOctets (const uint8_t *const Rec)
+{
+    return (uint16_t)(Rec[2] | (Rec[3] << 8));
+}
+
+
+static bool checkPage (uint8_t pageData[static 512], const uint32_t Seq)
+{
+    if (*((uint32_t *)&pageData[0])  != KV_PAGE_SIGNATURE ||
+        *((uint32_t *)&pageData[4])  != Seq ||
+        *((uint32_t *)&pageData[12]) != s_kv.sectors ||
+        *((uint32_t *)&pageData[16]) > KV_PAGE_PAYLOAD)
+    {
+        return false;
+    }
+
+    const uint32_t StoredCrc32 = *((uint32_t *)&pageData[512-4]);
+
+    *((uint32_t *)&pageData[512-4]) = 0;
+
+    const uint32_t ComputedCrc32 = CRC32C_Update (0, pageData, 512);
+
+    *((uint32_t *)&pageData[512-4]) = StoredCrc32;
+
+    return (StoredCrc32 == ComputedCrc32);
+}
+
+
+static enum STORAGE_KV_Result readPage (const uint32_t Seq,
+                                        const uint8_t **const Page)
+{
+    if (Seq == s_kv.headSeq)
+    {
+        *Page = s_kv.page;
+        return STORAGE_KV_Result_Ok;
+    }
+
+    if (!s_kv.scratchValid || s_kv.scratchSeq != Seq)
+    {
+        s_kv.scratchValid = false;
+
+        if (STORAGE_LinearRead (STORAGE_Role_LinearPersistent, s_kv.scratch,
+                                pageSector(Seq), 1, s_kv.retries)
+                                                != RAWSTOR_Status_Result_Ok)
+        {
+            return STORAGE_KV_Result_MediaError;
+        }
+
+        if (!checkPage (s_kv.scratch, Seq))
+        {
+            return STORAGE_KV_Result_Corrupted;
+        }
+
+        s_kv.scratchValid   = true;
+        s_kv.scratchSeq     = Seq;
+    }
+
+    *Page = s_kv.scratch;
+    return STORAGE_KV_Result_Ok;
+}
+
+
+// Index entry of Key, or the unused entry where Key would be inserted.
+static enum STORAGE_KV_Result findEntry (const char *const Key,
+                                         const uint32_t KeyOctets,
+                                         const uint32_t Hash,
+                                         uint32_t *const Slot,
+                                         bool *const Found)
+{
+    const uint32_t Mask = STORAGE_KV_INDEX_ENTRIES - 1;
+
+    for (uint32_t i = Hash & Mask;; i = (i + 1) & Mask)
+    {
+        const struct KV_IndexEntry *const E = &s_index[i];
+
+        if (!(E->flags & KV_ENTRY_USED))
+        {
+            *Slot   = i;
+            *Found  = false;
+            return STORAGE_KV_Result_Ok;
+        }
+
+        if (E->hash != Hash || E->keyOctets != KeyOctets)
+        {
+            continue;
+        }
+
+        // Same hash. Compare the key stored on the entry record.
+        const uint8_t *page;
+        const enum STORAGE_KV_Result R = readPage (E->seq, &page);
+
+        if (R != STORAGE_KV_Result_Ok)
+        {
+            return R;
+        }
+
+        if (!memcmp(&page[E->offset + KV_RECORD_HEADER], Key, KeyOctets))
+        {
+            *Slot   = i;
+            *Found  = true;
+            return STORAGE_KV_Result_Ok;
+        }
+    }
+}
+
+
+// Index entry pointing at the record in sequence Seq and Offset, if any.
+static uint32_t liveEntry (const uint32_t Hash, const uint32_t Seq,
+                           const uint32_t Offset)
+{
+    const uint32_t Mask = STORAGE_KV_INDEX_ENTRIES - 1;
+
+    for (uint32_t i = Hash & Mask; s_index[i].flags & KV_ENTRY_USED;
+         i = (i + 1) & Mask)
+    {
+        if (s_index[i].seq == Seq && s_index[i].offset == Offset)
+        {
+            return i;
+        }
+    }
+
+    return STORAGE_KV_INDEX_ENTRIES;
+}
+
+
+static void removeEntry (uint32_t slot)
+{
+    const uint32_t Mask = STORAGE_KV_INDEX_ENTRIES - 1;
+
+    s_kv.stats.liveOctets -= entryOctets (&s_index[slot]);
+
+    if (!(s_index[slot].flags & KV_ENTRY_DELETED))
+    {
+        -- s_kv.stats.keys;
+    }
+
+    // Backward shift: move following entries of the same probe sequence
+    // into the hole, so lookups need no deleted entry markers.
+    for (uint32_t next = (slot + 1) & Mask; s_index[next].flags &
+         KV_ENTRY_USED; next = (next + 1) & Mask)
+    {
+        const uint32_t Home = s_index[next].hash & Mask;
+
+        if (((next - Home) & Mask) >= ((next - slot) & Mask))
+        {
+            s_index[slot]   = s_index[next];
+            slot            = next;
+        }
+    }
+
+    s_index[slot].flags = 0;
+    -- s_kv.entries;
+}
+
+
+static void setEntry (const uint32_t Slot, const bool Found,
+                      const uint32_t Hash, const uint8_t KeyOctets,
+                      const uint8_t RecordFlags, const uint16_t ValueOctets,
+                      const uint32_t Seq, const uint16_t Offset)
+{
+    struct KV_IndexEntry *const E = &s_index[Slot];
+
+    if (Found)
+    {
+        s_kv.stats.liveOctets -= entryOctets (E);
+
+        if (!(E->flags & KV_ENTRY_DELETED))
+        {
+            -- s_kv.stats.keys;
+        }
+    }
+    else
+    {
+        ++ s_kv.entries;
+    }
+
+    E->hash         = Hash;
+    E->seq          = Seq;
+    E->offset       = Offset;
+    E->valueOctets  = ValueOctets;
+    E->keyOctets    = KeyOctets;
+    E->flags        = KV_ENTRY_USED;
+
+    if (RecordFlags & KV_RECORD_DELETED)
+    {
+        E->flags |= KV_ENTRY_DELETED;
+    }
+    else
+    {
+        ++ s_kv.stats.keys;
+    }
+
+    s_kv.stats.liveOctets += entryOctets (E);
+}
+
+
+// Appends a record to the page in RAM. Returns its page offset.
+static uint16_t appendRecord (const uint8_t KeyOctets,
+                              const uint8_t RecordFlags,
+                              const uint16_t ValueOctets,
+                              const void *const Key, const void *const Value)
+{
+    BOARD_AssertState (s_kv.headOctets + KV_RECORD_HEADER + KeyOctets +
+                       ValueOctets <= KV_PAGE_PAYLOAD);
+
+    if (!s_kv.headOctets)
+    {
+        s_kv.firstPending = TICKS_Now ();
+    }
+
+    const uint16_t Offset = (uint16_t)(KV_PAGE_HEADER + s_kv.headOctets);
+    uint8_t *const R = &s_kv.page[Offset];
+
+    R[0] = KeyOctets;
+    R[1] = RecordFlags;
+    R[2] = (uint8_t) ValueOctets;
+    R[3] = (uint8_t)(ValueOctets >> 8);
+
+    memcpy (&R[KV_RECORD_HEADER], Key, KeyOctets);
+
+    if (ValueOctets)
+    {
+        memcpy (&R[KV_RECORD_HEADER + KeyOctets], Value, ValueOctets);
+    }
+
+    s_kv.headOctets += KV_RECORD_HEADER + KeyOctets + ValueOctets;
+
+    return Offset;
+}
+
+
+static enum STORAGE_KV_Result writePage (void)
+{
+    // A sector released by compaction is reused only once the page that
+    // recorded its release is on media.
+    if (s_kv.headSeq - s_kv.syncedTailSeq >= s_kv.sectors)
+    {
+        if (STORAGE_Sync (s_kv.retries) != RAWSTOR_Status_Result_Ok)
+        {
+            return STORAGE_KV_Result_MediaError;
+        }
+
+        s_kv.syncedTailSeq = s_kv.durableTailSeq;
+    }
+
+    BOARD_AssertState (s_kv.headSeq - s_kv.syncedTailSeq < s_kv.sectors);
+
+    uint8_t *const P = s_kv.page;
+
+    *((uint32_t *)&P[0])  = KV_PAGE_SIGNATURE;
+    *((uint32_t *)&P[4])  = s_kv.headSeq;
+    *((uint32_t *)&P[8])  = s_kv.tailSeq;
+    *((uint32_t *)&P[12]) = s_kv.sectors;
+    *((uint32_t *)&P[16]) = s_kv.headOctets;
+    *((uint32_t *)&P[20]) = 0;
+
+    memset (&P[KV_PAGE_HEADER + s_kv.headOctets], 0,
+            KV_PAGE_PAYLOAD - s_kv.headOctets + 4);
+
+    *((uint32_t *)&P[512-4]) = CRC32C_Update (0, P, 512);
+
+    const RAWSTOR_Status_Result Rsr =
+            STORAGE_LinearWrite (STORAGE_Role_LinearPersistent, P,
+                                 pageSector(s_kv.headSeq), 1, s_kv.retries);
+
+    if (Rsr != RAWSTOR_Status_Result_Ok)
+    {
+        return STORAGE_KV_Result_MediaError;
+    }
+
+    // Records in the written page are read back from the scratch copy
+    memcpy (s_kv.scratch, P, 512);
+
+    s_kv.scratchValid   = true;
+    s_kv.scratchSeq     = s_kv.headSeq;
+    s_kv.durableTailSeq = s_kv.tailSeq;
+    s_kv.headOctets     = 0;
+
+    ++ s_kv.headSeq;
+    ++ s_kv.stats.sectorWrites;
+
+    return STORAGE_KV_Result_Ok;
+}
+
+
+static void dropPageEntries (const uint32_t Seq)
+{
+    for (uint32_t i = 0; i < STORAGE_KV_INDEX_ENTRIES;)
+    {
+        if ((s_index[i].flags & KV_ENTRY_USED) && s_index[i].seq == Seq)
+        {
+            // Entries shifted into this one are checked again
+            removeEntry (i);
+        }
+        else
+        {
+            ++ i;
+        }
+    }
+}
+
+
+/*
+    Copies live records on the oldest page to the page in RAM, then
+    releases the oldest page. Deleted key markers reaching the tail are
+    dropped, as no older record of that key remains in the log.
+*/
+static enum STORAGE_KV_Result compactTail (void)
+{
+    BOARD_AssertState (usedSectors() > 0);
+
+    const uint8_t *page;
+    const enum STORAGE_KV_Result R = readPage (s_kv.tailSeq, &page);
+
+    if (R == STORAGE_KV_Result_MediaError)
+    {
+        return R;
+    }
+
+    if (R == STORAGE_KV_Result_Corrupted)
+    {
+        LOG_Warn (NOBJ, LANG_KV_SECTOR_CORRUPTED);
+        LOG_Items (1, LANG_SECTOR, pageSector(s_kv.tailSeq));
+
+        dropPageEntries (s_kv.tailSeq);
+
+        ++ s_kv.stats.corruptedSectors;
+        ++ s_kv.tailSeq;
+        return STORAGE_KV_Result_Ok;
+    }
+
+    // Writing the page in RAM replaces the scratch page
+    uint8_t tail[512];
+    memcpy (tail, page, 512);
+
+    const uint32_t End = KV_PAGE_HEADER + *((uint32_t *)&tail[16]);
+    uint32_t liveOctets = 0;
+
+    for (uint32_t offset = KV_PAGE_HEADER; offset < End;)
+    {
+        const uint8_t *const Rec = &tail[offset];
+        const uint32_t Octets = KV_RECORD_HEADER + Rec[0] +
+                                recordValueOctets (Rec);
+
+        if (!(Rec[1] & KV_RECORD_DELETED) &&
+            liveEntry(keyHash((const char *)&Rec[KV_RECORD_HEADER], Rec[0]),
+                      s_kv.tailSeq, offset) < STORAGE_KV_INDEX_ENTRIES)
+        {
+            liveOctets += Octets;
+        }
+
+        offset += Octets;
+    }
+
+    if (liveOctets > KV_PAGE_PAYLOAD - s_kv.headOctets)
+    {
+        const enum STORAGE_KV_Result Rw = writePage ();
+
+        if (Rw != STORAGE_KV_Result_Ok)
+        {
+            return Rw;
+        }
+    }
+
+    for (uint32_t offset = KV_PAGE_HEADER; offset < End;)
+    {
+        const uint8_t *const Rec = &tail[offset];
+        const uint16_t ValueOctets = recordValueOctets (Rec);
+        const uint32_t Octets = KV_RECORD_HEADER + Rec[0] + ValueOctets;
+        const uint32_t Slot = liveEntry (
+                        keyHash((const char *)&Rec[KV_RECORD_HEADER], Rec[0]),
+                        s_kv.tailSeq, offset);
+
+        offset += Octets;
+
+        if (Slot == STORAGE_KV_INDEX_ENTRIES)
+        {
+            continue;
+        }
+
+        if (Rec[1] & KV_RECORD_DELETED)
+        {
+            removeEntry (Slot);
+            continue;
+        }
+
+        s_index[Slot].seq       = s_kv.headSeq;
+        s_index[Slot].offset    = appendRecord (Rec[0], Rec[1], ValueOctets,
+                                        &Rec[KV_RECORD_HEADER],
+                                        &Rec[KV_RECORD_HEADER + Rec[0]]);
+    }
+
+    ++ s_kv.stats.compactedSectors;
+    ++ s_kv.tailSeq;
+
+    return STORAGE_KV_Result_Ok;
+}
+
+
+// Writes the page in RAM, compacting first if the log is running out of
+// sectors.
+static enum STORAGE_KV_Result commit (void)
+{
+    if (!s_kv.headOctets)
+    {
+        return STORAGE_KV_Result_Ok;
+    }
+
+    // Each compaction either frees a sector or moves a full one forward
+    for (uint32_t i = 0; usedSectors() > s_kv.sectors - KV_RESERVED_SECTORS
+                                                                    - 1; ++i)
+    {
+        if (i == s_kv.sectors * 2)
+        {
+            return STORAGE_KV_Result_Full;
+        }
+
+        const enum STORAGE_KV_Result R = compactTail ();
+
+        if (R != STORAGE_KV_Result_Ok)
+        {
+            return R;
+        }
+    }
+
+    return writePage ();
+}
+
+
+static enum STORAGE_KV_Result replayPage (const uint8_t *const PageData,
+                                          const uint32_t Seq)
+{
+    const uint32_t End = KV_PAGE_HEADER + *((uint32_t *)&PageData[16]);
+
+    for (uint32_t offset = KV_PAGE_HEADER; offset + KV_RECORD_HEADER <= End;)
+    {
+        const uint8_t *const Rec = &PageData[offset];
+        const char *const Key = (const char *)&Rec[KV_RECORD_HEADER];
+        const uint16_t ValueOctets = recordValueOctets (Rec);
+        const uint32_t Octets = KV_RECORD_HEADER + Rec[0] + ValueOctets;
+
+        if (!Rec[0] || offset + Octets > End)
+        {
+            break;
+        }
+
+        const uint32_t Hash = keyHash (Key, Rec[0]);
+        uint32_t slot;
+        bool found;
+
+        const enum STORAGE_KV_Result R = findEntry (Key, Rec[0], Hash,
+                                                    &slot, &found);
+        if (R != STORAGE_KV_Result_Ok)
+        {
+            return R;
+        }
+
+        if (!found && s_kv.entries == STORAGE_KV_INDEX_ENTRIES - 1)
+        {
+            return STORAGE_KV_Result_Full;
+        }
+
+        setEntry (slot, found, Hash, Rec[0], Rec[1], ValueOctets, Seq,
+                  (uint16_t)offset);
+
+        offset += Octets;
+    }
+
+    return STORAGE_KV_Result_Ok;
+}
+
+
+static enum STORAGE_KV_Result readLogSector (const uint32_t Seq,
+                                             uint8_t pageData[static 512])
+{
+    if (STORAGE_LinearRead (STORAGE_Role_LinearPersistent, pageData,
+                            pageSector(Seq), 1, s_kv.retries)
+                                                != RAWSTOR_Status_Result_Ok)
+    {
+        return STORAGE_KV_Result_MediaError;
+    }
+
+    return checkPage (pageData, Seq)? STORAGE_KV_Result_Ok :
+                                      STORAGE_KV_Result_Corrupted;
+}
+
+
+/*
+    Pages that were waiting in the write-back buffer on a power failure may
+    reach the media in any order. The log ends before the first missing page
+    among the last KV_TORN_PAGES pages. Later pages are erased, so they are
+    not taken as the most recent ones on the next mount.
+*/
+static enum STORAGE_KV_Result truncateTornPages (uint32_t *const NewestSeq)
+{
+    uint8_t pageData[512];
+    uint32_t lastSeq = *NewestSeq;
+    enum STORAGE_KV_Result r;
+
+    if ((r = readLogSector (*NewestSeq, pageData)) != STORAGE_KV_Result_Ok)
+    {
+        return r;
+    }
+
+    // Sectors of pages before the tail may already be reused
+    const uint32_t LogPages = *NewestSeq - *((uint32_t *)&pageData[8]);
+    const uint32_t Pages = (LogPages < KV_TORN_PAGES - 1)? LogPages :
+                                                          KV_TORN_PAGES - 1;
+
+    for (uint32_t i = Pages; i > 0; --i)
+    {
+        if ((r = readLogSector (*NewestSeq - i, pageData)) ==
+                                                STORAGE_KV_Result_MediaError)
+        {
+            return r;
+        }
+
+        if (r == STORAGE_KV_Result_Corrupted)
+        {
+            lastSeq = *NewestSeq - i - 1;
+            break;
+        }
+    }
+
+    if (lastSeq == *NewestSeq)
+    {
+        return STORAGE_KV_Result_Ok;
+    }
+
+    // Not a torn write if the page before the gap is missing too. Missing
+    // pages are skipped as corrupted.
+    if ((r = readLogSector (lastSeq, pageData)) != STORAGE_KV_Result_Ok)
+    {
+        return (r == STORAGE_KV_Result_Corrupted)? STORAGE_KV_Result_Ok : r;
+    }
+
+    memset (pageData, 0, sizeof(pageData));
+
+    for (uint32_t seq = lastSeq + 1; seq != *NewestSeq + 1; ++seq)
+    {
+        if (STORAGE_LinearWrite (STORAGE_Role_LinearPersistent, pageData,
+                                 pageSector(seq), 1, s_kv.retries)
+                                                != RAWSTOR_Status_Result_Ok)
+        {
+            return STORAGE_KV_Result_MediaError;
+        }
+    }
+
+    if (STORAGE_Sync (s_kv.retries) != RAWSTOR_Status_Result_Ok)
+    {
+        return STORAGE_KV_Result_MediaError;
+    }
+
+    LOG_Warn (NOBJ, LANG_KV_TORN_PAGES);
+    LOG_Items (1, LANG_SECTORS, *NewestSeq - lastSeq);
+
+    *NewestSeq = lastSeq;
+    return STORAGE_KV_Result_Ok;
+}
+
+
+static enum STORAGE_KV_Result mount (void)
+{
+    uint8_t pageData[512];
+    bool found = false;
+    uint32_t newestSeq = 0;
+
+    // Most recent page
+    for (uint32_t i = 0; i < s_kv.sectors; ++i)
+    {
+        if (STORAGE_LinearRead (STORAGE_Role_LinearPersistent, pageData,
+                                s_kv.sectorBegin + i, 1, s_kv.retries)
+                                                != RAWSTOR_Status_Result_Ok)
+        {
+            return STORAGE_KV_Result_MediaError;
+        }
+
+        const uint32_t Seq = *((uint32_t *)&pageData[4]);
+
+        if (Seq % s_kv.sectors != i || !checkPage (pageData, Seq))
+        {
+            continue;
+        }
+
+        if (!found || (int32_t)(Seq - newestSeq) > 0)
+        {
+            found       = true;
+            newestSeq   = Seq;
+        }
+    }
+
+    if (!found)
+    {
+        return STORAGE_KV_Result_Ok;
+    }
+
+    enum STORAGE_KV_Result r = truncateTornPages (&newestSeq);
+
+    if (r != STORAGE_KV_Result_Ok)
+    {
+        return r;
+    }
+
+    if ((r = readLogSector (newestSeq, pageData)) != STORAGE_KV_Result_Ok)
+    {
+        return r;
+    }
+
+    s_kv.headSeq = newestSeq + 1;
+    s_kv.tailSeq = *((uint32_t *)&pageData[8]);
+
+    if (usedSectors() > s_kv.sectors)
+    {
+        s_kv.tailSeq = s_kv.headSeq - s_kv.sectors;
+    }
+
+    s_kv.durableTailSeq = s_kv.syncedTailSeq = s_kv.tailSeq;
+
+    for (uint32_t seq = s_kv.tailSeq; seq != s_kv.headSeq; ++seq)
+    {
+        if ((r = readLogSector (seq, pageData)) ==
+                                                STORAGE_KV_Result_MediaError)
+        {
+            return r;
+        }
+
+        if (r == STORAGE_KV_Result_Corrupted)
+        {
+            LOG_Warn (NOBJ, LANG_KV_SECTOR_CORRUPTED);
+            LOG_Items (1, LANG_SECTOR, pageSector(seq));
+
+            ++ s_kv.stats.corruptedSectors;
+            continue;
+        }
+
+        if ((r = replayPage (pageData, seq)) != STORAGE_KV_Result_Ok)
+        {
+            return r;
+        }
+    }
+
+    // A page written while compacting may leave less free sectors than a
+    // commit needs. The page in RAM is empty, so the tail always fits.
+    while (usedSectors() > s_kv.sectors - KV_RESERVED_SECTORS)
+    {
+        if ((r = compactTail ()) != STORAGE_KV_Result_Ok)
+        {
+            return r;
+        }
+    }
+
+    return STORAGE_KV_Result_Ok;
+}
+
+
+enum STORAGE_KV_Result STORAGE_KV_Mount (const uint32_t LocalSector,
+                                         const uint32_t Sectors,
+                                         const uint32_t Retries)
+{
+    BOARD_AssertState  (!s_kv.mounted);
+    BOARD_AssertParams (STORAGE_ValidVolume(STORAGE_Role_LinearPersistent) &&
+                        Sectors >= KV_MIN_SECTORS);
+
+    const struct STORAGE_VolumeInfo Vi =
+                        STORAGE_VolumeInfo (STORAGE_Role_LinearPersistent);
+
+    BOARD_AssertParams (LocalSector + Sectors <=
+                        Vi.sectorEnd - Vi.sectorBegin + 1);
+
+    memset (s_index, 0, sizeof(s_index));
+    memset (&s_kv, 0, sizeof(s_kv));
+
+    s_kv.sectorBegin    = LocalSector;
+    s_kv.sectors        = Sectors;
+    s_kv.retries        = Retries;
+    // At most half of the sectors left after the reserve hold live records,
+    // so compaction always finds space to reclaim.
+    s_kv.capacity       = (Sectors - KV_RESERVED_SECTORS - 1) *
+                                                        KV_PAGE_PAYLOAD / 2;
+
+    const enum STORAGE_KV_Result R = mount ();
+
+    if (R != STORAGE_KV_Result_Ok)
+    {
+        LOG_Warn (NOBJ, LANG_KV_MOUNT_FAILED);
+        LOG_Items (1, LANG_ERROR, (uint32_t)R);
+        return R;
+    }
+
+    s_kv.mounted = true;
+
+    LOG (NOBJ, LANG_KV_MOUNTED);
+    LOG_Items (4,
+                    LANG_SECTORS,           Sectors,
+                    LANG_KEYS,              s_kv.stats.keys,
+                    LANG_OCTETS,            s_kv.stats.liveOctets,
+                    LANG_CORRUPTED_SECTORS, s_kv.stats.corruptedSectors);
+
+    return STORAGE_KV_Result_Ok;
+}
+
+
+bool STORAGE_KV_Mounted (void)
+{
+    return s_kv.mounted;
+}
+
+
+static enum STORAGE_KV_Result checkKey (const char *const Key,
+                                        uint32_t *const KeyOctets)
+{
+    BOARD_AssertState  (s_kv.mounted);
+    BOARD_AssertParams (Key);
+
+    uint32_t octets = 0;
+
+    while (octets <= STORAGE_KV_KEY_MAX_OCTETS && Key[octets])
+    {
+        ++ octets;
+    }
+
+    *KeyOctets = octets;
+
+    return (*KeyOctets && *KeyOctets <= STORAGE_KV_KEY_MAX_OCTETS)?
+                STORAGE_KV_Result_Ok : STORAGE_KV_Result_InvalidParam;
+}
+
+
+enum STORAGE_KV_Result STORAGE_KV_Get (const char *const Key,
+                                       void *const Value,
+                                       const uint32_t Octets,
+                                       uint32_t *const ValueOctets)
+{
+    BOARD_AssertParams (Value || !Octets);
+
+    uint32_t keyOctets;
+    enum STORAGE_KV_Result r = checkKey (Key, &keyOctets);
+
+    if (r != STORAGE_KV_Result_Ok)
+    {
+        return r;
+    }
+
+    const uint32_t Hash = keyHash (Key, keyOctets);
+    uint32_t slot;
+    bool found;
+
+    if ((r = findEntry (Key, keyOctets, Hash, &slot, &found))
+                                                    != STORAGE_KV_Result_Ok)
+    {
+        return r;
+    }
+
+    const struct KV_IndexEntry *const E = &s_index[slot];
+
+    if (!found || (E->flags & KV_ENTRY_DELETED))
+    {
+        return STORAGE_KV_Result_NotFound;
+    }
+
+    const uint8_t *page;
+
+    if ((r = readPage (E->seq, &page)) != STORAGE_KV_Result_Ok)
+    {
+        return r;
+    }
+
+    memcpy (Value, &page[E->offset + KV_RECORD_HEADER + keyOctets],
+            (Octets < E->valueOctets)? Octets : E->valueOctets);
+
+    if (ValueOctets)
+    {
+        *ValueOctets = E->valueOctets;
+    }
+
+    return STORAGE_KV_Result_Ok;
+}
+
+
+static enum STORAGE_KV_Result putRecord (const char *const Key,
+                                         const uint8_t RecordFlags,
+                                         const void *const Value,
+                                         const uint32_t Octets)
+{
+    uint32_t keyOctets;
+    enum STORAGE_KV_Result r = checkKey (Key, &keyOctets);
+
+    if (r != STORAGE_KV_Result_Ok)
+    {
+        return r;
+    }
+
+    if (Octets > STORAGE_KV_VALUE_MAX_OCTETS)
+    {
+        return STORAGE_KV_Result_InvalidParam;
+    }
+
+    const uint32_t Hash = keyHash (Key, keyOctets);
+    const uint32_t RecordOctets = KV_RECORD_HEADER + keyOctets + Octets;
+    uint32_t slot;
+    bool found;
+
+    if ((r = findEntry (Key, keyOctets, Hash, &slot, &found))
+                                                    != STORAGE_KV_Result_Ok)
+    {
+        return r;
+    }
+
+    const struct KV_IndexEntry *e = &s_index[slot];
+    const bool Deleted = found && (e->flags & KV_ENTRY_DELETED);
+
+    if (RecordFlags & KV_RECORD_DELETED)
+    {
+        if (!found || Deleted)
+        {
+            return STORAGE_KV_Result_NotFound;
+        }
+    }
+    // A pending record of the same size is updated in RAM
+    else if (found && !Deleted && e->seq == s_kv.headSeq &&
+             e->valueOctets == Octets)
+    {
+        memcpy (&s_kv.page[e->offset + KV_RECORD_HEADER + keyOctets], Value,
+                Octets);
+
+        ++ s_kv.stats.absorbedWrites;
+        return STORAGE_KV_Result_Ok;
+    }
+
+    if (RecordOctets > KV_PAGE_PAYLOAD - s_kv.headOctets)
+    {
+        if ((r = commit ()) != STORAGE_KV_Result_Ok)
+        {
+            return r;
+        }
+
+        // Compaction moves index entries and drops deleted ones
+        if ((r = findEntry (Key, keyOctets, Hash, &slot, &found))
+                                                    != STORAGE_KV_Result_Ok)
+        {
+            return r;
+        }
+
+        e = &s_index[slot];
+    }
+
+    if (!found && s_kv.entries == STORAGE_KV_INDEX_ENTRIES - 1)
+    {
+        return STORAGE_KV_Result_Full;
+    }
+
+    if (s_kv.stats.liveOctets - (found? entryOctets(e) : 0) + RecordOctets >
+                                                            s_kv.capacity)
+    {
+        return STORAGE_KV_Result_Full;
+    }
+
+    const uint16_t Offset = appendRecord ((uint8_t)keyOctets, RecordFlags,
+                                          (uint16_t)Octets, Key, Value);
+
+    setEntry (slot, found, Hash, (uint8_t)keyOctets, RecordFlags,
+              (uint16_t)Octets, s_kv.headSeq, Offset);
+
+    return STORAGE_KV_Result_Ok;
+}
+
+
+/*
+    Updates or adds Key. The record is appended to the log on the next
+    STORAGE_KV_Commit(), after STORAGE_KV_COMMIT_TIMEOUT milliseconds or
+    when no more records fit in a log sector, whatever happens first.
+*/
+enum STORAGE_KV_Result STORAGE_KV_Set (const char *const Key,
+                                       const void *const Value,
+                                       const uint32_t Octets)
+{
+    BOARD_AssertParams (Value || !Octets);
+
+    return putRecord (Key, 0, Value, Octets);
+}
+
+
+enum STORAGE_KV_Result STORAGE_KV_Delete (const char *const Key)
+{
+    return putRecord (Key, KV_RECORD_DELETED, NULL, 0);
+}
+
+
+/*
+    Appends pending records to the log and flushes the persistent volume.
+    Records are on media when this function returns Ok.
+*/
+enum STORAGE_KV_Result STORAGE_KV_Commit (void)
+{
+    BOARD_AssertState (s_kv.mounted);
+
+    const enum STORAGE_KV_Result R = commit ();
+
+    if (R != STORAGE_KV_Result_Ok)
+    {
+        return R;
+    }
+
+    if (STORAGE_Sync (s_kv.retries) != RAWSTOR_Status_Result_Ok)
+    {
+        return STORAGE_KV_Result_MediaError;
+    }
+
+    s_kv.syncedTailSeq = s_kv.durableTailSeq;
+
+    return STORAGE_KV_Result_Ok;
+}
+
+
+/*
+    Background work called from BOARD_Sync(): commits pending records on
+    timeout and, once more than half of the log sectors are in use,
+    compacts one sector per call until a whole pass over the log is done.
+*/
+void STORAGE_KV_Update (void)
+{
+    if (!s_kv.mounted)
+    {
+        return;
+    }
+
+    if (s_kv.headOctets &&
+        TICKS_Now() - s_kv.firstPending >= STORAGE_KV_COMMIT_TIMEOUT)
+    {
+        if (commit () != STORAGE_KV_Result_Ok)
+        {
+            // Try again on the next timeout
+            s_kv.firstPending = TICKS_Now ();
+        }
+        return;
+    }
+
+    // Octets not taken by live records, reclaimable by compaction
+    const uint32_t Reclaimable = usedSectors() * KV_PAGE_PAYLOAD +
+                                 s_kv.headOctets - s_kv.stats.liveOctets;
+
+    if (!s_kv.compactLeft && usedSectors() * 2 > s_kv.sectors &&
+        Reclaimable >= KV_PAGE_PAYLOAD)
+    {
+        s_kv.compactLeft = usedSectors ();
+    }
+
+    if (s_kv.compactLeft && usedSectors())
+    {
+        -- s_kv.compactLeft;
+
+        if (compactTail () != STORAGE_KV_Result_Ok)
+        {
+            s_kv.compactLeft = 0;
+        }
+    }
+}
+
+
+struct STORAGE_KV_Stats STORAGE_KV_Stats (void)
+{
+    struct STORAGE_KV_Stats stats = s_kv.stats;
+
+    stats.capacityOctets    = s_kv.capacity;
+    stats.sectors           = s_kv.sectors;
+    stats.usedSectors       = usedSectors ();
+    stats.cycles            = s_kv.sectors? s_kv.headSeq / s_kv.sectors : 0;
+
+    return stats;
+}
+
+#endif
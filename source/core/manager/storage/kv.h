@@ -0,0 +1,105 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+
+  [STORAGE subsystem] log-structured key-value store on the persistent
+  linear volume.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "embedul.ar/source/core/manager/storage.h"
+
+
+// Keys held by the RAM hash index, including deleted keys not yet compacted.
+// Must be a power of two. Zero disables the key-value store.
+#define STORAGE_KV_INDEX_ENTRIES    LIB_EMBEDULAR_CONFIG_STORAGE_KV_INDEX_ENTRIES
+
+// Milliseconds a pending record may wait in RAM before STORAGE_KV_Update()
+// appends it to the log. With write-back enabled, the appended sector may then
+// wait STORAGE_WRITE_BACK_TIMEOUT more before reaching the media: up to 1.5 s
+// for 500 and 1000 ms. Call STORAGE_KV_Commit() to store records right away.
+#define STORAGE_KV_COMMIT_TIMEOUT   LIB_EMBEDULAR_CONFIG_STORAGE_KV_COMMIT_TIMEOUT
+
+
+#if STORAGE_KV_INDEX_ENTRIES & (STORAGE_KV_INDEX_ENTRIES - 1)
+    #error STORAGE_KV_INDEX_ENTRIES must be a power of two
+#endif
+
+
+// Longest key and value. A record (4 octets header, key and value) must fit
+// in the payload of a single log sector (24 octets header, CRC32 last).
+#define STORAGE_KV_KEY_MAX_OCTETS   64
+#define STORAGE_KV_VALUE_MAX_OCTETS (512 - 24 - 4 - 4 - \
+                                     STORAGE_KV_KEY_MAX_OCTETS)
+
+
+enum STORAGE_KV_Result
+{
+    STORAGE_KV_Result_Ok = 0,
+    STORAGE_KV_Result_NotFound,
+    STORAGE_KV_Result_InvalidParam,
+    // No room for the record, either in the log or in the RAM index
+    STORAGE_KV_Result_Full,
+    STORAGE_KV_Result_MediaError,
+    // The record lives in a sector that failed its checksum
+    STORAGE_KV_Result_Corrupted
+};
+
+
+struct STORAGE_KV_Stats
+{
+    uint32_t    keys;
+    // Octets taken by current records, including deleted key markers
+    uint32_t    liveOctets;
+    uint32_t    capacityOctets;
+    uint32_t    sectors;
+    uint32_t    usedSectors;
+    uint32_t    sectorWrites;
+    // Updates of a still pending record of the same size
+    uint32_t    absorbedWrites;
+    uint32_t    compactedSectors;
+    uint32_t    corruptedSectors;
+    // Sectors are written in order; each one once per cycle.
+    uint32_t    cycles;
+};
+
+
+enum STORAGE_KV_Result
+        STORAGE_KV_Mount        (const uint32_t LocalSector,
+                                 const uint32_t Sectors,
+                                 const uint32_t Retries);
+bool    STORAGE_KV_Mounted      (void);
+enum STORAGE_KV_Result
+        STORAGE_KV_Get          (const char *const Key, void *const Value,
+                                 const uint32_t Octets,
+                                 uint32_t *const ValueOctets);
+enum STORAGE_KV_Result
+        STORAGE_KV_Set          (const char *const Key,
+                                 const void *const Value,
+                                 const uint32_t Octets);
+enum STORAGE_KV_Result
+        STORAGE_KV_Delete       (const char *const Key);
+enum STORAGE_KV_Result
+        STORAGE_KV_Commit       (void);
+void    STORAGE_KV_Update       (void);
+struct STORAGE_KV_Stats
+        STORAGE_KV_Stats        (void);
@@ -0,0 +1,38 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+  
+  CRC-32C (Castagnoli) checksum.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+// CRC-32C (Castagnoli) polynomial, in reversed bit order.
+#define CRC32C_POLY                 0x82f63b78
+
+
+uint32_t        CRC32C_Update           (uint32_t Crc, const void *const Data,
+                                         const size_t Octets);
+const char *    CRC32C_Implementation   (void);
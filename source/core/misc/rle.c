@@ -0,0 +1,210 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+  
+  byte oriented run-length encoding, tuned for rgb332 images.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "embedul.ar/source/core/misc/rle.h"
+#include <stdbool.h>
+#include <string.h>
+
+
+static uint32_t flushLiterals (const uint8_t *literals, uint32_t count,
+                               uint8_t *encoded)
+{
+    uint32_t o = 0;
+
+    while (count)
+    {
+        const uint32_t N = (count > RLE_LITERAL_MAX)? RLE_LITERAL_MAX : count;
+
+        encoded[o ++] = (uint8_t)(N - 1);
+        memcpy (&encoded[o], literals, N);
+
+        o           += N;
+        literals    += N;
+        count       -= N;
+    }
+
+    return o;
+}
+
+
+// Encodes Octets from Data into Encoded, which must have room for at least
+// RLE_ENCODE_BOUND(Octets) octets. Returns the encoded size. Each call
+// produces a self-contained stream; consecutive calls can be concatenated.
+uint32_t RLE_Encode (const uint8_t *const Data, const uint32_t Octets,
+                     uint8_t *const Encoded)
+{
+    uint32_t i          = 0;
+    uint32_t o          = 0;
+    uint32_t literals   = 0;
+
+    while (i < Octets)
+    {
+        const uint8_t V = Data[i];
+        uint32_t run = 1;
+
+        while (i + run < Octets && run < RLE_RUN_MAX && Data[i + run] == V)
+        {
+            ++ run;
+        }
+
+        if (run < RLE_RUN_MIN)
+        {
+            // Too short, keep it along with the current literals.
+            literals    += run;
+            i           += run;
+            continue;
+        }
+
+        o += flushLiterals (&Data[i - literals], literals, &Encoded[o]);
+        literals = 0;
+
+        Encoded[o ++] = (uint8_t)(0x80 + run - RLE_RUN_MIN);
+        Encoded[o ++] = V;
+
+        i += run;
+    }
+
+    o += flushLiterals (&Data[i - literals], literals, &Encoded[o]);
+
+    return o;
+}
+
+
+void RLE_DecoderInit (struct RLE_Decoder *const D)
+{
+    D->stage    = RLE_DecoderStage_Control;
+    D->left     = 0;
+    D->value    = 0;
+}
+
+
+// Decodes up to Octets into Data from EncodedOctets of Encoded. Stops when
+// either the encoded input is exhausted or the output is full. Decoding
+// continues on the next call from where it stopped.
+struct RLE_DecodeResult RLE_Decode (struct RLE_Decoder *const D,
+                                    const uint8_t *const Encoded,
+                                    const uint32_t EncodedOctets,
+                                    uint8_t *const Data,
+                                    const uint32_t Octets)
+{
+    struct RLE_DecodeResult res;
+    res.in  = 0;
+    res.out = 0;
+
+    bool starved = false;
+
+    while (!starved && res.out < Octets)
+    {
+        switch (D->stage)
+        {
+            case RLE_DecoderStage_Control:
+            {
+                if (res.in == EncodedOctets)
+                {
+                    starved = true;
+                    break;
+                }
+
+                const uint8_t C = Encoded[res.in ++];
+
+                if (C & 0x80)
+                {
+                    D->left     = (uint32_t)(C & 0x7F) + RLE_RUN_MIN;
+                    D->stage    = RLE_DecoderStage_RunValue;
+                }
+                else
+                {
+                    D->left     = (uint32_t)C + 1;
+                    D->stage    = RLE_DecoderStage_Literal;
+                }
+                break;
+            }
+
+            case RLE_DecoderStage_RunValue:
+                if (res.in == EncodedOctets)
+                {
+                    starved = true;
+                    break;
+                }
+
+                D->value    = Encoded[res.in ++];
+                D->stage    = RLE_DecoderStage_Run;
+                break;
+
+            case RLE_DecoderStage_Run:
+            {
+                uint32_t n = Octets - res.out;
+                if (n > D->left)
+                {
+                    n = D->left;
+                }
+
+                memset (&Data[res.out], D->value, n);
+
+                res.out += n;
+                D->left -= n;
+
+                if (!D->left)
+                {
+                    D->stage = RLE_DecoderStage_Control;
+                }
+                break;
+            }
+
+            case RLE_DecoderStage_Literal:
+            {
+                uint32_t n = Octets - res.out;
+                if (n > D->left)
+                {
+                    n = D->left;
+                }
+                if (n > EncodedOctets - res.in)
+                {
+                    n = EncodedOctets - res.in;
+                }
+
+                if (!n)
+                {
+                    starved = true;
+                    break;
+                }
+
+                memcpy (&Data[res.out], &Encoded[res.in], n);
+
+                res.in  += n;
+                res.out += n;
+                D->left -= n;
+
+                if (!D->left)
+                {
+                    D->stage = RLE_DecoderStage_Control;
+                }
+                break;
+            }
+        }
+    }
+
+    return res;
+}
@@ -0,0 +1,82 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+  
+  byte oriented run-length encoding, tuned for rgb332 images.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/*
+    Encoded stream format. A control octet C is followed by:
+    C = 0x00..0x7F: C + 1 literal octets (1 to 128).
+    C = 0x80..0xFF: a single octet repeated C - 0x80 + 3 times (3 to 130).
+*/
+#define RLE_LITERAL_MAX             128
+#define RLE_RUN_MIN                 3
+#define RLE_RUN_MAX                 130
+
+// Worst case encoded size of _octets input octets.
+#define RLE_ENCODE_BOUND(_octets) \
+    ((_octets) + ((_octets) + RLE_LITERAL_MAX - 1) / RLE_LITERAL_MAX)
+
+
+enum RLE_DecoderStage
+{
+    RLE_DecoderStage_Control = 0,
+    RLE_DecoderStage_RunValue,
+    RLE_DecoderStage_Run,
+    RLE_DecoderStage_Literal
+};
+
+
+// Streaming decoder state. Encoded data can be fed in blocks of any size.
+struct RLE_Decoder
+{
+    enum RLE_DecoderStage   stage;
+    uint32_t                left;
+    uint8_t                 value;
+};
+
+
+struct RLE_DecodeResult
+{
+    // Encoded octets consumed
+    uint32_t    in;
+    // Decoded octets produced
+    uint32_t    out;
+};
+
+
+uint32_t    RLE_Encode              (const uint8_t *const Data,
+                                     const uint32_t Octets,
+                                     uint8_t *const Encoded);
+void        RLE_DecoderInit         (struct RLE_Decoder *const D);
+struct RLE_DecodeResult
+            RLE_Decode              (struct RLE_Decoder *const D,
+                                     const uint8_t *const Encoded,
+                                     const uint32_t EncodedOctets,
+                                     uint8_t *const Data,
+                                     const uint32_t Octets);
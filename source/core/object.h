@@ -60,9 +60,11 @@
         struct SEQUENCE *       : 1, \
         struct VARIANT *        : 1, \
         struct INPUT_ACTION *   : 1, \
+        struct SCREEN_DLIST *   : 1, \
         struct SCREEN_DOTMAP *  : 1, \
         struct SCREEN_FADE *    : 1, \
         struct SCREEN_FONT *    : 1, \
+        struct SCREEN_FONT_RUN *: 1, \
         struct RGB332_Gradient *: 1, \
         struct SCREEN_SPRITE *  : 1, \
         struct SCREEN_TILEMAP * : 1, \
@@ -111,9 +113,11 @@
         struct SEQUENCE *       : "base", \
         struct VARIANT *        : "base", \
         struct INPUT_ACTION *   : "base", \
+        struct SCREEN_DLIST *   : "base" OBJECT_TYPE_SEPARATOR "screen", \
         struct SCREEN_DOTMAP *  : "base" OBJECT_TYPE_SEPARATOR "screen", \
         struct SCREEN_FADE *    : "base" OBJECT_TYPE_SEPARATOR "screen", \
         struct SCREEN_FONT *    : "base" OBJECT_TYPE_SEPARATOR "screen", \
+        struct SCREEN_FONT_RUN *: "base" OBJECT_TYPE_SEPARATOR "screen", \
         struct RGB332_Gradient *: "base" OBJECT_TYPE_SEPARATOR "screen", \
         struct SCREEN_SPRITE *  : "base" OBJECT_TYPE_SEPARATOR "screen", \
         struct SCREEN_TILEMAP * : "base" OBJECT_TYPE_SEPARATOR "screen", \
@@ -153,9 +157,11 @@
         struct SEQUENCE *       : "sequence", \
         struct VARIANT *        : "variant", \
         struct INPUT_ACTION *   : "input action", \
+        struct SCREEN_DLIST *   : "display list", \
         struct SCREEN_DOTMAP *  : "dotmap", \
         struct SCREEN_FADE *    : "fade", \
         struct SCREEN_FONT *    : "font", \
+        struct SCREEN_FONT_RUN *: "text run cache", \
         struct RGB332_Gradient *: "rgb332 gradient", \
         struct SCREEN_SPRITE *  : "sprite", \
         struct SCREEN_TILEMAP * : "tilemap", \
@@ -195,9 +201,11 @@
         struct SEQUENCE *       : _p, \
         struct VARIANT *        : _p, \
         struct INPUT_ACTION *   : _p, \
+        struct SCREEN_DLIST *   : _p, \
         struct SCREEN_DOTMAP *  : _p, \
         struct SCREEN_FADE *    : _p, \
         struct SCREEN_FONT *    : _p, \
+        struct SCREEN_FONT_RUN *: _p, \
         struct RGB332_Gradient *: _p, \
         struct SCREEN_SPRITE *  : _p, \
         struct SCREEN_TILEMAP * : _p, \
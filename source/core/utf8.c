@@ -25,6 +25,11 @@
 
 #include "embedul.ar/source/core/utf8.h"
 #include "embedul.ar/source/core/device/board.h"
+#include <string.h>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
 
 
 #define BEGIN_2B_MARK           0xC0            // 0b11000000
@@ -38,6 +43,9 @@
 #define PAYLOAD_DATA_MASK       0x3F            // 0b00111111
 
 
+#define ASCII_WORD_MASK         0x80808080u
+
+
 const struct UTF8_CodePointRange UTF8_LatinPrintableAlnum[7] =
 {
     // Basic Latin
@@ -60,6 +68,75 @@ const struct UTF8_CodePointRange UTF8_Decimal[1] =
 };
 
 
+// Returns the number of consecutive 7-bit ASCII octets at the start of Data.
+// Text is mostly ASCII, so runs are skipped 16 octets at a time with SSE2 or
+// 8 octets at a time using 32-bit words elsewhere (Cortex-M included).
+static size_t asciiRun (const uint8_t *const Data, const size_t Octets)
+{
+    size_t i = 0;
+
+#ifdef __SSE2__
+    for (; i + 16 <= Octets; i += 16)
+    {
+        const __m128i V = _mm_loadu_si128 ((const __m128i *)&Data[i]);
+        const uint32_t NonAscii = (uint32_t) _mm_movemask_epi8 (V);
+
+        if (NonAscii)
+        {
+            return i + (size_t)__builtin_ctz (NonAscii);
+        }
+    }
+#else
+    for (; i + 8 <= Octets; i += 8)
+    {
+        uint32_t w0, w1;
+        // memcpy compiles to plain word loads where unaligned access is
+        // supported and to a safe sequence where it is not.
+        memcpy (&w0, &Data[i], sizeof(w0));
+        memcpy (&w1, &Data[i + 4], sizeof(w1));
+
+        if ((w0 | w1) & ASCII_WORD_MASK)
+        {
+            break;
+        }
+    }
+#endif
+
+    while (i < Octets && Data[i] < 128)
+    {
+        ++ i;
+    }
+
+    return i;
+}
+
+
+// Widens a run of ASCII octets to code points.
+static void asciiToCodePoints (uint16_t *const CodePoints,
+                               const uint8_t *const Data, const uint32_t Count)
+{
+    uint32_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i Zero = _mm_setzero_si128 ();
+
+    for (; i + 16 <= Count; i += 16)
+    {
+        const __m128i V = _mm_loadu_si128 ((const __m128i *)&Data[i]);
+        _mm_storeu_si128 ((__m128i *)&CodePoints[i],
+                          _mm_unpacklo_epi8 (V, Zero));
+        _mm_storeu_si128 ((__m128i *)&CodePoints[i + 8],
+                          _mm_unpackhi_epi8 (V, Zero));
+    }
+#endif
+
+    for (; i < Count; ++i)
+    {
+        CodePoints[i] = Data[i];
+    }
+}
+
+
 /**
  * Encodes a UTF-8 character. This function
  * will only encode a variable-width character up to three octets in
@@ -192,10 +269,24 @@ struct UTF8_CheckResult UTF8_Check (const uint8_t *const Data,
     res.invalidOctets   = 0;
     res.rangePassed     = true;
 
-    uint32_t i = 0;
+    size_t i = 0;
 
     while (i < Octets)
     {
+        // ASCII runs need no decoding unless they are subject to range checks
+        if (!Ranges || !res.rangePassed)
+        {
+            const size_t Run = asciiRun (&Data[i], Octets - i);
+
+            res.validChars += (uint32_t) Run;
+            i += Run;
+
+            if (i == Octets)
+            {
+                break;
+            }
+        }
+
         const uint8_t * d       = &Data[i];
         const uint32_t  Size    = Octets - i;
 
@@ -204,7 +295,10 @@ struct UTF8_CheckResult UTF8_Check (const uint8_t *const Data,
         // or malformed UTF-8 stream.
         if (!CPR.dataLength)
         {
-            const uint32_t SyncOffset = UTF8_ReSync (d, Size);
+            // An invalid lead octet is itself a sequence start; skip at least
+            // that octet to keep going forward.
+            const uint32_t ReSync       = UTF8_ReSync (d, Size);
+            const uint32_t SyncOffset   = ReSync? ReSync : 1;
             res.invalidOctets += SyncOffset;
 
             BOARD_AssertState (res.invalidOctets <= Octets);
@@ -258,8 +352,104 @@ struct UTF8_CheckResult UTF8_Check (const uint8_t *const Data,
  */
 uint32_t UTF8_Count (const uint8_t *const Data, const size_t Octets)
 {
-    struct UTF8_CheckResult r = UTF8_Check (Data, Octets, NULL, 0);
-    return r.validChars + r.invalidOctets;
+    BOARD_AssertParams (Data);
+
+    uint32_t count = 0;
+    size_t i = 0;
+
+    while (i < Octets)
+    {
+        const size_t Run = asciiRun (&Data[i], Octets - i);
+
+        count += (uint32_t) Run;
+        i += Run;
+
+        if (i == Octets)
+        {
+            break;
+        }
+
+        const struct UTF8_GetCodePointResult CPR =
+                            UTF8_GetCodePoint (&Data[i], (uint32_t)(Octets - i));
+
+        // Each invalid octet counts as one (replacement) character.
+        i += CPR.dataLength? CPR.dataLength : 1;
+        ++ count;
+    }
+
+    return count;
+}
+
+
+/**
+ * Decodes a UTF-8 encoded stream into a buffer of
+ * **Basic Multilingual Plane** code points in a single pass. Each invalid
+ * octet decodes to ``Replacement``, so the number of code points obtained
+ * from a whole stream is the same as the one returned by :c:func:`UTF8_Count`.
+ * Decoding stops when ``CodePoints`` is full; the caller may then continue
+ * from the returned :c:member:`UTF8_DecodeResult.octets` offset.
+ *
+ * :param Data: An array of :c:type:`uint8_t` elements containing UTF-8
+ *              encoded characters.
+ * :param Octets: Element count in ``data``.
+ * :param CodePoints: An array of :c:type:`uint16_t` to store decoded code
+ *                    points.
+ * :param MaxCodePoints: Element count in ``CodePoints``.
+ * :param Replacement: Code point to store in place of each invalid octet.
+ * :return: :c:struct:`UTF8_DecodeResult` with results.
+ */
+struct UTF8_DecodeResult UTF8_Decode (const uint8_t *const Data,
+                                      const uint32_t Octets,
+                                      uint16_t *const CodePoints,
+                                      const uint32_t MaxCodePoints,
+                                      const uint16_t Replacement)
+{
+    BOARD_AssertParams (Data && CodePoints && MaxCodePoints);
+
+    struct UTF8_DecodeResult res;
+    res.codepoints      = 0;
+    res.octets          = 0;
+    res.invalidOctets   = 0;
+
+    while (res.octets < Octets && res.codepoints < MaxCodePoints)
+    {
+        const uint8_t *const D      = &Data[res.octets];
+        const uint32_t       Size   = Octets - res.octets;
+
+        if (D[0] < 128)
+        {
+            uint32_t run = (uint32_t) asciiRun (D, Size);
+
+            if (run > MaxCodePoints - res.codepoints)
+            {
+                run = MaxCodePoints - res.codepoints;
+            }
+
+            asciiToCodePoints (&CodePoints[res.codepoints], D, run);
+
+            res.codepoints  += run;
+            res.octets      += run;
+            continue;
+        }
+
+        const struct UTF8_GetCodePointResult CPR = UTF8_GetCodePoint (D, Size);
+
+        if (CPR.dataLength)
+        {
+            CodePoints[res.codepoints] = CPR.codepoint;
+            res.octets += CPR.dataLength;
+        }
+        else
+        {
+            CodePoints[res.codepoints] = Replacement;
+            ++ res.invalidOctets;
+            ++ res.octets;
+        }
+
+        ++ res.codepoints;
+    }
+
+    return res;
 }
 
 
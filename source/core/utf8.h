@@ -83,6 +83,7 @@
  *
  * | :c:func:`UTF8_SetCodePoint`
  * | :c:func:`UTF8_GetCodePoint`
+ * | :c:func:`UTF8_Decode`
  *
  * Handling UTF-8 encoded buffer data 
  * ----------------------------------
@@ -112,6 +113,8 @@
  * Version Date*      Author              Comment
  * ======= ========== =================== ======================================
  * 1.0.0   2022.9.7   sgermino            Initial release.
+ * 1.1.0   2026.10.19 sgermino            Word-at-a-time ASCII fast paths,
+ *                                        :c:func:`UTF8_Decode`.
  * ======= ========== =================== ======================================
  *
  * \* Date format is Year.Month.Day.
@@ -170,6 +173,26 @@ struct UTF8_CheckResult
 };
 
 
+/**
+ * Information returned by :c:func:`UTF8_Decode`.
+ */
+struct UTF8_DecodeResult
+{
+    /**
+     * Number of code points stored, including replacements for invalid octets.
+     */
+    uint32_t    codepoints;
+    /**
+     * Number of data octets consumed.
+     */
+    uint32_t    octets;
+    /**
+     * Number of invalid octets in the variable-width encoding.
+     */
+    uint32_t    invalidOctets;
+};
+
+
 extern const struct UTF8_CodePointRange UTF8_LatinPrintableAlnum[7];
 extern const struct UTF8_CodePointRange UTF8_Decimal[1];
 
@@ -188,6 +211,12 @@ struct UTF8_CheckResult
                                          const uint32_t RangeCount);
 uint32_t        UTF8_Count              (const uint8_t *const Data,
                                          const size_t Octets);
+struct UTF8_DecodeResult
+                UTF8_Decode             (const uint8_t *const Data,
+                                         const uint32_t Octets,
+                                         uint16_t *const CodePoints,
+                                         const uint32_t MaxCodePoints,
+                                         const uint16_t Replacement);
 uint32_t        UTF8_ReSync             (const uint8_t *const Data,
                                          const uint32_t Octets);
 uint32_t        UTF8_RemoveChars        (struct ARRAY *const A,
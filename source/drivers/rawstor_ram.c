@@ -0,0 +1,400 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+  
+  [RAWSTOR driver] ram disk with media timing and fault injection.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "embedul.ar/source/drivers/rawstor_ram.h"
+#include "embedul.ar/source/core/device/board.h"
+#include <string.h>
+
+
+// Common IO interface
+static RAWSTOR_Status_Result    mediaInit       (struct RAWSTOR *const R);
+static RAWSTOR_Status_Result    mediaRead       (struct RAWSTOR *const R,
+                                                 uint8_t *const Data,
+                                                 const uint32_t SectorBegin,
+                                                 const uint32_t SectorCount);
+static RAWSTOR_Status_Result    mediaWrite      (struct RAWSTOR *const R,
+                                                 const uint8_t *const Data,
+                                                 const uint32_t SectorBegin,
+                                                 const uint32_t SectorCount);
+static RAWSTOR_Status_Result    mediaIoctl      (struct RAWSTOR *const R,
+                                                 const uint8_t Cmd,
+                                                 void *const Data);
+
+
+static const struct RAWSTOR_IFACE RAWSTOR_RAM_IFACE =
+{
+    .Description    = "ram disk",
+    .MediaInit      = mediaInit,
+    .MediaRead      = mediaRead,
+    .MediaWrite     = mediaWrite,
+    .MediaIoctl     = mediaIoctl
+};
+
+
+// Timing NULL: no emulated delays.
+void RAWSTOR_RAM_Init (struct RAWSTOR_RAM *const R, uint8_t *const Data,
+                       const uint32_t SectorCount,
+                       const struct RAWSTOR_RAM_Timing *const Timing)
+{
+    BOARD_AssertParams (R && Data && SectorCount);
+
+    DEVICE_IMPLEMENTATION_Clear (R);
+
+    R->data         = Data;
+    R->sectorCount  = SectorCount;
+    R->randomState  = 0x2545F491;
+
+    RAWSTOR_RAM_SetTiming (R, Timing);
+
+    RAWSTOR_Init ((struct RAWSTOR *)R, &RAWSTOR_RAM_IFACE);
+}
+
+
+void RAWSTOR_RAM_SetTiming (struct RAWSTOR_RAM *const R,
+                            const struct RAWSTOR_RAM_Timing *const Timing)
+{
+    BOARD_AssertParams (R);
+
+    if (Timing)
+    {
+        R->timing = *Timing;
+    }
+    else
+    {
+        R->timing = (struct RAWSTOR_RAM_Timing) { 0 };
+    }
+}
+
+
+// Rule NULL: the fault is no longer injected.
+void RAWSTOR_RAM_SetFault (struct RAWSTOR_RAM *const R,
+                           const enum RAWSTOR_RAM_Fault Fault,
+                           const struct RAWSTOR_RAM_FaultRule *const Rule)
+{
+    BOARD_AssertParams (R && Fault < RAWSTOR_RAM_Fault__COUNT);
+
+    if (Rule)
+    {
+        R->fault[Fault] = *Rule;
+    }
+    else
+    {
+        R->fault[Fault] = (struct RAWSTOR_RAM_FaultRule) { 0 };
+    }
+}
+
+
+void RAWSTOR_RAM_SetBadSectors (struct RAWSTOR_RAM *const R,
+                                const uint32_t SectorBegin,
+                                const uint32_t SectorCount)
+{
+    BOARD_AssertParams (R);
+
+    R->badSectorBegin = SectorBegin;
+    R->badSectorCount = SectorCount;
+}
+
+
+void RAWSTOR_RAM_SetWriteProtected (struct RAWSTOR_RAM *const R,
+                                    const bool WriteProtected)
+{
+    BOARD_AssertParams (R);
+
+    R->writeProtected = WriteProtected;
+
+    if (WriteProtected)
+    {
+        R->device.status.disk |= RAWSTOR_Status_Disk_WriteProtected;
+    }
+    else
+    {
+        R->device.status.disk &= ~RAWSTOR_Status_Disk_WriteProtected;
+    }
+}
+
+
+struct RAWSTOR_RAM_Stats RAWSTOR_RAM_Stats (struct RAWSTOR_RAM *const R)
+{
+    BOARD_AssertParams (R);
+    return R->stats;
+}
+
+
+static RAWSTOR_Status_Result mediaInit (struct RAWSTOR *const R)
+{
+    struct RAWSTOR_RAM *const M = (struct RAWSTOR_RAM *) R;
+
+    R->status.disk &= ~RAWSTOR_Status_Disk_NotPresent;
+    R->status.disk &= ~RAWSTOR_Status_Disk_NotInitialized;
+
+    RAWSTOR_UpdateStatusMedia (R, RAWSTOR_Status_Media_Ready, 0, 0);
+    RAWSTOR_UpdateStatusResult (R, RAWSTOR_Status_Result_Ok);
+
+    LOG_Items (3,
+            LANG_SECTORS,   M->sectorCount,
+            LANG_READ,      M->timing.readOctetsPerSecond,
+            LANG_WRITE,     M->timing.writeOctetsPerSecond);
+
+    return RAWSTOR_Status_Result_Ok;
+}
+
+
+// Xorshift32. Same fault sequence on each run.
+static uint32_t nextRandom (struct RAWSTOR_RAM *const M)
+{
+    uint32_t x = M->randomState;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    M->randomState = x;
+    return x;
+}
+
+
+static bool injectFault (struct RAWSTOR_RAM *const M,
+                         const enum RAWSTOR_RAM_Fault Fault)
+{
+    struct RAWSTOR_RAM_FaultRule *const Rule = &M->fault[Fault];
+    bool fail = false;
+
+    if (Rule->skip)
+    {
+        -- Rule->skip;
+    }
+    else if (Rule->count)
+    {
+        if (Rule->count != RAWSTOR_RAM_FAULT_FOREVER)
+        {
+            -- Rule->count;
+        }
+
+        fail = true;
+    }
+
+    if (!fail && Rule->oneIn && !(nextRandom(M) % Rule->oneIn))
+    {
+        fail = true;
+    }
+
+    if (fail)
+    {
+        ++ M->stats.faults[Fault];
+    }
+
+    return fail;
+}
+
+
+static void mediaDelay (struct RAWSTOR_RAM *const M, const uint64_t Us)
+{
+    M->stats.mediaUs += Us;
+
+    const uint64_t PendingUs = M->pendingUs + Us;
+
+    if (PendingUs >= 1000)
+    {
+        TICKS_Delay ((TIMER_Ticks)(PendingUs / 1000));
+    }
+
+    M->pendingUs = (uint32_t)(PendingUs % 1000);
+}
+
+
+static uint64_t transferUs (const uint32_t Sectors, const uint32_t SectorUs,
+                            const uint32_t OctetsPerSecond)
+{
+    uint64_t us = (uint64_t)Sectors * SectorUs;
+
+    if (OctetsPerSecond)
+    {
+        us += (uint64_t)Sectors * RAWSTOR_SECTOR_SIZE * 1000000 /
+                                                        OctetsPerSecond;
+    }
+
+    return us;
+}
+
+
+// Sectors before the first bad sector in the request, or Count if none.
+static uint32_t goodSectors (struct RAWSTOR_RAM *const M,
+                             const uint32_t Sector, const uint32_t Count)
+{
+    const uint32_t BadBegin = M->badSectorBegin;
+    const uint32_t BadEnd   = M->badSectorBegin + M->badSectorCount;
+
+    if (!M->badSectorCount || Sector >= BadEnd || Sector + Count <= BadBegin)
+    {
+        return Count;
+    }
+
+    return (Sector < BadBegin)? BadBegin - Sector : 0;
+}
+
+
+static RAWSTOR_Status_Result mediaRead (struct RAWSTOR *const R,
+                                        uint8_t *const Data,
+                                        const uint32_t Sector,
+                                        const uint32_t Count)
+{
+    struct RAWSTOR_RAM *const M = (struct RAWSTOR_RAM *) R;
+
+    if (Sector > M->sectorCount || Count > M->sectorCount - Sector)
+    {
+        return RAWSTOR_Status_Result_InvalidParam;
+    }
+
+    ++ M->stats.reads;
+
+    mediaDelay (M, M->timing.requestUs);
+
+    if (injectFault (M, RAWSTOR_RAM_Fault_Timeout))
+    {
+        mediaDelay (M, M->timing.timeoutUs);
+        return RAWSTOR_Status_Result_Timeout;
+    }
+
+    const uint32_t Good = goodSectors (M, Sector, Count);
+
+    memcpy (Data, &M->data[(size_t)Sector * RAWSTOR_SECTOR_SIZE],
+            (size_t)Good * RAWSTOR_SECTOR_SIZE);
+
+    M->stats.sectorsRead += Good;
+
+    mediaDelay (M, transferUs (Good, M->timing.readSectorUs,
+                               M->timing.readOctetsPerSecond));
+
+    if (Good < Count || injectFault (M, RAWSTOR_RAM_Fault_ReadError))
+    {
+        return RAWSTOR_Status_Result_ReadWriteError;
+    }
+
+    return RAWSTOR_Status_Result_Ok;
+}
+
+
+static RAWSTOR_Status_Result mediaWrite (struct RAWSTOR *const R,
+                                         const uint8_t *const Data,
+                                         const uint32_t Sector,
+                                         const uint32_t Count)
+{
+    struct RAWSTOR_RAM *const M = (struct RAWSTOR_RAM *) R;
+
+    if (Sector > M->sectorCount || Count > M->sectorCount - Sector)
+    {
+        return RAWSTOR_Status_Result_InvalidParam;
+    }
+
+    if (M->writeProtected)
+    {
+        return RAWSTOR_Status_Result_WriteProtected;
+    }
+
+    ++ M->stats.writes;
+
+    mediaDelay (M, M->timing.requestUs);
+
+    if (injectFault (M, RAWSTOR_RAM_Fault_Timeout))
+    {
+        mediaDelay (M, M->timing.timeoutUs);
+        return RAWSTOR_Status_Result_Timeout;
+    }
+
+    uint32_t good = goodSectors (M, Sector, Count);
+    const bool Fail = (good < Count ||
+                       injectFault (M, RAWSTOR_RAM_Fault_WriteError));
+
+    // A failed multi-sector write leaves the media partially written
+    if (Fail && good == Count)
+    {
+        good = Count / 2;
+    }
+
+    memcpy (&M->data[(size_t)Sector * RAWSTOR_SECTOR_SIZE], Data,
+            (size_t)good * RAWSTOR_SECTOR_SIZE);
+
+    M->stats.sectorsWritten += good;
+
+    mediaDelay (M, transferUs (good, M->timing.writeSectorUs,
+                               M->timing.writeOctetsPerSecond));
+
+    return Fail? RAWSTOR_Status_Result_ReadWriteError :
+                 RAWSTOR_Status_Result_Ok;
+}
+
+
+static RAWSTOR_Status_Result mediaIoctl (struct RAWSTOR *const R,
+                                         const uint8_t Cmd,
+                                         void *const Data)
+{
+    struct RAWSTOR_RAM *const M = (struct RAWSTOR_RAM *) R;
+
+    if (R->status.disk & RAWSTOR_Status_Disk_NotInitialized)
+    {
+        return RAWSTOR_Status_Result_NotReady;
+    }
+
+    switch (Cmd)
+    {
+        // Writes complete before returning
+        case RAWSTOR_IOCTL_CMD_SYNC:
+            break;
+
+        case RAWSTOR_IOCTL_CMD_GET_SECTOR_COUNT:
+            *(uint32_t *) Data = M->sectorCount;
+            break;
+
+        case RAWSTOR_IOCTL_CMD_GET_SECTOR_SIZE:
+            *(uint16_t *) Data = RAWSTOR_SECTOR_SIZE;
+            break;
+
+        case RAWSTOR_IOCTL_CMD_GET_ERASE_BLOCK_SIZE:
+            *(uint32_t *) Data = 1;
+            break;
+
+        // Data points to the first and last sectors to erase (uint32_t[2])
+        case RAWSTOR_IOCTL_CMD_TRIM:
+        {
+            const uint32_t *const Range = (const uint32_t *) Data;
+
+            if (Range[0] > Range[1] || Range[1] >= M->sectorCount)
+            {
+                return RAWSTOR_Status_Result_InvalidParam;
+            }
+
+            memset (&M->data[(size_t)Range[0] * RAWSTOR_SECTOR_SIZE], 0xFF,
+                    (size_t)(Range[1] - Range[0] + 1) * RAWSTOR_SECTOR_SIZE);
+            break;
+        }
+
+        default:
+            BOARD_AssertUnexpectedValue (R, Cmd);
+            break;
+    }
+
+    return RAWSTOR_Status_Result_Ok;
+}
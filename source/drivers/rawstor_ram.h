@@ -0,0 +1,138 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+  
+  [RAWSTOR driver] ram disk with media timing and fault injection.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#pragma once
+
+#include "embedul.ar/source/core/device/rawstor.h"
+
+
+// Media timing of a SD card on a 25 MHz SPI bus, written one block at a time.
+#define RAWSTOR_RAM_TIMING_SD_SPI       { .requestUs            = 400, \
+                                          .readSectorUs         = 0, \
+                                          .writeSectorUs        = 250, \
+                                          .readOctetsPerSecond  = 1500000, \
+                                          .writeOctetsPerSecond = 600000, \
+                                          .timeoutUs            = 250000 }
+
+// Media timing of a class 10 SD card on a 4-bit SD bus.
+#define RAWSTOR_RAM_TIMING_SD_4BIT      { .requestUs            = 150, \
+                                          .readSectorUs         = 0, \
+                                          .writeSectorUs        = 60, \
+                                          .readOctetsPerSecond  = 20000000, \
+                                          .writeOctetsPerSecond = 10000000, \
+                                          .timeoutUs            = 250000 }
+
+// Fault rule count that never runs out.
+#define RAWSTOR_RAM_FAULT_FOREVER       ((uint32_t)-1)
+
+
+// Emulated time is waited by TICKS_Delay() in whole milliseconds. Shorter
+// waits accumulate until they add up to one.
+struct RAWSTOR_RAM_Timing
+{
+    // Command, access and response time of each request
+    uint32_t    requestUs;
+    // Added for each sector. Writes include the programming time.
+    uint32_t    readSectorUs;
+    uint32_t    writeSectorUs;
+    // Bus transfer rate. Zero is unlimited.
+    uint32_t    readOctetsPerSecond;
+    uint32_t    writeOctetsPerSecond;
+    // Time taken by a request that fails with a timeout
+    uint32_t    timeoutUs;
+};
+
+
+enum RAWSTOR_RAM_Fault
+{
+    // Read requests fail with RAWSTOR_Status_Result_ReadWriteError
+    RAWSTOR_RAM_Fault_ReadError = 0,
+    // Write requests fail with RAWSTOR_Status_Result_ReadWriteError after
+    // writing the first half of their sectors.
+    RAWSTOR_RAM_Fault_WriteError,
+    // Read and write requests fail with RAWSTOR_Status_Result_Timeout
+    RAWSTOR_RAM_Fault_Timeout,
+    RAWSTOR_RAM_Fault__COUNT
+};
+
+
+struct RAWSTOR_RAM_FaultRule
+{
+    // Requests let through before failing
+    uint32_t    skip;
+    // Requests failed after skip
+    uint32_t    count;
+    // Also fail one in this many requests at random. Zero disables.
+    uint32_t    oneIn;
+};
+
+
+struct RAWSTOR_RAM_Stats
+{
+    uint32_t    reads;
+    uint32_t    writes;
+    uint32_t    sectorsRead;
+    uint32_t    sectorsWritten;
+    uint32_t    faults[RAWSTOR_RAM_Fault__COUNT];
+    // Total emulated media time
+    uint64_t    mediaUs;
+};
+
+
+struct RAWSTOR_RAM
+{
+    struct RAWSTOR                  device;
+    uint8_t                         * data;
+    uint32_t                        sectorCount;
+    struct RAWSTOR_RAM_Timing       timing;
+    struct RAWSTOR_RAM_FaultRule    fault[RAWSTOR_RAM_Fault__COUNT];
+    // Sectors that fail on every access
+    uint32_t                        badSectorBegin;
+    uint32_t                        badSectorCount;
+    bool                            writeProtected;
+    // Emulated time still to wait, less than a millisecond
+    uint32_t                        pendingUs;
+    uint32_t                        randomState;
+    struct RAWSTOR_RAM_Stats        stats;
+};
+
+
+void    RAWSTOR_RAM_Init                (struct RAWSTOR_RAM *const R,
+                                         uint8_t *const Data,
+                                         const uint32_t SectorCount,
+                        const struct RAWSTOR_RAM_Timing *const Timing);
+void    RAWSTOR_RAM_SetTiming           (struct RAWSTOR_RAM *const R,
+                        const struct RAWSTOR_RAM_Timing *const Timing);
+void    RAWSTOR_RAM_SetFault            (struct RAWSTOR_RAM *const R,
+                                         const enum RAWSTOR_RAM_Fault Fault,
+                        const struct RAWSTOR_RAM_FaultRule *const Rule);
+void    RAWSTOR_RAM_SetBadSectors       (struct RAWSTOR_RAM *const R,
+                                         const uint32_t SectorBegin,
+                                         const uint32_t SectorCount);
+void    RAWSTOR_RAM_SetWriteProtected   (struct RAWSTOR_RAM *const R,
+                                         const bool WriteProtected);
+struct RAWSTOR_RAM_Stats
+        RAWSTOR_RAM_Stats               (struct RAWSTOR_RAM *const R);
@@ -42,6 +42,20 @@
 #define WAIT_READY_XMIT_TIMEOUT     500
 #define INITIALIZATION_TIMEOUT      2000
 
+// Busy octets are polled in bursts. Clocking a card that already went ready
+// is harmless, while polling one octet at a time spends more time in the
+// STREAM layer and the tick counter than on the bus.
+#define WAIT_READY_BURST_OCTETS     8
+
+// Data response token (xxx0sss1), sss = 010: data accepted
+#define DATA_RESPONSE_MASK          0x1F
+#define DATA_RESPONSE_ACCEPTED      0x05
+
+// ACMD23 block count is 23 bits wide
+#define PRE_ERASE_MAX_BLOCKS        0x7FFFFF
+
+#define R1_ILLEGAL_COMMAND          0x04
+
 // MMC/SDC commands according to SD Group "Physical Layer Simplified 
 // Specification Version 6.00"
 #define SD_CMD0                     0           // GO_IDLE_STATE
@@ -170,16 +184,28 @@ static uint8_t recvOctet (struct RAWSTOR_SD_1BIT *const S)
 
 static bool waitForCardReady (struct RAWSTOR_SD_1BIT *const S, uint32_t timeout)
 {
-	uint8_t d;
-    
+    // A ready card is the common case
+    if (recvOctet (S) == 0xFF)
+    {
+        return true;
+    }
+
+    uint8_t burst[WAIT_READY_BURST_OCTETS];
+
 	timeout += TICKS_Now();
 	do
     {
-		d = recvOctet (S);
+        recvBuffer (S, burst, sizeof(burst));
+
+        // Busy does not come back once the card outputs 0xFF
+        if (burst[sizeof(burst) - 1] == 0xFF)
+        {
+            return true;
+        }
     }
-	while (d != 0xFF && TICKS_Now() < timeout);
+	while (TICKS_Now() < timeout);
 
-	return (d == 0xFF)? true : false;
+	return false;
 }
 
 
@@ -264,25 +290,33 @@ static bool recvCardDatablock (struct RAWSTOR_SD_1BIT *const S,
         return false;
     }
 
+    uint8_t crc[2];
+
     // Store trailing data to the buffer
     recvBuffer  (S, Data, Size);
     // Discard CRC
-	recvOctet   (S);
-	recvOctet   (S);
+    recvBuffer  (S, crc, sizeof(crc));
 
 	return true;
 }
 
 
+// "Ready" tells if the card was seen ready after the last data block. It
+// skips the leading busy check of the next one.
 static bool sendCardDatablock (struct RAWSTOR_SD_1BIT *const S, 
-                               const uint8_t *const Data, const uint8_t Token)
+                               const uint8_t *const Data, const uint8_t Token,
+                               bool *const Ready)
 {
+    static const uint8_t DummyCrc[2] = { 0xFF, 0xFF };
+
     // Leading busy check: Wait for card ready to accept data block
-	if (!waitForCardReady (S, WAIT_READY_XMIT_TIMEOUT))
+	if (!*Ready && !waitForCardReady (S, WAIT_READY_XMIT_TIMEOUT))
     {
         return false;
     }
 
+    *Ready = false;
+
 	sendOctet (S, Token);
     // Do not send data if token is StopTran
     if (Token == 0xFD)
@@ -291,16 +325,20 @@ static bool sendCardDatablock (struct RAWSTOR_SD_1BIT *const S,
     }
     
     sendBuffer  (S, Data, 512);
-    // Dummy CRC
-    sendOctet   (S, 0xFF);
-    sendOctet   (S, 0xFF);
-    
-    // Reveive data response
-    const uint8_t Resp = recvOctet (S);
+    sendBuffer  (S, DummyCrc, sizeof(DummyCrc));
     
+    // Receive the data response along with the first burst of busy octets
+    // the next block has to wait for anyway.
+    uint8_t resp[1 + WAIT_READY_BURST_OCTETS];
+
+    recvBuffer (S, resp, sizeof(resp));
+
+    *Ready = (resp[sizeof(resp) - 1] == 0xFF);
+
     // Data was accepted or not
     // (Busy check is done at next transmission)
-    return ((Resp & 0x1F) == 0x05)? true : false;    
+    return ((resp[0] & DATA_RESPONSE_MASK) == DATA_RESPONSE_ACCEPTED)?
+                                                                true : false;
 }
 
 
@@ -309,6 +347,7 @@ static uint8_t sendCardCommand (struct RAWSTOR_SD_1BIT *const S,
                                 const uint8_t Command, const uint32_t Arg)
 {
     uint8_t res;
+    uint8_t packet[6];
   
     const uint8_t Cmd = (Command & 0x80)? Command & 0x7F : Command;
 
@@ -332,19 +371,22 @@ static uint8_t sendCardCommand (struct RAWSTOR_SD_1BIT *const S,
         }
     }
     
-	// Send command packet
-	sendOctet (S, 0x40 | Cmd);              // Start (01xxxxxx) + Command index
-	sendOctet (S, (uint8_t) (Arg >> 24));	// Argument[31..24]
-	sendOctet (S, (uint8_t) (Arg >> 16));	// Argument[23..16]
-	sendOctet (S, (uint8_t) (Arg >>  8));   // Argument[15..8]
-	sendOctet (S, (uint8_t)  Arg);			// Argument[7..0]
+	// Command packet
+	packet[0] = 0x40 | Cmd;                 // Start (01xxxxxx) + Command index
+	packet[1] = (uint8_t) (Arg >> 24);	    // Argument[31..24]
+	packet[2] = (uint8_t) (Arg >> 16);	    // Argument[23..16]
+	packet[3] = (uint8_t) (Arg >>  8);      // Argument[15..8]
+	packet[4] = (uint8_t)  Arg;			    // Argument[7..0]
     
     // Valid CRC + Stop bit for SD_CMD0(0) -or-
     // Valid CRC + Stop bit for SD_CMD8(0x1AA) -or-
     // Dummy CRC + Stop bit
-	uint8_t n = (Cmd == SD_CMD0)? 0x95 : (Cmd == SD_CMD8)? 0x87 : 0x01;
-    
-	sendOctet (S, n);
+	packet[5] = (Cmd == SD_CMD0)? 0x95 : (Cmd == SD_CMD8)? 0x87 : 0x01;
+
+    // Sent in a single transfer
+    sendBuffer (S, packet, sizeof(packet));
+
+    uint8_t n;
 
 	// Receive command response
 	if (Cmd == SD_CMD12)
@@ -370,6 +412,12 @@ static bool detectCard (struct RAWSTOR *const R)
 {
     (void) R;
 
+    // Sockets without a card detect switch
+    if (!MIO_IS_INPUT_BIT_MAPPED(CONTROL, StorageDetect))
+    {
+        return true;
+    }
+
     return MIO_GET_INPUT_BIT_NOW(CONTROL,StorageDetect)? true : false;
 }
 
@@ -434,11 +482,7 @@ static RAWSTOR_Status_Result mediaInit (struct RAWSTOR *const R)
 	powerOn (P);
     // After supply voltage reached 2.2 volts, wait for one millisecond at 
     // least.
-    TIMER_Ticks timeout = TICKS_Now() + 20;
-    while (TICKS_Now() < timeout)
-    {
-        __WFI ();
-    }
+    TICKS_Delay (20);
     // Set SPI clock rate between 100 kHz and 400 kHz. 
     setSlowClock (P);
     // Set DI and CS high (recvByte sends 0xFF)
@@ -470,7 +514,7 @@ static RAWSTOR_Status_Result mediaInit (struct RAWSTOR *const R)
                             RAWSTOR_SD_STATUS_MEDIA_INITIALIZING__P1_IDLE,
                             0);
 
-        timeout = TICKS_Now() + INITIALIZATION_TIMEOUT;
+        const TIMER_Ticks Timeout = TICKS_Now() + INITIALIZATION_TIMEOUT;
         
         // SD_CMD8 "Send Interface Condition Command".
         // 0x0AA = Check pattern. 0x100 = 2.7-3.6V
@@ -488,12 +532,12 @@ static RAWSTOR_Status_Result mediaInit (struct RAWSTOR *const R)
                 // bit 30 HCS: "Host Capacity Support" 1b: SDHC or SDXC 
                 // Supported. Wait for leaving idle state (SD_ACMD41 with
                 // HCS bit)
-				while (TICKS_Now() < timeout &&
+				while (TICKS_Now() < Timeout &&
                        sendCardCommand (P, SD_ACMD41, 1UL << 30))
                 {
                 }
 
-                if (TICKS_Now() < timeout &&
+                if (TICKS_Now() < Timeout &&
                         sendCardCommand (P, SD_CMD58, 0) == 0)
                 {	
                     // Check CCS bit in the OCR
@@ -523,11 +567,11 @@ static RAWSTOR_Status_Result mediaInit (struct RAWSTOR *const R)
             }
             
             // Wait for leaving idle state
-			while (TICKS_Now() < timeout &&
+			while (TICKS_Now() < Timeout &&
                    sendCardCommand (P, cmd, 0));
             
             // Set R/W block length to 512
-			if (TICKS_Now() >= timeout ||
+			if (TICKS_Now() >= Timeout ||
                     sendCardCommand (P, SD_CMD16, 512) != 0)
             {
 				ty = 0;
@@ -619,13 +663,16 @@ static RAWSTOR_Status_Result mediaWrite (struct RAWSTOR *R,
                                 SectorBegin << 9 : SectorBegin;
 
     uint32_t sectorsWritten = 0;
+    // The leading busy check of the first block also clocks the NWR octet
+    // required between the command response and the first data token.
+    bool ready = false;
 
     // Single sector write
 	if (SectorCount == 1) 
     {
         // WRITE_BLOCK
 		if ((sendCardCommand (P, SD_CMD24, RealSector) == 0) &&
-                sendCardDatablock (P, Data, 0xFE))
+                sendCardDatablock (P, Data, 0xFE, &ready))
         {
             sectorsWritten = 1;
         }
@@ -633,29 +680,42 @@ static RAWSTOR_Status_Result mediaWrite (struct RAWSTOR *R,
     // Multiple sector write
 	else 
     {
+        bool preErased = true;
+
 		if (P->tFlags & RAWSTOR_SD_TYPE_SD_ANY)
         {
-            // Predefine number of sectors
-            sendCardCommand (P, SD_ACMD23, SectorCount);
+            // Pre-erase: the number of blocks to come lets the card erase
+            // them ahead of programming. It is only a hint; a card that
+            // rejects it as an illegal command still takes the write.
+            // Pre-erased blocks not written have undefined contents.
+            const uint32_t Blocks = (SectorCount > PRE_ERASE_MAX_BLOCKS)?
+                                        PRE_ERASE_MAX_BLOCKS : SectorCount;
+
+            const uint8_t Res = sendCardCommand (P, SD_ACMD23, Blocks);
+
+            preErased = !(Res & ~R1_ILLEGAL_COMMAND);
         }
         
         // WRITE_MULTIPLE_BLOCK
-		if (sendCardCommand (P, SD_CMD25, RealSector) == 0)
+		if (preErased && sendCardCommand (P, SD_CMD25, RealSector) == 0)
         {
 			do 
             {
-				if (!sendCardDatablock (P, &Data[sectorsWritten << 9], 0xFC))
+				if (!sendCardDatablock (P, &Data[sectorsWritten << 9], 0xFC,
+                                        &ready))
                 {
                     break;
                 }
 			}
             while (++ sectorsWritten < SectorCount);
 
-            // STOP_TRAN token
-			if (!sendCardDatablock (P, 0, 0xFD))
+            // STOP_TRAN token. Without it the card is left receiving data
+            // and none of the blocks can be taken as programmed. The busy
+            // wait that follows is left to the next command to overlap
+            // programming of the last block with the caller.
+			if (!sendCardDatablock (P, NULL, 0xFD, &ready))
             {
-                // TODO: do proper error handling
-				sectorsWritten = 1;
+				sectorsWritten = 0;
             }
 		}
 	}
@@ -675,7 +735,7 @@ static RAWSTOR_Status_Result mediaIoctl (struct RAWSTOR *const R,
 
 	RAWSTOR_Status_Result   res;
 	uint8_t                 csd[16], n, *ptr = Data;
-	uint16_t                *dp, st, ed, csize;
+	uint32_t                *dp, st, ed, csize;
 
 	res = RAWSTOR_Status_Result_ReadWriteError;
     
@@ -26,7 +26,6 @@
 #include "embedul.ar/source/core/device/rawstor.h"
 #include "embedul.ar/source/core/device/rawstor/sd.h"
 #include "embedul.ar/source/core/manager/comm.h"
-#include "embedul.ar/source/arch/arm-cortex/lpc/18xx_43xx/lpcopen/chip_18xx_43xx/chip.h"
 
 
 struct RAWSTOR_SD_1BIT
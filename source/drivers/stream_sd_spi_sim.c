@@ -0,0 +1,902 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+  
+  [STREAM driver] sd card spi mode protocol simulator.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "embedul.ar/source/drivers/stream_sd_spi_sim.h"
+#include "embedul.ar/source/core/device/board.h"
+#include <string.h>
+
+
+#define DEFAULT_SPEED               100000
+
+// R1 response bits
+#define R1_IDLE                     0x01
+#define R1_ILLEGAL_COMMAND          0x04
+#define R1_CRC_ERROR                0x08
+#define R1_ERASE_SEQUENCE_ERROR     0x10
+#define R1_ADDRESS_ERROR            0x20
+#define R1_PARAMETER_ERROR          0x40
+
+// Data tokens
+#define TOKEN_START_BLOCK           0xFE
+#define TOKEN_START_BLOCK_MULTIPLE  0xFC
+#define TOKEN_STOP_TRAN             0xFD
+#define TOKEN_ERROR                 0x01
+#define TOKEN_ERROR_OUT_OF_RANGE    0x08
+
+// Data response tokens (xxx0sss1)
+#define DATA_RESPONSE_ACCEPTED      0xE5
+#define DATA_RESPONSE_WRITE_ERROR   0xED
+
+#define ERASE_UNSET                 0xFFFFFFFF
+
+// Byte addressed cards
+#define BYTE_ADDRESSING_MAX_SECTORS (4UL * 1024 * 1024)
+
+
+// Common IO interface
+static enum DEVICE_CommandResult
+                    command         (const void *const D,
+                                     const char *const Name,
+                                     struct VARIANT *const Value);
+static uint32_t     dataIn          (struct STREAM *const S,
+                                     const uint8_t *const Data,
+                                     const uint32_t Octets);
+static uint32_t     dataOut         (struct STREAM *const S,
+                                     uint8_t *const Buffer,
+                                     const uint32_t Octets);
+
+
+static const struct STREAM_IFACE STREAM_SD_SPI_SIM_IFACE =
+{
+    .Description    = "sd card spi simulator",
+    .Command        = command,
+    .DataIn         = dataIn,
+    .DataOut        = dataOut
+};
+
+
+// Timing NULL: the card answers as soon as possible and is never busy.
+void STREAM_SD_SPI_SIM_Init (struct STREAM_SD_SPI_SIM *const S,
+                             struct RAWSTOR *const Media,
+                             const enum STREAM_SD_SPI_SIM_Card Card,
+                             const struct STREAM_SD_SPI_SIM_Timing *const Timing)
+{
+    BOARD_AssertParams (S && Media && Card <= STREAM_SD_SPI_SIM_Card_SdV1);
+
+    DEVICE_IMPLEMENTATION_Clear (S);
+
+    uint32_t sectorCount = 0;
+
+    if (RAWSTOR_MediaIoctl (Media, RAWSTOR_IOCTL_CMD_GET_SECTOR_COUNT,
+                            &sectorCount) != RAWSTOR_Status_Result_Ok)
+    {
+        // The card does not answer
+        sectorCount = 0;
+    }
+
+    BOARD_AssertParams ((Card == STREAM_SD_SPI_SIM_Card_SdV2BlockAddressing)?
+                            sectorCount >= 1024 :
+                            sectorCount <= BYTE_ADDRESSING_MAX_SECTORS);
+
+    S->media        = Media;
+    S->card         = Card;
+    S->sectorCount  = sectorCount;
+    S->speed        = DEFAULT_SPEED;
+    S->idle         = true;
+    S->eraseBegin   = ERASE_UNSET;
+    S->eraseEnd     = ERASE_UNSET;
+
+    STREAM_SD_SPI_SIM_SetTiming (S, Timing);
+
+    STREAM_Init ((struct STREAM *)S, &STREAM_SD_SPI_SIM_IFACE);
+}
+
+
+void STREAM_SD_SPI_SIM_SetTiming (struct STREAM_SD_SPI_SIM *const S,
+                        const struct STREAM_SD_SPI_SIM_Timing *const Timing)
+{
+    BOARD_AssertParams (S);
+
+    if (Timing)
+    {
+        BOARD_AssertParams (Timing->responseOctets >= 1 &&
+                            Timing->responseOctets <= 8);
+        S->timing = *Timing;
+    }
+    else
+    {
+        S->timing = (struct STREAM_SD_SPI_SIM_Timing) { .responseOctets = 1 };
+    }
+}
+
+
+struct STREAM_SD_SPI_SIM_Stats
+STREAM_SD_SPI_SIM_Stats (struct STREAM_SD_SPI_SIM *const S)
+{
+    BOARD_AssertParams (S);
+
+    struct STREAM_SD_SPI_SIM_Stats stats = S->stats;
+
+    stats.busUs = S->busNs / 1000;
+
+    return stats;
+}
+
+
+static bool blockAddressing (struct STREAM_SD_SPI_SIM *const S)
+{
+    return (S->card == STREAM_SD_SPI_SIM_Card_SdV2BlockAddressing);
+}
+
+
+static uint8_t crc7 (const uint8_t *const Data, const uint32_t Octets)
+{
+    uint8_t crc = 0;
+
+    for (uint32_t i = 0; i < Octets; ++i)
+    {
+        uint8_t d = Data[i];
+
+        for (uint32_t b = 0; b < 8; ++b)
+        {
+            crc <<= 1;
+            if ((d ^ crc) & 0x80)
+            {
+                crc ^= 0x09;
+            }
+            d <<= 1;
+        }
+    }
+
+    // CRC7 + end bit
+    return (uint8_t)((crc << 1) | 1);
+}
+
+
+static void respond (struct STREAM_SD_SPI_SIM *const S,
+                     const uint8_t *const Octets, const uint32_t Count)
+{
+    BOARD_AssertState (S->responseCount + Count <= sizeof(S->response));
+
+    for (uint32_t i = 0; i < Count; ++i)
+    {
+        const uint32_t Tail = (S->responseHead + S->responseCount) %
+                                                        sizeof(S->response);
+        S->response[Tail] = Octets[i];
+        ++ S->responseCount;
+    }
+}
+
+
+// NCR octets, then R1 and the remaining octets of R2, R3 or R7.
+static void respondCommand (struct STREAM_SD_SPI_SIM *const S, uint8_t r1,
+                            const uint8_t *const Extra,
+                            const uint32_t ExtraCount)
+{
+    if (S->idle)
+    {
+        r1 |= R1_IDLE;
+    }
+
+    if (r1 & ~R1_IDLE)
+    {
+        ++ S->stats.rejectedCommands;
+    }
+
+    for (uint32_t i = 1; i < S->timing.responseOctets; ++i)
+    {
+        respond (S, &(uint8_t){ 0xFF }, 1);
+    }
+
+    respond (S, &r1, 1);
+
+    if (ExtraCount)
+    {
+        respond (S, Extra, ExtraCount);
+    }
+}
+
+
+static void enterBusy (struct STREAM_SD_SPI_SIM *const S,
+                       const uint32_t Octets,
+                       const enum STREAM_SD_SPI_SIM_State Next)
+{
+    S->state        = Octets? STREAM_SD_SPI_SIM_State_Busy : Next;
+    S->busyNext     = Next;
+    S->phaseOctets  = Octets;
+}
+
+
+// Sends a register as a data block after the command response.
+static void readRegister (struct STREAM_SD_SPI_SIM *const S,
+                          const uint8_t *const Data, const uint32_t Octets)
+{
+    memcpy (S->block, Data, Octets);
+    S->block[Octets]        = 0xFF;
+    S->block[Octets + 1]    = 0xFF;
+    S->blockOctets  = Octets;
+    S->readSectors  = false;
+    S->multiple     = false;
+    S->phaseOctets  = 1;
+    S->state        = STREAM_SD_SPI_SIM_State_ReadAccess;
+}
+
+
+static void readCsd (struct STREAM_SD_SPI_SIM *const S)
+{
+    uint8_t csd[16] =
+    {
+        0x00, 0x0E, 0x00, 0x32, 0x5B, 0x59, 0x00, 0x00,
+        0x00, 0x00, 0x7F, 0x80, 0x0A, 0x40, 0x00, 0x01
+    };
+
+    if (blockAddressing (S))
+    {
+        // CSD version 2.0: capacity = (C_SIZE + 1) * 512 KiB
+        const uint32_t CSize = S->sectorCount / 1024 - 1;
+
+        csd[0] = 0x40;
+        csd[7] = (uint8_t)((CSize >> 16) & 0x3F);
+        csd[8] = (uint8_t)(CSize >> 8);
+        csd[9] = (uint8_t) CSize;
+    }
+    else
+    {
+        // CSD version 1.0: sectors = (C_SIZE + 1) << (READ_BL_LEN - 9 +
+        // C_SIZE_MULT + 2). Capacity is rounded down to what fits in the
+        // twelve bits of C_SIZE.
+        uint32_t shift = 2;
+
+        while ((S->sectorCount >> shift) > 4096 && shift < 11)
+        {
+            ++ shift;
+        }
+
+        const uint32_t ReadBlLen    = (shift > 9)? shift : 9;
+        const uint32_t CSizeMult    = shift - 2 - (ReadBlLen - 9);
+        const uint32_t Units        = S->sectorCount >> shift;
+        const uint32_t CSize        = Units? Units - 1 : 0;
+
+        csd[5]  = (uint8_t)(0x50 | ReadBlLen);
+        csd[6]  = (uint8_t)((CSize >> 10) & 0x03);
+        csd[7]  = (uint8_t)(CSize >> 2);
+        csd[8]  = (uint8_t)((CSize & 0x03) << 6);
+        csd[9]  = (uint8_t)(0xFC | (CSizeMult >> 1));
+        csd[10] = (uint8_t)(0x7F | ((CSizeMult & 1) << 7));
+    }
+
+    readRegister (S, csd, sizeof(csd));
+}
+
+
+static void readCid (struct STREAM_SD_SPI_SIM *const S)
+{
+    static const uint8_t Cid[16] =
+    {
+        // MID, OID "EM", PNM "SDSIM", PRV 1.0, PSN, MDT, CRC
+        0x45, 'E', 'M', 'S', 'D', 'S', 'I', 'M',
+        0x10, 0x00, 0x00, 0x00, 0x01, 0x01, 0x6A, 0x01
+    };
+
+    readRegister (S, Cid, sizeof(Cid));
+}
+
+
+static void readSdStatus (struct STREAM_SD_SPI_SIM *const S)
+{
+    uint8_t status[64] = { 0 };
+
+    // AU_SIZE 4 MiB
+    status[10] = 0x90;
+
+    readRegister (S, status, sizeof(status));
+}
+
+
+// Returns false on a R1 address or parameter error, already answered.
+static bool dataAddress (struct STREAM_SD_SPI_SIM *const S, const uint32_t Arg)
+{
+    if (!blockAddressing(S) && (Arg & (RAWSTOR_SECTOR_SIZE - 1)))
+    {
+        respondCommand (S, R1_ADDRESS_ERROR, NULL, 0);
+        return false;
+    }
+
+    const uint32_t Sector = blockAddressing(S)? Arg : Arg / RAWSTOR_SECTOR_SIZE;
+
+    if (Sector >= S->sectorCount)
+    {
+        respondCommand (S, R1_PARAMETER_ERROR, NULL, 0);
+        return false;
+    }
+
+    S->sector = Sector;
+    return true;
+}
+
+
+static void erase (struct STREAM_SD_SPI_SIM *const S)
+{
+    if (S->eraseBegin == ERASE_UNSET || S->eraseEnd == ERASE_UNSET ||
+        S->eraseBegin > S->eraseEnd)
+    {
+        respondCommand (S, R1_ERASE_SEQUENCE_ERROR, NULL, 0);
+        return;
+    }
+
+    const uint32_t Range[2] = { S->eraseBegin, S->eraseEnd };
+
+    // Erased contents are card dependent; media without TRIM keep theirs.
+    RAWSTOR_MediaIoctl (S->media, RAWSTOR_IOCTL_CMD_TRIM, (void *)Range);
+
+    S->eraseBegin   = ERASE_UNSET;
+    S->eraseEnd     = ERASE_UNSET;
+
+    respondCommand (S, 0, NULL, 0);
+    enterBusy (S, S->timing.eraseBusyOctets, STREAM_SD_SPI_SIM_State_Command);
+}
+
+
+static void processCommand (struct STREAM_SD_SPI_SIM *const S)
+{
+    const uint8_t   Index   = S->command[0] & 0x3F;
+    const uint32_t  Arg     = (uint32_t)S->command[1] << 24 |
+                              (uint32_t)S->command[2] << 16 |
+                              (uint32_t)S->command[3] << 8 |
+                              (uint32_t)S->command[4];
+    const bool      CrcOk   = (S->command[5] == crc7(S->command, 5));
+    const bool      App     = S->appCommand;
+
+    S->appCommand = false;
+
+    ++ S->stats.commands;
+
+    if (App)
+    {
+        ++ S->stats.appCommands;
+    }
+
+    // An unpowered card or one without media never answers
+    if (!S->sectorCount)
+    {
+        return;
+    }
+
+    // CMD12 ends a multiple block read. One stuff octet comes before the
+    // response.
+    if (Index == 12)
+    {
+        respond (S, &(uint8_t){ 0xFF }, 1);
+        respondCommand (S, 0, NULL, 0);
+
+        if (S->multiple && S->readSectors &&
+            (S->state == STREAM_SD_SPI_SIM_State_ReadAccess ||
+             S->state == STREAM_SD_SPI_SIM_State_ReadData))
+        {
+            enterBusy (S, S->timing.stopBusyOctets,
+                       STREAM_SD_SPI_SIM_State_Command);
+        }
+        return;
+    }
+
+    // Any other command leaves a data phase
+    S->state = STREAM_SD_SPI_SIM_State_Command;
+
+    // Only initialization commands are accepted while idle
+    if (S->idle && Index != 0 && Index != 8 && Index != 55 && Index != 58 &&
+        Index != 59 && !(App && Index == 41))
+    {
+        respondCommand (S, R1_ILLEGAL_COMMAND, NULL, 0);
+        return;
+    }
+
+    if (App)
+    {
+        switch (Index)
+        {
+            case 13:
+                // SD_STATUS, R2
+                respondCommand (S, 0, &(uint8_t){ 0x00 }, 1);
+                readSdStatus (S);
+                return;
+
+            case 23:
+                // SET_WR_BLK_ERASE_COUNT
+                S->preErase = Arg & 0x7FFFFF;
+                respondCommand (S, 0, NULL, 0);
+                return;
+
+            case 41:
+                // SD_SEND_OP_COND
+                if (S->initRetries)
+                {
+                    -- S->initRetries;
+                }
+                else
+                {
+                    S->idle = false;
+                }
+                respondCommand (S, 0, NULL, 0);
+                return;
+
+            default:
+                // Other application commands are taken as regular ones
+                break;
+        }
+    }
+
+    switch (Index)
+    {
+        case 0:
+            // GO_IDLE_STATE
+            if (!CrcOk)
+            {
+                respondCommand (S, R1_CRC_ERROR, NULL, 0);
+                break;
+            }
+            S->idle         = true;
+            S->initRetries  = S->timing.initRetries;
+            S->preErase     = 0;
+            S->eraseBegin   = ERASE_UNSET;
+            S->eraseEnd     = ERASE_UNSET;
+            respondCommand (S, 0, NULL, 0);
+            break;
+
+        case 8:
+        {
+            // SEND_IF_COND, R7
+            if (S->card == STREAM_SD_SPI_SIM_Card_SdV1)
+            {
+                respondCommand (S, R1_ILLEGAL_COMMAND, NULL, 0);
+                break;
+            }
+            if (!CrcOk)
+            {
+                respondCommand (S, R1_CRC_ERROR, NULL, 0);
+                break;
+            }
+            // Voltage accepted (2.7-3.6V only) and check pattern echo
+            const uint8_t R7[4] = { 0x00, 0x00,
+                                    (uint8_t)(Arg >> 8) & 0x01,
+                                    (uint8_t) Arg };
+            respondCommand (S, 0, R7, sizeof(R7));
+            break;
+        }
+
+        case 9:
+            // SEND_CSD
+            respondCommand (S, 0, NULL, 0);
+            readCsd (S);
+            break;
+
+        case 10:
+            // SEND_CID
+            respondCommand (S, 0, NULL, 0);
+            readCid (S);
+            break;
+
+        case 13:
+            // SEND_STATUS, R2
+            respondCommand (S, 0, &(uint8_t){ 0x00 }, 1);
+            break;
+
+        case 16:
+            // SET_BLOCKLEN, fixed on block addressed cards
+            respondCommand (S, (Arg == RAWSTOR_SECTOR_SIZE ||
+                                blockAddressing(S))? 0 : R1_PARAMETER_ERROR,
+                            NULL, 0);
+            break;
+
+        case 17:
+        case 18:
+            // READ_SINGLE_BLOCK, READ_MULTIPLE_BLOCK
+            if (dataAddress (S, Arg))
+            {
+                respondCommand (S, 0, NULL, 0);
+                S->blockOctets  = RAWSTOR_SECTOR_SIZE;
+                S->readSectors  = true;
+                S->multiple     = (Index == 18);
+                S->phaseOctets  = S->timing.readAccessOctets;
+                S->state        = STREAM_SD_SPI_SIM_State_ReadAccess;
+            }
+            break;
+
+        case 24:
+        case 25:
+            // WRITE_BLOCK, WRITE_MULTIPLE_BLOCK
+            if (Index == 24)
+            {
+                S->preErase = 0;
+            }
+            if (dataAddress (S, Arg))
+            {
+                respondCommand (S, 0, NULL, 0);
+                S->blockOctets  = RAWSTOR_SECTOR_SIZE;
+                S->readSectors  = false;
+                S->multiple     = (Index == 25);
+                S->state        = STREAM_SD_SPI_SIM_State_WriteToken;
+            }
+            break;
+
+        case 32:
+        case 33:
+            // ERASE_WR_BLK_START, ERASE_WR_BLK_END
+            if (dataAddress (S, Arg))
+            {
+                if (Index == 32)
+                {
+                    S->eraseBegin = S->sector;
+                }
+                else
+                {
+                    S->eraseEnd = S->sector;
+                }
+                respondCommand (S, 0, NULL, 0);
+            }
+            break;
+
+        case 38:
+            // ERASE
+            erase (S);
+            break;
+
+        case 55:
+            // APP_CMD
+            S->appCommand = true;
+            respondCommand (S, 0, NULL, 0);
+            break;
+
+        case 58:
+        {
+            // READ_OCR, R3. Power up status and CCS are valid after
+            // initialization.
+            uint8_t ocr[4] = { 0x00, 0xFF, 0x80, 0x00 };
+            if (!S->idle)
+            {
+                ocr[0] = blockAddressing(S)? 0xC0 : 0x80;
+            }
+            respondCommand (S, 0, ocr, sizeof(ocr));
+            break;
+        }
+
+        case 59:
+            // CRC_ON_OFF, accepted but CRC stays unchecked
+            respondCommand (S, 0, NULL, 0);
+            break;
+
+        default:
+            respondCommand (S, R1_ILLEGAL_COMMAND, NULL, 0);
+            break;
+    }
+}
+
+
+static void writeBlock (struct STREAM_SD_SPI_SIM *const S)
+{
+    const RAWSTOR_Status_Result Res = (S->sector < S->sectorCount)?
+                RAWSTOR_MediaWrite (S->media, S->block, S->sector, 1) :
+                RAWSTOR_Status_Result_InvalidParam;
+
+    const enum STREAM_SD_SPI_SIM_State Next = S->multiple?
+                                    STREAM_SD_SPI_SIM_State_WriteToken :
+                                    STREAM_SD_SPI_SIM_State_Command;
+
+    if (Res != RAWSTOR_Status_Result_Ok)
+    {
+        ++ S->stats.dataErrors;
+        respond (S, &(uint8_t){ DATA_RESPONSE_WRITE_ERROR }, 1);
+        enterBusy (S, S->timing.stopBusyOctets, Next);
+        return;
+    }
+
+    uint32_t busyOctets = S->timing.writeBusyOctets;
+
+    if (S->preErase)
+    {
+        -- S->preErase;
+        ++ S->stats.blocksPreErased;
+        busyOctets = S->timing.preErasedBusyOctets;
+    }
+
+    ++ S->stats.blocksWritten;
+    ++ S->sector;
+
+    respond (S, &(uint8_t){ DATA_RESPONSE_ACCEPTED }, 1);
+    enterBusy (S, busyOctets, Next);
+}
+
+
+// Card output of a single exchanged octet.
+static uint8_t output (struct STREAM_SD_SPI_SIM *const S)
+{
+    if (S->responseCount)
+    {
+        const uint8_t Octet = S->response[S->responseHead];
+
+        S->responseHead = (S->responseHead + 1) % sizeof(S->response);
+        -- S->responseCount;
+
+        return Octet;
+    }
+
+    switch (S->state)
+    {
+        case STREAM_SD_SPI_SIM_State_ReadAccess:
+            if (S->phaseOctets)
+            {
+                -- S->phaseOctets;
+                return 0xFF;
+            }
+
+            if (S->readSectors)
+            {
+                // Expected when a multiple block read reaches the end of
+                // the media before CMD12
+                if (S->sector >= S->sectorCount)
+                {
+                    S->state = STREAM_SD_SPI_SIM_State_Command;
+                    return TOKEN_ERROR_OUT_OF_RANGE;
+                }
+
+                if (RAWSTOR_MediaRead (S->media, S->block, S->sector, 1)
+                                                != RAWSTOR_Status_Result_Ok)
+                {
+                    ++ S->stats.dataErrors;
+                    S->state = STREAM_SD_SPI_SIM_State_Command;
+                    return TOKEN_ERROR;
+                }
+
+                S->block[RAWSTOR_SECTOR_SIZE]       = 0xFF;
+                S->block[RAWSTOR_SECTOR_SIZE + 1]   = 0xFF;
+            }
+
+            S->blockOffset  = 0;
+            S->state        = STREAM_SD_SPI_SIM_State_ReadData;
+            return TOKEN_START_BLOCK;
+
+        case STREAM_SD_SPI_SIM_State_ReadData:
+        {
+            const uint8_t Octet = S->block[S->blockOffset ++];
+
+            if (S->blockOffset == S->blockOctets + 2)
+            {
+                if (S->readSectors)
+                {
+                    ++ S->stats.blocksRead;
+                    ++ S->sector;
+                }
+
+                if (S->multiple)
+                {
+                    S->phaseOctets  = S->timing.readAccessOctets;
+                    S->state        = STREAM_SD_SPI_SIM_State_ReadAccess;
+                }
+                else
+                {
+                    S->state = STREAM_SD_SPI_SIM_State_Command;
+                }
+            }
+
+            return Octet;
+        }
+
+        case STREAM_SD_SPI_SIM_State_Busy:
+            ++ S->stats.busyOctets;
+
+            if (!-- S->phaseOctets)
+            {
+                S->state = S->busyNext;
+            }
+            return 0x00;
+
+        default:
+            return 0xFF;
+    }
+}
+
+
+// Host input of a single exchanged octet.
+static void input (struct STREAM_SD_SPI_SIM *const S, const uint8_t Octet)
+{
+    if (S->commandOctets)
+    {
+        S->command[S->commandOctets ++] = Octet;
+
+        if (S->commandOctets == sizeof(S->command))
+        {
+            S->commandOctets = 0;
+            processCommand (S);
+        }
+        return;
+    }
+
+    switch (S->state)
+    {
+        case STREAM_SD_SPI_SIM_State_WriteToken:
+            if ((Octet == TOKEN_START_BLOCK && !S->multiple) ||
+                (Octet == TOKEN_START_BLOCK_MULTIPLE && S->multiple))
+            {
+                S->blockOffset  = 0;
+                S->state        = STREAM_SD_SPI_SIM_State_WriteData;
+                return;
+            }
+
+            if (Octet == TOKEN_STOP_TRAN && S->multiple)
+            {
+                S->preErase = 0;
+                respond (S, &(uint8_t){ 0xFF }, 1);
+                enterBusy (S, S->timing.stopBusyOctets,
+                           STREAM_SD_SPI_SIM_State_Command);
+                return;
+            }
+            break;
+
+        case STREAM_SD_SPI_SIM_State_WriteData:
+            S->block[S->blockOffset ++] = Octet;
+
+            if (S->blockOffset == S->blockOctets + 2)
+            {
+                writeBlock (S);
+            }
+            return;
+
+        case STREAM_SD_SPI_SIM_State_Busy:
+            // Busy cards ignore commands
+            return;
+
+        default:
+            break;
+    }
+
+    // Start bit and transmission bit
+    if ((Octet & 0xC0) == 0x40)
+    {
+        S->command[0]       = Octet;
+        S->commandOctets    = 1;
+    }
+}
+
+
+static uint8_t exchange (struct STREAM_SD_SPI_SIM *const S, const uint8_t In)
+{
+    const uint8_t Out = output (S);
+
+    input (S, In);
+
+    return Out;
+}
+
+
+static void countTransfer (struct STREAM_SD_SPI_SIM *const S,
+                           const uint32_t Octets)
+{
+    ++ S->stats.transfers;
+    S->stats.octets += Octets;
+    S->busNs        += (uint64_t)Octets * 8 * 1000000000 / S->speed;
+}
+
+
+static enum DEVICE_CommandResult command (const void *const D,
+                                          const char *const Name,
+                                          struct VARIANT *const Value)
+{
+    struct STREAM_SD_SPI_SIM *const P = (struct STREAM_SD_SPI_SIM *) D;
+
+    if (DEVICE_COMMAND_CHECK(STREAM_SET_SPEED))
+    {
+        const uint32_t Speed = VARIANT_ToUint (Value);
+        if (!Speed)
+        {
+            return DEVICE_CommandResult_Failed;
+        }
+
+        P->speed = Speed;
+    }
+    else if (DEVICE_COMMAND_CHECK(STREAM_SET_FRAME_BITS))
+    {
+        if (VARIANT_ToUint (Value) != 8)
+        {
+            return DEVICE_CommandResult_Failed;
+        }
+    }
+    else
+    {
+        return DEVICE_CommandResult_NotHandled;
+    }
+
+    return DEVICE_CommandResult_Ok;
+}
+
+
+// Host to card. Card output is discarded, as a SPI controller does on writes.
+static uint32_t dataIn (struct STREAM *const S, const uint8_t *const Data,
+                        const uint32_t Octets)
+{
+    struct STREAM_SD_SPI_SIM *const P = (struct STREAM_SD_SPI_SIM *) S;
+
+    uint32_t i = 0;
+
+    while (i < Octets)
+    {
+        // Block data is copied whole
+        if (P->state == STREAM_SD_SPI_SIM_State_WriteData &&
+            !P->commandOctets && !P->responseCount)
+        {
+            const uint32_t Left     = P->blockOctets + 2 - P->blockOffset;
+            const uint32_t Count    = (Octets - i < Left)? Octets - i : Left;
+
+            memcpy (&P->block[P->blockOffset], &Data[i], Count);
+            P->blockOffset  += Count;
+            i               += Count;
+
+            if (P->blockOffset == P->blockOctets + 2)
+            {
+                writeBlock (P);
+            }
+            continue;
+        }
+
+        exchange (P, Data[i ++]);
+    }
+
+    countTransfer (P, Octets);
+
+    return Octets;
+}
+
+
+// Card to host. The host clocks out 0xFF for each octet.
+static uint32_t dataOut (struct STREAM *const S, uint8_t *const Buffer,
+                         const uint32_t Octets)
+{
+    struct STREAM_SD_SPI_SIM *const P = (struct STREAM_SD_SPI_SIM *) S;
+
+    uint32_t i = 0;
+
+    while (i < Octets)
+    {
+        // Block data is copied whole, leaving the last octet to output() so
+        // it can advance the state.
+        if (P->state == STREAM_SD_SPI_SIM_State_ReadData &&
+            !P->commandOctets && !P->responseCount &&
+            P->blockOffset + 1 < P->blockOctets + 2)
+        {
+            const uint32_t Left     = P->blockOctets + 1 - P->blockOffset;
+            const uint32_t Count    = (Octets - i < Left)? Octets - i : Left;
+
+            memcpy (&Buffer[i], &P->block[P->blockOffset], Count);
+            P->blockOffset  += Count;
+            i               += Count;
+            continue;
+        }
+
+        Buffer[i ++] = exchange (P, 0xFF);
+    }
+
+    countTransfer (P, Octets);
+
+    return Octets;
+}
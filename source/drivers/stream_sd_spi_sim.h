@@ -0,0 +1,159 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+  
+  [STREAM driver] sd card spi mode protocol simulator.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#pragma once
+
+#include "embedul.ar/source/core/device/stream.h"
+#include "embedul.ar/source/core/device/rawstor.h"
+
+
+// Card latencies of a typical SD card clocked at 14 MHz. The simulator has no
+// notion of time: latencies are given as octets the host has to clock out
+// before the card answers or goes ready. The backing RAWSTOR may add its own
+// media timing.
+#define STREAM_SD_SPI_SIM_TIMING_TYPICAL    { .responseOctets       = 1, \
+                                              .readAccessOctets     = 120, \
+                                              .writeBusyOctets      = 440, \
+                                              .preErasedBusyOctets  = 180, \
+                                              .stopBusyOctets       = 60, \
+                                              .eraseBusyOctets      = 4000, \
+                                              .initRetries          = 4 }
+
+
+struct STREAM_SD_SPI_SIM_Timing
+{
+    // NCR: the response comes in this octet after the command, 1 to 8
+    uint32_t    responseOctets;
+    // NAC: octets before each read data token
+    uint32_t    readAccessOctets;
+    // Busy octets after a write data response. Blocks announced by ACMD23
+    // before a multiple block write were pre-erased and program faster.
+    uint32_t    writeBusyOctets;
+    uint32_t    preErasedBusyOctets;
+    // Busy octets after a STOP_TRAN token or CMD12 and after CMD38.
+    uint32_t    stopBusyOctets;
+    uint32_t    eraseBusyOctets;
+    // ACMD41 answered "idle" this many times before initialization completes
+    uint32_t    initRetries;
+};
+
+
+enum STREAM_SD_SPI_SIM_Card
+{
+    // SD version 2, block addressed (SDHC, SDXC). Needs 1024 sectors or more.
+    STREAM_SD_SPI_SIM_Card_SdV2BlockAddressing = 0,
+    // SD version 2, byte addressed (SDSC). Up to 2 GiB.
+    STREAM_SD_SPI_SIM_Card_SdV2,
+    // SD version 1, byte addressed. Rejects CMD8. Up to 2 GiB.
+    STREAM_SD_SPI_SIM_Card_SdV1
+};
+
+
+enum STREAM_SD_SPI_SIM_State
+{
+    // Waiting for a command
+    STREAM_SD_SPI_SIM_State_Command = 0,
+    // NAC octets, then a data token
+    STREAM_SD_SPI_SIM_State_ReadAccess,
+    STREAM_SD_SPI_SIM_State_ReadData,
+    // Waiting for a start block or STOP_TRAN token
+    STREAM_SD_SPI_SIM_State_WriteToken,
+    STREAM_SD_SPI_SIM_State_WriteData,
+    STREAM_SD_SPI_SIM_State_Busy
+};
+
+
+struct STREAM_SD_SPI_SIM_Stats
+{
+    uint32_t    commands;
+    // Included in commands
+    uint32_t    appCommands;
+    uint32_t    rejectedCommands;
+    uint32_t    blocksRead;
+    uint32_t    blocksWritten;
+    // Included in blocksWritten
+    uint32_t    blocksPreErased;
+    // Read error tokens and rejected write blocks
+    uint32_t    dataErrors;
+    // DataIn and DataOut calls
+    uint32_t    transfers;
+    // Octets clocked by the host, including busy and access octets
+    uint64_t    octets;
+    uint64_t    busyOctets;
+    // Time taken by those octets at the bus speed set when clocked
+    uint64_t    busUs;
+};
+
+
+// Chip select is not observed: commands are recognized by their start bits
+// wherever the card would accept them, and data phases are left with CMD0 or
+// CMD12. Read data CRC is sent as 0xFFFF and write data CRC is not checked,
+// as with CRC off, the SPI mode default. CMD0 and CMD8 CRC is checked.
+struct STREAM_SD_SPI_SIM
+{
+    struct STREAM                   device;
+    struct RAWSTOR                  * media;
+    enum STREAM_SD_SPI_SIM_Card     card;
+    struct STREAM_SD_SPI_SIM_Timing timing;
+    uint32_t                        sectorCount;
+    uint32_t                        speed;
+    enum STREAM_SD_SPI_SIM_State    state;
+    enum STREAM_SD_SPI_SIM_State    busyNext;
+    bool                            idle;
+    bool                            appCommand;
+    uint32_t                        initRetries;
+    uint8_t                         command[6];
+    uint8_t                         commandOctets;
+    // Response octets waiting to be clocked out, before the state octets
+    uint8_t                         response[16];
+    uint8_t                         responseHead;
+    uint8_t                         responseCount;
+    // Octets left in the current access or busy phase
+    uint32_t                        phaseOctets;
+    // Data block being transferred, CRC included
+    uint8_t                         block[RAWSTOR_SECTOR_SIZE + 2];
+    uint32_t                        blockOffset;
+    uint32_t                        blockOctets;
+    bool                            readSectors;
+    bool                            multiple;
+    uint32_t                        sector;
+    // Blocks announced by ACMD23 for the next multiple block write
+    uint32_t                        preErase;
+    uint32_t                        eraseBegin;
+    uint32_t                        eraseEnd;
+    uint64_t                        busNs;
+    struct STREAM_SD_SPI_SIM_Stats  stats;
+};
+
+
+void    STREAM_SD_SPI_SIM_Init      (struct STREAM_SD_SPI_SIM *const S,
+                                     struct RAWSTOR *const Media,
+                                     const enum STREAM_SD_SPI_SIM_Card Card,
+                        const struct STREAM_SD_SPI_SIM_Timing *const Timing);
+void    STREAM_SD_SPI_SIM_SetTiming (struct STREAM_SD_SPI_SIM *const S,
+                        const struct STREAM_SD_SPI_SIM_Timing *const Timing);
+struct STREAM_SD_SPI_SIM_Stats
+        STREAM_SD_SPI_SIM_Stats     (struct STREAM_SD_SPI_SIM *const S);
@@ -0,0 +1,625 @@
+/*
+  embedul.ar™ embedded systems framework - http://embedul.ar
+
+  Host tool: builds the STORAGE linear cache partition of a disk image.
+
+  Copyright 2018-2022 Santiago Germino
+  <sgermino@embedul.ar> https://www.linkedin.com/in/royconejo
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+/*
+    Reads filesystem slots from the FAT32 partition (MBR partition 1) of a
+    disk image and writes them as cached elements to the linear cache
+    partition (MBR partition 2, type 0xDA), exactly as cache.c would do on
+    first boot: element data, element info sectors, manifest and sector 0.
+    Slot files are read through FatFs, so file dates and times recorded in
+    the cache match the ones the target will find.
+
+    Built and run by the "cache-image" make target, which passes the same
+    version strings and STORAGE_CACHE configuration as the firmware build.
+*/
+
+#include "embedul.ar/source/core/manager/storage/cache_layout.h"
+#include "embedul.ar/source/core/misc/crc32c.h"
+#include "embedul.ar/source/core/misc/rle.h"
+#include "ff.h"
+#include "diskio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#if !defined(CC_VcsFwkVersionStr) || !defined(CC_VcsAppVersionStr) || \
+    !defined(CC_AppNameStr)
+    #error Undefined framework or application version strings
+#endif
+
+#if !defined(LIB_EMBEDULAR_STORAGE_CACHE_FS_FRAMEWORK_DIR) || \
+    !defined(LIB_EMBEDULAR_STORAGE_CACHE_FS_APPLICATION_DIR)
+    #error Undefined filesystem cache directories
+#endif
+
+#if !defined(LIB_EMBEDULAR_CONFIG_STORAGE_CACHE_INDEX_ELEMENTS) || \
+    !defined(LIB_EMBEDULAR_CONFIG_STORAGE_CACHE_COMPRESSION)
+    #error Undefined STORAGE_CACHE configuration
+#endif
+
+
+#define MBR_PART_TYPE_W95_FAT32_LBA     0x0C
+#define MBR_PART_TYPE_NO_FS_DATA        0xDA
+
+// Values of enum STORAGE_CACHE_Encoding
+#define CACHE_ENCODING_RAW              0
+#define CACHE_ENCODING_RLE              1
+
+
+// FatFs volume 0: physical drive 0 (the image), MBR partition 1.
+PARTITION VolToPart[FF_VOLUMES] =
+{
+    {0, 1},
+    {0xFF, 0xFF}
+};
+
+
+struct CacheImage
+{
+    FILE        * image;
+    uint32_t    imageSectors;
+    // Linear cache partition, in image sectors
+    uint32_t    cacheBegin;
+    uint32_t    cacheSectors;
+    // Last element data sector, partition relative
+    uint32_t    sectorEnd;
+    uint32_t    elementCount;
+    uint8_t     manifest[CACHE_MANIFEST_SECTORS][512];
+};
+
+
+static struct CacheImage s_ci;
+
+
+static void putU16 (uint8_t *const Data, const uint16_t Value)
+{
+    Data[0] = (uint8_t) Value;
+    Data[1] = (uint8_t)(Value >> 8);
+}
+
+
+static void putU32 (uint8_t *const Data, const uint32_t Value)
+{
+    Data[0] = (uint8_t) Value;
+    Data[1] = (uint8_t)(Value >> 8);
+    Data[2] = (uint8_t)(Value >> 16);
+    Data[3] = (uint8_t)(Value >> 24);
+}
+
+
+static uint32_t getU32 (const uint8_t *const Data)
+{
+    return (uint32_t)Data[0] | (uint32_t)Data[1] << 8 |
+           (uint32_t)Data[2] << 16 | (uint32_t)Data[3] << 24;
+}
+
+
+static void sealSector (uint8_t sectorData[static 512])
+{
+    // Sector CRC32 is computed with 0 in the CRC32 field.
+    putU32 (&sectorData[512-4], 0);
+    putU32 (&sectorData[512-4], CRC32C_Update (0, sectorData, 512));
+}
+
+
+static int imageAccess (uint8_t *const Data, const uint32_t Sector,
+                        const uint32_t Count, const int Write)
+{
+    if ((uint64_t)Sector + Count > s_ci.imageSectors)
+    {
+        return -1;
+    }
+
+    if (fseek (s_ci.image, (long)Sector * 512, SEEK_SET))
+    {
+        return -1;
+    }
+
+    const size_t Done = (Write)? fwrite (Data, 512, Count, s_ci.image) :
+                                 fread (Data, 512, Count, s_ci.image);
+
+    return (Done == Count)? 0 : -1;
+}
+
+
+static int cacheWrite (const uint8_t *const Data, const uint32_t Sector)
+{
+    if (Sector >= s_ci.cacheSectors)
+    {
+        return -1;
+    }
+
+    return imageAccess ((uint8_t *)Data, s_ci.cacheBegin + Sector, 1, 1);
+}
+
+
+// FatFs disk access, read-only over the image file.
+DSTATUS disk_initialize (BYTE pdrv)
+{
+    return (pdrv || !s_ci.image)? STA_NOINIT : 0;
+}
+
+
+DSTATUS disk_status (BYTE pdrv)
+{
+    return (pdrv || !s_ci.image)? STA_NOINIT : 0;
+}
+
+
+DRESULT disk_read (BYTE pdrv, BYTE *buff, LBA_t sector, UINT count)
+{
+    if (pdrv)
+    {
+        return RES_PARERR;
+    }
+
+    return imageAccess (buff, sector, count, 0)? RES_ERROR : RES_OK;
+}
+
+
+DRESULT disk_write (BYTE pdrv, const BYTE *buff, LBA_t sector, UINT count)
+{
+    (void) pdrv;
+    (void) buff;
+    (void) sector;
+    (void) count;
+
+    return RES_WRPRT;
+}
+
+
+DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void *buff)
+{
+    if (pdrv)
+    {
+        return RES_PARERR;
+    }
+
+    switch (cmd)
+    {
+        case CTRL_SYNC:
+            return RES_OK;
+
+        case GET_SECTOR_COUNT:
+            *((LBA_t *)buff) = s_ci.imageSectors;
+            return RES_OK;
+
+        case GET_SECTOR_SIZE:
+            *((WORD *)buff) = 512;
+            return RES_OK;
+
+        case GET_BLOCK_SIZE:
+            *((DWORD *)buff) = 1;
+            return RES_OK;
+    }
+
+    return RES_PARERR;
+}
+
+
+static int openImage (const char *const Filepath)
+{
+    s_ci.image = fopen (Filepath, "r+b");
+
+    if (!s_ci.image)
+    {
+        fprintf (stderr, "cannot open '%s'\n", Filepath);
+        return -1;
+    }
+
+    if (fseek (s_ci.image, 0, SEEK_END))
+    {
+        return -1;
+    }
+
+    s_ci.imageSectors = (uint32_t)(ftell (s_ci.image) / 512);
+
+    uint8_t mbr[512];
+
+    if (imageAccess (mbr, 0, 1, 0) || mbr[510] != 0x55 || mbr[511] != 0xAA)
+    {
+        fprintf (stderr, "'%s' has no MBR\n", Filepath);
+        return -1;
+    }
+
+    // Same partitioning STORAGE expects: FAT32 on 1, linear cache on 2.
+    const uint8_t *const Part1 = &mbr[0x01BE];
+    const uint8_t *const Part2 = &mbr[0x01BE + 16];
+
+    if (Part1[0x04] != MBR_PART_TYPE_W95_FAT32_LBA ||
+        Part2[0x04] != MBR_PART_TYPE_NO_FS_DATA)
+    {
+        fprintf (stderr, "'%s' partition types are 0x%02X and 0x%02X, "
+                         "required 0x%02X and 0x%02X\n", Filepath,
+                         Part1[0x04], Part2[0x04],
+                         MBR_PART_TYPE_W95_FAT32_LBA,
+                         MBR_PART_TYPE_NO_FS_DATA);
+        return -1;
+    }
+
+    s_ci.cacheBegin     = getU32 (&Part2[0x08]);
+    s_ci.cacheSectors   = getU32 (&Part2[0x0C]);
+
+    if ((uint64_t)s_ci.cacheBegin + s_ci.cacheSectors > s_ci.imageSectors ||
+        s_ci.cacheSectors <= CACHE_MANIFEST_SECTORS + 1)
+    {
+        fprintf (stderr, "invalid linear cache partition\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int getSlot (const uint32_t Element, char filepath[static 64],
+                    FILINFO *const Fno)
+{
+    // Same slot to element mapping as getFilesystemSlotInfo() in cache.c
+    memset (filepath, 0, 64);
+
+    snprintf (filepath, 64, "%s%u/", (Element < CACHE_FWK_ELEMENTS)?
+                                LIB_EMBEDULAR_STORAGE_CACHE_FS_FRAMEWORK_DIR :
+                                LIB_EMBEDULAR_STORAGE_CACHE_FS_APPLICATION_DIR,
+                                Element);
+    FRESULT res;
+    DIR     dir;
+
+    if (f_opendir (&dir, filepath) != FR_OK)
+    {
+        // No more slots
+        return -1;
+    }
+
+    while ((res = f_readdir(&dir, Fno)) == FR_OK &&
+           Fno->fname[0] &&
+           Fno->fattrib & AM_DIR &&
+           !(Fno->fattrib & AM_ARC))
+    {
+    }
+
+    f_closedir (&dir);
+
+    if (res != FR_OK || !Fno->fname[0])
+    {
+        fprintf (stderr, "slot '%s' has no file\n", filepath);
+        return -1;
+    }
+
+    if (strlen (filepath) + strlen (Fno->fname) >= 64)
+    {
+        fprintf (stderr, "slot '%s' file path too long\n", filepath);
+        return -1;
+    }
+
+    strncat (filepath, Fno->fname, 13);
+
+    return 0;
+}
+
+
+static uint32_t pathHash (const char *const Filepath)
+{
+    uint32_t hash = CACHE_PATH_HASH_BASIS;
+
+    for (uint32_t i = 0; i < 64 && Filepath[i]; ++i)
+    {
+        hash ^= (uint8_t) Filepath[i];
+        hash *= CACHE_PATH_HASH_PRIME;
+    }
+
+    return hash;
+}
+
+
+static int readSlotFile (const char *const Filepath, uint8_t *const Data,
+                         const uint32_t Octets)
+{
+    FIL     file;
+    UINT    br;
+
+    if (f_open (&file, Filepath, FA_READ) != FR_OK)
+    {
+        return -1;
+    }
+
+    const FRESULT R = f_read (&file, Data, Octets, &br);
+
+    f_close (&file);
+
+    return (R == FR_OK && br == Octets)? 0 : -1;
+}
+
+
+/*
+    RLE encodes Data the way slotToRleData() does: in 512 octet blocks, as
+    read from the slot file. Returns encoded octets or 0 when compression
+    would not save at least one sector.
+*/
+static uint32_t encodeSlotData (const uint8_t *const Data,
+                                const uint32_t Octets,
+                                uint8_t *const Encoded,
+                                const uint32_t MaxEncodedOctets)
+{
+    uint32_t encodedOctets = 0;
+
+    for (uint32_t i = 0; i < Octets; i += 512)
+    {
+        const uint32_t Block = (Octets - i < 512)? Octets - i : 512;
+
+        encodedOctets += RLE_Encode (&Data[i], Block, &Encoded[encodedOctets]);
+
+        if (encodedOctets > MaxEncodedOctets)
+        {
+            return 0;
+        }
+    }
+
+    return encodedOctets;
+}
+
+
+static int writeElement (const uint32_t Element, const char *const Filepath,
+                         const FILINFO *const Fno)
+{
+    const uint32_t Octets       = (uint32_t) Fno->fsize;
+    const uint32_t SectorBegin  = s_ci.sectorEnd + 1;
+    uint32_t sectorEnd          = s_ci.sectorEnd + ((Octets & 511)?
+                                                        (Octets >> 9) + 1 :
+                                                        (Octets >> 9));
+    const uint32_t Blocks       = (Octets + 511) >> 9;
+
+    uint8_t *const Data     = malloc (Octets + 512);
+    uint8_t *const Encoded  = malloc (Blocks * RLE_ENCODE_BOUND(512) + 512);
+
+    if (!Data || !Encoded || readSlotFile (Filepath, Data, Octets))
+    {
+        fprintf (stderr, "cannot read '%s'\n", Filepath);
+        free (Data);
+        free (Encoded);
+        return -1;
+    }
+
+    uint32_t    encoding        = CACHE_ENCODING_RAW;
+    uint32_t    encodedOctets   = 0;
+    uint8_t     * stored        = Data;
+    uint32_t    storedOctets    = Octets;
+
+    // Single sector elements are not worth compressing.
+    if (LIB_EMBEDULAR_CONFIG_STORAGE_CACHE_COMPRESSION && Octets > 512)
+    {
+        encodedOctets = encodeSlotData (Data, Octets, Encoded,
+                                        (sectorEnd - SectorBegin) << 9);
+        if (encodedOctets)
+        {
+            encoding        = CACHE_ENCODING_RLE;
+            stored          = Encoded;
+            storedOctets    = encodedOctets;
+            sectorEnd       = SectorBegin + ((encodedOctets + 511) >> 9) - 1;
+        }
+    }
+
+    // Last data sector padded with zeros
+    memset (&stored[storedOctets], 0, 512 - (storedOctets & 511));
+
+    // Element info sectors advance backwards from partition end.
+    const uint32_t InfoSector = s_ci.cacheSectors - 1 - Element;
+
+    if (sectorEnd >= InfoSector)
+    {
+        fprintf (stderr, "linear cache partition full at '%s'\n", Filepath);
+        free (Data);
+        free (Encoded);
+        return -1;
+    }
+
+    uint32_t crc32 = 0;
+    int r = 0;
+
+    for (uint32_t s = SectorBegin; s <= sectorEnd && !r; ++s)
+    {
+        const uint8_t *const SectorData = &stored[(s - SectorBegin) << 9];
+
+        crc32   = CRC32C_Update (crc32, SectorData, 512);
+        r       = cacheWrite (SectorData, s);
+    }
+
+    free (Data);
+    free (Encoded);
+
+    if (r)
+    {
+        fprintf (stderr, "cannot write '%s' element data\n", Filepath);
+        return -1;
+    }
+
+    uint8_t sectorData[512];
+
+    memset (sectorData, 0, sizeof(sectorData));
+
+    putU32 (&sectorData[0], Fno->fdate);
+    putU32 (&sectorData[4], Fno->ftime);
+    putU32 (&sectorData[8], Octets);
+    putU32 (&sectorData[12], SectorBegin);
+    putU32 (&sectorData[16], sectorEnd);
+    putU32 (&sectorData[20], crc32);
+    memcpy (&sectorData[24], Filepath, 64);
+    putU32 (&sectorData[88], encoding);
+    putU32 (&sectorData[92], encodedOctets);
+    sealSector (sectorData);
+
+    if (cacheWrite (sectorData, InfoSector))
+    {
+        fprintf (stderr, "cannot write '%s' element info\n", Filepath);
+        return -1;
+    }
+
+    if (Element < LIB_EMBEDULAR_CONFIG_STORAGE_CACHE_INDEX_ELEMENTS)
+    {
+        uint8_t *const Entry =
+            &s_ci.manifest[Element / CACHE_MANIFEST_ENTRIES]
+                [(Element % CACHE_MANIFEST_ENTRIES) *
+                                            CACHE_MANIFEST_ENTRY_OCTETS];
+
+        putU32 (&Entry[0], Fno->fdate);
+        putU32 (&Entry[4], Fno->ftime);
+        putU32 (&Entry[8], Octets);
+        putU32 (&Entry[12], SectorBegin);
+        putU32 (&Entry[16], sectorEnd);
+        putU32 (&Entry[20], crc32);
+        putU32 (&Entry[24], pathHash (Filepath));
+        putU16 (&Entry[28], (uint16_t) encoding);
+        putU16 (&Entry[30], CACHE_MANIFEST_ENTRY_USED);
+    }
+
+    printf ("%3u %-40s %10u octets, sectors %u-%u (%s)\n", Element, Filepath,
+            Octets, SectorBegin, sectorEnd,
+            (encoding == CACHE_ENCODING_RLE)? "rle" : "raw");
+
+    s_ci.sectorEnd = sectorEnd;
+
+    return 0;
+}
+
+
+static int writeManifest (void)
+{
+    for (uint32_t sector = 0; sector < CACHE_MANIFEST_SECTORS; ++sector)
+    {
+        sealSector (s_ci.manifest[sector]);
+
+        if (cacheWrite (s_ci.manifest[sector], 1 + sector))
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+static int writeSector0 (void)
+{
+    uint8_t sectorData[512];
+
+    memset (sectorData, 0x00, sizeof(sectorData));
+
+    memcpy  ((char *)&sectorData[0], CACHE_SIGNATURE, 16);
+    strncpy ((char *)&sectorData[16], CC_VcsFwkVersionStr, 64);
+    strncpy ((char *)&sectorData[80], CC_AppNameStr, 64);
+    strncpy ((char *)&sectorData[144], CC_VcsAppVersionStr, 64);
+
+    putU32 (&sectorData[208], CACHE_MANIFEST_SECTORS);
+    putU32 (&sectorData[512-8], s_ci.elementCount);
+    sealSector (sectorData);
+
+    return cacheWrite (sectorData, 0);
+}
+
+
+int main (int argc, char *argv[])
+{
+    if (argc != 2)
+    {
+        fprintf (stderr, "usage: %s <disk image>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (openImage (argv[1]))
+    {
+        return EXIT_FAILURE;
+    }
+
+    FATFS fs;
+
+    if (f_mount (&fs, "0:", 1) != FR_OK)
+    {
+        fprintf (stderr, "cannot mount FAT32 partition\n");
+        fclose (s_ci.image);
+        return EXIT_FAILURE;
+    }
+
+    printf ("'%s' linear cache: %u sectors at %u, %s %s %s\n", argv[1],
+            s_ci.cacheSectors, s_ci.cacheBegin, CC_AppNameStr,
+            CC_VcsAppVersionStr, CC_VcsFwkVersionStr);
+
+    // Element data begins right after the manifest.
+    s_ci.sectorEnd = CACHE_MANIFEST_SECTORS;
+
+    uint8_t sectorData[512];
+
+    memset (sectorData, 0, sizeof(sectorData));
+
+    // Invalidate the current cache; sector 0 is written back last so that a
+    // failed run leaves no valid cache behind.
+    int r = cacheWrite (sectorData, 0);
+
+    if (r)
+    {
+        fprintf (stderr, "cannot write sector 0\n");
+    }
+
+    char filepath[64];
+    FILINFO fno;
+
+    while (!r && !getSlot (s_ci.elementCount, filepath, &fno))
+    {
+        if ((r = writeElement (s_ci.elementCount, filepath, &fno)))
+        {
+            break;
+        }
+
+        ++ s_ci.elementCount;
+    }
+
+    // Element info sectors of later elements must not overlap element data.
+    if (!r && s_ci.elementCount &&
+        s_ci.sectorEnd >= s_ci.cacheSectors - s_ci.elementCount)
+    {
+        fprintf (stderr, "linear cache partition full\n");
+        r = -1;
+    }
+
+    if (!r && (writeManifest () || writeSector0 ()))
+    {
+        fprintf (stderr, "cannot write cache manifest or sector 0\n");
+        r = -1;
+    }
+
+    f_mount (NULL, "0:", 0);
+
+    if (fclose (s_ci.image))
+    {
+        r = -1;
+    }
+
+    if (!r)
+    {
+        printf ("%u cached elements, %u sectors used\n", s_ci.elementCount,
+                s_ci.sectorEnd + 1 + s_ci.elementCount);
+    }
+
+    return (r)? EXIT_FAILURE : EXIT_SUCCESS;
+}